@@ -1,5 +1,11 @@
+#include <Arduino.h>
 #include <WiFi.h>
 #include <PubSubClient.h>
+#include <atomic>
+#include <sys/time.h>
+#include "esp_sleep.h"
+#include "esp_heap_caps.h"
+#include <metricas.h> // ESP32/libraries/Metricas
 
 // --- CONFIGURAÇÕES DE WI-FI ---
 const char* ssid = "GEORGE";
@@ -9,9 +15,18 @@ const char* password = "gege1234";
 const char* mqtt_server = "broker.hivemq.com"; // Broker público gratuito
 const int mqtt_port = 1883;
 
+// Nome deste sensor no dashboard. Com vários ESP32, dê um nome diferente a
+// cada um (ex.: "chuva/quintal"): o dashboard assina george/sensor/# e cria
+// um gráfico para cada tópico novo.
+#define DISPOSITIVO "chuva"
+
 // Tópicos
-const char* topic_publish = "george/sensor/chuva"; 
+const char* topic_publish = "george/sensor/" DISPOSITIVO;
 const char* topic_subscribe = "george/sensor/led";
+const char* topic_resposta = "george/sensor/led/ack"; // Confirmação dos comandos
+const char* topic_pedido = "george/sensor/historico/pedido"; // Dashboard pedindo o histórico
+const char* topic_historico = "george/sensor/" DISPOSITIVO "/historico"; // Resposta ao pedido
+const char* topic_stats = "george/sensor/" DISPOSITIVO "/stats"; // Métricas (ver publicarMetricas)
 
 // --- PINOS ---
 const int pinoSensor = 36; // VP
@@ -20,103 +35,1214 @@ const int pinoLED = 26;
 WiFiClient espClient;
 PubSubClient client(espClient);
 
-// Variáveis de tempo (para não usar delay)
-unsigned long lastMsg = 0;
-#define MSG_INTERVAL 2000 // Enviar dados a cada 2 segundos
+#define MSG_INTERVAL 2000 // Ler o sensor a cada 2 segundos
+// Período em uso (ms), muda por comando. Fica na RTC como os outros ajustes:
+// MSG_INTERVAL só vale no boot a frio.
+RTC_DATA_ATTR std::atomic<uint32_t> intervaloAmostragem(MSG_INTERVAL);
+
+// --- GERENCIADOR DE CONEXÃO (MÁQUINA DE ESTADOS) ---
+// A tarefa de rede chama gerenciarConexao() a cada volta e ela nunca fica esperando:
+// cada estado só confere se já pode avançar. Falhas seguidas aumentam o tempo
+// até a próxima tentativa (backoff exponencial) com um sorteio (jitter) para
+// vários sensores não tentarem todos no mesmo instante.
+enum EstadoConexao { SEM_WIFI, CONECTANDO_WIFI, SEM_MQTT, CONECTADO };
+EstadoConexao estado = SEM_WIFI;
+
+unsigned long proximaTentativa = 0; // millis() da próxima tentativa
+unsigned long inicioWifi = 0;       // millis() do WiFi.begin() em andamento
+uint8_t falhasSeguidas = 0;
+
+#define WIFI_TIMEOUT 15000 // ms esperando associar antes de desistir da tentativa
+#define BACKOFF_BASE 500   // ms de espera após a 1ª falha
+#define BACKOFF_MAX 60000  // ms (teto do backoff)
+
+// --- BUFFER DE AMOSTRAS (STORE-AND-FORWARD) ---
+// Toda leitura entra primeiro nesta fila. Se o broker cair, as leituras
+// continuam sendo guardadas e, quando a conexão volta, são enviadas
+// da mais antiga para a mais nova. Assim nenhuma amostra se perde.
+struct Amostra {
+  uint32_t instante; // relogioMs() no momento da leitura
+  int16_t valor;     // nivelChuva (0-4095)
+};
+
+// Fila circular (ring buffer) de tamanho fixo
+struct FilaAmostras {
+  Amostra* dados;
+  uint16_t capacidade;
+  uint16_t inicio;     // posição da amostra mais antiga
+  uint16_t quantidade; // quantas amostras estão guardadas
+};
+
+// 1ª camada: RAM comum (2048 amostras = ~68 min a cada 2 s)
+#define TAM_FILA_RAM 2048
+Amostra bufferRam[TAM_FILA_RAM];
+FilaAmostras filaRam = { bufferRam, TAM_FILA_RAM, 0, 0 };
+
+// 2ª camada (transbordo): RTC slow memory (512 amostras = ~17 min a mais).
+// Recebe as amostras mais antigas quando a RAM enche.
+#define TAM_FILA_RTC 512
+RTC_DATA_ATTR Amostra bufferRtc[TAM_FILA_RTC];
+RTC_DATA_ATTR FilaAmostras filaRtc = { bufferRtc, TAM_FILA_RTC, 0, 0 };
+
+// Só chega aqui se as duas camadas encherem (queda maior que ~85 min)
+RTC_DATA_ATTR unsigned long amostrasPerdidas = 0;
+
+// Drenagem com limite de taxa para não afogar o broker ao reconectar
+#define DRENO_INTERVALO 100 // ms entre rodadas de envio
+#define DRENO_POR_RODADA 10 // máximo de mensagens por rodada (100 msg/s)
+
+// --- MODO LOTE (VÁRIAS AMOSTRAS POR MENSAGEM) ---
+// Lote de 1 mantém o formato texto "valor;idade" (uma mensagem por leitura).
+// Lote > 1 junta as leituras em um único quadro binário:
+//
+//   byte 0     : 0xB1 (marcador do quadro, nunca é um caractere de texto)
+//   byte 1     : n (quantidade de amostras)
+//   bytes 2-3  : período entre amostras em ms (uint16)
+//   bytes 4-7  : idade da 1ª amostra em ms no momento do envio (uint32)
+//   bytes 8-9  : valor da 1ª amostra (int16)
+//   bytes 10.. : n-1 diferenças para a amostra anterior (int16)
+//
+// Todos os campos são little-endian. O quadro sai quando enche OU quando a
+// amostra mais antiga esperou BATCH_MAX_LATENCY (os dois ajustes são independentes).
+// BATCH_SIZE é o tamanho máximo; o tamanho em uso (tamanhoLote) começa em
+// LOTE_PADRAO e muda por comando (ex.: "B=16"). O padrão é 1: o gráfico ao vivo
+// continua recebendo uma leitura a cada 2 s, como antes do modo lote. O tamanho
+// em uso fica na RTC para valer também entre os ciclos de deep sleep.
+#define BATCH_SIZE 16
+#define LOTE_PADRAO 1
+#define BATCH_MAX_LATENCY 30000 // ms
+#define QUADRO_MARCADOR 0xB1
+#define QUADRO_CABECALHO 8
+static_assert(BATCH_SIZE >= 1 && BATCH_SIZE <= 100, "BATCH_SIZE precisa caber no buffer do PubSubClient (256 bytes)");
+static_assert(LOTE_PADRAO >= 1 && LOTE_PADRAO <= BATCH_SIZE, "LOTE_PADRAO vai de 1 a BATCH_SIZE");
+RTC_DATA_ATTR uint8_t tamanhoLote = LOTE_PADRAO;
+
+// --- HISTÓRICO PARA O DASHBOARD (BACKFILL) ---
+// Ao abrir, o dashboard publica em topic_pedido (payload opcional: quantas
+// amostras quer, em texto). O sensor responde em topic_historico com as
+// últimas leituras (todas, mesmo as suprimidas pelo envio por exceção) em um
+// único bloco comprimido, e o gráfico já nasce com a última meia hora desenhada:
+//
+//   byte 0     : 0xB2 (marcador do bloco)
+//   bytes 1-2  : n (quantidade de amostras, uint16)
+//   bytes 3-6  : idade da amostra mais antiga em ms no momento do envio (uint32)
+//   depois, para cada amostra da mais antiga para a mais nova, dois varints zigzag:
+//     - variação do intervalo (intervalo desta amostra - intervalo da anterior)
+//     - variação do valor (valor desta amostra - valor da anterior)
+//
+// Com período constante a variação do intervalo é 0, e a chuva muda devagar:
+// quase toda amostra cabe em 2 bytes (contra 8 a 10 no formato texto).
+// Varint = 7 bits por byte, bit mais alto ligado se vier outro byte.
+// Zigzag = 0, -1, 1, -2, ... viram 0, 1, 2, 3, ... (números pequenos, bytes poucos).
+#define TAM_HISTORICO 1024 // ~34 min a cada 2 s (8 KB de RAM)
+#define HISTORICO_MARCADOR 0xB2
+#define HISTORICO_CABECALHO 7
+Amostra bufferHistorico[TAM_HISTORICO];
+FilaAmostras filaHistorico = { bufferHistorico, TAM_HISTORICO, 0, 0 };
+uint16_t pedidoHistorico = 0; // amostras pedidas pelo dashboard (0 = nenhum pedido)
+
+// --- CANAL DE COMANDOS (george/sensor/led) ---
+// Interpretado direto no buffer do PubSubClient, sem String e sem malloc.
+// Formato texto: "1" / "0" (LED, como antes) ou pares chave=valor separados
+// por ';' ',' ou espaço, ex.: "I=5000;B=8;D=30;L=1". Formato binário: byte
+// COMANDO_MARCADOR seguido de blocos [chave (1 byte)][valor uint32 little-endian].
+//   I = intervalo de amostragem (ms)     B = tamanho do lote (1-BATCH_SIZE)
+//   D = deadband absoluto (LSB)          P = deadband percentual (%)
+//   T = limite de taxa (LSB/s)           H = heartbeat (s)
+//   E = envio por exceção (0/1)          L = LED (0/1)
+// Ou todos os valores são válidos e aplicados, ou nenhum é. A resposta vai para
+// topic_resposta: "ok I=... B=..." com a configuração em uso, ou "erro X".
+#define COMANDO_MARCADOR 0xC3
+#define INTERVALO_MIN 500   // ms
+#define INTERVALO_MAX 65535 // ms: o período vai em 16 bits no quadro do modo lote
+
+struct Configuracao {
+  uint32_t intervalo;
+  uint8_t lote;
+  uint16_t deadbandAbs;
+  uint8_t deadbandPct;
+  uint16_t taxa;
+  uint32_t heartbeat; // ms
+  bool excecao;
+  bool led;
+};
+bool estadoLed = false;
+
+// Heap: o firmware não deveria alocar depois do setup(). O relatório mostra a
+// memória livre, o maior bloco contínuo e a fragmentação (100% - maior bloco / livre);
+// menorBlocoHeap é o pior valor desde o boot e não pode cair com o tempo.
+uint32_t menorBlocoHeap = UINT32_MAX;
+
+// --- ENVIO POR EXCEÇÃO (DEADBAND + HEARTBEAT) ---
+// Com modoExcecao ligado, uma leitura só vai para a fila de envio se:
+//   - sair da faixa morta em torno do último valor enviado (o maior entre
+//     deadbandAbsoluto e deadbandPercentual % desse valor), ou
+//   - variar pelo menos limiteTaxa LSB/s desde a leitura anterior (início de
+//     chuva é enviado na hora, sem esperar o lote encher), ou
+//   - já tiver passado heartbeatMs desde o último envio (sinal de vida).
+// As demais são descartadas e contadas como suprimidas.
+// Os ajustes e o estado ficam na RTC para continuar valendo entre ciclos de
+// deep sleep: os valores abaixo só são carregados no boot a frio (ligar ou
+// reset); depois de um despertar continua valendo o último comando recebido.
+// Começa desligado (um envio por leitura, como antes); liga com o comando "E=1".
+RTC_DATA_ATTR bool modoExcecao = false;
+RTC_DATA_ATTR uint16_t deadbandAbsoluto = 40;  // LSB
+RTC_DATA_ATTR uint8_t deadbandPercentual = 2;  // %
+RTC_DATA_ATTR uint16_t limiteTaxa = 100;       // LSB/s; 0 desliga o envio por taxa ("T=0")
+RTC_DATA_ATTR uint32_t heartbeatMs = 300000;   // 5 min
+
+RTC_DATA_ATTR Amostra ultimaEnviada; // última leitura que entrou na fila de envio
+RTC_DATA_ATTR Amostra ultimaLida;    // leitura anterior (para a taxa de variação)
+RTC_DATA_ATTR bool temReferencia = false;
+bool enviarJa = false; // há uma mudança na fila: não esperar o lote encher
+
+RTC_DATA_ATTR unsigned long suprimidas = 0;
+RTC_DATA_ATTR unsigned long enviadasDeadband = 0;
+RTC_DATA_ATTR unsigned long enviadasTaxa = 0;
+RTC_DATA_ATTR unsigned long enviadasHeartbeat = 0;
+
+// --- MODO DEEP SLEEP (NÓS A BATERIA) ---
+// Com MODO_DEEP_SLEEP 1 o ESP32 não fica acordado: a cada DEEP_SLEEP_INTERVALO
+// ele acorda pelo timer da RTC, lê o sensor e guarda a amostra na fila da RTC
+// (que sobrevive ao deep sleep). Só a cada DEEP_SLEEP_K despertares ele liga o
+// Wi-Fi, publica tudo de uma vez e volta a dormir. Para conectar rápido, o
+// BSSID, o canal e o IP recebido por DHCP ficam guardados na RTC: nas próximas
+// vezes não há varredura de canais nem DHCP (IP estático).
+// Nesse modo o período é sempre DEEP_SLEEP_INTERVALO e o comando "I=" é recusado.
+#ifndef MODO_DEEP_SLEEP
+#define MODO_DEEP_SLEEP 0
+#endif
+#define DEEP_SLEEP_INTERVALO 60000   // ms entre leituras
+#define DEEP_SLEEP_K 10              // conecta a cada 10 leituras (10 min)
+#define DEEP_SLEEP_WIFI_TIMEOUT 8000 // ms; se estourar, o cache é descartado
+#define DEEP_SLEEP_ENVIO_TIMEOUT 5000 // ms máximos publicando a fila
+
+struct RedeCache {
+  bool valido;
+  uint8_t bssid[6];
+  int32_t canal;
+  uint32_t ip, gateway, mascara, dns;
+};
+RTC_DATA_ATTR RedeCache redeCache;
+RTC_DATA_ATTR uint32_t despertares = 0;
+RTC_DATA_ATTR uint32_t ultimoTempoAcordado = 0; // ms acordado no ciclo anterior
+
+// --- DIVISÃO EM DOIS NÚCLEOS ---
+// Núcleo 1: tarefaAmostragem, acordada pelo ADC (blocos de DMA) e por um timer de
+//           hardware a cada MSG_INTERVAL. Filtra o sinal e entrega uma amostra por
+//           período na fila SPSC; nunca espera pela rede.
+// Núcleo 0: tarefaRede (o mesmo núcleo da pilha Wi-Fi/TCP). Conexão, fila
+//           store-and-forward, publish e Serial. Se a rede travar, a leitura
+//           continua saindo no horário.
+#define NUCLEO_AMOSTRAGEM 1
+#define NUCLEO_REDE 0
+TaskHandle_t tarefaAmostragemHandle = NULL;
+hw_timer_t* timerAmostragem = NULL;
+
+// Motivos para acordar a tarefa de amostragem (bits da notificação)
+#define AVISO_BLOCO_ADC (1 << 0) // o DMA terminou um bloco de conversões
+#define AVISO_PERIODO (1 << 1)   // o timer fechou um período de MSG_INTERVAL
+
+// --- ADC CONTÍNUO (DMA) E FILTRO DECIMADOR ---
+// Em vez de um analogRead() isolado a cada 2 s, o ADC converte sem parar via DMA:
+//   1) ADC a ADC_FREQUENCIA; o driver entrega a média de cada bloco de
+//      ADC_CONVERSOES_POR_BLOCO conversões (boxcar + decimação, 100 blocos/s)
+//   2) Mediana móvel de FILTRO_MEDIANA blocos (remove picos isolados; 1 = desliga)
+//   3) Média de todos os blocos do período -> um valor limpo por MSG_INTERVAL
+// No ESP32 clássico o modo contínuo não aceita menos de 20 kHz.
+#define ADC_FREQUENCIA 20000         // Hz
+#define ADC_CONVERSOES_POR_BLOCO 200 // 20000 / 200 = 100 blocos por segundo
+#define FILTRO_MEDIANA 5             // tamanho da janela da mediana (ímpar)
+#define FILTRO_LOTE 10               // blocos por sub-média, para estimar o ruído do valor final
+
+struct FiltroChuva {
+  int janela[FILTRO_MEDIANA]; // últimos blocos, para a mediana
+  uint8_t posicao;
+  uint8_t preenchidos;
+  // Estatística do período (algoritmo de Welford: média e variância em uma passada)
+  uint32_t n;
+  float media;
+  float m2;
+  int minimo;
+  int maximo;
+  // Sub-médias de FILTRO_LOTE blocos: a mediana deixa blocos vizinhos parecidos,
+  // então o ruído do valor final sai da variação entre sub-médias, não entre blocos
+  float somaLote;
+  uint32_t nLotes;
+  float mediaLotes;
+  float m2Lotes;
+};
+FiltroChuva filtro;
+
+// Estatísticas do último período, lidas pela tarefa de rede para o relatório
+std::atomic<float> ruidoBloco(0);      // desvio padrão entre blocos (LSB)
+std::atomic<float> bitsEfetivos(0);    // resolução efetiva do valor publicado
+std::atomic<uint32_t> blocosPorPeriodo(0);
+std::atomic<uint32_t> picoAPico(0);    // LSB
+std::atomic<uint32_t> periodosSemAdc(0); // períodos sem nenhum bloco do DMA (amostra não gerada)
+
+// Fila SPSC (um produtor, um consumidor) sem trava: cada índice só é
+// alterado por uma das tarefas, então basta a ordem de memória dos atomics.
+#define TAM_SPSC 64 // potência de 2 (64 leituras = ~2 min de rede parada)
+Amostra filaSpsc[TAM_SPSC];
+std::atomic<uint32_t> spscEscrita(0); // só a tarefa de amostragem altera
+std::atomic<uint32_t> spscLeitura(0); // só a tarefa de rede altera
+std::atomic<uint32_t> spscPico(0);     // maior ocupação desde o boot (high-water mark)
+std::atomic<uint32_t> spscDescartes(0); // leituras perdidas com a fila SPSC cheia
+
+// --- TEMPOS POR ETAPA ---
+// Máximos desde o último relatório, impresso a cada RELATORIO_TEMPOS.
+// Os dois primeiros são escritos no núcleo 1 e lidos/zerados no núcleo 0.
+#define RELATORIO_TEMPOS 10000 // ms
+std::atomic<uint32_t> maxDesvioTimer(0); // us: diferença entre leituras seguidas e MSG_INTERVAL
+std::atomic<uint32_t> maxLeituraAdc(0);  // us: leitura de um bloco do DMA + filtro
+uint32_t maxEsperaSpsc = 0;  // ms: da leitura até a tarefa de rede retirar da fila SPSC
+uint32_t maxVoltaRede = 0;   // us: uma volta completa da tarefa de rede
+uint32_t maxPublicacao = 0;  // us: uma rodada de drenarFila()
+unsigned long ultimoRelatorio = 0;
+
+// --- MÉTRICAS (metricas.h) ---
+// O relatório acima mostra só o máximo de cada janela. Aqui ficam a distribuição
+// dos tempos (histogramas) e contadores desde o boot, publicados no tópico
+// george/sensor/<DISPOSITIVO>/stats a cada INTERVALO_METRICAS, no formato texto
+// do Prometheus. O dashboard ignora este tópico; um coletor pode assiná-lo.
+#define INTERVALO_METRICAS 60000 // ms
+#define TAM_TEXTO_METRICAS 4096  // bytes (o texto completo tem ~2,7 KB)
+const uint32_t LIMITES_US[] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000 };
+Histograma metricaVoltaRede("chuva_rede_volta_us", "Uma volta da tarefa de rede (us)", LIMITES_US);
+Histograma metricaBlocoAdc("chuva_adc_bloco_us", "Leitura de um bloco do DMA do ADC + filtro (us)", LIMITES_US);
+Histograma metricaPublicacao("chuva_mqtt_publicacao_us", "Uma rodada de publicacao da fila no broker (us)", LIMITES_US);
+Contador metricaConexoes("chuva_mqtt_conexoes_total", "Conexoes MQTT feitas desde o boot (a primeira + reconexoes)");
+Contador metricaFalhasMqtt("chuva_mqtt_falhas_total", "Tentativas de conexao MQTT que falharam");
+Medidor metricaHeapLivre("chuva_heap_livre_bytes", "Heap livre",
+                         []() -> int32_t { return heap_caps_get_free_size(MALLOC_CAP_8BIT); });
+Medidor metricaMaiorBloco("chuva_heap_maior_bloco_bytes", "Maior bloco livre do heap",
+                          []() -> int32_t { return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); });
+
+// --- PROTÓTIPOS ---
+// A IDE do Arduino gera estas declarações sozinha, mas com elas o sketch também
+// compila como C++ comum (ex.: copiado para um .cpp em um build no PC com
+// versões de mentira de WiFi, PubSubClient e das funções do ESP32).
+void IRAM_ATTR aoDispararTimer();
+void IRAM_ATTR aoTerminarBlocoAdc();
+void tarefaAmostragem(void* parametro);
+void tarefaRede(void* parametro);
+
+void callback(char* topic, byte* payload, unsigned int length);
+Configuracao configuracaoAtual();
+bool definirValor(Configuracao& c, char chave, uint32_t v);
+char interpretarComando(const byte* p, unsigned int n, Configuracao& c);
+void aplicarConfiguracao(const Configuracao& c);
+
+void gerenciarConexao();
+void agendarNovaTentativa();
+bool reconnect();
+void relatorioTempos();
+void registrarMaximo(std::atomic<uint32_t>& maximo, uint32_t valor);
+
+void filtroReiniciar();
+void filtroEntrada(int bloco);
+bool filtroFecharPeriodo(int* valor);
+bool spscEmpilhar(const Amostra& a);
+bool spscRetirar(Amostra& a);
+
+uint32_t relogioMs();
+void cicloDeepSleep();
+bool conectarWifiRapido();
+bool deveEnviar(const Amostra& a);
+
+bool filaCheia(const FilaAmostras& f);
+void filaInserir(FilaAmostras& f, const Amostra& a);
+Amostra filaRetirar(FilaAmostras& f);
+void guardarAmostra(const Amostra& a);
+void guardarAmostraRtc(const Amostra& a);
+uint16_t totalNaFila();
+const Amostra& amostraNaFila(uint16_t i);
+void descartarDaFila(uint16_t n);
+void escreveU16(uint8_t* p, uint16_t v);
+void escreveU32(uint8_t* p, uint32_t v);
+uint16_t montarQuadro(uint8_t* quadro, size_t* tamanho, unsigned long agora);
+void drenarFila();
+uint8_t* escreveVarint(uint8_t* p, int32_t v);
+size_t codificarHistorico(uint16_t primeiro, bool enviar);
+void responderHistorico();
+void publicarMetricas();
 
 void setup() {
   Serial.begin(115200);
-  pinMode(pinoSensor, INPUT);
   pinMode(pinoLED, OUTPUT);
 
-  setup_wifi();
-  
+  if (MODO_DEEP_SLEEP) cicloDeepSleep(); // Não retorna: termina em deep sleep
+
+  // A reconexão do Wi-Fi fica por conta do gerenciador de conexão
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(false);
+
   // Configura o servidor MQTT
   client.setServer(mqtt_server, mqtt_port);
   client.setCallback(callback); // Define a função que roda quando chega mensagem
+
+  // Tempo máximo (s) que uma tentativa de conexão MQTT pode segurar o loop
+  espClient.setTimeout(2);
+  client.setSocketTimeout(2);
+
+  xTaskCreatePinnedToCore(tarefaRede, "rede", 8192, NULL, 1, NULL, NUCLEO_REDE);
+  xTaskCreatePinnedToCore(tarefaAmostragem, "amostragem", 4096, NULL, 5, &tarefaAmostragemHandle, NUCLEO_AMOSTRAGEM);
+
+  // ADC em modo contínuo (12 bits, 0-3,3 V) no pino do sensor
+  const uint8_t pinosAdc[] = { pinoSensor };
+  analogContinuousSetWidth(12);
+  analogContinuousSetAtten(ADC_11db);
+  analogContinuous(pinosAdc, 1, ADC_CONVERSOES_POR_BLOCO, ADC_FREQUENCIA, &aoTerminarBlocoAdc);
+  analogContinuousStart();
+
+  // Timer de hardware com tick de 1 us disparando a cada MSG_INTERVAL (auto-reload)
+  timerAmostragem = timerBegin(1000000);
+  timerAttachInterrupt(timerAmostragem, &aoDispararTimer);
+  timerAlarm(timerAmostragem, (uint64_t)intervaloAmostragem.load() * 1000, true, 0);
 }
 
 void loop() {
-  // Garante que o MQTT está conectado
-  if (!client.connected()) {
-    reconnect();
+  // Todo o trabalho está em tarefaAmostragem e tarefaRede
+  vTaskDelete(NULL);
+}
+
+// --- TAREFAS ---
+
+// Interrupção do timer: só acorda a tarefa de amostragem
+void IRAM_ATTR aoDispararTimer() {
+  BaseType_t acordar = pdFALSE;
+  xTaskNotifyFromISR(tarefaAmostragemHandle, AVISO_PERIODO, eSetBits, &acordar);
+  if (acordar) portYIELD_FROM_ISR();
+}
+
+// Interrupção do DMA do ADC: um bloco novo está pronto
+void IRAM_ATTR aoTerminarBlocoAdc() {
+  BaseType_t acordar = pdFALSE;
+  xTaskNotifyFromISR(tarefaAmostragemHandle, AVISO_BLOCO_ADC, eSetBits, &acordar);
+  if (acordar) portYIELD_FROM_ISR();
+}
+
+void tarefaAmostragem(void* parametro) {
+  unsigned long anterior = 0;
+  filtroReiniciar();
+
+  for (;;) {
+    uint32_t avisos = 0;
+    xTaskNotifyWait(0, 0xFFFFFFFF, &avisos, portMAX_DELAY); // Dorme até o ADC ou o timer
+
+    unsigned long inicio = micros();
+
+    if (avisos & AVISO_BLOCO_ADC) {
+      adc_continuous_data_t* resultado = NULL;
+      if (analogContinuousRead(&resultado, 0)) filtroEntrada(resultado[0].avg_read_raw);
+      uint32_t duracao = micros() - inicio;
+      registrarMaximo(maxLeituraAdc, duracao);
+      metricaBlocoAdc.observar(duracao);
+    }
+
+    if (avisos & AVISO_PERIODO) {
+      if (anterior != 0) {
+        long desvio = (long)(inicio - anterior) - (long)intervaloAmostragem * 1000;
+        registrarMaximo(maxDesvioTimer, labs(desvio));
+      }
+      anterior = inicio;
+
+      int valor;
+      if (!filtroFecharPeriodo(&valor)) {
+        periodosSemAdc++;
+        continue;
+      }
+      int nivelChuva = 4095 - valor; // Inverte valor
+
+      Amostra a = { relogioMs(), (int16_t)nivelChuva };
+      if (!spscEmpilhar(a)) spscDescartes++;
+    }
   }
-  client.loop(); // Mantém a comunicação viva
+}
 
-  // Lógica de envio de dados (Substitui o delay)
-  unsigned long now = millis();
-  if (now - lastMsg > MSG_INTERVAL) {
-    lastMsg = now;
-    
-    // Leitura do Sensor
-    int valor = analogRead(pinoSensor);
-    int nivelChuva = 4095 - valor; // Inverte valor
+void tarefaRede(void* parametro) {
+  unsigned long ultimoDreno = 0;
+  unsigned long ultimasMetricas = 0;
+
+  for (;;) {
+    unsigned long inicioVolta = micros();
 
-    // Prepara a mensagem
-    char msg[50];
-    snprintf(msg, 50, "%d", nivelChuva);
-    
-    Serial.print("Publicando: ");
-    Serial.println(msg);
-    
-    // Envia para o Broker
-    client.publish(topic_publish, msg);
+    // Garante que o MQTT está conectado (sem nunca ficar esperando)
+    gerenciarConexao();
+
+    // Passa as leituras novas para a fila store-and-forward
+    Amostra a;
+    while (spscRetirar(a)) {
+      uint32_t espera = relogioMs() - a.instante;
+      if (espera > maxEsperaSpsc) maxEsperaSpsc = espera;
+      if (filaCheia(filaHistorico)) filaRetirar(filaHistorico);
+      filaInserir(filaHistorico, a);
+      if (deveEnviar(a)) guardarAmostra(a);
+    }
+
+    // Envia o que estiver na fila para o Broker
+    unsigned long now = millis();
+    if (estado == CONECTADO && now - ultimoDreno >= DRENO_INTERVALO) {
+      ultimoDreno = now;
+      unsigned long inicioPublicacao = micros();
+      drenarFila();
+      uint32_t duracao = micros() - inicioPublicacao;
+      if (duracao > maxPublicacao) maxPublicacao = duracao;
+      metricaPublicacao.observar(duracao);
+    }
+
+    // Pedido de histórico feito no callback: responde fora dele, no ritmo da tarefa
+    if (estado == CONECTADO && pedidoHistorico > 0) responderHistorico();
+
+    if (estado == CONECTADO && now - ultimasMetricas >= INTERVALO_METRICAS) {
+      ultimasMetricas = now;
+      publicarMetricas();
+    }
+
+    uint32_t volta = micros() - inicioVolta;
+    if (volta > maxVoltaRede) maxVoltaRede = volta;
+    metricaVoltaRede.observar(volta);
+    relatorioTempos();
+
+    vTaskDelay(pdMS_TO_TICKS(5)); // Libera o núcleo 0 para a pilha Wi-Fi
   }
 }
 
 // --- FUNÇÕES AUXILIARES ---
 
-void setup_wifi() {
-  delay(10);
+// Esta função roda AUTOMATICAMENTE quando chega uma mensagem no tópico assinado.
+// payload aponta para o buffer interno do PubSubClient: tudo é lido antes do publish da resposta.
+void callback(char* topic, byte* payload, unsigned int length) {
+  static char resposta[96]; // estático: nada vai para o heap nem cresce a pilha
+
+  if (strcmp(topic, topic_pedido) == 0) {
+    // Só anota o pedido; a resposta sai na tarefa de rede (responderHistorico)
+    uint32_t n = 0;
+    for (unsigned int i = 0; i < length && payload[i] >= '0' && payload[i] <= '9'; i++) {
+      n = n * 10 + (payload[i] - '0');
+      if (n > TAM_HISTORICO) break;
+    }
+    pedidoHistorico = (n == 0 || n > TAM_HISTORICO) ? TAM_HISTORICO : n;
+    return;
+  }
+
+  Configuracao nova = configuracaoAtual();
+  char erro = interpretarComando(payload, length, nova);
+
+  if (erro) {
+    snprintf(resposta, sizeof(resposta), "erro %c", erro);
+  } else {
+    aplicarConfiguracao(nova);
+    snprintf(resposta, sizeof(resposta), "ok I=%lu B=%u D=%u P=%u T=%u H=%lu E=%u L=%u",
+             (unsigned long)nova.intervalo, nova.lote, nova.deadbandAbs, nova.deadbandPct,
+             nova.taxa, (unsigned long)(nova.heartbeat / 1000), nova.excecao, nova.led);
+  }
+
+  Serial.print("Comando -> ");
+  Serial.println(resposta);
+  client.publish(topic_resposta, resposta);
+}
+
+Configuracao configuracaoAtual() {
+  Configuracao c = { intervaloAmostragem.load(), tamanhoLote, deadbandAbsoluto, deadbandPercentual,
+                     limiteTaxa, heartbeatMs, modoExcecao, estadoLed };
+  return c;
+}
+
+// Valida e guarda um valor em c. Retorna false se a chave não existe ou o valor está fora da faixa.
+bool definirValor(Configuracao& c, char chave, uint32_t v) {
+  switch (chave) {
+    case 'I': if (MODO_DEEP_SLEEP || v < INTERVALO_MIN || v > INTERVALO_MAX) return false; c.intervalo = v; return true;
+    case 'B': if (v < 1 || v > BATCH_SIZE) return false; c.lote = v; return true;
+    case 'D': if (v > 4095) return false; c.deadbandAbs = v; return true;
+    case 'P': if (v > 100) return false; c.deadbandPct = v; return true;
+    case 'T': if (v > 65535) return false; c.taxa = v; return true;
+    case 'H': if (v < 1 || v > 86400) return false; c.heartbeat = v * 1000; return true;
+    case 'E': if (v > 1) return false; c.excecao = v; return true;
+    case 'L': if (v > 1) return false; c.led = v; return true;
+  }
+  return false;
+}
+
+// Lê o comando (texto ou binário) sem copiar o payload. Retorna 0 se tudo foi
+// aceito, ou a chave com problema ('?' para erro de formato).
+char interpretarComando(const byte* p, unsigned int n, Configuracao& c) {
+  if (n == 0) return '?';
+
+  if (p[0] == COMANDO_MARCADOR) {
+    if ((n - 1) % 5 != 0) return '?';
+    for (unsigned int i = 1; i < n; i += 5) {
+      uint32_t v = p[i + 1] | (p[i + 2] << 8) | (p[i + 3] << 16) | ((uint32_t)p[i + 4] << 24);
+      if (!definirValor(c, p[i], v)) return p[i];
+    }
+    return 0;
+  }
+
+  // Compatibilidade: "1" / "0" controla o LED. Como na versão original, só o
+  // primeiro byte conta ("1\n" de um terminal também liga)
+  if (p[0] == '0' || p[0] == '1') {
+    c.led = p[0] == '1';
+    return 0;
+  }
+
+  unsigned int i = 0;
+  while (i < n) {
+    if (p[i] == ';' || p[i] == ',' || p[i] == ' ') {
+      i++;
+      continue;
+    }
+    char chave = toupper(p[i]);
+    if (i + 2 >= n || p[i + 1] != '=' || !isdigit(p[i + 2])) return chave;
+    i += 2;
+    uint32_t v = 0;
+    while (i < n && isdigit(p[i])) {
+      if (v > 429496728) return chave; // estouraria 32 bits
+      v = v * 10 + (p[i++] - '0');
+    }
+    if (!definirValor(c, chave, v)) return chave;
+  }
+  return 0;
+}
+
+void aplicarConfiguracao(const Configuracao& c) {
+  if (c.intervalo != intervaloAmostragem.load()) {
+    intervaloAmostragem = c.intervalo;
+    if (timerAmostragem) timerAlarm(timerAmostragem, (uint64_t)c.intervalo * 1000, true, 0);
+  }
+  tamanhoLote = c.lote;
+  deadbandAbsoluto = c.deadbandAbs;
+  deadbandPercentual = c.deadbandPct;
+  limiteTaxa = c.taxa;
+  heartbeatMs = c.heartbeat;
+  modoExcecao = c.excecao;
+  estadoLed = c.led;
+  digitalWrite(pinoLED, estadoLed ? HIGH : LOW);
+}
+
+// --- CONEXÃO WI-FI / MQTT ---
+
+void gerenciarConexao() {
+  unsigned long now = millis();
+
+  switch (estado) {
+    case SEM_WIFI:
+      if ((long)(now - proximaTentativa) < 0) return;
+      Serial.print("Conectando em ");
+      Serial.println(ssid);
+      WiFi.begin(ssid, password);
+      inicioWifi = now;
+      estado = CONECTANDO_WIFI;
+      break;
+
+    case CONECTANDO_WIFI:
+      if (WiFi.status() == WL_CONNECTED) {
+        Serial.print("WiFi conectado! IP: ");
+        Serial.println(WiFi.localIP());
+        falhasSeguidas = 0;
+        proximaTentativa = now;
+        estado = SEM_MQTT;
+      } else if (now - inicioWifi > WIFI_TIMEOUT) {
+        Serial.println("WiFi nao conectou");
+        WiFi.disconnect();
+        agendarNovaTentativa();
+        estado = SEM_WIFI;
+      }
+      break;
+
+    case SEM_MQTT:
+      if (WiFi.status() != WL_CONNECTED) {
+        estado = SEM_WIFI;
+        return;
+      }
+      if ((long)(now - proximaTentativa) < 0) return;
+      if (reconnect()) {
+        falhasSeguidas = 0;
+        estado = CONECTADO;
+      } else {
+        agendarNovaTentativa();
+      }
+      break;
+
+    case CONECTADO:
+      if (client.loop()) return; // Mantém a comunicação viva
+      Serial.println("MQTT desconectado");
+      proximaTentativa = now;
+      estado = WiFi.status() == WL_CONNECTED ? SEM_MQTT : SEM_WIFI;
+      break;
+  }
+}
+
+// Espera sorteada entre metade e o total do backoff atual (BACKOFF_BASE * 2^falhas, até BACKOFF_MAX)
+void agendarNovaTentativa() {
+  unsigned long espera = BACKOFF_MAX;
+  if (falhasSeguidas < 7) espera = min((unsigned long)BACKOFF_MAX, (unsigned long)BACKOFF_BASE << falhasSeguidas);
+  if (falhasSeguidas < 255) falhasSeguidas++;
+
+  espera = random(espera / 2, espera + 1);
+  proximaTentativa = millis() + espera;
+  Serial.print("Nova tentativa em ");
+  Serial.print(espera);
+  Serial.println(" ms");
+}
+
+// Faz UMA tentativa de conexão MQTT. Quem decide quando tentar de novo é gerenciarConexao().
+bool reconnect() {
+  Serial.print("Tentando conexão MQTT...");
+  // ID a partir do MAC (único por placa), montado sem String para não usar o heap
+  static char clientId[24];
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  snprintf(clientId, sizeof(clientId), "ESP32Client-%02x%02x%02x", mac[3], mac[4], mac[5]);
+
+  if (client.connect(clientId)) {
+    Serial.println("conectado");
+    metricaConexoes.somar();
+    // Assim que conectar, avisa e se inscreve no tópico de comando
+    client.publish(topic_publish, "Conectado!");
+    client.subscribe(topic_subscribe);
+    client.subscribe(topic_pedido);
+    return true;
+  }
+
+  metricaFalhasMqtt.somar();
+  Serial.print("falhou, rc=");
+  Serial.print(client.state());
+  Serial.print(" (amostras na fila: ");
+  Serial.print(filaRam.quantidade + filaRtc.quantidade);
+  Serial.println(")");
+  return false;
+}
+
+// A cada RELATORIO_TEMPOS imprime os máximos de cada etapa e zera para a próxima janela
+void relatorioTempos() {
+  unsigned long now = millis();
+  if (now - ultimoRelatorio < RELATORIO_TEMPOS) return;
+  ultimoRelatorio = now;
+
+  Serial.print(estado == CONECTADO ? "[conectado]" : "[sem conexao]");
+  Serial.print(" desvio timer max ");
+  Serial.print(maxDesvioTimer.exchange(0));
+  Serial.print(" us | bloco ADC max ");
+  Serial.print(maxLeituraAdc.exchange(0));
+  Serial.print(" us | espera SPSC max ");
+  Serial.print(maxEsperaSpsc);
+  Serial.print(" ms | volta rede max ");
+  Serial.print(maxVoltaRede);
+  Serial.print(" us | publish max ");
+  Serial.print(maxPublicacao);
+  Serial.print(" us | SPSC pico ");
+  Serial.print(spscPico.load());
+  Serial.print("/");
+  Serial.print(TAM_SPSC);
+  Serial.print(", descartes ");
+  Serial.println(spscDescartes.load());
+
+  Serial.print("  excecao: suprimidas ");
+  Serial.print(suprimidas);
+  Serial.print(" | enviadas por deadband ");
+  Serial.print(enviadasDeadband);
+  Serial.print(", taxa ");
+  Serial.print(enviadasTaxa);
+  Serial.print(", heartbeat ");
+  Serial.println(enviadasHeartbeat);
+
+  uint32_t livre = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  uint32_t maiorBloco = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  if (maiorBloco < menorBlocoHeap) menorBlocoHeap = maiorBloco;
+  Serial.print("  heap: livre ");
+  Serial.print(livre);
+  Serial.print(" (min ");
+  Serial.print(heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+  Serial.print(") | maior bloco ");
+  Serial.print(maiorBloco);
+  Serial.print(" (pior ");
+  Serial.print(menorBlocoHeap);
+  Serial.print(") | fragmentacao ");
+  Serial.print(livre ? 100 - maiorBloco * 100 / livre : 0);
+  Serial.println("%");
+
+  Serial.print("  filtro: ");
+  Serial.print(blocosPorPeriodo.load());
+  Serial.print(" blocos/periodo | ruido ");
+  Serial.print(ruidoBloco.load(), 2);
+  Serial.print(" LSB (pico-a-pico ");
+  Serial.print(picoAPico.load());
+  Serial.print(") | bits efetivos ");
+  Serial.print(bitsEfetivos.load(), 1);
+  Serial.print(" | periodos sem ADC ");
+  Serial.println(periodosSemAdc.load());
+
+  maxEsperaSpsc = 0;
+  maxVoltaRede = 0;
+  maxPublicacao = 0;
+}
+
+void registrarMaximo(std::atomic<uint32_t>& maximo, uint32_t valor) {
+  uint32_t atual = maximo.load(std::memory_order_relaxed);
+  while (valor > atual && !maximo.compare_exchange_weak(atual, valor, std::memory_order_relaxed)) {
+  }
+}
+
+// --- FILTRO DO ADC (roda só na tarefa de amostragem) ---
+
+void filtroReiniciar() {
+  filtro.n = 0;
+  filtro.media = 0;
+  filtro.m2 = 0;
+  filtro.minimo = 4095;
+  filtro.maximo = 0;
+  filtro.somaLote = 0;
+  filtro.nLotes = 0;
+  filtro.mediaLotes = 0;
+  filtro.m2Lotes = 0;
+}
+
+// Recebe a média de um bloco do DMA, passa pela mediana móvel e acumula no período
+void filtroEntrada(int bloco) {
+  filtro.janela[filtro.posicao] = bloco;
+  filtro.posicao = (filtro.posicao + 1) % FILTRO_MEDIANA;
+  if (filtro.preenchidos < FILTRO_MEDIANA) filtro.preenchidos++;
+
+  // Mediana: ordena uma cópia da janela (no máximo FILTRO_MEDIANA elementos)
+  int ordenado[FILTRO_MEDIANA];
+  uint8_t n = filtro.preenchidos;
+  for (uint8_t i = 0; i < n; i++) {
+    int v = filtro.janela[i];
+    int j = i;
+    while (j > 0 && ordenado[j - 1] > v) {
+      ordenado[j] = ordenado[j - 1];
+      j--;
+    }
+    ordenado[j] = v;
+  }
+  int x = ordenado[n / 2];
+
+  filtro.n++;
+  float delta = x - filtro.media;
+  filtro.media += delta / filtro.n;
+  filtro.m2 += delta * (x - filtro.media);
+  if (x < filtro.minimo) filtro.minimo = x;
+  if (x > filtro.maximo) filtro.maximo = x;
+
+  filtro.somaLote += x;
+  if (filtro.n % FILTRO_LOTE == 0) {
+    float lote = filtro.somaLote / FILTRO_LOTE;
+    filtro.somaLote = 0;
+    filtro.nLotes++;
+    float d = lote - filtro.mediaLotes;
+    filtro.mediaLotes += d / filtro.nLotes;
+    filtro.m2Lotes += d * (lote - filtro.mediaLotes);
+  }
+}
+
+// Fecha o período: devolve a média dos blocos e publica as estatísticas de ruído.
+// Bits efetivos = log2(4096 / (sigma * raiz(12))), com o sigma do valor final
+// estimado pelas sub-médias (sigma entre sub-médias / raiz(quantidade)) mais o
+// arredondamento para inteiro (1/12 LSB²). Sem ruído nenhum dá 12 bits.
+bool filtroFecharPeriodo(int* valor) {
+  if (filtro.n == 0) return false;
+
+  *valor = (int)(filtro.media + 0.5f);
+
+  float sigmaBloco = filtro.n > 1 ? sqrtf(filtro.m2 / (filtro.n - 1)) : 0;
+  // Período curto (menos de 2 sub-médias): volta para sigma entre blocos / raiz(n)
+  float variancia = filtro.nLotes > 1 ? filtro.m2Lotes / (filtro.nLotes - 1) / filtro.nLotes
+                                      : sigmaBloco * sigmaBloco / filtro.n;
+  float sigmaSaida = sqrtf(variancia + 1.0f / 12);
+  ruidoBloco.store(sigmaBloco);
+  bitsEfetivos.store(min(12.0f, log2f(4096.0f / (sigmaSaida * sqrtf(12.0f)))));
+  blocosPorPeriodo.store(filtro.n);
+  picoAPico.store(filtro.maximo - filtro.minimo);
+
+  filtroReiniciar();
+  return true;
+}
+
+// --- FILA SPSC (NÚCLEO 1 -> NÚCLEO 0) ---
+
+// Chamada só pela tarefa de amostragem
+bool spscEmpilhar(const Amostra& a) {
+  uint32_t escrita = spscEscrita.load(std::memory_order_relaxed);
+  uint32_t ocupacao = escrita - spscLeitura.load(std::memory_order_acquire);
+  if (ocupacao == TAM_SPSC) return false;
+
+  filaSpsc[escrita % TAM_SPSC] = a;
+  spscEscrita.store(escrita + 1, std::memory_order_release);
+  if (ocupacao + 1 > spscPico.load(std::memory_order_relaxed)) spscPico.store(ocupacao + 1, std::memory_order_relaxed);
+  return true;
+}
+
+// Chamada só pela tarefa de rede
+bool spscRetirar(Amostra& a) {
+  uint32_t leitura = spscLeitura.load(std::memory_order_relaxed);
+  if (leitura == spscEscrita.load(std::memory_order_acquire)) return false;
+
+  a = filaSpsc[leitura % TAM_SPSC];
+  spscLeitura.store(leitura + 1, std::memory_order_release);
+  return true;
+}
+
+// --- RELÓGIO DAS AMOSTRAS ---
+
+// Tempo em ms pelo relógio do sistema (gettimeofday). Diferente do millis(),
+// ele não volta a zero depois do deep sleep, então as idades continuam certas.
+uint32_t relogioMs() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint32_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// --- CICLO DE DEEP SLEEP ---
+
+void cicloDeepSleep() {
+  despertares++;
+  intervaloAmostragem = DEEP_SLEEP_INTERVALO; // período do timer da RTC ("I=" é recusado neste modo)
+
+  // Leitura rápida (média de 64 analogRead) para não gastar tempo acordado com o DMA
+  long soma = 0;
+  for (int i = 0; i < 64; i++) soma += analogRead(pinoSensor);
+  Amostra a = { relogioMs(), (int16_t)(4095 - soma / 64) }; // Inverte valor
+  if (deveEnviar(a)) guardarAmostraRtc(a);
+
+  long wakeParaPublish = -1;
+  uint16_t enviadas = 0;
+  if (despertares % DEEP_SLEEP_K == 0 && totalNaFila() > 0 && conectarWifiRapido()) {
+    client.setServer(mqtt_server, mqtt_port);
+    client.setCallback(callback);
+    if (reconnect()) {
+      uint16_t antes = totalNaFila();
+      unsigned long inicio = millis();
+      enviarJa = true; // Tudo que está na fila sai agora, mesmo em lote incompleto
+      while (totalNaFila() > 0 && millis() - inicio < DEEP_SLEEP_ENVIO_TIMEOUT) {
+        if (wakeParaPublish < 0) wakeParaPublish = millis();
+        drenarFila();
+        client.loop();
+      }
+      enviadas = antes - totalNaFila();
+      client.disconnect();
+      delay(10); // Dá tempo do DISCONNECT sair antes de desligar o rádio
+    }
+  }
+
+  // O millis() conta desde o despertar, então é o tempo acordado deste ciclo
+  uint32_t acordado = millis();
+  Serial.print("Ciclo ");
+  Serial.print(despertares);
+  Serial.print(": acordado ");
+  Serial.print(acordado);
+  Serial.print(" ms (anterior ");
+  Serial.print(ultimoTempoAcordado);
+  Serial.print(" ms) | fila ");
+  Serial.print(totalNaFila());
+  if (enviadas > 0) {
+    Serial.print(" | ");
+    Serial.print(enviadas);
+    Serial.print(" amostras enviadas, despertar->publish ");
+    Serial.print(wakeParaPublish);
+    Serial.print(" ms");
+  }
   Serial.println();
-  Serial.print("Conectando em ");
-  Serial.println(ssid);
-  WiFi.begin(ssid, password);
+  Serial.flush();
+  ultimoTempoAcordado = acordado;
+
+  WiFi.disconnect(true);
+  uint32_t dormir = DEEP_SLEEP_INTERVALO > acordado ? DEEP_SLEEP_INTERVALO - acordado : 1;
+  esp_sleep_enable_timer_wakeup((uint64_t)dormir * 1000);
+  esp_deep_sleep_start();
+}
+
+// Conexão com os dados da RTC (sem varredura e sem DHCP). Na primeira vez
+// (ou se o cache falhar) faz a conexão normal e guarda os dados para as próximas.
+bool conectarWifiRapido() {
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+  if (redeCache.valido) {
+    WiFi.config(IPAddress(redeCache.ip), IPAddress(redeCache.gateway), IPAddress(redeCache.mascara), IPAddress(redeCache.dns));
+    WiFi.begin(ssid, password, redeCache.canal, redeCache.bssid);
+  } else {
+    WiFi.begin(ssid, password);
+  }
+
+  unsigned long inicio = millis();
   while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
+    if (millis() - inicio > DEEP_SLEEP_WIFI_TIMEOUT) {
+      Serial.println("WiFi nao conectou, descartando cache");
+      redeCache.valido = false;
+      return false;
+    }
+    delay(5);
+  }
+
+  if (!redeCache.valido) {
+    memcpy(redeCache.bssid, WiFi.BSSID(), 6);
+    redeCache.canal = WiFi.channel();
+    redeCache.ip = WiFi.localIP();
+    redeCache.gateway = WiFi.gatewayIP();
+    redeCache.mascara = WiFi.subnetMask();
+    redeCache.dns = WiFi.dnsIP();
+    redeCache.valido = true;
   }
-  Serial.println("WiFi conectado!");
+  Serial.print("WiFi conectado em ");
+  Serial.print(millis() - inicio);
+  Serial.println(" ms");
+  return true;
 }
 
-// Esta função roda AUTOMATICAMENTE quando chega uma mensagem no tópico assinado
-void callback(char* topic, byte* payload, unsigned int length) {
-  Serial.print("Mensagem chegou [");
-  Serial.print(topic);
-  Serial.print("] ");
-  
-  // Converte o payload para char para podermos ler
-  char comando = (char)payload[0];
-  Serial.println(comando);
-
-  // Controle do LED via MQTT
-  if (comando == '1') {
-    digitalWrite(pinoLED, HIGH);
-    Serial.println("LED LIGADO via MQTT");
-  } else if (comando == '0') {
-    digitalWrite(pinoLED, LOW);
-    Serial.println("LED DESLIGADO via MQTT");
-  }
-}
-
-void reconnect() {
-  // Loop até reconectar
-  while (!client.connected()) {
-    Serial.print("Tentando conexão MQTT...");
-    // Cria um ID randômico para não dar conflito
-    String clientId = "ESP32Client-";
-    clientId += String(random(0xffff), HEX);
-    
-    if (client.connect(clientId.c_str())) {
-      Serial.println("conectado");
-      // Assim que conectar, avisa e se inscreve no tópico de comando
-      client.publish(topic_publish, "Conectado!");
-      client.subscribe(topic_subscribe);
-    } else {
-      Serial.print("falhou, rc=");
-      Serial.print(client.state());
-      Serial.println(" tentando novamente em 5s");
-      delay(5000);
+// --- ENVIO POR EXCEÇÃO ---
+
+// Decide se a leitura nova vai para a fila de envio (ver modoExcecao)
+bool deveEnviar(const Amostra& a) {
+  if (!modoExcecao || !temReferencia) {
+    temReferencia = true;
+    ultimaEnviada = a;
+    ultimaLida = a;
+    return true;
+  }
+
+  int variacao = abs(a.valor - ultimaEnviada.valor);
+  int faixa = max((int)deadbandAbsoluto, ultimaEnviada.valor * deadbandPercentual / 100);
+  uint32_t intervalo = max((uint32_t)1, a.instante - ultimaLida.instante);
+  uint32_t taxa = (uint32_t)abs(a.valor - ultimaLida.valor) * 1000 / intervalo;
+  ultimaLida = a;
+
+  if (limiteTaxa && taxa >= limiteTaxa) {
+    enviadasTaxa++;
+    enviarJa = true;
+  } else if (variacao > faixa) {
+    enviadasDeadband++;
+    enviarJa = true;
+  } else if (a.instante - ultimaEnviada.instante >= heartbeatMs) {
+    enviadasHeartbeat++;
+  } else {
+    suprimidas++;
+    return false;
+  }
+
+  ultimaEnviada = a;
+  return true;
+}
+
+// --- FILA DE AMOSTRAS ---
+
+bool filaCheia(const FilaAmostras& f) {
+  return f.quantidade == f.capacidade;
+}
+
+void filaInserir(FilaAmostras& f, const Amostra& a) {
+  f.dados[(f.inicio + f.quantidade) % f.capacidade] = a;
+  f.quantidade++;
+}
+
+Amostra filaRetirar(FilaAmostras& f) {
+  Amostra a = f.dados[f.inicio];
+  f.inicio = (f.inicio + 1) % f.capacidade;
+  f.quantidade--;
+  return a;
+}
+
+// Guarda a leitura nova. Se a RAM estiver cheia, a amostra mais antiga
+// desce para a RTC; se a RTC também estiver cheia, a mais antiga de todas é descartada.
+void guardarAmostra(const Amostra& a) {
+  if (filaCheia(filaRam)) {
+    if (filaCheia(filaRtc)) {
+      filaRetirar(filaRtc);
+      amostrasPerdidas++;
     }
+    filaInserir(filaRtc, filaRetirar(filaRam));
+  }
+  filaInserir(filaRam, a);
+}
+
+// No modo deep sleep a RAM se perde a cada ciclo: a amostra vai direto para a RTC
+void guardarAmostraRtc(const Amostra& a) {
+  if (filaCheia(filaRtc)) {
+    filaRetirar(filaRtc);
+    amostrasPerdidas++;
   }
-}
\ No newline at end of file
+  filaInserir(filaRtc, a);
+}
+
+// Acesso à fila completa (RTC + RAM) como se fosse uma só, do mais antigo (0) ao mais novo
+uint16_t totalNaFila() {
+  return filaRtc.quantidade + filaRam.quantidade;
+}
+
+const Amostra& amostraNaFila(uint16_t i) {
+  if (i < filaRtc.quantidade) return filaRtc.dados[(filaRtc.inicio + i) % filaRtc.capacidade];
+  i -= filaRtc.quantidade;
+  return filaRam.dados[(filaRam.inicio + i) % filaRam.capacidade];
+}
+
+void descartarDaFila(uint16_t n) {
+  while (n-- > 0) filaRetirar(filaRtc.quantidade > 0 ? filaRtc : filaRam);
+}
+
+void escreveU16(uint8_t* p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+void escreveU32(uint8_t* p, uint32_t v) {
+  escreveU16(p, v & 0xFFFF);
+  escreveU16(p + 2, v >> 16);
+}
+
+// Monta um quadro binário com as amostras do início da fila. Só entram amostras
+// que seguem o período nominal (uma falha na leitura fecha o quadro).
+// Retorna quantas amostras foram usadas.
+uint16_t montarQuadro(uint8_t* quadro, size_t* tamanho, unsigned long agora) {
+  const Amostra& base = amostraNaFila(0);
+  uint16_t n = 1;
+  int16_t anterior = base.valor;
+  uint16_t total = totalNaFila();
+
+  while (n < tamanhoLote && n < total) {
+    const Amostra& a = amostraNaFila(n);
+    long esperado = (long)(base.instante + (uint32_t)n * intervaloAmostragem);
+    if (labs((long)a.instante - esperado) > (long)intervaloAmostragem / 2) break;
+    escreveU16(quadro + QUADRO_CABECALHO + 2 * n, (uint16_t)(a.valor - anterior));
+    anterior = a.valor;
+    n++;
+  }
+
+  quadro[0] = QUADRO_MARCADOR;
+  quadro[1] = n;
+  escreveU16(quadro + 2, intervaloAmostragem);
+  escreveU32(quadro + 4, agora - base.instante);
+  escreveU16(quadro + QUADRO_CABECALHO, (uint16_t)base.valor);
+  *tamanho = QUADRO_CABECALHO + 2 * n;
+  return n;
+}
+
+// Envia até DRENO_POR_RODADA mensagens, sempre da amostra mais antiga (RTC) para a mais nova (RAM).
+// A amostra só sai da fila depois que o publish() confirmar o envio.
+void drenarFila() {
+  for (int i = 0; i < DRENO_POR_RODADA && totalNaFila() > 0; i++) {
+    unsigned long agora = relogioMs();
+    const Amostra& a = amostraNaFila(0);
+
+    if (tamanhoLote == 1) {
+      // Formato texto "valor;idade" (idade em ms desde a leitura), para que o
+      // dashboard consiga posicionar no gráfico as amostras que ficaram presas na fila.
+      char msg[50];
+      snprintf(msg, 50, "%d;%lu", a.valor, (unsigned long)(agora - a.instante));
+      if (!client.publish(topic_publish, msg)) return; // tenta de novo na próxima rodada
+
+      Serial.print("Publicando: ");
+      Serial.println(msg);
+      descartarDaFila(1);
+      continue;
+    }
+
+    uint8_t quadro[QUADRO_CABECALHO + 2 * BATCH_SIZE];
+    size_t tamanho;
+    uint16_t n = montarQuadro(quadro, &tamanho, agora);
+
+    // Quadro incompleto só sai se já esperou demais ou se foi fechado por uma falha no período
+    bool completo = n == tamanhoLote || n < totalNaFila() || enviarJa;
+    if (!completo && agora - a.instante < BATCH_MAX_LATENCY) return;
+
+    if (!client.publish(topic_publish, quadro, tamanho)) return;
+
+    Serial.print("Publicando lote de ");
+    Serial.print(n);
+    Serial.print(" amostras (");
+    Serial.print(tamanho);
+    Serial.println(" bytes)");
+    descartarDaFila(n);
+  }
+  if (totalNaFila() == 0) enviarJa = false;
+}
+
+// --- HISTÓRICO (BACKFILL) ---
+
+// Escreve v em zigzag + varint e devolve a posição seguinte (no máximo 5 bytes)
+uint8_t* escreveVarint(uint8_t* p, int32_t v) {
+  uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+  while (z >= 0x80) {
+    *p++ = (z & 0x7F) | 0x80;
+    z >>= 7;
+  }
+  *p++ = z;
+  return p;
+}
+
+// Codifica as amostras do histórico a partir de "primeiro" (depois do cabeçalho).
+// Com enviar = false só conta os bytes; com enviar = true escreve no publish
+// aberto em pedaços de 64 bytes, sem precisar de um buffer do tamanho do bloco.
+size_t codificarHistorico(uint16_t primeiro, bool enviar) {
+  uint8_t pedaco[64];
+  uint8_t* p = pedaco;
+  size_t total = 0;
+  int32_t intervaloAnterior = 0;
+  const Amostra* anterior = &filaHistorico.dados[(filaHistorico.inicio + primeiro) % TAM_HISTORICO];
+  int16_t valorAnterior = 0;
+
+  for (uint16_t i = primeiro; i < filaHistorico.quantidade; i++) {
+    const Amostra& a = filaHistorico.dados[(filaHistorico.inicio + i) % TAM_HISTORICO];
+    int32_t intervalo = (int32_t)(a.instante - anterior->instante);
+    p = escreveVarint(p, intervalo - intervaloAnterior);
+    p = escreveVarint(p, a.valor - valorAnterior);
+    intervaloAnterior = intervalo;
+    valorAnterior = a.valor;
+    anterior = &a;
+
+    if (p - pedaco > (int)sizeof(pedaco) - 10) { // Não cabem mais dois varints
+      if (enviar) client.write(pedaco, p - pedaco);
+      total += p - pedaco;
+      p = pedaco;
+    }
+  }
+  if (enviar) client.write(pedaco, p - pedaco);
+  return total + (p - pedaco);
+}
+
+// Publica as últimas pedidoHistorico leituras em um único bloco
+void responderHistorico() {
+  uint16_t n = min<uint16_t>(pedidoHistorico, filaHistorico.quantidade);
+  pedidoHistorico = 0;
+  if (n == 0) return;
+
+  unsigned long inicio = micros();
+  uint16_t primeiro = filaHistorico.quantidade - n;
+  const Amostra& maisAntiga = filaHistorico.dados[(filaHistorico.inicio + primeiro) % TAM_HISTORICO];
+  uint8_t cabecalho[HISTORICO_CABECALHO];
+  cabecalho[0] = HISTORICO_MARCADOR;
+  escreveU16(cabecalho + 1, n);
+  escreveU32(cabecalho + 3, relogioMs() - maisAntiga.instante);
+
+  size_t tamanho = HISTORICO_CABECALHO + codificarHistorico(primeiro, false);
+  if (!client.beginPublish(topic_historico, tamanho, false)) return;
+  client.write(cabecalho, HISTORICO_CABECALHO);
+  codificarHistorico(primeiro, true);
+  client.endPublish();
+
+  Serial.print("Histórico enviado: ");
+  Serial.print(n);
+  Serial.print(" amostras em ");
+  Serial.print(tamanho);
+  Serial.print(" bytes (");
+  Serial.print((float)tamanho / n, 1);
+  Serial.print(" bytes/amostra), ");
+  Serial.print(micros() - inicio);
+  Serial.println(" us");
+}
+
+// --- MÉTRICAS ---
+
+// Publica todas as métricas (texto do Prometheus) em topic_stats. O texto passa
+// bem do buffer de 256 bytes do PubSubClient: é montado uma vez em um buffer
+// estático (o tamanho exato precisa ir no cabeçalho do PUBLISH) e escrito
+// direto no socket com beginPublish.
+void publicarMetricas() {
+  static char texto[TAM_TEXTO_METRICAS];
+  CursorMetricas cursor;
+  metricasIniciar(cursor);
+  size_t tamanho = metricasExportar(cursor, texto, sizeof(texto));
+  if (cursor.atual) Serial.println("Metricas cortadas: aumente TAM_TEXTO_METRICAS");
+
+  if (!client.beginPublish(topic_stats, tamanho, false)) return;
+  client.write((const uint8_t*)texto, tamanho);
+  client.endPublish();
+}
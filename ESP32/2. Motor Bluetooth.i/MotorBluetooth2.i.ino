@@ -19,6 +19,15 @@
 
 #include <BLEDevice.h>
 #include <RemoteXY.h>
+#include "esp_gatts_api.h"        // Serviço da telemetria direto no Bluedroid (sem BLEServer)
+#include "esp_gatt_common_api.h"  // esp_ble_gatt_set_local_mtu
+#include "esp_gap_ble_api.h"      // esp_ble_gap_update_conn_params
+#include <atomic>
+#include "driver/pulse_cnt.h" // Contador de pulsos (PCNT) para o encoder
+#include "driver/gpio.h"      // gpio_set_level: pode ser chamada dentro de interrupção
+#include "esp_timer.h"        // esp_timer_get_time: relógio em us que funciona em interrupção
+#include "rampa.h" // Perfil de velocidade (curva em S), sem dependência do Arduino
+#include "pid.h"   // PID em ponto fixo, sem dependência do Arduino
 
 // Nome que vai aparecer na lista de Bluetooth do celular
 #define REMOTEXY_BLUETOOTH_NAME "ESP32_Motor_Final"
@@ -52,12 +61,368 @@ const int pinoIN1 = 19; // Controla Direção A
 const int pinoIN2 = 18; // Controla Direção B
 const int pinoENA = 16; // Controla a Velocidade (PWM)
 
+// Encoder do motor (canais A e B; só entrada, com pull-up externo se o encoder for open-collector)
+const int pinoEncoderA = 34;
+const int pinoEncoderB = 35;
+
+// Medidas da alimentação do motor (só ADC1: o ADC2 não funciona com o rádio ligado)
+const int pinoTensao = 32;   // Divisor 100k/10k da fonte do motor
+const int pinoCorrente = 33; // Resistor de sense do L298N (pino SENSA)
+
+// =================================================================================
+// 2.1 ESTADO APLICADO NAS SAÍDAS
+// =================================================================================
+
+// O último comando entregue à tarefa da rampa. O loop compara o que veio do app
+// com isto e só repassa quando algo mudou (antes, ledcWrite e os dois
+// digitalWrite rodavam a cada volta, mesmo com o app parado).
+struct Comando {
+  uint8_t ligado;
+  uint8_t sentido;
+  int8_t velocidade; // 0 a 100, como no slider
+};
+Comando aplicado = { 0, 0, 0 }; // setup() começa com o motor parado
+
+// --- LATÊNCIA COMANDO -> SAÍDA (Monitor Serial a cada RELATORIO_TEMPOS) ---
+// O RemoteXY só entrega os dados novos dentro do RemoteXY_Handler(); eles podem
+// ter chegado logo depois da chamada anterior. Por isso a latência medida vai do
+// handler anterior até o comando entregue à rampa: é o pior caso de cada
+// comando. A partir daí a rampa começa a mexer nos pinos no próximo tick (1 ms).
+#define RELATORIO_TEMPOS 10000 // ms
+uint32_t maxLatencia = 0;   // us: handler anterior -> comando entregue
+uint32_t somaLatencia = 0;  // us somados na janela (para a média)
+uint32_t maxAplicacao = 0;  // us: só a entrega do comando
+uint32_t comandosAplicados = 0;
+unsigned long inicioHandlerAnterior = 0; // micros()
+unsigned long ultimoRelatorio = 0;
+
+// =================================================================================
+// 2.2 PERFIL DE MOVIMENTO (RAMPAS E INVERSÃO)
+// =================================================================================
+
+// Um timer de hardware acorda a tarefa da rampa a cada 1 ms. Ela é a única que
+// escreve nos pinos da Ponte H: a velocidade segue o slider por uma curva em S
+// (rampa.h) em vez de pular de 0 para 100% de uma vez.
+//
+// Inverter o sentido com o motor girando trocava IN1/IN2 na hora, sob carga:
+// pico de corrente e a fonte da bancada caía. Agora a inversão é:
+//   1. rampa até parar no sentido atual;
+//   2. freio por FREIO_MS (IN1 = IN2 = HIGH, ENA cheio: motor em curto pela ponte);
+//   3. rampa até a velocidade pedida no sentido novo.
+#define FREQ_RAMPA 1000       // Hz (passo do perfil)
+#define ACELERACAO_MAX 200.0f // %/s: 0 -> 100% em ~0,6 s
+#define JERK_MAX 2000.0f      // %/s²: a aceleração leva 0,1 s para chegar no máximo
+#define FREIO_MS 150          // ms com o motor freado antes de inverter
+
+const LimitesRampa limites = { ACELERACAO_MAX, JERK_MAX };
+
+// Comando pedido pelo loop (núcleo do Arduino) e lido pela tarefa da rampa
+std::atomic<bool> motorLigado(false);
+std::atomic<int8_t> velocidadePedida(0); // -100 a 100: o sinal é o sentido (negativo = sentido 1)
+
+enum EstadoMotor { PARADO, GIRANDO, FREANDO };
+EstadoMotor estadoMotor = PARADO; // Só a tarefa da rampa mexe nestes três
+Rampa rampa = { 0, 0 };
+uint8_t sentidoAtual = 0;
+
+hw_timer_t* timerRampa = NULL;
+TaskHandle_t tarefaRampaHandle = NULL;
+
+// O loop() dorme até o handler GATT avisar que chegou um pacote do app do
+// RemoteXY (notificação de tarefa). Sem pacote ele acorda na próxima amostra
+// da telemetria ou, no máximo, a cada ESPERA_MAX_LOOP_MS (relatórios e failsafe).
+#define ESPERA_MAX_LOOP_MS 20
+TaskHandle_t tarefaLoopHandle = NULL;
+
+// Último duty escrito em ENA. Com o motor em velocidade constante a tarefa
+// calcula o mesmo duty a cada 1 ms; só chama ledcWrite quando ele muda.
+int dutyNoPino = -1; // -1 = ainda não escrito
+
+// =================================================================================
+// 2.3 CONTROLE DE VELOCIDADE EM MALHA FECHADA (ENCODER + PID)
+// =================================================================================
+
+// Em malha aberta o slider vira duty direto, e com carga a velocidade cai.
+// Com MODO_MALHA_FECHADA, o slider é um alvo em RPM (0 a 100% = 0 a RPM_MAX):
+// a cada tick da tarefa da rampa (1 kHz) o encoder é lido pelo PCNT e o PID
+// (pid.h) corrige o duty para manter a rotação. A rampa continua moldando o
+// alvo, agora em RPM.
+//
+// O padrão é malha aberta: as bancadas montadas ainda não têm encoder, e sem
+// pulsos o PID leva o duty ao máximo. Só mude para 1 com o encoder ligado. Mesmo
+// assim, se o PCNT não iniciar ou se o encoder não mandar nenhum pulso com duty
+// alto por PRAZO_ENCODER_MS, o sketch volta sozinho para a malha aberta.
+#ifndef MODO_MALHA_FECHADA
+#define MODO_MALHA_FECHADA 0
+#endif
+#define ENCODER_QUADRATURA 1  // 1 = canais A e B (conta nos dois sentidos); 0 = só o canal A
+#define PULSOS_POR_VOLTA 1320 // por volta do eixo de saída: 11 pulsos x redução 30:1 x 4 bordas (quadratura)
+#define RPM_MAX 200           // alvo com o slider em 100%
+#define RPM_SEM_CARGA 230     // rotação com duty 255 e sem carga (para o feedforward)
+
+// A velocidade é a diferença de pulsos nos últimos JANELA_VELOCIDADE passos.
+// Com 1 ms por passo, 1 pulso a mais na janela = 60000 / (1320 * 10) = 4,5 RPM.
+#define JANELA_VELOCIDADE 10 // passos (10 ms)
+
+// Encoder ausente: duty >= DUTY_TESTE_ENCODER por PRAZO_ENCODER_MS sem nenhum
+// pulso. Com 50% de duty qualquer motor da bancada já gira (ou está travado,
+// e aí também é melhor não deixar o PID ir a 100%).
+#define DUTY_TESTE_ENCODER 128
+#define PRAZO_ENCODER_MS 300
+
+// Ganhos (duty por RPM). Ki e Kd entram no PID já divididos/multiplicados pela frequência.
+#define PID_KP 0.8
+#define PID_KI 8.0 // por segundo
+#define PID_KD 0.0
+const GanhosPid ganhos = {
+  Q16(PID_KP), Q16(PID_KI / FREQ_RAMPA), Q16(PID_KD * FREQ_RAMPA), Q16(255.0 / RPM_SEM_CARGA), Q16(255)
+};
+
+pcnt_unit_handle_t unidadeEncoder = NULL; // NULL: PCNT não iniciou (sem medida de RPM)
+int contagens[JANELA_VELOCIDADE]; // contagem do encoder nos últimos passos (anel)
+uint8_t posicaoContagem = 0;
+int ultimaContagem = 0;
+std::atomic<bool> malhaFechada(false);     // começa em MODO_MALHA_FECHADA; cai para aberta se o encoder falhar
+std::atomic<bool> avisoMalhaAberta(false); // a tarefa da rampa desistiu do encoder: o loop() avisa
+int contagemTesteEncoder = 0;
+uint16_t passosSemPulso = 0;
+Pid pid;
+float rpmMedida = 0; // RPM no sentido atual (só a tarefa da rampa escreve)
+
+// --- TEMPO DA MALHA (Monitor Serial a cada RELATORIO_TEMPOS) ---
+// Jitter: quanto o intervalo entre dois ticks fugiu de 1 ms.
+std::atomic<uint32_t> maxJitter(0);     // us
+std::atomic<uint32_t> somaJitter(0);    // us somados na janela
+std::atomic<uint32_t> passosControle(0); // passos na janela
+std::atomic<uint32_t> maxPassoControle(0); // us: duração de um passo da tarefa
+
+// --- RESPOSTA AO DEGRAU ---
+// Quando o alvo muda (mesmo sentido, motor girando), a tarefa mede a resposta
+// por JANELA_DEGRAU_MS: subida de 10% a 90% do degrau, sobressinal, tempo até
+// ficar dentro de ±FAIXA_ACOMODACAO do alvo e erro médio no fim. Inclui a rampa,
+// ou seja, é o que o motor realmente faz quando o slider é movido.
+#define JANELA_DEGRAU_MS 3000
+#define FAIXA_ACOMODACAO 0.05f
+struct Degrau {
+  bool ativo;
+  uint32_t inicio;     // millis()
+  float de, para;      // RPM
+  float pico;          // maior fração do degrau alcançada (1.0 = chegou no alvo)
+  uint32_t t10, t90;   // ms desde o início (0 = ainda não chegou)
+  uint32_t ultimoFora; // ms desde o início: última vez fora da faixa
+  float somaErroFinal; // RPM, nos últimos 500 ms
+  uint32_t amostrasFinal;
+};
+Degrau degrau = {};
+Degrau resultadoDegrau;              // cópia para o loop() imprimir
+std::atomic<bool> degrauPronto(false);
+
+// --- TRAÇO CSV (para plotar as rampas) ---
+// Com TRACO_CSV 1, o Monitor Serial vira um CSV a cada TRACO_DIVISOR passos
+// enquanto o motor estiver mudando de velocidade (copie e abra em uma planilha):
+//   t_ms,alvo,velocidade,aceleracao,duty,estado,rpm
+// A tarefa da rampa só coloca o ponto em uma fila; quem imprime é o loop().
+#define TRACO_CSV 0
+#define TRACO_DIVISOR 10 // 1 ponto a cada 10 ms
+struct PontoTraco {
+  uint32_t instante; // ms
+  int8_t alvo;
+  float velocidade;
+  float aceleracao;
+  uint8_t duty;
+  uint8_t estado;
+  float rpm;
+};
+QueueHandle_t filaTraco = NULL;
+
+// =================================================================================
+// 2.4 TELEMETRIA POR BLE
+// =================================================================================
+
+// O app do RemoteXY só manda comandos; de volta vinha só o connect_flag. Aqui
+// um serviço BLE a mais (no mesmo rádio e na mesma conexão do RemoteXY) tem uma
+// característica de telemetria com notify: duty aplicado, sentido, estado, RPM
+// medido, tensão e corrente da fonte e jitter da malha de controle.
+// Ela é lida por um cliente BLE genérico (nRF Connect, Web Bluetooth, um
+// script no PC); o app do RemoteXY não mostra este serviço.
+//
+// O BLEDevice só guarda um BLEServer (o último criado recebe todos os eventos),
+// e esse é o do RemoteXY. Por isso a telemetria é uma app GATT própria no
+// Bluedroid (APP_TELEMETRIA), registrada antes do RemoteXY_Init, com a tabela
+// de atributos do IDF e um handler (setCustomGattsHandler) que só olha os
+// eventos do seu gatts_if.
+//
+// Em vez de um notify por valor, as amostras são juntadas em um pacote do
+// tamanho do MTU negociado e enviadas de uma vez (ou após TELEMETRIA_LATENCIA_MS).
+// Formato de cada notify (little-endian):
+//   [0xD1][n: uint8][seq: uint16][instante da 1ª amostra: uint32 ms]
+//   n x [dt: uint16 ms][duty: uint8][sentido | estado << 1 | failsafe << 3: uint8][rpm x 10: int16]
+//       [tensao: uint16 mV][corrente: uint16 mA][jitter max: uint16 us]
+#define TELEMETRIA_HZ 50             // amostras por segundo
+#define TELEMETRIA_LATENCIA_MS 250   // envia mesmo sem encher o pacote
+#define TELEMETRIA_MARCADOR 0xD1
+#define TELEMETRIA_CABECALHO 8       // bytes
+#define TELEMETRIA_AMOSTRA 12        // bytes
+#define TELEMETRIA_VALORES 6         // valores em cada amostra (para comparar com um notify por valor)
+#define MTU_PEDIDO 247               // maior MTU que cabe em um pacote do rádio com DLE
+#define TAMANHO_PACOTE_LL 251        // bytes úteis por pacote do rádio com Data Length Extension (27 sem)
+#define DIVISOR_TENSAO 11            // (100k + 10k) / 10k
+#define RESISTOR_SENSE_MOHM 500      // 0,5 ohm
+
+#define APP_TELEMETRIA 0x55             // app_id no Bluedroid (o RemoteXY usa a 0)
+
+#define SERVICO_TELEMETRIA "8d1a0001-2f4e-4c2b-9a55-3c7e1f0b6a01"
+#define CARACTERISTICA_TELEMETRIA "8d1a0002-2f4e-4c2b-9a55-3c7e1f0b6a01"
+
+// Os mesmos UUIDs em bytes, na ordem do IDF (little-endian: de trás para frente)
+const uint8_t uuidServicoTelemetria[16] = { 0x01, 0x6a, 0x0b, 0x1f, 0x7e, 0x3c, 0x55, 0x9a,
+                                            0x2b, 0x4c, 0x4e, 0x2f, 0x01, 0x00, 0x1a, 0x8d };
+const uint8_t uuidCaracteristicaTelemetria[16] = { 0x01, 0x6a, 0x0b, 0x1f, 0x7e, 0x3c, 0x55, 0x9a,
+                                                   0x2b, 0x4c, 0x4e, 0x2f, 0x02, 0x00, 0x1a, 0x8d };
+const uint16_t uuidServicoPrimario = ESP_GATT_UUID_PRI_SERVICE;
+const uint16_t uuidDeclaracao = ESP_GATT_UUID_CHAR_DECLARE;
+const uint16_t uuidCccd = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+const uint8_t propriedadeNotify = ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+uint8_t cccdTelemetria[2] = { 0, 0 }; // o cliente escreve 0x0001 para ligar o notify
+
+// Tabela de atributos do serviço (a ordem é a dos handles que o Bluedroid devolve)
+enum { IDX_SERVICO, IDX_DECLARACAO, IDX_VALOR, IDX_CCCD, ATRIBUTOS_TELEMETRIA };
+
+uint8_t pacoteTelemetria[MTU_PEDIDO - 3]; // notify = MTU - 3 bytes do cabeçalho ATT
+
+const esp_gatts_attr_db_t tabelaTelemetria[ATRIBUTOS_TELEMETRIA] = {
+  { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t*)&uuidServicoPrimario, ESP_GATT_PERM_READ,
+                             sizeof(uuidServicoTelemetria), sizeof(uuidServicoTelemetria), (uint8_t*)uuidServicoTelemetria } },
+  { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t*)&uuidDeclaracao, ESP_GATT_PERM_READ,
+                             1, 1, (uint8_t*)&propriedadeNotify } },
+  { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_128, (uint8_t*)uuidCaracteristicaTelemetria, ESP_GATT_PERM_READ,
+                             sizeof(pacoteTelemetria), 0, NULL } },
+  { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t*)&uuidCccd, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                             sizeof(cccdTelemetria), sizeof(cccdTelemetria), cccdTelemetria } },
+};
+
+// Escritos pelo handler GATT (tarefa do Bluetooth), lidos pelo loop()
+std::atomic<uint8_t> telemetriaIf(ESP_GATT_IF_NONE); // gatts_if da nossa app (chega no ESP_GATTS_REG_EVT)
+uint16_t handlesTelemetria[ATRIBUTOS_TELEMETRIA];
+std::atomic<bool> servicoTelemetria(false);        // ESP_GATTS_START_EVT sem erro
+std::atomic<bool> conectadoTelemetria(false);
+std::atomic<uint16_t> connIdTelemetria(0);
+std::atomic<bool> notifyTelemetria(false);         // o cliente ligou o notify no CCCD
+std::atomic<uint16_t> mtuTelemetria(23); // 23 = padrão do BLE até o celular negociar
+std::atomic<uint32_t> notifyRecusados(0);          // ESP_GATTS_CONF_EVT com erro
+std::atomic<uint8_t> dutyAplicado(0);           // escrito pela tarefa da rampa
+std::atomic<uint32_t> maxJitterTelemetria(0);   // us, desde a última amostra
+
+uint8_t amostrasNoPacote = 0;
+uint32_t inicioPacote = 0; // millis() da primeira amostra do pacote
+uint16_t seqTelemetria = 0;
+unsigned long ultimaAmostraTelemetria = 0;
+
+// Vazão na janela do relatório
+uint32_t notificacoesEnviadas = 0;
+uint32_t bytesTelemetria = 0;
+uint32_t amostrasTelemetria = 0;
+uint32_t airtimeTelemetria = 0; // us estimados no rádio (ver airtimeNotify)
+
+// =================================================================================
+// 2.5 FAILSAFE (PARADA SE O CELULAR SUMIR)
+// =================================================================================
+
+// Se o celular desconecta ou sai do alcance, o RemoteXY guarda os últimos
+// valores e o motor continuaria girando. Um supervisor em um timer de hardware
+// próprio (não depende do loop() nem da tarefa da rampa) entra em failsafe se:
+//   1. o BLE avisar que a conexão caiu (ESP_GATTS_DISCONNECT_EVT no handler
+//      GATT, na tarefa do Bluetooth); ou
+//   2. passar PRAZO_HEARTBEAT_MS sem chegar nenhum pacote do app do RemoteXY
+//      (ESP_GATTS_WRITE_EVT de outro gatts_if que não o da telemetria). O app
+//      reenvia os controles a cada ~100 ms; com o celular fora do alcance os
+//      pacotes param na hora, mas o DISCONNECT só vem quando a supervisão da
+//      conexão estoura (segundos depois).
+// Em failsafe a tarefa da rampa leva o motor a zero com limites mais fortes e
+// freia. Se em PRAZO_PARADA_MS (contados da queda) o motor ainda não parou, a
+// própria interrupção corta: IN1 = IN2 = LOW (parada rápida no L298N).
+// Em malha fechada o motor só conta como parado quando o encoder mede menos
+// de RPM_PARADO; em malha aberta não há medida, e o instante em que a rampa
+// chega ao zero (ou o corte) entra no relatório como estimado.
+// O failsafe só é desarmado com o app conectado de novo e o botão Power em
+// desligado: o motor nunca volta a girar sozinho com o valor antigo.
+#define PERIODO_SUPERVISOR_US 5000   // 200 Hz
+#define PRAZO_HEARTBEAT_MS 200
+#define PRAZO_PARADA_MS 500          // da queda até o motor parado (pior caso garantido)
+#define RPM_PARADO 5                 // até 1 pulso na janela de velocidade (4,5 RPM)
+#define ACELERACAO_FAILSAFE 500.0f   // %/s: 100% -> 0 em ~0,25 s
+#define JERK_FAILSAFE 10000.0f       // %/s²
+
+const LimitesRampa limitesFailsafe = { ACELERACAO_FAILSAFE, JERK_FAILSAFE };
+
+// Parâmetros pedidos ao celular ao conectar. A supervisão padrão do Android é
+// de 5 s (o DISCONNECT de um celular fora do alcance demora isso); 2 s é a
+// menor que o iOS aceita em um pedido (abaixo disso ele recusa).
+#define INTERVALO_MIN_CONEXAO 12     // x 1,25 ms = 15 ms
+#define INTERVALO_MAX_CONEXAO 24     // x 1,25 ms = 30 ms
+#define SUPERVISAO_CONEXAO_MS 2000
+
+enum MotivoFailsafe { SEM_FAILSAFE, QUEDA_LINK, SEM_HEARTBEAT };
+
+hw_timer_t* timerSupervisor = NULL;
+std::atomic<uint32_t> ultimoBatimento(0);    // us: último pacote do app do RemoteXY
+std::atomic<bool> linkCaiu(false);           // o handler GATT viu a conexão cair
+std::atomic<uint32_t> instanteQueda(0);      // us: quando caiu
+std::atomic<bool> failsafe(false);
+std::atomic<uint8_t> motivoFailsafe(SEM_FAILSAFE);
+std::atomic<uint32_t> instanteReferencia(0); // us: a queda (ou o último batimento)
+std::atomic<uint32_t> instanteDeteccao(0);   // us: quando o supervisor percebeu
+std::atomic<bool> paradoFailsafe(false);     // o motor já parou depois do failsafe
+std::atomic<uint32_t> instanteParada(0);     // us
+std::atomic<bool> corteForcado(false);       // a interrupção cortou IN1/IN2 no prazo
+std::atomic<bool> paradaMedida(false);       // a parada foi vista no encoder (malha fechada)
+std::atomic<bool> relatorioFailsafe(false);  // há uma parada para o loop() imprimir
+
+// --- PROTÓTIPOS ---
+void pararMotor();
+void escreverDuty(uint8_t duty);
+void entregarComando(const Comando& c);
+void aoDispararTimerRampa();
+void tarefaRampa(void* parametro);
+bool iniciarEncoder();
+bool pcntOk(esp_err_t erro, const char* chamada);
+void verificarEncoder(uint8_t duty);
+void avisarMalhaAberta();
+void lerVelocidade();
+void iniciarDegrau(float para);
+void acompanharDegrau();
+void imprimirDegrau();
+uint8_t calcularDuty();
+void frear(unsigned long& fimFreio);
+uint8_t dutyDaVelocidade(float velocidade);
+void escreverSentido(uint8_t sentido);
+void imprimirTraco();
+void relatorioTempos();
+void iniciarTelemetria();
+void eventoGattsTelemetria(esp_gatts_cb_event_t evento, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t* param);
+uint8_t capacidadeTelemetria();
+void amostrarTelemetria();
+void enviarTelemetria();
+uint32_t airtimeNotify(uint16_t bytes);
+void escreveU16(uint8_t* p, uint16_t v);
+void escreveU32(uint8_t* p, uint32_t v);
+void supervisor();
+void marcarParada(uint32_t agora);
+void confirmarParada();
+void pedirParametrosConexao(esp_ble_gatts_cb_param_t* param);
+void passoFailsafe(float dt, unsigned long& fimFreio);
+void verificarFailsafe();
+void registrarMaximo(std::atomic<uint32_t>& maximo, uint32_t valor);
+uint32_t esperaLoop();
+
 // =================================================================================
 // 3. SETUP (CONFIGURAÇÕES INICIAIS)
 // =================================================================================
 void setup() {
-  RemoteXY_Init();       // Inicia o serviço Bluetooth
+  tarefaLoopHandle = xTaskGetCurrentTaskHandle(); // setup() e loop() rodam na mesma tarefa
   Serial.begin(115200);  // Inicia comunicação Serial para Debug no PC
+  iniciarTelemetria();   // Liga o Bluetooth e registra a app da telemetria (antes do RemoteXY)
+  RemoteXY_Init();       // Inicia o serviço Bluetooth do app
   
   // Configura os pinos de direção como SAÍDA (Output)
   pinMode(pinoIN1, OUTPUT);
@@ -77,6 +442,28 @@ void setup() {
   
   // Garante que o motor comece parado ao ligar a placa
   pararMotor();
+
+  // Malha fechada só com o PCNT funcionando
+  malhaFechada = MODO_MALHA_FECHADA;
+  if (!iniciarEncoder() && malhaFechada) {
+    malhaFechada = false;
+    Serial.println("Sem encoder: seguindo em malha aberta");
+  }
+
+  // Tarefa da rampa (prioridade alta) acordada pelo timer a cada 1 ms
+  if (TRACO_CSV) {
+    filaTraco = xQueueCreate(64, sizeof(PontoTraco));
+    Serial.println("t_ms,alvo,velocidade,aceleracao,duty,estado,rpm");
+  }
+  xTaskCreatePinnedToCore(tarefaRampa, "rampa", 4096, NULL, 5, &tarefaRampaHandle, 1);
+  timerRampa = timerBegin(1000000); // tick de 1 us
+  timerAttachInterrupt(timerRampa, &aoDispararTimerRampa);
+  timerAlarm(timerRampa, 1000000 / FREQ_RAMPA, true, 0);
+
+  // Supervisor do failsafe, em outro timer
+  timerSupervisor = timerBegin(1000000);
+  timerAttachInterrupt(timerSupervisor, &supervisor);
+  timerAlarm(timerSupervisor, PERIODO_SUPERVISOR_US, true, 0);
   
   Serial.println("Sistema iniciado! Aguardando conexao Bluetooth...");
 }
@@ -86,45 +473,44 @@ void setup() {
 // 4. LOOP (LÓGICA DE CONTROLE)
 // =================================================================================
 void loop() {
- 
+  unsigned long inicioHandler = micros();
   RemoteXY_Handler();
+  verificarFailsafe();
 
-  // --- LÓGICA DE LIGAR / DESLIGAR ---
-  // Verifica se o interruptor principal está desligado (0)
-  if (RemoteXY.switch_power == 0) {
-    pararMotor(); // Se desligado, corta tudo.
-  } 
-  else {
-    
-    int velocidade = RemoteXY.slider_vel * 2.55;
-    
-    // --- TRAVAS DE SEGURANÇA ---
-    // Garante que a variável nunca ultrapasse os limites do PWM
-    if (velocidade > 255) velocidade = 255;
-    if (velocidade < 0) velocidade = 0;
-
-    // --- APLICAÇÃO DA VELOCIDADE (DUTY CYCLE) ---
-    // A função ledcWrite altera o "Duty Cycle" (Ciclo de Trabalho).
-
-    ledcWrite(pinoENA, velocidade);
-
-    // --- LÓGICA DE SENTIDO (PONTE H) ---
-    // Verifica a chave de sentido no app
-    if (RemoteXY.switch_sentido == 0) {
-      // Sentido Horário (Frente)
-      // Para girar, um lado deve ser HIGH e o outro LOW.
-      digitalWrite(pinoIN1, HIGH);
-      digitalWrite(pinoIN2, LOW);
-    } else {
-      // Sentido Anti-Horário (Trás)
-      // Invertemos a polaridade: IN1 vira LOW e IN2 vira HIGH.
-      digitalWrite(pinoIN1, LOW);
-      digitalWrite(pinoIN2, HIGH);
-    }
+  // --- O QUE O APP PEDE AGORA ---
+  // Com o interruptor principal desligado, sentido e velocidade não importam:
+  // mexer no slider com o motor desligado não deve tocar nos pinos.
+  Comando pedido = { 0, 0, 0 };
+  if (RemoteXY.switch_power != 0) {
+    pedido.ligado = 1;
+    pedido.sentido = RemoteXY.switch_sentido;
+    pedido.velocidade = RemoteXY.slider_vel;
   }
-  
-  // Pequeno atraso para não sobrecarregar o processador
-  delay(10);
+
+  // --- SÓ APLICA SE MUDOU ---
+  if (memcmp(&pedido, &aplicado, sizeof(Comando)) != 0) {
+    unsigned long inicioAplicacao = micros();
+    entregarComando(pedido);
+    aplicado = pedido;
+
+    unsigned long fim = micros();
+    uint32_t latencia = fim - inicioHandlerAnterior;
+    if (latencia > maxLatencia) maxLatencia = latencia;
+    if (fim - inicioAplicacao > maxAplicacao) maxAplicacao = fim - inicioAplicacao;
+    somaLatencia += latencia;
+    comandosAplicados++;
+  }
+  inicioHandlerAnterior = inicioHandler;
+
+  relatorioTempos();
+  imprimirTraco();
+  imprimirDegrau();
+  avisarMalhaAberta();
+  amostrarTelemetria();
+
+  // Em vez de acordar a cada tick, dorme até chegar um pacote do app: o
+  // comando novo é lido assim que o handler GATT avisa
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(esperaLoop()));
 }
 
 // =================================================================================
@@ -132,8 +518,772 @@ void loop() {
 // =================================================================================
 
 
+// Repassa o comando para a tarefa da rampa (quem mexe nos pinos é ela)
+void entregarComando(const Comando& c) {
+  // --- TRAVAS DE SEGURANÇA ---
+  // Garante que a velocidade nunca ultrapasse os limites do slider
+  int velocidade = c.velocidade;
+  if (velocidade > 100) velocidade = 100;
+  if (velocidade < 0) velocidade = 0;
+
+  velocidadePedida.store(c.sentido == 0 ? velocidade : -velocidade);
+  motorLigado.store(c.ligado);
+}
+
+// Interrupção do timer: só acorda a tarefa da rampa
+void IRAM_ATTR aoDispararTimerRampa() {
+  BaseType_t acordar = pdFALSE;
+  vTaskNotifyGiveFromISR(tarefaRampaHandle, &acordar);
+  if (acordar) portYIELD_FROM_ISR();
+}
+
+// Um passo do perfil (e do PID) a cada tick do timer
+void tarefaRampa(void* parametro) {
+  const float dt = 1.0f / FREQ_RAMPA;
+  unsigned long fimFreio = 0;
+  uint32_t passos = 0;
+  uint32_t tickAnterior = 0;
+  int8_t pedidaAnterior = 0;
+  uint8_t duty = 0;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // Dorme até o próximo tick
+
+    uint32_t inicio = micros();
+    if (tickAnterior != 0) {
+      uint32_t jitter = abs((int32_t)(inicio - tickAnterior) - 1000000 / FREQ_RAMPA);
+      registrarMaximo(maxJitter, jitter);
+      registrarMaximo(maxJitterTelemetria, jitter);
+      somaJitter.fetch_add(jitter, std::memory_order_relaxed);
+      passosControle.fetch_add(1, std::memory_order_relaxed);
+    }
+    tickAnterior = inicio;
+
+    lerVelocidade();
+
+    // --- FAILSAFE ---
+    // Tem prioridade sobre tudo: o comando do app é ignorado até desarmar
+    if (failsafe.load()) {
+      passoFailsafe(dt, fimFreio);
+      pedidaAnterior = 0;
+      registrarMaximo(maxPassoControle, micros() - inicio);
+      continue;
+    }
+
+    // --- LÓGICA DE LIGAR / DESLIGAR ---
+    // Desligar é corte geral: sem rampa, o motor fica solto na hora.
+    if (!motorLigado.load()) {
+      if (estadoMotor != PARADO) {
+        pararMotor();
+        rampa = { 0, 0 };
+        estadoMotor = PARADO;
+        degrau.ativo = false;
+      }
+      pedidaAnterior = 0; // Ao ligar de novo, conta como degrau a partir do zero
+      dutyAplicado.store(0);
+      registrarMaximo(maxPassoControle, micros() - inicio);
+      continue;
+    }
+
+    int8_t pedida = velocidadePedida.load();
+    uint8_t sentidoPedido = pedida < 0 ? 1 : 0;
+    float alvo = abs(pedida);
+
+    if (estadoMotor == PARADO) {
+      // Acabou de ligar: parte do zero no sentido pedido
+      sentidoAtual = sentidoPedido;
+      escreverSentido(sentidoAtual);
+      pidReiniciar(pid, Q16(rpmMedida));
+      estadoMotor = GIRANDO;
+    }
+
+    switch (estadoMotor) {
+      case GIRANDO:
+        if (sentidoPedido != sentidoAtual) {
+          // Inversão: primeiro até parar; parado, freia
+          degrau.ativo = false;
+          rampaPasso(rampa, 0, limites, dt);
+          if (rampaChegou(rampa, 0)) {
+            frear(fimFreio);
+            break;
+          }
+        } else {
+          if (malhaFechada && pedida != pedidaAnterior) iniciarDegrau(alvo * RPM_MAX / 100);
+          rampaPasso(rampa, alvo, limites, dt);
+        }
+
+        duty = calcularDuty();
+        if (malhaFechada) verificarEncoder(duty);
+        if (degrau.ativo) acompanharDegrau();
+        escreverDuty(duty);
+        break;
+
+      case FREANDO:
+        if ((long)(millis() - fimFreio) >= 0) {
+          // Fim do freio: solta e segue no sentido que estiver pedido agora
+          escreverDuty(0);
+          sentidoAtual = sentidoPedido;
+          escreverSentido(sentidoAtual);
+          pidReiniciar(pid, Q16(rpmMedida));
+          estadoMotor = GIRANDO;
+        }
+        break;
+
+      case PARADO:
+        break;
+    }
+    pedidaAnterior = pedida;
+    dutyAplicado.store(estadoMotor == FREANDO ? 255 : duty);
+
+    // Traço: só enquanto algo está mudando
+    if (filaTraco && ++passos % TRACO_DIVISOR == 0
+        && (estadoMotor == FREANDO || !rampaChegou(rampa, alvo) || sentidoPedido != sentidoAtual || degrau.ativo)) {
+      PontoTraco p = { (uint32_t)millis(), pedida, rampa.velocidade, rampa.aceleracao,
+                       estadoMotor == FREANDO ? (uint8_t)255 : duty,
+                       (uint8_t)estadoMotor, rpmMedida };
+      xQueueSend(filaTraco, &p, 0); // Fila cheia: o ponto se perde, a rampa não espera
+    }
+
+    registrarMaximo(maxPassoControle, micros() - inicio);
+  }
+}
+
+// --- ENCODER (PCNT) ---
+
+// Configura o PCNT para contar o encoder sozinho, sem interrupção por pulso.
+// Em quadratura conta as 4 bordas de A e B e o sinal diz o sentido.
+// Devolve false (e deixa unidadeEncoder em NULL) se alguma chamada falhar.
+bool iniciarEncoder() {
+  pcnt_unit_config_t unidade = {};
+  unidade.low_limit = -30000;
+  unidade.high_limit = 30000;
+  unidade.flags.accum_count = 1; // Continua contando além do limite do contador de 16 bits
+  bool ok = pcntOk(pcnt_new_unit(&unidade, &unidadeEncoder), "pcnt_new_unit");
+
+  pcnt_glitch_filter_config_t filtro = {};
+  filtro.max_glitch_ns = 1000; // Ignora pulsos menores que 1 us (ruído do motor)
+  ok = ok && pcntOk(pcnt_unit_set_glitch_filter(unidadeEncoder, &filtro), "pcnt_unit_set_glitch_filter");
+
+  pcnt_chan_config_t configA = {};
+  configA.edge_gpio_num = pinoEncoderA;
+  configA.level_gpio_num = ENCODER_QUADRATURA ? pinoEncoderB : -1;
+  pcnt_channel_handle_t canalA = NULL;
+  pcnt_channel_handle_t canalB = NULL;
+  ok = ok && pcntOk(pcnt_new_channel(unidadeEncoder, &configA, &canalA), "pcnt_new_channel A");
+
+  if (ENCODER_QUADRATURA) {
+    pcnt_chan_config_t configB = {};
+    configB.edge_gpio_num = pinoEncoderB;
+    configB.level_gpio_num = pinoEncoderA;
+    ok = ok && pcntOk(pcnt_new_channel(unidadeEncoder, &configB, &canalB), "pcnt_new_channel B");
+
+    ok = ok && pcntOk(pcnt_channel_set_edge_action(canalA, PCNT_CHANNEL_EDGE_ACTION_DECREASE, PCNT_CHANNEL_EDGE_ACTION_INCREASE),
+                      "pcnt_channel_set_edge_action A");
+    ok = ok && pcntOk(pcnt_channel_set_level_action(canalA, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE),
+                      "pcnt_channel_set_level_action A");
+    ok = ok && pcntOk(pcnt_channel_set_edge_action(canalB, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_DECREASE),
+                      "pcnt_channel_set_edge_action B");
+    ok = ok && pcntOk(pcnt_channel_set_level_action(canalB, PCNT_CHANNEL_LEVEL_ACTION_KEEP, PCNT_CHANNEL_LEVEL_ACTION_INVERSE),
+                      "pcnt_channel_set_level_action B");
+  } else {
+    // Um canal só: conta a borda de subida, sem saber o sentido
+    ok = ok && pcntOk(pcnt_channel_set_edge_action(canalA, PCNT_CHANNEL_EDGE_ACTION_INCREASE, PCNT_CHANNEL_EDGE_ACTION_HOLD),
+                      "pcnt_channel_set_edge_action A");
+  }
+
+  // Os limites precisam ser pontos de observação para o accum_count funcionar
+  ok = ok && pcntOk(pcnt_unit_add_watch_point(unidadeEncoder, unidade.low_limit), "pcnt_unit_add_watch_point");
+  ok = ok && pcntOk(pcnt_unit_add_watch_point(unidadeEncoder, unidade.high_limit), "pcnt_unit_add_watch_point");
+  ok = ok && pcntOk(pcnt_unit_enable(unidadeEncoder), "pcnt_unit_enable");
+  ok = ok && pcntOk(pcnt_unit_clear_count(unidadeEncoder), "pcnt_unit_clear_count");
+  ok = ok && pcntOk(pcnt_unit_start(unidadeEncoder), "pcnt_unit_start");
+  if (ok) return true;
+
+  // Desfaz o que chegou a ser criado (os canais antes da unidade, como o IDF exige)
+  if (canalB) pcnt_del_channel(canalB);
+  if (canalA) pcnt_del_channel(canalA);
+  if (unidadeEncoder) pcnt_del_unit(unidadeEncoder);
+  unidadeEncoder = NULL;
+  return false;
+}
+
+// Confere o retorno de uma chamada do PCNT; na falha imprime qual foi e o erro
+bool pcntOk(esp_err_t erro, const char* chamada) {
+  if (erro == ESP_OK) return true;
+  Serial.print("Encoder: ");
+  Serial.print(chamada);
+  Serial.print(" falhou (");
+  Serial.print(esp_err_to_name(erro));
+  Serial.println(")");
+  return false;
+}
+
+// Com duty alto e nenhum pulso por PRAZO_ENCODER_MS, o encoder não está ligado
+// (ou o motor está travado): desiste da malha fechada em vez de deixar o PID
+// levar o duty ao máximo
+void verificarEncoder(uint8_t duty) {
+  if (duty < DUTY_TESTE_ENCODER || ultimaContagem != contagemTesteEncoder) {
+    contagemTesteEncoder = ultimaContagem;
+    passosSemPulso = 0;
+    return;
+  }
+  if (++passosSemPulso < PRAZO_ENCODER_MS * FREQ_RAMPA / 1000) return;
+  malhaFechada = false;
+  degrau.ativo = false;
+  avisoMalhaAberta.store(true);
+}
+
+// Chamada no loop(): avisa uma vez quando a tarefa da rampa desistiu do encoder
+void avisarMalhaAberta() {
+  if (!avisoMalhaAberta.exchange(false)) return;
+  Serial.print("Encoder sem pulsos com duty >= ");
+  Serial.print(DUTY_TESTE_ENCODER);
+  Serial.print(" por ");
+  Serial.print(PRAZO_ENCODER_MS);
+  Serial.println(" ms: seguindo em malha aberta");
+}
+
+// Lê o contador e atualiza rpmMedida (no sentido atual: positivo = girando como pedido)
+void lerVelocidade() {
+  if (unidadeEncoder == NULL) {
+    rpmMedida = 0; // Sem PCNT não há medida
+    return;
+  }
+  int contagem = 0;
+  if (pcnt_unit_get_count(unidadeEncoder, &contagem) != ESP_OK) return;
+  ultimaContagem = contagem;
+  int diferenca = contagem - contagens[posicaoContagem]; // contra a de JANELA_VELOCIDADE passos atrás
+  contagens[posicaoContagem] = contagem;
+  posicaoContagem = (posicaoContagem + 1) % JANELA_VELOCIDADE;
+
+  float rpm = diferenca * (60.0f * FREQ_RAMPA) / (PULSOS_POR_VOLTA * JANELA_VELOCIDADE);
+  if (!ENCODER_QUADRATURA) rpmMedida = rpm;
+  else rpmMedida = sentidoAtual == 0 ? rpm : -rpm;
+}
+
+// --- RESPOSTA AO DEGRAU ---
+
+void iniciarDegrau(float para) {
+  degrau = {};
+  if (fabsf(para - rpmMedida) < 5) return; // Degrau pequeno demais para medir
+  degrau.ativo = true;
+  degrau.inicio = millis();
+  degrau.de = rpmMedida;
+  degrau.para = para;
+}
+
+void acompanharDegrau() {
+  uint32_t t = millis() - degrau.inicio;
+  float tamanho = degrau.para - degrau.de;
+  float fracao = (rpmMedida - degrau.de) / tamanho;
+
+  if (degrau.t10 == 0 && fracao >= 0.1f) degrau.t10 = t;
+  if (degrau.t90 == 0 && fracao >= 0.9f) degrau.t90 = t;
+  if (fracao > degrau.pico) degrau.pico = fracao;
+  if (fabsf(rpmMedida - degrau.para) > FAIXA_ACOMODACAO * fabsf(tamanho)) degrau.ultimoFora = t;
+  if (t + 500 >= JANELA_DEGRAU_MS) {
+    degrau.somaErroFinal += degrau.para - rpmMedida;
+    degrau.amostrasFinal++;
+  }
+
+  if (t >= JANELA_DEGRAU_MS) {
+    degrau.ativo = false;
+    if (!degrauPronto.load()) { // O loop ainda não imprimiu o anterior? Este se perde
+      resultadoDegrau = degrau;
+      degrauPronto.store(true);
+    }
+  }
+}
+
+// Imprime a última resposta ao degrau medida pela tarefa da rampa
+void imprimirDegrau() {
+  if (!degrauPronto.load()) return;
+  Degrau d = resultadoDegrau;
+  degrauPronto.store(false);
+  if (TRACO_CSV) return; // Não mistura texto no meio do CSV
+
+  Serial.print("Degrau ");
+  Serial.print(d.de, 0);
+  Serial.print(" -> ");
+  Serial.print(d.para, 0);
+  Serial.print(" RPM: subida (10-90%) ");
+  if (d.t90) Serial.print(d.t90 - d.t10);
+  else Serial.print("--");
+  Serial.print(" ms | sobressinal ");
+  Serial.print(d.pico > 1 ? (d.pico - 1) * 100 : 0, 1);
+  Serial.print("% | acomodacao ");
+  Serial.print(d.ultimoFora);
+  Serial.print(" ms | erro final ");
+  Serial.print(d.amostrasFinal ? d.somaErroFinal / d.amostrasFinal : 0, 1);
+  Serial.println(" RPM");
+}
+
+// Duty para a velocidade atual da rampa: em malha fechada a rampa dá o alvo do
+// momento em RPM e o PID acha o duty; em malha aberta é direto
+uint8_t calcularDuty() {
+  if (!malhaFechada) return dutyDaVelocidade(rampa.velocidade);
+  q16 alvoRpm = Q16(rampa.velocidade * RPM_MAX / 100);
+  return pidPasso(pid, ganhos, alvoRpm, Q16(rpmMedida)) >> 16;
+}
+
+// Freio: IN1 = IN2 = HIGH com ENA cheio (motor em curto pela ponte) por FREIO_MS
+void frear(unsigned long& fimFreio) {
+  digitalWrite(pinoIN1, HIGH);
+  digitalWrite(pinoIN2, HIGH);
+  escreverDuty(255);
+  fimFreio = millis() + FREIO_MS;
+  estadoMotor = FREANDO;
+}
+
+// 0 a 100% -> 0 a 255 do PWM
+uint8_t dutyDaVelocidade(float velocidade) {
+  return (uint8_t)(velocidade * 2.55f + 0.5f);
+}
+
+// --- LÓGICA DE SENTIDO (PONTE H) ---
+void escreverSentido(uint8_t sentido) {
+  if (sentido == 0) {
+    // Sentido Horário (Frente)
+    // Para girar, um lado deve ser HIGH e o outro LOW.
+    digitalWrite(pinoIN1, HIGH);
+    digitalWrite(pinoIN2, LOW);
+  } else {
+    // Sentido Anti-Horário (Trás)
+    // Invertemos a polaridade: IN1 vira LOW e IN2 vira HIGH.
+    digitalWrite(pinoIN1, LOW);
+    digitalWrite(pinoIN2, HIGH);
+  }
+}
+
+// Imprime os pontos do traço que a tarefa da rampa deixou na fila
+void imprimirTraco() {
+  if (!filaTraco) return;
+  PontoTraco p;
+  while (xQueueReceive(filaTraco, &p, 0) == pdTRUE) {
+    Serial.print(p.instante);
+    Serial.print(",");
+    Serial.print(p.alvo);
+    Serial.print(",");
+    Serial.print(p.velocidade, 2);
+    Serial.print(",");
+    Serial.print(p.aceleracao, 1);
+    Serial.print(",");
+    Serial.print(p.duty);
+    Serial.print(",");
+    Serial.print(p.estado);
+    Serial.print(",");
+    Serial.println(p.rpm, 1);
+  }
+}
+
+// A cada RELATORIO_TEMPOS imprime a latência dos comandos e zera para a próxima janela
+void relatorioTempos() {
+  if (TRACO_CSV) return; // Não mistura texto no meio do CSV
+  unsigned long now = millis();
+  if (now - ultimoRelatorio < RELATORIO_TEMPOS) return;
+  ultimoRelatorio = now;
+
+  Serial.print("Comandos aplicados: ");
+  Serial.print(comandosAplicados);
+  Serial.print(" | latencia max ");
+  Serial.print(maxLatencia);
+  Serial.print(" us, media ");
+  Serial.print(comandosAplicados ? somaLatencia / comandosAplicados : 0);
+  Serial.print(" us | entrega max ");
+  Serial.print(maxAplicacao);
+  Serial.println(" us");
+
+  uint32_t passos = passosControle.exchange(0);
+  Serial.print("  malha ");
+  Serial.print(malhaFechada ? "fechada" : "aberta");
+  Serial.print(": ");
+  Serial.print(rpmMedida, 1);
+  Serial.print(" RPM | jitter max ");
+  Serial.print(maxJitter.exchange(0));
+  Serial.print(" us, medio ");
+  Serial.print(passos ? somaJitter.exchange(0) / passos : 0);
+  Serial.print(" us | passo max ");
+  Serial.print(maxPassoControle.exchange(0));
+  Serial.println(" us");
+
+  // Telemetria: vazão na janela e tempo de rádio por amostra, contra mandar
+  // cada valor em um notify próprio
+  float segundos = RELATORIO_TEMPOS / 1000.0f;
+  Serial.print("  telemetria: ");
+  Serial.print(notificacoesEnviadas / segundos, 1);
+  Serial.print(" notify/s, ");
+  Serial.print(bytesTelemetria / segundos, 0);
+  Serial.print(" B/s, ");
+  Serial.print(amostrasTelemetria / segundos, 1);
+  Serial.print(" amostras/s | MTU ");
+  Serial.print(mtuTelemetria.load());
+  Serial.print(" (");
+  Serial.print(capacidadeTelemetria());
+  Serial.print(" amostras/notify) | airtime/amostra ");
+  Serial.print(amostrasTelemetria ? airtimeTelemetria / amostrasTelemetria : 0);
+  Serial.print(" us (um notify por valor: ");
+  Serial.print(TELEMETRIA_VALORES * airtimeNotify(2));
+  Serial.print(" us) | recusados ");
+  Serial.println(notifyRecusados.exchange(0));
+  notificacoesEnviadas = 0;
+  bytesTelemetria = 0;
+  amostrasTelemetria = 0;
+  airtimeTelemetria = 0;
+
+  maxLatencia = 0;
+  somaLatencia = 0;
+  maxAplicacao = 0;
+  comandosAplicados = 0;
+}
+
+// --- TELEMETRIA ---
+
+// Liga o Bluedroid e registra a app da telemetria. O resto (tabela de
+// atributos e início do serviço) segue nos eventos, em eventoGattsTelemetria.
+// O RemoteXY_Init vem depois: o BLEDevice::init dele não faz nada de novo e o
+// BLEServer dele continua sendo o único.
+void iniciarTelemetria() {
+  BLEDevice::init(REMOTEXY_BLUETOOTH_NAME);
+  BLEDevice::setCustomGattsHandler(eventoGattsTelemetria);
+  esp_err_t erro = esp_ble_gatt_set_local_mtu(MTU_PEDIDO); // O celular pode aceitar menos; o valor final chega no ESP_GATTS_MTU_EVT
+  if (erro == ESP_OK) erro = esp_ble_gatts_app_register(APP_TELEMETRIA);
+  if (erro != ESP_OK) {
+    Serial.print("Telemetria desligada: ");
+    Serial.println(esp_err_to_name(erro));
+  }
+}
+
+// Handler GATT do Bluedroid, na tarefa do Bluetooth. Recebe os eventos de
+// todas as apps (o RemoteXY também): fora o registro e o batimento do
+// failsafe, só trata os do nosso gatts_if.
+void eventoGattsTelemetria(esp_gatts_cb_event_t evento, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t* param) {
+  if (evento == ESP_GATTS_REG_EVT) {
+    if (param->reg.app_id != APP_TELEMETRIA) return;
+    if (param->reg.status != ESP_GATT_OK) {
+      Serial.println("Telemetria desligada: app GATT recusada");
+      return;
+    }
+    telemetriaIf = gattsIf;
+    if (esp_ble_gatts_create_attr_tab(tabelaTelemetria, gattsIf, ATRIBUTOS_TELEMETRIA, 0) != ESP_OK) {
+      Serial.println("Telemetria desligada: tabela de atributos recusada");
+    }
+    return;
+  }
+  if (gattsIf != telemetriaIf.load()) {
+    // Escrita na app do RemoteXY: chegou um pacote do app (sinal de vida para o
+    // supervisor). O BLEServer do RemoteXY já guardou os bytes (ele recebe o
+    // evento antes deste handler), então o loop() pode acordar e ler
+    if (evento == ESP_GATTS_WRITE_EVT) {
+      ultimoBatimento.store((uint32_t)esp_timer_get_time());
+      if (tarefaLoopHandle) xTaskNotifyGive(tarefaLoopHandle);
+    }
+    return;
+  }
+
+  switch (evento) {
+    case ESP_GATTS_CREAT_ATTR_TAB_EVT:
+      if (param->add_attr_tab.status != ESP_GATT_OK || param->add_attr_tab.num_handle != ATRIBUTOS_TELEMETRIA) {
+        Serial.println("Telemetria desligada: tabela de atributos recusada");
+        break;
+      }
+      memcpy(handlesTelemetria, param->add_attr_tab.handles, sizeof(handlesTelemetria));
+      esp_ble_gatts_start_service(handlesTelemetria[IDX_SERVICO]);
+      break;
+
+    case ESP_GATTS_START_EVT:
+      servicoTelemetria = param->start.status == ESP_GATT_OK;
+      if (!servicoTelemetria) Serial.println("Telemetria desligada: servico nao iniciou");
+      break;
+
+    case ESP_GATTS_CONNECT_EVT:
+      connIdTelemetria = param->connect.conn_id;
+      conectadoTelemetria = true;
+      linkCaiu = false;
+      pedirParametrosConexao(param);
+      break;
+
+    case ESP_GATTS_MTU_EVT:
+      mtuTelemetria = param->mtu.mtu;
+      break;
+
+    case ESP_GATTS_WRITE_EVT: // Só o CCCD é gravável (a pilha já respondeu: ESP_GATT_AUTO_RSP)
+      if (param->write.handle == handlesTelemetria[IDX_CCCD] && param->write.len == 2) {
+        notifyTelemetria = (param->write.value[0] & 1) != 0;
+      }
+      break;
+
+    case ESP_GATTS_CONF_EVT:
+      if (param->conf.status != ESP_GATT_OK) notifyRecusados++;
+      break;
+
+    case ESP_GATTS_DISCONNECT_EVT:
+      conectadoTelemetria = false;
+      notifyTelemetria = false; // O cliente liga de novo na próxima conexão
+      mtuTelemetria = 23;
+      instanteQueda = (uint32_t)esp_timer_get_time();
+      linkCaiu = true; // O supervisor vê no próximo tick (até 5 ms)
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Pede intervalo e supervisão ao celular (ele pode recusar; aí seguem os dele).
+// O CONNECT chega uma vez por app: só a da telemetria pede. Se a supervisão
+// do celular já é curta (o iOS usa 720 ms), não pede: pioraria a detecção.
+void pedirParametrosConexao(esp_ble_gatts_cb_param_t* param) {
+  if (param->connect.conn_params.timeout * 10 <= SUPERVISAO_CONEXAO_MS) return;
+  esp_ble_conn_update_params_t parametros = {};
+  memcpy(parametros.bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+  parametros.min_int = INTERVALO_MIN_CONEXAO;
+  parametros.max_int = INTERVALO_MAX_CONEXAO;
+  parametros.latency = 0; // O ESP32 não pula eventos: o comando chega no próximo
+  parametros.timeout = SUPERVISAO_CONEXAO_MS / 10;
+  esp_err_t erro = esp_ble_gap_update_conn_params(&parametros);
+  if (erro != ESP_OK) {
+    Serial.print("Parametros de conexao: ");
+    Serial.println(esp_err_to_name(erro));
+  }
+}
+
+// Quantas amostras cabem em um notify com o MTU atual
+uint8_t capacidadeTelemetria() {
+  uint16_t carga = min<uint16_t>(mtuTelemetria.load() - 3, sizeof(pacoteTelemetria));
+  return (carga - TELEMETRIA_CABECALHO) / TELEMETRIA_AMOSTRA;
+}
+
+// Lê uma amostra a cada 1/TELEMETRIA_HZ s e envia quando o pacote enche
+void amostrarTelemetria() {
+  if (!servicoTelemetria.load() || !conectadoTelemetria.load() || !notifyTelemetria.load()) {
+    amostrasNoPacote = 0;
+    return;
+  }
+  unsigned long agora = millis();
+  if (agora - ultimaAmostraTelemetria < 1000 / TELEMETRIA_HZ) return;
+  ultimaAmostraTelemetria = agora;
+
+  if (amostrasNoPacote == 0) inicioPacote = agora;
+  uint8_t* p = pacoteTelemetria + TELEMETRIA_CABECALHO + amostrasNoPacote * TELEMETRIA_AMOSTRA;
+  escreveU16(p, agora - inicioPacote);
+  p[2] = dutyAplicado.load();
+  p[3] = sentidoAtual | (estadoMotor << 1) | (failsafe.load() << 3);
+  escreveU16(p + 4, (int16_t)(rpmMedida * 10));
+  escreveU16(p + 6, analogReadMilliVolts(pinoTensao) * DIVISOR_TENSAO);
+  escreveU16(p + 8, (uint32_t)analogReadMilliVolts(pinoCorrente) * 1000 / RESISTOR_SENSE_MOHM);
+  escreveU16(p + 10, min<uint32_t>(maxJitterTelemetria.exchange(0), 65535));
+  amostrasNoPacote++;
+
+  if (amostrasNoPacote >= capacidadeTelemetria() || agora - inicioPacote >= TELEMETRIA_LATENCIA_MS) {
+    enviarTelemetria();
+  }
+}
+
+// Ticks que o loop() pode dormir sem atrasar a próxima amostra da telemetria
+// (pelo menos 1, para não deixar as outras tarefas sem CPU)
+uint32_t esperaLoop() {
+  uint32_t espera = ESPERA_MAX_LOOP_MS;
+  if (notifyTelemetria.load()) {
+    uint32_t passou = millis() - ultimaAmostraTelemetria;
+    uint32_t periodo = 1000 / TELEMETRIA_HZ;
+    espera = passou >= periodo ? 1 : min<uint32_t>(espera, periodo - passou);
+  }
+  return espera;
+}
+
+// Fecha o cabeçalho e manda o pacote em um único notify
+void enviarTelemetria() {
+  pacoteTelemetria[0] = TELEMETRIA_MARCADOR;
+  pacoteTelemetria[1] = amostrasNoPacote;
+  escreveU16(pacoteTelemetria + 2, seqTelemetria++);
+  escreveU32(pacoteTelemetria + 4, inicioPacote);
+  size_t tamanho = TELEMETRIA_CABECALHO + amostrasNoPacote * TELEMETRIA_AMOSTRA;
+  // need_confirm = false: notify (sem confirmação do celular); um erro volta no ESP_GATTS_CONF_EVT
+  esp_err_t erro = esp_ble_gatts_send_indicate(telemetriaIf.load(), connIdTelemetria.load(), handlesTelemetria[IDX_VALOR],
+                                               tamanho, pacoteTelemetria, false);
+  if (erro != ESP_OK) {
+    // O pacote não saiu: só conta a recusa. As amostras são descartadas e o
+    // buraco no seq mostra a perda para o celular
+    notifyRecusados++;
+    amostrasNoPacote = 0;
+    return;
+  }
+
+  notificacoesEnviadas++;
+  bytesTelemetria += tamanho;
+  amostrasTelemetria += amostrasNoPacote;
+  airtimeTelemetria += airtimeNotify(tamanho);
+  amostrasNoPacote = 0;
+}
+
+// Tempo estimado de rádio (us, PHY de 1 Mbit/s) para um notify com "bytes" de
+// dados: +3 do cabeçalho ATT e +4 do L2CAP, quebrado em pacotes de até
+// TAMANHO_PACOTE_LL; cada pacote tem +10 bytes (preâmbulo, endereço, cabeçalho
+// e CRC), 150 us de intervalo, o ACK vazio do celular (80 us) e mais 150 us.
+uint32_t airtimeNotify(uint16_t bytes) {
+  uint32_t restante = bytes + 7;
+  uint32_t total = 0;
+  while (restante > 0) {
+    uint32_t pedaco = min<uint32_t>(restante, TAMANHO_PACOTE_LL);
+    total += (pedaco + 10) * 8 + 150 + 80 + 150;
+    restante -= pedaco;
+  }
+  return total;
+}
+
+// Inteiros em little-endian (como o ESP32 e os celulares guardam na memória)
+void escreveU16(uint8_t* p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+void escreveU32(uint8_t* p, uint32_t v) {
+  escreveU16(p, v & 0xFFFF);
+  escreveU16(p + 2, v >> 16);
+}
+
+// --- FAILSAFE ---
+
+// Interrupção do supervisor (a cada PERIODO_SUPERVISOR_US). Só lê e escreve
+// atomics e, no pior caso, os pinos de direção com gpio_set_level.
+void IRAM_ATTR supervisor() {
+  uint32_t agora = (uint32_t)esp_timer_get_time();
+
+  if (!failsafe.load()) {
+    if (!motorLigado.load()) return; // Motor desligado: nada a proteger
+    uint8_t motivo = SEM_FAILSAFE;
+    uint32_t referencia = 0;
+    if (linkCaiu.load()) {
+      motivo = QUEDA_LINK;
+      referencia = instanteQueda.load();
+    } else if ((int32_t)(agora - ultimoBatimento.load()) > PRAZO_HEARTBEAT_MS * 1000L) {
+      // Com sinal: o batimento pode ter sido gravado no outro núcleo depois de "agora"
+      motivo = SEM_HEARTBEAT;
+      referencia = ultimoBatimento.load();
+    }
+    if (motivo == SEM_FAILSAFE) return;
+
+    motivoFailsafe.store(motivo);
+    instanteReferencia.store(referencia);
+    instanteDeteccao.store(agora);
+    failsafe.store(true); // A tarefa da rampa começa a parar no próximo tick
+    return;
+  }
+
+  // Prazo estourado sem o motor parado (tarefa da rampa atrasada ou travada): corta aqui mesmo
+  if (!paradoFailsafe.load() && !corteForcado.load() && agora - instanteReferencia.load() >= PRAZO_PARADA_MS * 1000UL) {
+    gpio_set_level((gpio_num_t)pinoIN1, 0);
+    gpio_set_level((gpio_num_t)pinoIN2, 0);
+    corteForcado.store(true);
+    // Sem encoder, o corte é a melhor estimativa; com encoder, espera a medida (confirmarParada)
+    if (!malhaFechada.load()) marcarParada(agora);
+  }
+}
+
+// Marca o instante em que o motor parou (uma vez por failsafe: quem chegar primeiro,
+// a tarefa da rampa ou o corte na interrupção)
+void IRAM_ATTR marcarParada(uint32_t agora) {
+  bool esperado = false;
+  if (!paradoFailsafe.compare_exchange_strong(esperado, true)) return;
+  instanteParada.store(agora);
+  paradaMedida.store(malhaFechada.load());
+  relatorioFailsafe.store(true);
+}
+
+// Um passo da tarefa da rampa em failsafe: rampa forte até zero, freio, solto
+void passoFailsafe(float dt, unsigned long& fimFreio) {
+  degrau.ativo = false;
+  if (corteForcado.load()) {
+    // A interrupção já cortou: só deixa tudo coerente (ENA em 0) e não mexe mais
+    if (estadoMotor != PARADO) {
+      pararMotor();
+      rampa = { 0, 0 };
+      estadoMotor = PARADO;
+    }
+    dutyAplicado.store(0);
+    confirmarParada();
+    return;
+  }
+
+  switch (estadoMotor) {
+    case GIRANDO:
+      rampaPasso(rampa, 0, limitesFailsafe, dt);
+      if (rampaChegou(rampa, 0)) {
+        frear(fimFreio);
+        confirmarParada(); // Rampa no zero e freio puxado
+        dutyAplicado.store(255);
+      } else {
+        uint8_t duty = calcularDuty();
+        escreverDuty(duty);
+        dutyAplicado.store(duty);
+      }
+      break;
+
+    case FREANDO: // Freio da rampa normal ou do failsafe: termina e fica parado
+      confirmarParada();
+      if ((long)(millis() - fimFreio) >= 0) {
+        pararMotor();
+        rampa = { 0, 0 };
+        estadoMotor = PARADO;
+        dutyAplicado.store(0);
+      }
+      break;
+
+    case PARADO:
+      confirmarParada();
+      dutyAplicado.store(0);
+      break;
+  }
+}
+
+// Na tarefa da rampa em failsafe: em malha fechada, parado é o que o encoder
+// mede; em malha aberta, o instante em que a rampa chegou ao zero (estimado)
+void confirmarParada() {
+  if (malhaFechada.load() && fabsf(rpmMedida) >= RPM_PARADO) return;
+  marcarParada((uint32_t)esp_timer_get_time());
+}
+
+// Chamada no loop(): imprime a latência da última parada e desarma o failsafe
+// quando o app voltou e o botão Power está em desligado
+void verificarFailsafe() {
+  if (relatorioFailsafe.load()) {
+    relatorioFailsafe.store(false);
+    uint32_t referencia = instanteReferencia.load();
+    Serial.print("FAILSAFE (");
+    Serial.print(motivoFailsafe.load() == QUEDA_LINK ? "conexao caiu" : "sem heartbeat");
+    Serial.print("): detectado em ");
+    Serial.print((instanteDeteccao.load() - referencia) / 1000.0f, 1);
+    Serial.print(" ms, motor parado em ");
+    Serial.print((instanteParada.load() - referencia) / 1000.0f, 1);
+    Serial.print(paradaMedida.load() ? " ms (medido no encoder, prazo " : " ms (estimado, sem encoder, prazo ");
+    Serial.print(PRAZO_PARADA_MS);
+    Serial.println(corteForcado.load() ? " ms, corte forcado)" : " ms)");
+  }
+
+  if (failsafe.load() && paradoFailsafe.load() && RemoteXY.connect_flag && RemoteXY.switch_power == 0) {
+    corteForcado.store(false);
+    paradoFailsafe.store(false);
+    linkCaiu.store(false);
+    failsafe.store(false);
+    Serial.println("Failsafe desarmado: app conectado e motor desligado");
+  }
+}
+
+void registrarMaximo(std::atomic<uint32_t>& maximo, uint32_t valor) {
+  uint32_t atual = maximo.load(std::memory_order_relaxed);
+  while (valor > atual && !maximo.compare_exchange_weak(atual, valor, std::memory_order_relaxed)) {
+  }
+}
+
 void pararMotor() {
   digitalWrite(pinoIN1, LOW);  // Desliga saida 1
   digitalWrite(pinoIN2, LOW);  // Desliga saida 2
-  ledcWrite(pinoENA, 0);       // Zera o PWM (Velocidade 0)
+  escreverDuty(0);             // Zera o PWM (Velocidade 0)
+}
+
+// ledcWrite em ENA só quando o duty muda
+void escreverDuty(uint8_t duty) {
+  if (duty == dutyNoPino) return;
+  ledcWrite(pinoENA, duty);
+  dutyNoPino = duty;
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+// Controlador PID de velocidade em ponto fixo (Q16.16), com anti-windup.
+//
+// Ponto fixo: um número x é guardado como o inteiro x * 65536 (16 bits de parte
+// fracionária). Somas são somas comuns e multiplicações passam por int64 e
+// voltam com >> 16. O passo do PID fica com tempo de execução constante, sem
+// depender da FPU.
+//
+// Assim como o rampa.h, é C++ puro (sem Arduino): ESP32/testes/teste_pid.cpp
+// roda o sketch com ele contra o motor CC simulado de motor_cc.h.
+#pragma once
+#include <stdint.h>
+
+typedef int32_t q16; // ponto fixo 16.16
+#define Q16(x) ((q16)((x) * 65536.0))
+
+inline q16 q16Mul(q16 a, q16 b) {
+  return (q16)(((int64_t)a * b) >> 16);
+}
+
+// Ganhos já "por passo": com o PID rodando a f Hz, ki = Ki / f e kd = Kd * f.
+// A saída é o duty do PWM (0 a saidaMax) e as velocidades são em RPM.
+struct GanhosPid {
+  q16 kp;       // duty por RPM de erro
+  q16 ki;       // duty por RPM de erro, somado a cada passo
+  q16 kd;       // duty por RPM de variação da medida entre dois passos
+  q16 kff;      // feedforward: duty por RPM de alvo (o que o motor pede sem carga)
+  q16 saidaMax; // ex.: Q16(255)
+};
+
+struct Pid {
+  q16 integral;       // parcela integral acumulada (já em duty)
+  q16 medidaAnterior; // para a derivada
+  bool saturado;      // a última saída foi cortada em 0 ou saidaMax
+};
+
+// Zera a memória do controlador (ao ligar ou depois de uma inversão)
+inline void pidReiniciar(Pid& p, q16 medida) {
+  p.integral = 0;
+  p.medidaAnterior = medida;
+  p.saturado = false;
+}
+
+// Um passo do controlador: devolve o duty (Q16) para o alvo e a medida dados
+inline q16 pidPasso(Pid& p, const GanhosPid& g, q16 alvo, q16 medida) {
+  q16 erro = alvo - medida;
+  q16 base = q16Mul(g.kff, alvo) + q16Mul(g.kp, erro);
+  // Derivada da medida (e não do erro): mudar o alvo não dá um "chute" na saída
+  q16 derivada = -q16Mul(g.kd, medida - p.medidaAnterior);
+  p.medidaAnterior = medida;
+
+  // Anti-windup: a integral só anda se isso não empurrar ainda mais uma saída
+  // já saturada (integração condicional), e nunca passa da faixa da saída.
+  q16 integral = p.integral + q16Mul(g.ki, erro);
+  if (integral > g.saidaMax) integral = g.saidaMax;
+  if (integral < -g.saidaMax) integral = -g.saidaMax;
+  q16 saida = base + integral + derivada;
+  bool empurraParaCima = saida > g.saidaMax && erro > 0;
+  bool empurraParaBaixo = saida < 0 && erro < 0;
+  if (!empurraParaCima && !empurraParaBaixo) p.integral = integral;
+
+  saida = base + p.integral + derivada;
+  p.saturado = saida > g.saidaMax || saida < 0;
+  if (saida > g.saidaMax) saida = g.saidaMax;
+  if (saida < 0) saida = 0;
+  return saida;
+}
@@ -0,0 +1,57 @@
+// Gerador de perfil de velocidade com aceleração e jerk limitados (curva em S).
+//
+// A velocidade não pula para o valor pedido: a aceleração sobe e desce aos
+// poucos (no máximo "jerk" por segundo) e nunca passa de "aceleracao". Assim o
+// degrau do slider (0 -> 100) vira uma rampa suave e a corrente de partida do
+// motor não derruba a fonte.
+//
+// Só usa C++ puro (sem Arduino), para poder ser testado no PC: basta incluir
+// este arquivo, chamar rampaPasso() em um laço e imprimir a velocidade.
+#pragma once
+#include <math.h>
+
+struct LimitesRampa {
+  float aceleracao; // %/s (ex.: 200 = de 0 a 100% em 0,5 s, sem contar o jerk)
+  float jerk;       // %/s² (quanto a aceleração pode mudar por segundo)
+};
+
+struct Rampa {
+  float velocidade; // % (0 a 100): o que vai para o PWM
+  float aceleracao; // %/s no momento
+};
+
+// Avança o perfil um passo de dt segundos em direção a "alvo" (0 a 100).
+// Chamar sempre no mesmo ritmo (ex.: 1 kHz, dt = 0.001).
+inline void rampaPasso(Rampa& r, float alvo, const LimitesRampa& lim, float dt) {
+  float erro = alvo - r.velocidade;
+
+  // Se a aceleração começar a voltar a zero agora (no ritmo do jerk), a
+  // velocidade ainda anda acel² / (2 * jerk). Se isso já cobre o erro, é hora
+  // de tirar a aceleração; senão, dá para acelerar mais.
+  float frenagem = r.aceleracao * fabsf(r.aceleracao) / (2 * lim.jerk);
+  float restante = erro - frenagem;
+  float aceleracaoDesejada = 0;
+  if (restante > 0) aceleracaoDesejada = lim.aceleracao;
+  else if (restante < 0) aceleracaoDesejada = -lim.aceleracao;
+
+  // A aceleração só muda até jerk * dt por passo
+  float passo = lim.jerk * dt;
+  float mudanca = aceleracaoDesejada - r.aceleracao;
+  if (mudanca > passo) mudanca = passo;
+  if (mudanca < -passo) mudanca = -passo;
+  r.aceleracao += mudanca;
+  r.velocidade += r.aceleracao * dt;
+
+  // Chegou (ou passou um fio): encaixa no alvo para não ficar oscilando em volta
+  if (fabsf(alvo - r.velocidade) < 0.05f && fabsf(r.aceleracao) <= passo) {
+    r.velocidade = alvo;
+    r.aceleracao = 0;
+  }
+  if (r.velocidade < 0) r.velocidade = 0;
+  if (r.velocidade > 100) r.velocidade = 100;
+}
+
+// Perfil parado e encaixado no alvo?
+inline bool rampaChegou(const Rampa& r, float alvo) {
+  return r.velocidade == alvo && r.aceleracao == 0;
+}
@@ -0,0 +1,328 @@
+#include "broker.h"
+
+using mqtt::Pacote;
+using mqtt::Publicacao;
+
+static std::vector<std::string> niveisDe(const std::string& topico) {
+  std::vector<std::string> niveis;
+  size_t inicio = 0;
+  for (;;) {
+    size_t fim = topico.find('/', inicio);
+    niveis.push_back(topico.substr(inicio, fim == std::string::npos ? std::string::npos : fim - inicio));
+    if (fim == std::string::npos) return niveis;
+    inicio = fim + 1;
+  }
+}
+
+Broker::Broker(Enviar enviar, Derrubar derrubar) : enviar(enviar), derrubar(derrubar) {}
+
+int Broker::abrir() {
+  int conexao = proximaConexao++;
+  sessoes[conexao];
+  return conexao;
+}
+
+void Broker::receber(int conexao, const char* dados, size_t n, uint64_t agoraMs) {
+  auto it = sessoes.find(conexao);
+  if (it == sessoes.end()) return;
+  contadores.bytesEntrada += n;
+  it->second.leitor.adicionar(dados, n);
+  it->second.ultimoPacoteMs = agoraMs;
+
+  Pacote p;
+  // A sessão pode sumir no meio (DISCONNECT, erro): procura de novo a cada pacote
+  while ((it = sessoes.find(conexao)) != sessoes.end() && it->second.leitor.proximo(p)) tratar(conexao, it->second, p);
+  if (it != sessoes.end() && it->second.leitor.erro()) encerrar(conexao, true);
+}
+
+void Broker::fechar(int conexao) {
+  if (!sessoes.count(conexao)) return;
+  contadores.quedas++;
+  apagar(conexao);
+}
+
+void Broker::verificarKeepAlive(uint64_t agoraMs) {
+  std::vector<int> vencidas;
+  for (auto& par : sessoes) {
+    const Sessao& s = par.second;
+    if (s.conectada && s.keepAliveS > 0 && agoraMs - s.ultimoPacoteMs > s.keepAliveS * 1500ull) vencidas.push_back(par.first);
+  }
+  for (int conexao : vencidas) {
+    contadores.keepAliveVencidos++;
+    encerrar(conexao, false);
+  }
+}
+
+size_t Broker::assinaturas() const {
+  size_t n = 0;
+  for (const auto& par : sessoes) n += par.second.filtros.size();
+  return n;
+}
+
+size_t Broker::pendentes(int conexao) const {
+  auto it = sessoes.find(conexao);
+  return it == sessoes.end() ? 0 : it->second.emVoo.size() + it->second.fila.size();
+}
+
+// --- PACOTES ---
+
+void Broker::tratar(int conexao, Sessao& s, const Pacote& p) {
+  if (!s.conectada) {
+    // O primeiro pacote tem que ser o CONNECT
+    if (p.tipo != mqtt::CONNECT || !tratarConnect(conexao, s, p)) encerrar(conexao, true);
+    return;
+  }
+  switch (p.tipo) {
+    case mqtt::PUBLISH: tratarPublish(conexao, s, p); break;
+    case mqtt::PUBACK: tratarPuback(conexao, s, p); break;
+    case mqtt::SUBSCRIBE: tratarSubscribe(conexao, s, p); break;
+    case mqtt::UNSUBSCRIBE: tratarUnsubscribe(conexao, s, p); break;
+    case mqtt::PINGREQ: mandar(conexao, mqtt::montar(mqtt::PINGRESP, 0, "")); break;
+    case mqtt::DISCONNECT:
+      contadores.desconexoes++;
+      apagar(conexao);
+      if (derrubar) derrubar(conexao);
+      break;
+    default: encerrar(conexao, true); break; // CONNECT repetido, QoS 2, pacote de servidor...
+  }
+}
+
+bool Broker::tratarConnect(int conexao, Sessao& s, const Pacote& p) {
+  size_t pos = 0;
+  std::string protocolo;
+  if (!mqtt::lerTexto(p.corpo, &pos, protocolo) || pos + 4 > p.corpo.size()) return false;
+  uint8_t nivel = p.corpo[pos], flags = p.corpo[pos + 1];
+  pos += 2;
+  uint16_t keepAlive;
+  mqtt::lerU16(p.corpo, &pos, &keepAlive);
+  std::string id;
+  if (!mqtt::lerTexto(p.corpo, &pos, id)) return false;
+  if (protocolo != "MQTT" || nivel != 4) {
+    mandar(conexao, mqtt::connack(1)); // versão do protocolo não aceita
+    return false;
+  }
+  if (!(flags & 0x02) && id.empty()) {
+    mandar(conexao, mqtt::connack(2)); // identificador recusado
+    return false;
+  }
+  // Will, usuário e senha (se vierem) são ignorados
+  if (id.empty()) id = "anonimo-" + std::to_string(conexao);
+
+  // Mesmo identificador conectado em outra conexão: a antiga sai (3.1.4-2)
+  auto antigo = porId.find(id);
+  if (antigo != porId.end()) encerrar(antigo->second, false);
+
+  s.conectada = true;
+  s.id = id;
+  s.keepAliveS = keepAlive;
+  porId[id] = conexao;
+  contadores.conexoes++;
+  mandar(conexao, mqtt::connack(0));
+  return true;
+}
+
+void Broker::tratarPublish(int conexao, Sessao& s, const Pacote& p) {
+  Publicacao pub;
+  if (!mqtt::lerPublish(p, pub) || pub.topico.find_first_of("+#") != std::string::npos) {
+    encerrar(conexao, true);
+    return;
+  }
+  contadores.publicacoes++;
+  if (pub.qos == 1) mandar(conexao, mqtt::puback(pub.id));
+
+  if (pub.retido) {
+    if (pub.payload.empty()) retidos.erase(pub.topico); // payload vazio apaga a retida
+    else retidos[pub.topico] = pub;
+  }
+
+  std::unordered_map<int, uint8_t> destino;
+  casar(raiz, niveisDe(pub.topico), 0, destino);
+  pub.retido = false; // para quem já assinava, a mensagem vai sem a flag (3.3.1-9)
+  pub.dup = false;
+  for (const auto& d : destino) {
+    auto it = sessoes.find(d.first);
+    if (it == sessoes.end()) continue;
+    Publicacao copia = pub;
+    copia.qos = std::min(pub.qos, d.second);
+    entregar(d.first, it->second, copia);
+  }
+}
+
+void Broker::tratarSubscribe(int conexao, Sessao& s, const Pacote& p) {
+  size_t pos = 0;
+  uint16_t id;
+  if ((p.flags != 0x02) || !mqtt::lerU16(p.corpo, &pos, &id)) {
+    encerrar(conexao, true);
+    return;
+  }
+  std::string codigos;
+  std::vector<std::pair<std::string, uint8_t> > novos;
+  while (pos < p.corpo.size()) {
+    std::string filtro;
+    if (!mqtt::lerTexto(p.corpo, &pos, filtro) || pos >= p.corpo.size()) {
+      encerrar(conexao, true);
+      return;
+    }
+    uint8_t qos = std::min<uint8_t>(p.corpo[pos++], 1); // QoS 2 vira 1
+    if (!mqtt::filtroValido(filtro)) {
+      codigos += (char)0x80;
+      continue;
+    }
+    bool repetido = false;
+    for (const std::string& f : s.filtros) repetido = repetido || f == filtro;
+    if (!repetido) s.filtros.push_back(filtro);
+    assinar(filtro, conexao, qos);
+    codigos += (char)qos;
+    novos.emplace_back(filtro, qos);
+  }
+  if (codigos.empty()) {
+    encerrar(conexao, true);
+    return;
+  }
+  mandar(conexao, mqtt::montar(mqtt::SUBACK, 0, mqtt::u16(id) + codigos));
+
+  // Retidas que casam com os filtros novos (3.3.1-6)
+  for (const auto& novo : novos)
+    for (const auto& r : retidos) {
+      if (!mqtt::casaTopico(novo.first, r.first)) continue;
+      auto it = sessoes.find(conexao);
+      if (it == sessoes.end()) return;
+      Publicacao copia = r.second;
+      copia.qos = std::min(copia.qos, novo.second);
+      copia.retido = true;
+      entregar(conexao, it->second, copia);
+    }
+}
+
+void Broker::tratarUnsubscribe(int conexao, Sessao& s, const Pacote& p) {
+  size_t pos = 0;
+  uint16_t id;
+  if (p.flags != 0x02 || !mqtt::lerU16(p.corpo, &pos, &id)) {
+    encerrar(conexao, true);
+    return;
+  }
+  while (pos < p.corpo.size()) {
+    std::string filtro;
+    if (!mqtt::lerTexto(p.corpo, &pos, filtro)) {
+      encerrar(conexao, true);
+      return;
+    }
+    desassinar(filtro, conexao);
+    for (size_t i = 0; i < s.filtros.size(); i++)
+      if (s.filtros[i] == filtro) {
+        s.filtros.erase(s.filtros.begin() + i);
+        break;
+      }
+  }
+  mandar(conexao, mqtt::montar(mqtt::UNSUBACK, 0, mqtt::u16(id)));
+}
+
+void Broker::tratarPuback(int conexao, Sessao& s, const Pacote& p) {
+  size_t pos = 0;
+  uint16_t id;
+  if (!mqtt::lerU16(p.corpo, &pos, &id)) {
+    encerrar(conexao, true);
+    return;
+  }
+  s.emVoo.erase(id);
+  // Abriu vaga: sai o próximo da fila
+  while (!s.fila.empty() && s.emVoo.size() < maxEmVoo) {
+    Publicacao proxima = s.fila.front();
+    s.fila.pop_front();
+    entregar(conexao, s, proxima);
+  }
+}
+
+// --- ENTREGA ---
+
+void Broker::entregar(int conexao, Sessao& s, Publicacao p) {
+  if (p.qos == 1) {
+    if (s.emVoo.size() >= maxEmVoo) {
+      if (s.fila.size() >= maxFila) contadores.descartes++;
+      else s.fila.push_back(p);
+      return;
+    }
+    do {
+      p.id = s.proximoId++;
+      if (s.proximoId == 0) s.proximoId = 1;
+    } while (s.emVoo.count(p.id));
+    s.emVoo.insert(p.id);
+  }
+  contadores.entregas++;
+  mandar(conexao, mqtt::publish(p));
+}
+
+void Broker::mandar(int conexao, const std::string& bytes) {
+  contadores.bytesSaida += bytes.size();
+  enviar(conexao, bytes);
+}
+
+// Fecha pelo lado do broker (erro de protocolo, keep alive, identificador repetido)
+void Broker::encerrar(int conexao, bool erro) {
+  if (erro) contadores.errosProtocolo++;
+  apagar(conexao);
+  if (derrubar) derrubar(conexao);
+}
+
+void Broker::apagar(int conexao) {
+  auto it = sessoes.find(conexao);
+  if (it == sessoes.end()) return;
+  for (const std::string& f : it->second.filtros) desassinar(f, conexao);
+  auto id = porId.find(it->second.id);
+  if (id != porId.end() && id->second == conexao) porId.erase(id);
+  sessoes.erase(it);
+}
+
+// --- ÁRVORE DE TÓPICOS ---
+
+void Broker::assinar(const std::string& filtro, int conexao, uint8_t qos) {
+  No* no = &raiz;
+  for (const std::string& nivel : niveisDe(filtro)) {
+    std::unique_ptr<No>& filho = no->filhos[nivel];
+    if (!filho) filho.reset(new No);
+    no = filho.get();
+  }
+  no->assinantes[conexao] = qos;
+}
+
+void Broker::desassinar(const std::string& filtro, int conexao) {
+  std::vector<std::pair<No*, std::string> > caminho;
+  No* no = &raiz;
+  for (const std::string& nivel : niveisDe(filtro)) {
+    auto it = no->filhos.find(nivel);
+    if (it == no->filhos.end()) return;
+    caminho.emplace_back(no, nivel);
+    no = it->second.get();
+  }
+  no->assinantes.erase(conexao);
+  // Apaga os nós que ficaram vazios, de baixo para cima
+  for (size_t i = caminho.size(); i-- > 0;) {
+    No* pai = caminho[i].first;
+    No* filho = pai->filhos[caminho[i].second].get();
+    if (!filho->assinantes.empty() || !filho->filhos.empty()) break;
+    pai->filhos.erase(caminho[i].second);
+  }
+}
+
+// Junta em destino os assinantes de todos os filtros que casam com niveis[i..]
+// (um assinante com vários filtros recebe uma vez, com o maior QoS)
+void Broker::casar(const No& no, const std::vector<std::string>& niveis, size_t i,
+                   std::unordered_map<int, uint8_t>& destino) const {
+  auto juntar = [&destino](const No& n) {
+    for (const auto& a : n.assinantes) {
+      auto it = destino.find(a.first);
+      if (it == destino.end()) destino.emplace(a.first, a.second);
+      else if (a.second > it->second) it->second = a.second;
+    }
+  };
+  auto resto = no.filhos.find("#"); // "a/#" casa com "a" e com tudo abaixo
+  if (resto != no.filhos.end()) juntar(*resto->second);
+  if (i == niveis.size()) {
+    juntar(no);
+    return;
+  }
+  auto exato = no.filhos.find(niveis[i]);
+  if (exato != no.filhos.end()) casar(*exato->second, niveis, i + 1, destino);
+  auto mais = no.filhos.find("+");
+  if (mais != no.filhos.end()) casar(*mais->second, niveis, i + 1, destino);
+}
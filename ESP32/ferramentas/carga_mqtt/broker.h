@@ -0,0 +1,96 @@
+// Broker MQTT 3.1.1 mínimo, sem socket: quem usa entrega os bytes de cada
+// conexão (receber) e recebe de volta os bytes a enviar (callback enviar).
+// O mesmo núcleo roda dentro do gerador de carga (rede simulada) e atrás de
+// um socket TCP de verdade (broker_tcp).
+//
+// Suporta: QoS 0 e 1, mensagens retidas, filtros com + e #, keep alive e
+// sessões limpas (clean session; sessão persistente e QoS 2 não).
+#pragma once
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "mqtt.h"
+
+class Broker {
+public:
+  typedef std::function<void(int conexao, const std::string& bytes)> Enviar;
+  typedef std::function<void(int conexao)> Derrubar; // o broker decidiu fechar a conexão
+
+  struct Contadores {
+    uint64_t conexoes = 0;        // CONNECT aceitos
+    uint64_t desconexoes = 0;     // DISCONNECT recebidos
+    uint64_t quedas = 0;          // conexões fechadas sem DISCONNECT
+    uint64_t keepAliveVencidos = 0;
+    uint64_t errosProtocolo = 0;
+    uint64_t publicacoes = 0;     // PUBLISH recebidos
+    uint64_t entregas = 0;        // PUBLISH enviados aos assinantes
+    uint64_t descartes = 0;       // fila de QoS 1 de um assinante cheia
+    uint64_t bytesEntrada = 0;
+    uint64_t bytesSaida = 0;
+  };
+
+  uint32_t maxEmVoo = 20;  // QoS 1 sem PUBACK por assinante (max_inflight_messages do mosquitto)
+  uint32_t maxFila = 1000; // QoS 1 esperando vaga por assinante (max_queued_messages)
+  Contadores contadores;
+
+  Broker(Enviar enviar, Derrubar derrubar);
+
+  int abrir();                                                            // nova conexão (ainda sem CONNECT)
+  void receber(int conexao, const char* dados, size_t n, uint64_t agoraMs); // bytes que chegaram
+  void fechar(int conexao);                                               // o socket caiu ou foi fechado
+  void verificarKeepAlive(uint64_t agoraMs);                              // derruba quem passou de 1,5 x keep alive
+
+  size_t conectadas() const { return porId.size(); }
+  size_t retidas() const { return retidos.size(); }
+  size_t assinaturas() const;
+  size_t pendentes(int conexao) const; // QoS 1 em voo + na fila para esta conexão
+
+private:
+  struct Sessao {
+    bool conectada = false;
+    std::string id;
+    mqtt::Leitor leitor;
+    uint16_t keepAliveS = 0;
+    uint64_t ultimoPacoteMs = 0;
+    uint16_t proximoId = 1;
+    std::unordered_set<uint16_t> emVoo;
+    std::deque<mqtt::Publicacao> fila;
+    std::vector<std::string> filtros;
+  };
+
+  // Árvore de tópicos: um nível por nó, assinantes (conexão -> QoS) no nó do fim do filtro
+  struct No {
+    std::map<std::string, std::unique_ptr<No> > filhos;
+    std::unordered_map<int, uint8_t> assinantes;
+  };
+
+  Enviar enviar;
+  Derrubar derrubar;
+  int proximaConexao = 1;
+  std::unordered_map<int, Sessao> sessoes;
+  std::unordered_map<std::string, int> porId;
+  std::map<std::string, mqtt::Publicacao> retidos;
+  No raiz;
+
+  void tratar(int conexao, Sessao& s, const mqtt::Pacote& p);
+  bool tratarConnect(int conexao, Sessao& s, const mqtt::Pacote& p);
+  void tratarPublish(int conexao, Sessao& s, const mqtt::Pacote& p);
+  void tratarSubscribe(int conexao, Sessao& s, const mqtt::Pacote& p);
+  void tratarUnsubscribe(int conexao, Sessao& s, const mqtt::Pacote& p);
+  void tratarPuback(int conexao, Sessao& s, const mqtt::Pacote& p);
+
+  void entregar(int conexao, Sessao& s, mqtt::Publicacao p);
+  void mandar(int conexao, const std::string& bytes);
+  void encerrar(int conexao, bool erro);
+  void apagar(int conexao);
+
+  void assinar(const std::string& filtro, int conexao, uint8_t qos);
+  void desassinar(const std::string& filtro, int conexao);
+  void casar(const No& no, const std::vector<std::string>& niveis, size_t i, std::unordered_map<int, uint8_t>& destino) const;
+};
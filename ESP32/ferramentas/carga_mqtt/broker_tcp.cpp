@@ -0,0 +1,127 @@
+// O broker em processo atrás de um socket TCP de verdade, para o simulador dos
+// testes (make simular BROKER=localhost:1883) ou um ESP32 na mesma rede.
+// Uma thread só, com poll(); imprime os contadores a cada 10 s.
+//
+//   build/broker_tcp [porta]     (padrão 1883)
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <set>
+#include "broker.h"
+
+struct Cliente {
+  int fd;
+  std::string saida; // o que o socket ainda não aceitou
+};
+
+static std::map<int, Cliente> clientes; // conexão do broker -> socket
+static std::set<int> fechar;            // derrubadas pelo broker, fecham no fim da volta
+
+static uint64_t agoraMs() {
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+
+static void escrever(Cliente& c) {
+  while (!c.saida.empty()) {
+    ssize_t n = send(c.fd, c.saida.data(), c.saida.size(), MSG_NOSIGNAL);
+    if (n <= 0) return; // EAGAIN: tenta de novo quando o poll deixar
+    c.saida.erase(0, n);
+  }
+}
+
+int main(int argc, char** argv) {
+  int porta = argc > 1 ? atoi(argv[1]) : 1883;
+  signal(SIGPIPE, SIG_IGN);
+
+  int servidor = socket(AF_INET, SOCK_STREAM, 0);
+  int um = 1;
+  setsockopt(servidor, SOL_SOCKET, SO_REUSEADDR, &um, sizeof um);
+  sockaddr_in endereco = {};
+  endereco.sin_family = AF_INET;
+  endereco.sin_port = htons(porta);
+  endereco.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(servidor, (sockaddr*)&endereco, sizeof endereco) < 0 || listen(servidor, 128) < 0) {
+    fprintf(stderr, "porta %d: %s\n", porta, strerror(errno));
+    return 1;
+  }
+  fcntl(servidor, F_SETFL, O_NONBLOCK);
+  printf("broker MQTT 3.1.1 na porta %d\n", porta);
+  fflush(stdout);
+
+  Broker broker(
+      [](int conexao, const std::string& bytes) {
+        auto it = clientes.find(conexao);
+        if (it == clientes.end()) return;
+        it->second.saida += bytes;
+        escrever(it->second);
+      },
+      [](int conexao) { fechar.insert(conexao); });
+
+  uint64_t proximoRelatorio = agoraMs() + 10000;
+  char buffer[16384];
+  for (;;) {
+    std::vector<pollfd> fds(1, pollfd{ servidor, POLLIN, 0 });
+    std::vector<int> conexoes(1, -1);
+    for (auto& par : clientes) {
+      fds.push_back(pollfd{ par.second.fd, (short)(POLLIN | (par.second.saida.empty() ? 0 : POLLOUT)), 0 });
+      conexoes.push_back(par.first);
+    }
+    poll(fds.data(), fds.size(), 500);
+
+    if (fds[0].revents & POLLIN) {
+      int fd;
+      while ((fd = accept(servidor, NULL, NULL)) >= 0) {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &um, sizeof um);
+        clientes[broker.abrir()] = Cliente{ fd, "" };
+      }
+    }
+
+    uint64_t agora = agoraMs();
+    for (size_t i = 1; i < fds.size(); i++) {
+      int conexao = conexoes[i];
+      if (fechar.count(conexao) || !clientes.count(conexao)) continue;
+      if (fds[i].revents & POLLOUT) escrever(clientes[conexao]);
+      if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+      ssize_t n = recv(fds[i].fd, buffer, sizeof buffer, 0);
+      if (n > 0) {
+        broker.receber(conexao, buffer, n, agora);
+      } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+        broker.fechar(conexao); // caiu sem DISCONNECT
+        fechar.insert(conexao);
+      }
+    }
+    broker.verificarKeepAlive(agora);
+
+    for (int conexao : fechar) {
+      auto it = clientes.find(conexao);
+      if (it == clientes.end()) continue;
+      escrever(it->second); // CONNACK de recusa, por exemplo
+      close(it->second.fd);
+      clientes.erase(it);
+    }
+    fechar.clear();
+
+    if (agora >= proximoRelatorio) {
+      proximoRelatorio = agora + 10000;
+      const Broker::Contadores& c = broker.contadores;
+      printf("%zu conectados | %llu publicacoes, %llu entregas, %llu descartes | %llu conexoes, %llu quedas, %llu keep alive, %llu erros\n",
+             broker.conectadas(), (unsigned long long)c.publicacoes, (unsigned long long)c.entregas,
+             (unsigned long long)c.descartes, (unsigned long long)c.conexoes, (unsigned long long)c.quedas,
+             (unsigned long long)c.keepAliveVencidos, (unsigned long long)c.errosProtocolo);
+      fflush(stdout);
+    }
+  }
+}
@@ -0,0 +1,773 @@
+// Gerador de carga: uma frota de sensores de chuva simulados e alguns
+// dashboards assinando george/sensor/#, todos falando MQTT 3.1.1 (bytes de
+// verdade) com o broker de broker.cpp, numa rede simulada em tempo virtual.
+// Serve para dimensionar a instalação sem placa nenhuma: quantas mensagens o
+// broker aguenta, latência p50/p99 até o dashboard e atraso (lag) de um
+// assinante lento.
+//
+//   build/frota --sensores 500 --horas 2 --quedas 6 --assinantes 3 --taxa-assinante 200
+//   build/frota --ajuda
+//
+// Cada sensor faz o mesmo que o sensorDeChuvaMQTT: leitura a cada
+// --intervalo ms (sinal de chuva_sintetica.h), fila store-and-forward de 2560
+// leituras, drenagem de 10 mensagens a cada 100 ms, formato "valor;idade" ou
+// quadro binário 0xB1 (--lote), métricas de ~2,7 KB a cada 60 s, keep alive
+// de 15 s e backoff exponencial na reconexão. Para medir a latência cada
+// mensagem leva no fim um contador (";n" no texto, 4 bytes no quadro).
+//
+// O tempo de CPU do broker em cada pacote é medido de verdade (ou fixo com
+// --servico-us) e vira fila de espera no tempo virtual: com carga demais a
+// latência cresce como cresceria no servidor.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <random>
+#include <unistd.h>
+#include "../../testes/chuva_sintetica.h"
+#include "broker.h"
+
+// --- CONFIGURAÇÃO ---
+
+struct Configuracao {
+  int sensores = 100;
+  double horas = 1;
+  uint32_t intervaloMs = 2000;
+  int lote = 1;                 // leituras por mensagem (1 = texto)
+  int qos = 0;                  // QoS das publicações dos sensores
+  bool metricas = true;         // texto do Prometheus a cada 60 s
+  double quedasPorDia = 4;      // quedas de Wi-Fi por sensor por dia
+  double quedaMinS = 10, quedaMaxS = 600;
+  int assinantes = 1;
+  double taxaAssinante = 0;     // mensagens/s que cada assinante processa (0 = sem limite)
+  int qosAssinante = 0;
+  double redeMs = 20, jitterMs = 5; // latência de um sentido
+  double servicoUs = -1;        // custo fixo por pacote no broker (-1 = medido)
+  double fatorCpu = 1;          // multiplica o custo medido (servidor mais lento que este PC)
+  double reinicioMin = -1;      // minuto em que o broker reinicia (todas as conexões caem)
+  uint64_t semente = 1;
+};
+
+static void ajuda() {
+  puts("uso: frota [opções]\n"
+       "  --sensores N          sensores simulados (100)\n"
+       "  --horas H             tempo simulado (1)\n"
+       "  --intervalo MS        leitura a cada MS ms (2000)\n"
+       "  --lote B              leituras por mensagem, 1 = texto \"valor;idade\" (1)\n"
+       "  --qos Q               QoS das publicações dos sensores, 0 ou 1 (0)\n"
+       "  --sem-metricas        não publica as métricas de 60 s\n"
+       "  --quedas N            quedas de Wi-Fi por sensor por dia (4)\n"
+       "  --queda-min S / --queda-max S   duração das quedas (10 / 600 s)\n"
+       "  --assinantes N        dashboards em george/sensor/# (1)\n"
+       "  --taxa-assinante R    mensagens/s que cada dashboard processa, 0 = sem limite (0)\n"
+       "  --qos-assinante Q     QoS da assinatura, 0 ou 1 (0)\n"
+       "  --rede MS / --jitter MS          latência de um sentido (20 / 5 ms)\n"
+       "  --servico-us US       custo fixo por pacote no broker (padrão: medido)\n"
+       "  --fator-cpu F         multiplica o custo medido (1)\n"
+       "  --reinicio MIN        reinicia o broker no minuto MIN\n"
+       "  --semente S           semente dos sorteios (1)");
+}
+
+static Configuracao lerArgumentos(int argc, char** argv) {
+  Configuracao c;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--ajuda" || a == "--help" || a == "-h") {
+      ajuda();
+      exit(0);
+    }
+    if (a == "--sem-metricas") {
+      c.metricas = false;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      fprintf(stderr, "falta o valor de %s\n", a.c_str());
+      exit(2);
+    }
+    double v = atof(argv[++i]);
+    if (a == "--sensores") c.sensores = (int)v;
+    else if (a == "--horas") c.horas = v;
+    else if (a == "--intervalo") c.intervaloMs = (uint32_t)v;
+    else if (a == "--lote") c.lote = (int)v;
+    else if (a == "--qos") c.qos = (int)v;
+    else if (a == "--quedas") c.quedasPorDia = v;
+    else if (a == "--queda-min") c.quedaMinS = v;
+    else if (a == "--queda-max") c.quedaMaxS = v;
+    else if (a == "--assinantes") c.assinantes = (int)v;
+    else if (a == "--taxa-assinante") c.taxaAssinante = v;
+    else if (a == "--qos-assinante") c.qosAssinante = (int)v;
+    else if (a == "--rede") c.redeMs = v;
+    else if (a == "--jitter") c.jitterMs = v;
+    else if (a == "--servico-us") c.servicoUs = v;
+    else if (a == "--fator-cpu") c.fatorCpu = v;
+    else if (a == "--reinicio") c.reinicioMin = v;
+    else if (a == "--semente") c.semente = (uint64_t)v;
+    else {
+      fprintf(stderr, "opção desconhecida: %s (veja --ajuda)\n", a.c_str());
+      exit(2);
+    }
+  }
+  if (c.sensores < 1 || c.horas <= 0 || c.intervaloMs < 100 || c.lote < 1 || c.lote > 16 || c.qos > 1 ||
+      c.qosAssinante > 1 || c.quedaMaxS < c.quedaMinS) {
+    fprintf(stderr, "valores fora da faixa (veja --ajuda)\n");
+    exit(2);
+  }
+  return c;
+}
+
+// --- TEMPO VIRTUAL ---
+
+struct Evento {
+  uint64_t us;
+  uint64_t ordem; // empate: na ordem em que foram agendados
+  std::function<void()> fn;
+  bool operator>(const Evento& o) const { return us != o.us ? us > o.us : ordem > o.ordem; }
+};
+
+static std::priority_queue<Evento, std::vector<Evento>, std::greater<Evento> > eventos;
+static uint64_t agoraUs = 0, ordemEventos = 0;
+
+static void agendar(uint64_t us, std::function<void()> fn) { eventos.push(Evento{ std::max(us, agoraUs), ordemEventos++, std::move(fn) }); }
+
+static Configuracao cfg;
+static std::mt19937_64 sorteio;
+static double uniforme(double a, double b) { return std::uniform_real_distribution<double>(a, b)(sorteio); }
+
+// --- REDE SIMULADA ---
+// Cada conexão TCP tem os dois sentidos em ordem (FIFO); os bytes chegam depois
+// de redeMs +- jitterMs. Uma conexão "morta" ignora o que ainda estava a caminho.
+
+struct Cliente {
+  virtual ~Cliente() {}
+  virtual void aoReceber(const std::string& bytes) = 0;
+  virtual void aoCair() = 0; // o broker fechou a conexão
+};
+
+struct Conexao {
+  int noBroker = -1;
+  Cliente* cliente = nullptr;
+  bool viva = true;
+  uint64_t ultimaIda = 0, ultimaVolta = 0; // chegada do último pedaço em cada sentido
+};
+
+static std::vector<Conexao> conexoes;
+static std::unordered_map<int, int> conexaoDoBroker; // id no broker -> índice em conexoes
+
+static uint64_t atrasoRede() { return (uint64_t)(std::max(0.0, cfg.redeMs + uniforme(-cfg.jitterMs, cfg.jitterMs)) * 1000); }
+
+// --- BROKER NA REDE ---
+
+static std::unique_ptr<Broker> broker;
+static bool brokerNoAr = true;
+static uint64_t brokerLivreUs = 0;       // fim do trabalho já aceito (fila de um servidor só)
+static double brokerOcupadoUs = 0;       // tempo virtual de CPU gasto
+static double brokerCpuRealNs = 0;       // tempo real medido dentro do broker
+static uint64_t brokerPacotes = 0;       // chamadas a receber()
+static std::vector<std::pair<int, std::string> > saidaBroker; // bytes gerados na chamada atual
+static std::vector<int> derrubadasBroker;
+
+static void novoBroker() {
+  Broker::Contadores antes = broker ? broker->contadores : Broker::Contadores();
+  broker.reset(new Broker([](int conexao, const std::string& bytes) { saidaBroker.emplace_back(conexao, bytes); },
+                          [](int conexao) { derrubadasBroker.push_back(conexao); }));
+  broker->contadores = antes;
+}
+
+// Avisa (depois da latência) os clientes das conexões que o broker derrubou
+static void avisarDerrubadas(uint64_t aPartirDeUs) {
+  for (int derrubada : derrubadasBroker) {
+    auto it = conexaoDoBroker.find(derrubada);
+    if (it == conexaoDoBroker.end()) continue;
+    int destino = it->second;
+    conexaoDoBroker.erase(it);
+    Conexao& d = conexoes[destino];
+    d.noBroker = -1;
+    uint64_t aviso = std::max(aPartirDeUs + atrasoRede(), d.ultimaVolta);
+    agendar(aviso, [destino]() {
+      Conexao& d = conexoes[destino];
+      if (!d.viva) return;
+      d.viva = false;
+      d.cliente->aoCair();
+    });
+  }
+  derrubadasBroker.clear();
+}
+
+// Leva os bytes de uma conexão até o broker e processa lá, entrando na fila de CPU
+static void enviarAoBroker(int indice, const std::string& bytes) {
+  Conexao& c = conexoes[indice];
+  uint64_t chegada = std::max(agoraUs + atrasoRede(), c.ultimaIda);
+  c.ultimaIda = chegada;
+  agendar(chegada, [indice, bytes]() {
+    Conexao& c = conexoes[indice];
+    if (!c.viva || c.noBroker < 0) return;
+    auto t0 = std::chrono::steady_clock::now();
+    broker->receber(c.noBroker, bytes.data(), bytes.size(), agoraUs / 1000);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    brokerCpuRealNs += ns;
+    brokerPacotes++;
+    double custoUs = cfg.servicoUs >= 0 ? cfg.servicoUs : ns / 1000 * cfg.fatorCpu;
+    brokerLivreUs = std::max(agoraUs, brokerLivreUs) + (uint64_t)ceil(custoUs);
+    brokerOcupadoUs += custoUs;
+    // O que o broker mandou sai quando ele termina este trabalho
+    for (auto& s : saidaBroker) {
+      auto it = conexaoDoBroker.find(s.first);
+      if (it == conexaoDoBroker.end()) continue;
+      int destino = it->second;
+      Conexao& d = conexoes[destino];
+      uint64_t entrega = std::max(brokerLivreUs + atrasoRede(), d.ultimaVolta);
+      d.ultimaVolta = entrega;
+      std::string b = std::move(s.second);
+      agendar(entrega, [destino, b]() {
+        if (conexoes[destino].viva) conexoes[destino].cliente->aoReceber(b);
+      });
+    }
+    saidaBroker.clear();
+    avisarDerrubadas(brokerLivreUs);
+  });
+}
+
+// Abre uma conexão TCP (1 RTT). falhou() se o broker estiver fora do ar.
+static void abrirConexao(Cliente* cliente, std::function<void(int)> pronta, std::function<void()> falhou) {
+  uint64_t rtt = atrasoRede() + atrasoRede();
+  agendar(agoraUs + rtt, [cliente, pronta, falhou]() {
+    if (!brokerNoAr) {
+      falhou();
+      return;
+    }
+    Conexao c;
+    c.cliente = cliente;
+    c.noBroker = broker->abrir();
+    c.ultimaIda = c.ultimaVolta = agoraUs;
+    conexoes.push_back(c);
+    conexaoDoBroker[c.noBroker] = (int)conexoes.size() - 1;
+    pronta((int)conexoes.size() - 1);
+  });
+}
+
+// O cliente some sem avisar (Wi-Fi caiu): o broker só descobre pelo keep alive
+static void abandonarConexao(int indice) { conexoes[indice].viva = false; }
+
+// O cliente fecha antes do CONNECT (o TCP avisa o broker na hora)
+static void fecharConexao(int indice) {
+  Conexao& c = conexoes[indice];
+  c.viva = false;
+  if (c.noBroker < 0) return;
+  conexaoDoBroker.erase(c.noBroker);
+  broker->fechar(c.noBroker);
+  c.noBroker = -1;
+}
+
+// --- LATÊNCIAS ---
+
+struct Amostras {
+  std::vector<float> v;
+  void somar(double x) { v.push_back((float)x); }
+  double percentil(double p) {
+    if (v.empty()) return 0;
+    size_t k = std::min(v.size() - 1, (size_t)(p * v.size()));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+  }
+  double maximo() const { return v.empty() ? 0 : *std::max_element(v.begin(), v.end()); }
+};
+
+// Envio de cada mensagem de dados (por sensor, indexado pelo contador da mensagem)
+static std::vector<std::vector<uint64_t> > envioUs;
+
+// --- SENSOR ---
+
+struct Leitura {
+  uint64_t us;
+  int16_t valor;
+};
+
+const size_t CAPACIDADE_FILA = 2048 + 512; // RAM + RTC do firmware
+const uint32_t DRENO_INTERVALO_US = 100000;
+const int DRENO_POR_RODADA = 10;
+const uint64_t LATENCIA_LOTE_US = 30000000; // BATCH_MAX_LATENCY
+const uint16_t KEEP_ALIVE_S = 15;           // padrão do PubSubClient
+const size_t TAMANHO_METRICAS = 2700;
+
+struct Sensor : Cliente {
+  enum Estado { FORA, CONECTANDO, CONECTADO } estado = FORA;
+  int indice;
+  std::string nome, topico;
+  ChuvaSintetica chuva;
+  int conexao = -1;
+  mqtt::Leitor leitor;
+  std::deque<Leitura> fila;
+  uint32_t contador = 0;     // mensagens de dados enviadas (vai no fim do payload)
+  uint16_t proximoId = 1;
+  std::map<uint16_t, std::deque<Leitura> > emVoo; // QoS 1: leituras esperando PUBACK
+  uint32_t falhasSeguidas = 0;
+  bool semWifi = false;
+  uint64_t ultimoEnvioUs = 0;
+  // Estatística
+  uint64_t leituras = 0, perdidas = 0, conexoesFeitas = 0, quedasWifi = 0, quedasBroker = 0;
+
+  Sensor(int i) : indice(i), chuva(cfg.semente * 1000 + i) {
+    char texto[32];
+    snprintf(texto, sizeof(texto), "chuva%03d", i);
+    nome = texto;
+    topico = "george/sensor/" + nome;
+  }
+
+  void iniciar() {
+    uint64_t fase = (uint64_t)uniforme(0, cfg.intervaloMs * 1000.0);
+    agendar(fase, [this]() { ler(); });
+    agendar((uint64_t)uniforme(0, 10e6), [this]() { conectar(); });
+    agendar(fase + DRENO_INTERVALO_US, [this]() { drenar(); });
+    if (cfg.quedasPorDia > 0) agendarQueda();
+  }
+
+  // Leitura do "ADC" a cada intervalo; fila cheia descarta a mais antiga (como o firmware)
+  void ler() {
+    agendar(agoraUs + cfg.intervaloMs * 1000ull, [this]() { ler(); });
+    leituras++;
+    if (fila.size() >= CAPACIDADE_FILA) {
+      fila.pop_front();
+      perdidas++;
+    }
+    fila.push_back(Leitura{ agoraUs, (int16_t)(4095 - chuva(agoraUs)) });
+  }
+
+  void conectar() {
+    if (semWifi || estado != FORA) return;
+    estado = CONECTANDO;
+    abrirConexao(this,
+                 [this](int c) {
+                   if (semWifi || estado != CONECTANDO) { // o Wi-Fi caiu enquanto abria
+                     fecharConexao(c);
+                     return;
+                   }
+                   conexao = c;
+                   leitor = mqtt::Leitor();
+                   enviar(mqtt::connect(nome, KEEP_ALIVE_S));
+                 },
+                 [this]() {
+                   if (estado == CONECTANDO) falhou();
+                 });
+  }
+
+  void falhou() {
+    estado = FORA;
+    conexao = -1;
+    // Backoff como o firmware: 0,5 s * 2^falhas até 60 s, sorteado entre metade e o total
+    double espera = std::min(60.0, 0.5 * (1 << std::min<uint32_t>(falhasSeguidas, 7)));
+    falhasSeguidas++;
+    agendar(agoraUs + (uint64_t)(uniforme(espera / 2, espera) * 1e6), [this]() { conectar(); });
+  }
+
+  void enviar(const std::string& bytes) {
+    ultimoEnvioUs = agoraUs;
+    enviarAoBroker(conexao, bytes);
+  }
+
+  void aoReceber(const std::string& bytes) override {
+    leitor.adicionar(bytes.data(), bytes.size());
+    mqtt::Pacote p;
+    while (conexao >= 0 && leitor.proximo(p)) {
+      if (p.tipo == mqtt::CONNACK) {
+        if (p.corpo.size() < 2 || p.corpo[1] != 0) {
+          abandonarConexao(conexao);
+          falhou();
+          return;
+        }
+        estado = CONECTADO;
+        falhasSeguidas = 0;
+        conexoesFeitas++;
+        // Igual ao reconnect() do firmware, mais um status retido para quem abrir o dashboard depois
+        enviar(mqtt::subscribe(1, { { "george/sensor/led", 0 }, { "george/sensor/historico/pedido", 0 } }));
+        mqtt::Publicacao status;
+        status.topico = topico + "/status";
+        status.payload = "online";
+        status.retido = true;
+        enviar(mqtt::publish(status));
+        agendarPing();
+        if (cfg.metricas) agendar(agoraUs + 60000000, [this, c = conexao]() { publicarMetricas(c); });
+      } else if (p.tipo == mqtt::PUBACK && p.corpo.size() >= 2) {
+        emVoo.erase(((uint8_t)p.corpo[0] << 8) | (uint8_t)p.corpo[1]);
+      }
+    }
+  }
+
+  void aoCair() override {
+    quedasBroker++;
+    voltarParaFila();
+    falhou();
+  }
+
+  // QoS 1: o que não teve PUBACK volta para o começo da fila (o assinante pode receber duplicado)
+  void voltarParaFila() {
+    for (auto it = emVoo.rbegin(); it != emVoo.rend(); ++it) fila.insert(fila.begin(), it->second.begin(), it->second.end());
+    emVoo.clear();
+    while (fila.size() > CAPACIDADE_FILA) {
+      fila.pop_front();
+      perdidas++;
+    }
+  }
+
+  void agendarPing() {
+    int c = conexao;
+    agendar(agoraUs + KEEP_ALIVE_S * 1000000ull, [this, c]() {
+      if (conexao != c || estado != CONECTADO) return;
+      if (agoraUs - ultimoEnvioUs >= KEEP_ALIVE_S * 1000000ull - 1000) enviar(mqtt::pingreq());
+      agendarPing();
+    });
+  }
+
+  void publicarMetricas(int c) {
+    if (conexao != c || estado != CONECTADO) return;
+    mqtt::Publicacao m;
+    m.topico = topico + "/stats";
+    m.payload.assign(TAMANHO_METRICAS, '#');
+    enviar(mqtt::publish(m));
+    agendar(agoraUs + 60000000, [this, c]() { publicarMetricas(c); });
+  }
+
+  // Rodada de envio: até 10 mensagens a cada 100 ms
+  void drenar() {
+    agendar(agoraUs + DRENO_INTERVALO_US, [this]() { drenar(); });
+    if (estado != CONECTADO) return;
+    for (int i = 0; i < DRENO_POR_RODADA && !fila.empty(); i++) {
+      if (cfg.qos == 1 && emVoo.size() >= 10) return;
+      size_t n = std::min<size_t>(cfg.lote, fila.size());
+      if (cfg.lote > 1 && n < (size_t)cfg.lote && agoraUs - fila.front().us < LATENCIA_LOTE_US) return;
+      mqtt::Publicacao p;
+      p.topico = topico;
+      p.qos = cfg.qos;
+      p.payload = montarPayload(n);
+      if (cfg.qos == 1) {
+        p.id = proximoId++;
+        if (proximoId == 0) proximoId = 1;
+        emVoo[p.id].assign(fila.begin(), fila.begin() + n);
+      }
+      if (envioUs[indice].size() <= contador) envioUs[indice].resize(contador + 1);
+      envioUs[indice][contador++] = agoraUs;
+      enviar(mqtt::publish(p));
+      fila.erase(fila.begin(), fila.begin() + n);
+    }
+  }
+
+  // Mesmo formato do firmware, mais o contador da mensagem no fim
+  std::string montarPayload(size_t n) {
+    char texto[48];
+    if (cfg.lote == 1) {
+      snprintf(texto, sizeof(texto), "%d;%llu;%u", fila[0].valor, (unsigned long long)((agoraUs - fila[0].us) / 1000), contador);
+      return texto;
+    }
+    std::string q(8 + 2 * n + 4, '\0');
+    uint8_t* b = (uint8_t*)&q[0];
+    uint32_t idade = (uint32_t)((agoraUs - fila[0].us) / 1000);
+    b[0] = 0xB1;
+    b[1] = (uint8_t)n;
+    b[2] = cfg.intervaloMs & 0xFF;
+    b[3] = cfg.intervaloMs >> 8;
+    for (int k = 0; k < 4; k++) b[4 + k] = idade >> (8 * k);
+    b[8] = fila[0].valor & 0xFF;
+    b[9] = (uint16_t)fila[0].valor >> 8;
+    for (size_t k = 1; k < n; k++) {
+      uint16_t d = (uint16_t)(fila[k].valor - fila[k - 1].valor);
+      b[8 + 2 * k] = d & 0xFF;
+      b[9 + 2 * k] = d >> 8;
+    }
+    for (int k = 0; k < 4; k++) b[8 + 2 * n + k] = contador >> (8 * k);
+    return q;
+  }
+
+  // Quedas de Wi-Fi: intervalo exponencial, duração uniforme
+  void agendarQueda() {
+    double intervaloS = -log(1 - uniforme(0, 1)) * 86400 / cfg.quedasPorDia;
+    agendar(agoraUs + (uint64_t)(intervaloS * 1e6), [this]() {
+      quedasWifi++;
+      semWifi = true;
+      if (conexao >= 0 && estado != FORA) abandonarConexao(conexao);
+      voltarParaFila();
+      estado = FORA;
+      conexao = -1;
+      agendar(agoraUs + (uint64_t)(uniforme(cfg.quedaMinS, cfg.quedaMaxS) * 1e6), [this]() {
+        semWifi = false;
+        falhasSeguidas = 0;
+        conectar();
+        agendarQueda();
+      });
+    });
+  }
+};
+
+// --- ASSINANTE (DASHBOARD) ---
+
+struct Assinante : Cliente {
+  int indice;
+  int conexao = -1;
+  bool conectado = false;
+  mqtt::Leitor leitor;
+  std::deque<std::pair<uint64_t, mqtt::Publicacao> > aProcessar; // (chegada, mensagem)
+  uint64_t livreUs = 0; // fim do processamento da mensagem atual
+  std::vector<std::vector<bool> > visto; // [sensor][contador]
+  // Estatística
+  uint64_t ultimoEnvioVisto = 0; // envio da mensagem mais nova já processada
+  Amostras latencia, idade, espera, lag;
+  uint64_t dados = 0, leituras = 0, duplicadas = 0, retidas = 0, outras = 0, maiorAtraso = 0, quedas = 0;
+
+  Assinante(int i) : indice(i), visto(cfg.sensores) {}
+
+  void conectar() {
+    abrirConexao(this,
+                 [this](int c) {
+                   conexao = c;
+                   leitor = mqtt::Leitor();
+                   enviarAoBroker(c, mqtt::connect("dashboard-" + std::to_string(indice), 60));
+                 },
+                 [this]() { agendar(agoraUs + 2000000, [this]() { conectar(); }); });
+  }
+
+  void aoReceber(const std::string& bytes) override {
+    leitor.adicionar(bytes.data(), bytes.size());
+    mqtt::Pacote p;
+    while (leitor.proximo(p)) {
+      if (p.tipo == mqtt::CONNACK) {
+        conectado = true;
+        enviarAoBroker(conexao, mqtt::subscribe(1, { { "george/sensor/#", (uint8_t)cfg.qosAssinante } }));
+        agendarPing(conexao);
+      } else if (p.tipo == mqtt::PUBLISH) {
+        mqtt::Publicacao pub;
+        if (!mqtt::lerPublish(p, pub)) continue;
+        aProcessar.emplace_back(agoraUs, pub);
+        if (aProcessar.size() == 1) processar();
+      }
+    }
+  }
+
+  void aoCair() override {
+    quedas++;
+    conectado = false;
+    aProcessar.clear();
+    agendar(agoraUs + 1000000, [this]() { conectar(); });
+  }
+
+  void agendarPing(int c) {
+    agendar(agoraUs + 30000000, [this, c]() {
+      if (conexao != c || !conectado || !conexoes[c].viva) return;
+      enviarAoBroker(c, mqtt::pingreq());
+      agendarPing(c);
+    });
+  }
+
+  // Uma mensagem por vez, cada uma levando 1/taxa s (o "processamento" do dashboard)
+  void processar() {
+    uint64_t custo = cfg.taxaAssinante > 0 ? (uint64_t)(1e6 / cfg.taxaAssinante) : 0;
+    int c = conexao;
+    agendar(agoraUs + custo, [this, c]() {
+      if (conexao != c || aProcessar.empty()) return;
+      auto chegada = aProcessar.front().first;
+      mqtt::Publicacao pub = std::move(aProcessar.front().second);
+      aProcessar.pop_front();
+      consumir(pub, chegada);
+      if (pub.qos == 1 && conexoes[c].viva) enviarAoBroker(c, mqtt::puback(pub.id));
+      if (!aProcessar.empty()) processar();
+    });
+  }
+
+  void consumir(const mqtt::Publicacao& pub, uint64_t chegadaUs) {
+    if (pub.retido) retidas++;
+    // Só os tópicos de dados: george/sensor/chuvaNNN
+    int sensor = -1;
+    if (sscanf(pub.topico.c_str(), "george/sensor/chuva%d", &sensor) != 1 || sensor < 0 || sensor >= cfg.sensores ||
+        pub.topico.find('/', 14) != std::string::npos) {
+      outras++;
+      return;
+    }
+    uint32_t contador;
+    size_t n;
+    uint32_t idadeMs;
+    const std::string& s = pub.payload;
+    if (!s.empty() && (uint8_t)s[0] == 0xB1) {
+      n = (uint8_t)s[1];
+      idadeMs = (uint8_t)s[4] | ((uint8_t)s[5] << 8) | ((uint8_t)s[6] << 16) | ((uint32_t)(uint8_t)s[7] << 24);
+      const uint8_t* fim = (const uint8_t*)s.data() + 8 + 2 * n;
+      contador = fim[0] | (fim[1] << 8) | (fim[2] << 16) | ((uint32_t)fim[3] << 24);
+    } else {
+      unsigned long long idade;
+      int valor;
+      if (sscanf(s.c_str(), "%d;%llu;%u", &valor, &idade, &contador) != 3) {
+        outras++;
+        return;
+      }
+      n = 1;
+      idadeMs = (uint32_t)idade;
+    }
+    std::vector<bool>& v = visto[sensor];
+    if (v.size() <= contador) v.resize(contador + 1);
+    if (v[contador]) {
+      duplicadas++;
+      return;
+    }
+    v[contador] = true;
+    dados++;
+    leituras += n;
+    uint64_t envio = envioUs[sensor][contador];
+    ultimoEnvioVisto = std::max(ultimoEnvioVisto, envio);
+    latencia.somar((agoraUs - envio) / 1000.0);
+    idade.somar((agoraUs - envio) / 1000.0 + idadeMs);
+    espera.somar((agoraUs - chegadaUs) / 1000.0);
+  }
+
+  // Amostra do lag, a cada segundo: quanto o que o dashboard mostra está atrás
+  // do que os sensores já mandaram, e quantas mensagens esperam por ele
+  void medirLag() {
+    if (!conectado || ultimoEnvioVisto == 0 || conexao < 0 || conexoes[conexao].noBroker < 0) return;
+    lag.somar((agoraUs - ultimoEnvioVisto) / 1000.0);
+    maiorAtraso = std::max<uint64_t>(maiorAtraso, broker->pendentes(conexoes[conexao].noBroker) + aProcessar.size());
+  }
+};
+
+// --- RELATÓRIO ---
+
+static std::string bytesLegiveis(double b) {
+  char t[32];
+  if (b >= 1e9) snprintf(t, sizeof(t), "%.2f GB", b / 1e9);
+  else if (b >= 1e6) snprintf(t, sizeof(t), "%.1f MB", b / 1e6);
+  else snprintf(t, sizeof(t), "%.1f kB", b / 1e3);
+  return t;
+}
+
+int main(int argc, char** argv) {
+  cfg = lerArgumentos(argc, argv);
+  sorteio.seed(cfg.semente);
+
+  novoBroker();
+  size_t picoSessoes = 0;
+  std::vector<std::unique_ptr<Assinante> > assinantes;
+
+  // Keep alive do broker e pico de sessões, a cada segundo
+  std::function<void()> vigiar = [&]() {
+    if (brokerNoAr) broker->verificarKeepAlive(agoraUs / 1000);
+    avisarDerrubadas(agoraUs);
+    picoSessoes = std::max(picoSessoes, broker->conectadas());
+    for (auto& a : assinantes) a->medirLag();
+    agendar(agoraUs + 1000000, vigiar);
+  };
+  agendar(1000000, vigiar);
+
+  envioUs.resize(cfg.sensores);
+  std::vector<std::unique_ptr<Sensor> > sensores;
+  for (int i = 0; i < cfg.sensores; i++) {
+    sensores.emplace_back(new Sensor(i));
+    sensores.back()->iniciar();
+  }
+  // Os dashboards abrem depois da frota (recebem os status retidos)
+  for (int i = 0; i < cfg.assinantes; i++) {
+    assinantes.emplace_back(new Assinante(i));
+    Assinante* a = assinantes.back().get();
+    agendar(15000000 + i * 100000, [a]() { a->conectar(); });
+  }
+
+  // Reinício do broker: todas as conexões caem, 10 s fora do ar, retidas perdidas
+  if (cfg.reinicioMin >= 0) {
+    agendar((uint64_t)(cfg.reinicioMin * 60e6), [&]() {
+      brokerNoAr = false;
+      for (size_t i = 0; i < conexoes.size(); i++) {
+        Conexao& c = conexoes[i];
+        if (c.noBroker >= 0) broker->fechar(c.noBroker);
+        c.noBroker = -1;
+        if (!c.viva) continue;
+        c.viva = false;
+        Cliente* cliente = c.cliente;
+        agendar(agoraUs + atrasoRede(), [cliente]() { cliente->aoCair(); });
+      }
+      conexaoDoBroker.clear();
+      agendar(agoraUs + 10000000, []() {
+        novoBroker();
+        brokerNoAr = true;
+      });
+    });
+  }
+
+  uint64_t fimUs = (uint64_t)(cfg.horas * 3600e6);
+  auto inicioReal = std::chrono::steady_clock::now();
+  bool terminal = isatty(2);
+  uint64_t proximoProgresso = 0;
+  while (!eventos.empty() && eventos.top().us <= fimUs) {
+    Evento e = eventos.top();
+    eventos.pop();
+    agoraUs = e.us;
+    e.fn();
+    if (terminal && agoraUs >= proximoProgresso) {
+      fprintf(stderr, "\r%.1f/%.1f h simuladas", agoraUs / 3600e6, cfg.horas);
+      proximoProgresso += 60000000;
+    }
+  }
+  if (terminal) fprintf(stderr, "\n");
+  double segundosReais = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicioReal).count();
+  double segundos = fimUs / 1e6;
+
+  // --- Resultado ---
+  uint64_t leituras = 0, perdidas = 0, naFila = 0, quedasWifi = 0, conexoesFeitas = 0;
+  for (auto& s : sensores) {
+    leituras += s->leituras;
+    perdidas += s->perdidas;
+    naFila += s->fila.size();
+    for (auto& v : s->emVoo) naFila += v.second.size();
+    quedasWifi += s->quedasWifi;
+    conexoesFeitas += s->conexoesFeitas;
+  }
+  const Broker::Contadores& k = broker->contadores;
+
+  printf("Frota: %d sensores, %.1f h simuladas em %.1f s (%.0fx o tempo real)\n", cfg.sensores, cfg.horas, segundosReais,
+         segundos / segundosReais);
+  printf("  leitura a cada %u ms, lote %d, QoS %d, metricas %s | rede %.0f +- %.0f ms | %llu quedas de Wi-Fi%s\n",
+         cfg.intervaloMs, cfg.lote, cfg.qos, cfg.metricas ? "sim" : "nao", cfg.redeMs, cfg.jitterMs,
+         (unsigned long long)quedasWifi, cfg.reinicioMin >= 0 ? ", 1 reinicio do broker" : "");
+  printf("Broker: %llu publicacoes recebidas (%.1f/s), %llu entregas (%.1f/s) | entrada %s, saida %s\n",
+         (unsigned long long)k.publicacoes, k.publicacoes / segundos, (unsigned long long)k.entregas, k.entregas / segundos,
+         bytesLegiveis(k.bytesEntrada).c_str(), bytesLegiveis(k.bytesSaida).c_str());
+  double usPorPacote = brokerPacotes ? brokerCpuRealNs / 1000 / brokerPacotes : 0;
+  printf("  CPU: %.2f us por pacote recebido (medido neste PC) -> capacidade ~%.0f pacotes/s | ocupacao %.2f%%\n",
+         usPorPacote, usPorPacote > 0 ? 1e6 / usPorPacote : 0, brokerOcupadoUs / (segundos * 1e6) * 100);
+  printf("  sessoes: pico %zu, %llu conexoes (%llu dos sensores), %llu keep alive vencidos, %llu quedas | retidas %zu | "
+         "descartes QoS 1 %llu | erros de protocolo %llu\n",
+         picoSessoes, (unsigned long long)k.conexoes, (unsigned long long)conexoesFeitas, (unsigned long long)k.keepAliveVencidos,
+         (unsigned long long)k.quedas, broker->retidas(), (unsigned long long)k.descartes, (unsigned long long)k.errosProtocolo);
+  printf("Sensores: %llu leituras, %llu perdidas (fila cheia), %llu ainda na fila\n", (unsigned long long)leituras,
+         (unsigned long long)perdidas, (unsigned long long)naFila);
+  for (auto& a : assinantes) {
+    // Perdidas: mensagens enviadas depois da primeira que o assinante viu de cada
+    // sensor (antes disso ele não tinha assinado) e que nunca chegaram. As
+    // enviadas depois da mais nova que ele processou (ou nos últimos 2 s) ainda
+    // podem estar a caminho ou na fila: contam como atrasadas, não perdidas.
+    uint64_t perdidasNoCaminho = 0, atrasadas = 0;
+    uint64_t corte = std::min(fimUs - std::min<uint64_t>(fimUs, 2000000), a->ultimoEnvioVisto);
+    for (int s = 0; s < cfg.sensores; s++) {
+      const std::vector<bool>& v = a->visto[s];
+      size_t primeira = std::find(v.begin(), v.end(), true) - v.begin();
+      for (size_t i = primeira; i < envioUs[s].size(); i++) {
+        if (i < v.size() && v[i]) continue;
+        if (envioUs[s][i] <= corte) perdidasNoCaminho++;
+        else atrasadas++;
+      }
+    }
+    printf("Assinante %d (george/sensor/#, QoS %d, %s):\n", a->indice, cfg.qosAssinante,
+           cfg.taxaAssinante > 0 ? (std::to_string((int)cfg.taxaAssinante) + " msg/s").c_str() : "sem limite");
+    printf("  %llu mensagens de dados (%llu leituras), %llu perdidas, %llu ainda nao processadas, %llu duplicadas | %llu outras "
+           "(status/stats), %llu retidas, %llu quedas\n",
+           (unsigned long long)a->dados, (unsigned long long)a->leituras, (unsigned long long)perdidasNoCaminho,
+           (unsigned long long)atrasadas,
+           (unsigned long long)a->duplicadas, (unsigned long long)a->outras, (unsigned long long)a->retidas,
+           (unsigned long long)a->quedas);
+    printf("  latencia sensor->dashboard: p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", a->latencia.percentil(0.5),
+           a->latencia.percentil(0.99), a->latencia.maximo());
+    printf("  idade da leitura ao chegar: p50 %.1f s, p99 %.1f s, max %.1f s (inclui a fila durante as quedas)\n",
+           a->idade.percentil(0.5) / 1000, a->idade.percentil(0.99) / 1000, a->idade.maximo() / 1000);
+    printf("  lag (o dashboard atras dos sensores): p50 %.1f ms, p99 %.1f ms, max %.1f ms | ate %llu mensagens esperando\n",
+           a->lag.percentil(0.5), a->lag.percentil(0.99), a->lag.maximo(), (unsigned long long)a->maiorAtraso);
+    printf("  espera na fila do proprio dashboard: p50 %.1f ms, p99 %.1f ms\n", a->espera.percentil(0.5),
+           a->espera.percentil(0.99));
+  }
+  return 0;
+}
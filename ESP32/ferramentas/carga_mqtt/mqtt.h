@@ -0,0 +1,214 @@
+// Pacotes MQTT 3.1.1: montagem e leitura (só o que o broker e a frota usam).
+//
+// Leitor recebe os bytes do socket em pedaços de qualquer tamanho e devolve
+// um pacote inteiro de cada vez, como um broker de verdade precisa fazer.
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mqtt {
+
+enum Tipo : uint8_t {
+  CONNECT = 1,
+  CONNACK = 2,
+  PUBLISH = 3,
+  PUBACK = 4,
+  SUBSCRIBE = 8,
+  SUBACK = 9,
+  UNSUBSCRIBE = 10,
+  UNSUBACK = 11,
+  PINGREQ = 12,
+  PINGRESP = 13,
+  DISCONNECT = 14
+};
+
+const size_t TAMANHO_MAXIMO = 268435455; // maior "remaining length" do 3.1.1
+
+struct Pacote {
+  Tipo tipo;
+  uint8_t flags; // 4 bits baixos do 1º byte
+  std::string corpo;
+};
+
+struct Publicacao {
+  std::string topico;
+  std::string payload;
+  uint8_t qos = 0;
+  bool retido = false;
+  bool dup = false;
+  uint16_t id = 0; // só QoS 1
+};
+
+// --- MONTAGEM ---
+
+inline std::string texto(const std::string& s) {
+  std::string r;
+  r += (char)(s.size() >> 8);
+  r += (char)(s.size() & 0xFF);
+  return r + s;
+}
+
+inline std::string u16(uint16_t v) {
+  std::string r;
+  r += (char)(v >> 8);
+  r += (char)(v & 0xFF);
+  return r;
+}
+
+inline std::string montar(Tipo tipo, uint8_t flags, const std::string& corpo) {
+  std::string r(1, (char)((tipo << 4) | (flags & 0x0F)));
+  size_t n = corpo.size();
+  do {
+    uint8_t b = n % 128;
+    n /= 128;
+    if (n) b |= 0x80;
+    r += (char)b;
+  } while (n);
+  return r + corpo;
+}
+
+inline std::string connect(const std::string& id, uint16_t keepAliveS) {
+  std::string corpo = texto("MQTT");
+  corpo += (char)4;    // nível do protocolo (3.1.1)
+  corpo += (char)0x02; // clean session
+  corpo += u16(keepAliveS);
+  corpo += texto(id);
+  return montar(CONNECT, 0, corpo);
+}
+
+inline std::string connack(uint8_t codigo) {
+  std::string corpo(1, 0);
+  corpo += (char)codigo;
+  return montar(CONNACK, 0, corpo);
+}
+
+inline std::string publish(const Publicacao& p) {
+  std::string corpo = texto(p.topico);
+  if (p.qos > 0) corpo += u16(p.id);
+  corpo += p.payload;
+  return montar(PUBLISH, (p.dup ? 0x08 : 0) | (p.qos << 1) | (p.retido ? 1 : 0), corpo);
+}
+
+inline std::string puback(uint16_t id) { return montar(PUBACK, 0, u16(id)); }
+
+inline std::string subscribe(uint16_t id, const std::vector<std::pair<std::string, uint8_t> >& filtros) {
+  std::string corpo = u16(id);
+  for (const auto& f : filtros) corpo += texto(f.first) + (char)f.second;
+  return montar(SUBSCRIBE, 0x02, corpo);
+}
+
+inline std::string unsubscribe(uint16_t id, const std::vector<std::string>& filtros) {
+  std::string corpo = u16(id);
+  for (const std::string& f : filtros) corpo += texto(f);
+  return montar(UNSUBSCRIBE, 0x02, corpo);
+}
+
+inline std::string pingreq() { return montar(PINGREQ, 0, ""); }
+inline std::string disconnect() { return montar(DISCONNECT, 0, ""); }
+
+// --- LEITURA ---
+
+class Leitor {
+public:
+  void adicionar(const char* dados, size_t n) { buffer.append(dados, n); }
+
+  // true e o pacote em p se já chegou um inteiro. Depois de um erro (erro()), não lê mais nada.
+  bool proximo(Pacote& p) {
+    if (falhou || buffer.size() - inicio < 2) return false;
+    size_t tamanho = 0, multiplicador = 1, i = inicio + 1;
+    for (;;) {
+      if (i >= buffer.size()) return false;
+      uint8_t b = buffer[i++];
+      tamanho += (b & 0x7F) * multiplicador;
+      if (!(b & 0x80)) break;
+      multiplicador *= 128;
+      if (multiplicador > 128 * 128 * 128) {
+        falhou = true; // mais de 4 bytes de tamanho
+        return false;
+      }
+    }
+    if (buffer.size() - i < tamanho) return false;
+    uint8_t primeiro = buffer[inicio];
+    p.tipo = (Tipo)(primeiro >> 4);
+    p.flags = primeiro & 0x0F;
+    p.corpo.assign(buffer, i, tamanho);
+    inicio = i + tamanho;
+    if (inicio > 65536 || inicio == buffer.size()) { // não deixa o buffer crescer sem fim
+      buffer.erase(0, inicio);
+      inicio = 0;
+    }
+    return true;
+  }
+
+  bool erro() const { return falhou; }
+  size_t pendente() const { return buffer.size() - inicio; }
+
+private:
+  std::string buffer;
+  size_t inicio = 0;
+  bool falhou = false;
+};
+
+// Lê uma string com prefixo de 2 bytes a partir de *pos
+inline bool lerTexto(const std::string& corpo, size_t* pos, std::string& s) {
+  if (*pos + 2 > corpo.size()) return false;
+  size_t n = ((uint8_t)corpo[*pos] << 8) | (uint8_t)corpo[*pos + 1];
+  if (*pos + 2 + n > corpo.size()) return false;
+  s.assign(corpo, *pos + 2, n);
+  *pos += 2 + n;
+  return true;
+}
+
+inline bool lerU16(const std::string& corpo, size_t* pos, uint16_t* v) {
+  if (*pos + 2 > corpo.size()) return false;
+  *v = ((uint8_t)corpo[*pos] << 8) | (uint8_t)corpo[*pos + 1];
+  *pos += 2;
+  return true;
+}
+
+inline bool lerPublish(const Pacote& pacote, Publicacao& p) {
+  size_t pos = 0;
+  p.dup = pacote.flags & 0x08;
+  p.qos = (pacote.flags >> 1) & 0x03;
+  p.retido = pacote.flags & 0x01;
+  if (p.qos > 1 || !lerTexto(pacote.corpo, &pos, p.topico) || p.topico.empty()) return false; // QoS 2 não é suportado
+  p.id = 0;
+  if (p.qos > 0 && (!lerU16(pacote.corpo, &pos, &p.id) || p.id == 0)) return false;
+  p.payload.assign(pacote.corpo, pos, std::string::npos);
+  return true;
+}
+
+// Filtro com + (um nível) e # (o resto, inclusive nenhum nível)
+inline bool casaTopico(const std::string& filtro, const std::string& topico) {
+  size_t f = 0, t = 0;
+  for (;;) {
+    size_t fimF = filtro.find('/', f), fimT = topico.find('/', t);
+    std::string nivelF = filtro.substr(f, fimF == std::string::npos ? std::string::npos : fimF - f);
+    if (nivelF == "#") return true;
+    if (t > topico.size()) return false;
+    std::string nivelT = topico.substr(t, fimT == std::string::npos ? std::string::npos : fimT - t);
+    if (nivelF != "+" && nivelF != nivelT) return false;
+    if (fimF == std::string::npos || fimT == std::string::npos) {
+      if (fimF == std::string::npos && fimT == std::string::npos) return true;
+      // "a/#" também casa com "a"
+      return fimT == std::string::npos && filtro.compare(fimF, std::string::npos, "/#") == 0;
+    }
+    f = fimF + 1;
+    t = fimT + 1;
+  }
+}
+
+// Filtro válido: + e # ocupam o nível inteiro e # só no fim
+inline bool filtroValido(const std::string& filtro) {
+  if (filtro.empty()) return false;
+  for (size_t i = 0; i < filtro.size(); i++) {
+    if (filtro[i] != '+' && filtro[i] != '#') continue;
+    if (i > 0 && filtro[i - 1] != '/') return false;
+    if (i + 1 < filtro.size() && (filtro[i] == '#' || filtro[i + 1] != '/')) return false;
+  }
+  return true;
+}
+
+} // namespace mqtt
@@ -0,0 +1,300 @@
+// Testes do broker em processo: codec dos pacotes, filtros com + e #,
+// retidas, QoS 1 (PUBACK, janela em voo e fila), troca de sessão pelo
+// identificador, keep alive e erros de protocolo.
+#include <string.h>
+#include <map>
+#include "../../testes/teste.h"
+#include "broker.h"
+
+using mqtt::Pacote;
+using mqtt::Publicacao;
+
+// Conexões de teste: guarda o que o broker mandou para cada uma e quem ele derrubou
+struct Bancada {
+  std::map<int, mqtt::Leitor> saida;
+  std::map<int, bool> derrubada;
+  Broker broker;
+
+  Bancada()
+      : broker([this](int c, const std::string& b) { saida[c].adicionar(b.data(), b.size()); },
+               [this](int c) { derrubada[c] = true; }) {}
+
+  int conectar(const std::string& id, uint16_t keepAlive = 60, uint64_t agoraMs = 0) {
+    int c = broker.abrir();
+    mandar(c, mqtt::connect(id, keepAlive), agoraMs);
+    pacotes(c); // descarta o CONNACK
+    return c;
+  }
+
+  void mandar(int c, const std::string& bytes, uint64_t agoraMs = 0) { broker.receber(c, bytes.data(), bytes.size(), agoraMs); }
+
+  void publicar(int c, const std::string& topico, const std::string& payload, uint8_t qos = 0, bool retido = false,
+                uint16_t id = 1) {
+    Publicacao p;
+    p.topico = topico;
+    p.payload = payload;
+    p.qos = qos;
+    p.retido = retido;
+    p.id = qos ? id : 0;
+    mandar(c, mqtt::publish(p));
+  }
+
+  std::vector<Pacote> pacotes(int c) {
+    std::vector<Pacote> v;
+    Pacote p;
+    while (saida[c].proximo(p)) v.push_back(p);
+    return v;
+  }
+
+  std::vector<Publicacao> publicacoes(int c) {
+    std::vector<Publicacao> v;
+    for (const Pacote& p : pacotes(c)) {
+      Publicacao pub;
+      if (p.tipo == mqtt::PUBLISH && mqtt::lerPublish(p, pub)) v.push_back(pub);
+    }
+    return v;
+  }
+};
+
+static void codec() {
+  puts("codec:");
+  Publicacao p;
+  p.topico = "george/sensor";
+  p.payload = std::string(300, 'x'); // 2 bytes de tamanho
+  p.qos = 1;
+  p.retido = true;
+  p.id = 513;
+  std::string bytes = mqtt::publish(p) + mqtt::pingreq();
+
+  // Chega um byte de cada vez: só sai pacote quando ele está inteiro
+  mqtt::Leitor leitor;
+  std::vector<Pacote> lidos;
+  Pacote pacote;
+  for (char b : bytes) {
+    leitor.adicionar(&b, 1);
+    while (leitor.proximo(pacote)) lidos.push_back(pacote);
+  }
+  Publicacao lida;
+  VERIFICA(lidos.size() == 2 && lidos[0].tipo == mqtt::PUBLISH && lidos[1].tipo == mqtt::PINGREQ,
+           "dois pacotes lidos byte a byte (%zu)", lidos.size());
+  VERIFICA(mqtt::lerPublish(lidos[0], lida) && lida.topico == p.topico && lida.payload == p.payload && lida.qos == 1 &&
+               lida.retido && lida.id == 513,
+           "PUBLISH volta igual (tópico, 300 bytes, QoS 1, retido, id)");
+  VERIFICA(leitor.pendente() == 0 && !leitor.erro(), "nada sobrando no leitor");
+
+  mqtt::Leitor ruim;
+  const char tamanhoDemais[] = { 0x30, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, 0x01 };
+  ruim.adicionar(tamanhoDemais, sizeof tamanhoDemais);
+  VERIFICA(!ruim.proximo(pacote) && ruim.erro(), "tamanho com mais de 4 bytes é erro");
+
+  Pacote qos2 = { mqtt::PUBLISH, 0x04, mqtt::texto("a") + mqtt::u16(1) };
+  VERIFICA(!mqtt::lerPublish(qos2, lida), "PUBLISH QoS 2 recusado");
+}
+
+static void filtros() {
+  puts("filtros:");
+  struct {
+    const char *filtro, *topico;
+    bool casa;
+  } casos[] = {
+    { "a/b", "a/b", true },        { "a/b", "a/c", false },     { "a/+", "a/b", true },
+    { "a/+", "a/b/c", false },     { "a/+/c", "a/b/c", true },  { "+/+", "a/b", true },
+    { "a/#", "a/b/c", true },      { "a/#", "a", true },        { "#", "a/b", true },
+    { "a/+", "a", false },         { "+", "/a", false },        { "+/a", "/a", true },
+    { "a/b/#", "a/c/d", false },   { "a//b", "a//b", true },    { "a/+/b", "a//b", true },
+  };
+  bool todos = true;
+  for (const auto& c : casos) {
+    bool r = mqtt::casaTopico(c.filtro, c.topico);
+    if (r != c.casa) printf("         %s x %s deu %d\n", c.filtro, c.topico, r);
+    todos = todos && r == c.casa;
+  }
+  VERIFICA(todos, "casaTopico em %zu casos", sizeof casos / sizeof casos[0]);
+  VERIFICA(mqtt::filtroValido("a/+/#") && mqtt::filtroValido("#") && !mqtt::filtroValido("a/#/b") &&
+               !mqtt::filtroValido("a+") && !mqtt::filtroValido("a/b#") && !mqtt::filtroValido(""),
+           "filtroValido");
+
+  // A árvore do broker tem que concordar com casaTopico
+  Bancada b;
+  int pub = b.conectar("pub");
+  std::vector<int> subs;
+  const char* filtrosSub[] = { "a/b", "a/+", "a/#", "#", "+/+", "a/+/c", "x/#" };
+  for (const char* f : filtrosSub) {
+    int s = b.conectar(std::string("sub-") + f);
+    b.mandar(s, mqtt::subscribe(1, { { f, 0 } }));
+    b.pacotes(s);
+    subs.push_back(s);
+  }
+  bool iguais = true;
+  for (const char* t : { "a/b", "a", "a/b/c", "x", "b/c" }) {
+    b.publicar(pub, t, "p");
+    for (size_t i = 0; i < subs.size(); i++) {
+      bool recebeu = b.publicacoes(subs[i]).size() == 1;
+      if (recebeu != mqtt::casaTopico(filtrosSub[i], t)) {
+        printf("         %s recebeu %s: %d\n", filtrosSub[i], t, recebeu);
+        iguais = false;
+      }
+    }
+  }
+  VERIFICA(iguais, "entregas do broker batem com casaTopico");
+
+  // Dois filtros da mesma conexão casando: uma entrega só, com o maior QoS
+  int s = b.conectar("dois");
+  b.mandar(s, mqtt::subscribe(2, { { "a/+", 0 }, { "a/#", 1 } }));
+  std::vector<Pacote> suback = b.pacotes(s);
+  VERIFICA(suback.size() == 1 && suback[0].tipo == mqtt::SUBACK && suback[0].corpo == mqtt::u16(2) + '\0' + '\1',
+           "SUBACK com um código por filtro");
+  b.publicar(pub, "a/b", "p", 1, false, 7);
+  std::vector<Publicacao> r = b.publicacoes(s);
+  VERIFICA(r.size() == 1 && r[0].qos == 1, "uma entrega só, em QoS 1 (%zu)", r.size());
+  b.mandar(s, mqtt::unsubscribe(3, { "a/#" }));
+  b.pacotes(s);
+  b.publicar(pub, "a/b", "p", 1, false, 8);
+  r = b.publicacoes(s);
+  VERIFICA(r.size() == 1 && r[0].qos == 0, "depois do UNSUBSCRIBE fica só o a/+ em QoS 0");
+
+  b.mandar(s, mqtt::subscribe(4, { { "a/#/b", 0 } }));
+  suback = b.pacotes(s);
+  VERIFICA(suback.size() == 1 && (uint8_t)suback[0].corpo[2] == 0x80, "filtro inválido volta 0x80 no SUBACK");
+}
+
+static void retidas() {
+  puts("retidas:");
+  Bancada b;
+  int pub = b.conectar("sensor");
+  b.publicar(pub, "george/sensor/status", "online", 1, true, 1);
+  b.publicar(pub, "george/sensor/status", "ligado", 0, true);
+  b.publicar(pub, "george/outro/status", "online", 0, true);
+  VERIFICA(b.broker.retidas() == 2, "uma retida por tópico, a última vale (%zu)", b.broker.retidas());
+
+  int s = b.conectar("dash");
+  b.mandar(s, mqtt::subscribe(1, { { "george/+/status", 0 } }));
+  std::vector<Publicacao> r = b.publicacoes(s);
+  VERIFICA(r.size() == 2 && r[0].retido && r[1].retido, "quem assina recebe as retidas com a flag (%zu)", r.size());
+  bool ultima = false;
+  for (const Publicacao& p : r) ultima = ultima || (p.topico == "george/sensor/status" && p.payload == "ligado");
+  VERIFICA(ultima, "com o payload mais novo");
+
+  b.publicar(pub, "george/sensor/status", "offline", 0, true);
+  r = b.publicacoes(s);
+  VERIFICA(r.size() == 1 && !r[0].retido, "quem já assinava recebe sem a flag de retida");
+
+  b.publicar(pub, "george/sensor/status", "", 0, true);
+  VERIFICA(b.broker.retidas() == 1, "payload vazio apaga a retida");
+  int s2 = b.conectar("dash2");
+  b.mandar(s2, mqtt::subscribe(1, { { "george/#", 0 } }));
+  VERIFICA(b.publicacoes(s2).size() == 1, "e ela não é mais entregue");
+}
+
+static void qos1() {
+  puts("QoS 1:");
+  Bancada b;
+  int pub = b.conectar("sensor");
+  b.publicar(pub, "t", "x", 1, false, 42);
+  std::vector<Pacote> r = b.pacotes(pub);
+  VERIFICA(r.size() == 1 && r[0].tipo == mqtt::PUBACK && r[0].corpo == mqtt::u16(42), "PUBACK com o mesmo id");
+
+  b.broker.maxEmVoo = 3;
+  b.broker.maxFila = 5;
+  int s = b.conectar("lento");
+  b.mandar(s, mqtt::subscribe(1, { { "t", 1 } }));
+  b.pacotes(s);
+  for (int i = 0; i < 10; i++) b.publicar(pub, "t", std::to_string(i), 1, false, i + 1);
+  std::vector<Publicacao> entregues = b.publicacoes(s);
+  VERIFICA(entregues.size() == 3, "só %u em voo sem PUBACK (%zu)", b.broker.maxEmVoo, entregues.size());
+  VERIFICA(b.broker.pendentes(s) == 8 && b.broker.contadores.descartes == 2, "5 na fila, 2 descartadas (pendentes %zu, descartes %llu)",
+           b.broker.pendentes(s), (unsigned long long)b.broker.contadores.descartes);
+
+  // Cada PUBACK libera uma vaga; a ordem se mantém
+  std::string ordem;
+  for (int volta = 0; volta < 5 && !entregues.empty(); volta++) {
+    for (const Publicacao& p : entregues) {
+      ordem += p.payload;
+      b.mandar(s, mqtt::puback(p.id));
+    }
+    entregues = b.publicacoes(s);
+  }
+  VERIFICA(ordem == "01234567" && b.broker.pendentes(s) == 0, "entregues em ordem conforme os PUBACKs (%s)", ordem.c_str());
+
+  // QoS 1 publicada para assinante QoS 0 desce para QoS 0
+  int s0 = b.conectar("qos0");
+  b.mandar(s0, mqtt::subscribe(1, { { "t", 0 } }));
+  b.pacotes(s0);
+  b.publicar(pub, "t", "y", 1, false, 99);
+  std::vector<Publicacao> p0 = b.publicacoes(s0);
+  VERIFICA(p0.size() == 1 && p0[0].qos == 0, "QoS da entrega = menor entre publicação e assinatura");
+}
+
+static void sessoes() {
+  puts("sessoes:");
+  Bancada b;
+  int a = b.conectar("sensor-1");
+  b.mandar(a, mqtt::subscribe(1, { { "x", 0 } }));
+  b.pacotes(a);
+  int a2 = b.conectar("sensor-1");
+  VERIFICA(b.derrubada[a] && b.broker.conectadas() == 1, "mesmo identificador derruba a conexão antiga");
+  int pub = b.conectar("pub");
+  b.publicar(pub, "x", "p");
+  VERIFICA(b.publicacoes(a2).empty() && b.broker.assinaturas() == 0, "clean session: a assinatura antiga não passa para a nova");
+
+  int k = b.conectar("keepalive", 10, 0);
+  b.broker.verificarKeepAlive(14000);
+  VERIFICA(!b.derrubada[k], "keep alive 10 s: ainda vivo com 14 s");
+  b.mandar(k, mqtt::pingreq(), 14000);
+  std::vector<Pacote> r = b.pacotes(k);
+  VERIFICA(r.size() == 1 && r[0].tipo == mqtt::PINGRESP, "PINGREQ -> PINGRESP");
+  b.broker.verificarKeepAlive(14000 + 15001);
+  VERIFICA(b.derrubada[k] && b.broker.contadores.keepAliveVencidos == 1, "derrubado depois de 1,5 x keep alive sem nada");
+
+  int d = b.conectar("tchau");
+  b.mandar(d, mqtt::disconnect());
+  VERIFICA(b.derrubada[d] && b.broker.contadores.desconexoes == 1, "DISCONNECT fecha a conexão");
+
+  int f = b.conectar("cai");
+  b.broker.fechar(f);
+  VERIFICA(b.broker.contadores.quedas == 1 && !b.derrubada[f], "socket caiu: conta como queda");
+}
+
+static void erros() {
+  puts("erros de protocolo:");
+  Bancada b;
+  int c = b.broker.abrir();
+  b.mandar(c, mqtt::pingreq());
+  VERIFICA(b.derrubada[c], "primeiro pacote que não é CONNECT");
+
+  c = b.broker.abrir();
+  std::string v3 = mqtt::texto("MQIsdp") + (char)3 + (char)2 + mqtt::u16(60) + mqtt::texto("velho");
+  b.mandar(c, mqtt::montar(mqtt::CONNECT, 0, v3));
+  std::vector<Pacote> r = b.pacotes(c);
+  VERIFICA(b.derrubada[c] && r.size() == 1 && r[0].tipo == mqtt::CONNACK && r[0].corpo[1] == 1,
+           "MQTT 3.1 recusado com CONNACK 1");
+
+  c = b.conectar("dois-connect");
+  b.mandar(c, mqtt::connect("dois-connect", 60));
+  VERIFICA(b.derrubada[c], "CONNECT repetido");
+
+  c = b.conectar("curinga");
+  b.publicar(c, "a/+", "p");
+  VERIFICA(b.derrubada[c], "PUBLISH em tópico com curinga");
+
+  c = b.conectar("qos2");
+  b.mandar(c, mqtt::montar(mqtt::PUBLISH, 0x04, mqtt::texto("a") + mqtt::u16(1)));
+  VERIFICA(b.derrubada[c], "PUBLISH QoS 2");
+
+  c = b.conectar("lixo");
+  const char lixo[] = { 0x30, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF };
+  b.broker.receber(c, lixo, sizeof lixo, 0);
+  VERIFICA(b.derrubada[c] && b.broker.contadores.errosProtocolo == 6, "tamanho inválido (%llu erros no total)",
+           (unsigned long long)b.broker.contadores.errosProtocolo);
+  VERIFICA(b.broker.conectadas() == 0, "nenhuma sessão sobrou");
+}
+
+int main() {
+  codec();
+  filtros();
+  retidas();
+  qos1();
+  sessoes();
+  erros();
+  return fimDosTestes();
+}
@@ -0,0 +1,175 @@
+// Métricas do firmware: contadores, medidores e histogramas de baldes fixos,
+// exportados no formato texto do Prometheus ("nome{rotulo} valor" por linha).
+//
+// Tudo é alocado na declaração (variáveis globais): registrar uma medida
+// (somar / observar) é só um incremento atômico, sem heap, e pode ser feito de
+// qualquer tarefa. Todos os contadores têm 32 bits de propósito: o Xtensa do
+// ESP32 só tem atomics nativos até 32 bits (um std::atomic de 64 bits vira uma
+// trava da libatomic). Cada métrica se coloca sozinha em uma lista ligada ao ser
+// criada; metricasExportar() percorre essa lista.
+//
+// Biblioteca compartilhada pelos dois sketches do detector de chuva
+// (sensorDeChuvaMQTT e sensorDeChuva3.0). Para a IDE do Arduino achar, aponte
+// o "Local do Sketchbook" (Arquivo > Preferências) para a pasta ESP32 deste
+// repositório, ou copie ESP32/libraries/Metricas para a pasta libraries do seu
+// sketchbook.
+//
+// Uso:
+//   const uint32_t LIMITES_US[] = { 100, 1000, 10000 };
+//   Histograma tempoLeitura("adc_leitura_us", "Tempo de uma leitura do ADC", LIMITES_US);
+//   Contador reconexoes("mqtt_reconexoes_total", "Conexoes MQTT feitas");
+//   Medidor heapLivre("heap_livre_bytes", "Heap livre", lerHeapLivre);
+//   ...
+//   tempoLeitura.observar(micros() - inicio);
+//   reconexoes.somar();
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+#define METRICAS_MAX_BALDES 12 // limites por histograma (+Inf é automático)
+#define METRICAS_MAX_LINHA 160 // maior linha exportada (HELP com a descrição)
+
+class Metrica;
+
+// Onde a exportação parou. Permite mandar o texto em pedaços (resposta chunked)
+// sem montar tudo na memória: cada chamada continua da linha seguinte.
+struct CursorMetricas {
+  Metrica* atual;
+  uint16_t linha;
+  // Cópia dos baldes do histograma atual, tirada na primeira linha dele: assim
+  // os baldes, a soma e a contagem exportados são da mesma leitura.
+  uint32_t copia[METRICAS_MAX_BALDES + 1];
+  uint32_t somaCopia;
+};
+
+class Metrica {
+public:
+  Metrica(const char* nome, const char* ajuda, const char* tipo)
+    : nome(nome), ajuda(ajuda), tipo(tipo), proxima(lista) {
+    lista = this;
+  }
+
+  const char* const nome;
+  const char* const ajuda;
+  const char* const tipo; // "counter", "gauge" ou "histogram"
+  Metrica* const proxima;
+  inline static Metrica* lista = NULL; // todas as métricas criadas
+
+  // Escreve em "p" a i-ésima linha de valores (depois de HELP e TYPE).
+  // Devolve o tamanho escrito, ou -1 se esta métrica não tem a linha i.
+  virtual int valor(uint16_t i, CursorMetricas& c, char* p, size_t max) = 0;
+};
+
+// Só sobe (ex.: reconexões, eventos enviados)
+class Contador : public Metrica {
+public:
+  Contador(const char* nome, const char* ajuda) : Metrica(nome, ajuda, "counter"), total(0) {}
+
+  void somar(uint32_t n = 1) { total.fetch_add(n, std::memory_order_relaxed); }
+  uint32_t ler() const { return total.load(std::memory_order_relaxed); }
+
+  int valor(uint16_t i, CursorMetricas& c, char* p, size_t max) override {
+    if (i > 0) return -1;
+    return snprintf(p, max, "%s %lu\n", nome, (unsigned long)ler());
+  }
+
+private:
+  std::atomic<uint32_t> total;
+};
+
+// Valor do momento (ex.: heap livre, clientes conectados). Com "leitor", o valor
+// é lido só na exportação: nada custa no resto do tempo.
+class Medidor : public Metrica {
+public:
+  Medidor(const char* nome, const char* ajuda, int32_t (*leitor)() = NULL)
+    : Metrica(nome, ajuda, "gauge"), leitor(leitor), atual(0) {}
+
+  void definir(int32_t v) { atual.store(v, std::memory_order_relaxed); }
+
+  int valor(uint16_t i, CursorMetricas& c, char* p, size_t max) override {
+    if (i > 0) return -1;
+    return snprintf(p, max, "%s %ld\n", nome, (long)(leitor ? leitor() : atual.load(std::memory_order_relaxed)));
+  }
+
+private:
+  int32_t (*const leitor)();
+  std::atomic<int32_t> atual;
+};
+
+// Distribuição em baldes fixos (ex.: tempos em us). Cada observação soma 1 no
+// primeiro balde com limite >= valor; a exportação gera os baldes acumulados
+// (le="..."), _sum e _count, como o Prometheus espera.
+// A _sum tem 32 bits e dá a volta depois de 2^32 (~71 min somados, em us): o
+// Prometheus trata a volta como um reinício do contador (rate() continua certo
+// fora da janela em que ela aconteceu).
+class Histograma : public Metrica {
+public:
+  template <size_t N>
+  Histograma(const char* nome, const char* ajuda, const uint32_t (&limites)[N])
+    : Metrica(nome, ajuda, "histogram"), limites(limites), nLimites(N), soma(0) {
+    static_assert(N >= 1 && N <= METRICAS_MAX_BALDES, "Histograma com baldes demais (METRICAS_MAX_BALDES)");
+    for (auto& b : baldes) b.store(0, std::memory_order_relaxed);
+  }
+
+  void observar(uint32_t v) {
+    uint8_t i = 0;
+    while (i < nLimites && v > limites[i]) i++; // i == nLimites: balde +Inf
+    baldes[i].fetch_add(1, std::memory_order_relaxed);
+    soma.fetch_add(v, std::memory_order_relaxed);
+  }
+
+  // Linhas: um balde por limite, +Inf, _sum e _count
+  int valor(uint16_t i, CursorMetricas& c, char* p, size_t max) override {
+    if (i == 0) {
+      for (uint8_t k = 0; k <= nLimites; k++) c.copia[k] = baldes[k].load(std::memory_order_relaxed);
+      c.somaCopia = soma.load(std::memory_order_relaxed);
+    }
+    uint32_t acumulado = 0;
+    for (uint8_t k = 0; k <= nLimites && k <= i; k++) acumulado += c.copia[k];
+
+    if (i < nLimites) return snprintf(p, max, "%s_bucket{le=\"%lu\"} %lu\n", nome, (unsigned long)limites[i], (unsigned long)acumulado);
+    if (i == nLimites) return snprintf(p, max, "%s_bucket{le=\"+Inf\"} %lu\n", nome, (unsigned long)acumulado);
+    if (i == nLimites + 1) return snprintf(p, max, "%s_sum %lu\n", nome, (unsigned long)c.somaCopia);
+    if (i == nLimites + 2) return snprintf(p, max, "%s_count %lu\n", nome, (unsigned long)acumulado);
+    return -1;
+  }
+
+private:
+  const uint32_t* const limites;
+  const uint8_t nLimites;
+  std::atomic<uint32_t> baldes[METRICAS_MAX_BALDES + 1];
+  std::atomic<uint32_t> soma;
+};
+
+// Começa uma exportação do início da lista
+inline void metricasIniciar(CursorMetricas& c) {
+  c.atual = Metrica::lista;
+  c.linha = 0;
+}
+
+// Escreve em "buffer" quantas linhas inteiras couberem, a partir do cursor, e
+// devolve os bytes escritos. Terminou quando c.atual == NULL; se voltar 0 com
+// c.atual != NULL, o buffer era pequeno demais para a próxima linha.
+inline size_t metricasExportar(CursorMetricas& c, char* buffer, size_t max) {
+  char linha[METRICAS_MAX_LINHA];
+  size_t n = 0;
+  while (c.atual) {
+    Metrica* m = c.atual;
+    int tamanho;
+    if (c.linha == 0) tamanho = snprintf(linha, sizeof(linha), "# HELP %s %s\n", m->nome, m->ajuda);
+    else if (c.linha == 1) tamanho = snprintf(linha, sizeof(linha), "# TYPE %s %s\n", m->nome, m->tipo);
+    else tamanho = m->valor(c.linha - 2, c, linha, sizeof(linha));
+
+    if (tamanho < 0) { // Acabaram as linhas desta métrica
+      c.atual = m->proxima;
+      c.linha = 0;
+      continue;
+    }
+    if ((size_t)tamanho >= sizeof(linha)) tamanho = sizeof(linha) - 1; // Cortada pelo snprintf
+    if (n + tamanho > max) break; // Fica para o próximo pedaço
+    memcpy(buffer + n, linha, tamanho);
+    n += tamanho;
+    c.linha++;
+  }
+  return n;
+}
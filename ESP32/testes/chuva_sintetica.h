@@ -0,0 +1,96 @@
+// Sinal sintético do sensor de chuva, para alimentar o ADC do simulador.
+//
+// Leitura do pino (0-4095, 4095 = placa seca) = 4095 - molhado(t) + ruído:
+//   - chuvas sorteadas (intervalo exponencial entre elas), cada uma com
+//     subida de alguns minutos, platô oscilando (rajadas) e secagem lenta
+//     (exponencial) depois que para;
+//   - ruído gaussiano do ADC e picos isolados de interferência.
+// O valor depende só de t e da semente: duas leituras do mesmo instante dão o
+// mesmo número, em qualquer ordem.
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+class ChuvaSintetica {
+public:
+  double chuvasPorDia = 2;     // média
+  double ruidoLsb = 6;         // desvio padrão do ruído do ADC
+  double probabilidadePico = 0.002; // por leitura
+  double picoLsb = 400;
+
+  explicit ChuvaSintetica(uint64_t semente = 1) : semente(semente), estado(semente) {}
+
+  int operator()(uint64_t us) {
+    double t = us / 1e6;
+    gerarAte(t);
+    double leitura = 4095 - molhado(t);
+    double u1 = uniforme(us, 1), u2 = uniforme(us, 2);
+    leitura += ruidoLsb * sqrt(-2 * log(u1 + 1e-300)) * cos(2 * M_PI * u2);
+    if (uniforme(us, 3) < probabilidadePico) leitura += uniforme(us, 4) < 0.5 ? -picoLsb : picoLsb;
+    if (leitura < 0) leitura = 0;
+    if (leitura > 4095) leitura = 4095;
+    return (int)lround(leitura);
+  }
+
+  // Quanto a placa está molhada em t (LSB, sem ruído): o valor "verdadeiro"
+  double molhado(double t) const {
+    double total = 0;
+    for (const Chuva& c : chuvas) {
+      if (t < c.inicio) break;
+      double dt = t - c.inicio;
+      double subida = 1 - exp(-dt / c.subida);
+      double rajadas = 1 + 0.25 * sin(2 * M_PI * dt / c.periodoRajada) + 0.1 * sin(2 * M_PI * dt / 97);
+      double nivel = c.pico * subida * rajadas;
+      if (dt > c.duracao) {
+        double fim = c.pico * (1 - exp(-c.duracao / c.subida)) * (1 + 0.25 * sin(2 * M_PI * c.duracao / c.periodoRajada) +
+                                                                  0.1 * sin(2 * M_PI * c.duracao / 97));
+        nivel = fim * exp(-(dt - c.duracao) / c.secagem);
+      }
+      total += nivel;
+    }
+    return total > 4000 ? 4000 : total;
+  }
+
+  size_t quantidadeChuvas() const { return chuvas.size(); }
+
+private:
+  struct Chuva {
+    double inicio, duracao, subida, secagem, pico, periodoRajada; // s, LSB
+  };
+
+  uint64_t semente;
+  uint64_t estado;
+  double proximaChuva = -1;
+  std::vector<Chuva> chuvas;
+
+  double sortear() { // 0..1 (sequência das chuvas)
+    estado ^= estado << 13;
+    estado ^= estado >> 7;
+    estado ^= estado << 17;
+    return (estado >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  double uniforme(uint64_t us, uint64_t canal) const { // 0..1, função só de (t, canal)
+    uint64_t z = us * 0x9E3779B97F4A7C15ull + canal * 0xBF58476D1CE4E5B9ull + semente;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  void gerarAte(double t) {
+    if (proximaChuva < 0) proximaChuva = -log(1 - sortear()) * 86400 / chuvasPorDia;
+    while (proximaChuva <= t + 86400) {
+      Chuva c;
+      c.inicio = proximaChuva;
+      c.duracao = 1200 + sortear() * 9600;  // 20 min a 3 h
+      c.subida = 60 + sortear() * 540;      // 1 a 10 min
+      c.secagem = 600 + sortear() * 1800;   // 10 a 40 min
+      c.pico = 300 + sortear() * 2200;      // LSB
+      c.periodoRajada = 120 + sortear() * 600;
+      chuvas.push_back(c);
+      proximaChuva += c.duracao - log(1 - sortear()) * 86400 / chuvasPorDia;
+    }
+  }
+};
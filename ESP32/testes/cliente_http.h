@@ -0,0 +1,129 @@
+// Navegador de mentira para os testes do servidor web (sim::web): GET com a
+// resposta inteira (Content-Length ou em pedaços) e EventSource, que devolve
+// cada evento com o instante (tempo virtual) em que chegou.
+#pragma once
+#include <ctype.h>
+#include <map>
+#include <memory>
+#include <string>
+#include "sim.h"
+
+struct RespostaHttp {
+  int status = 0;          // 0 = não chegou resposta
+  bool recusada = false;   // SYN sem resposta: desistiu de conectar
+  std::map<std::string, std::string> cabecalhos; // nomes em minúsculas
+  std::string corpo;
+  uint64_t inicioUs = 0;   // abriu a conexão
+  uint64_t fimUs = 0;      // a conexão fechou
+};
+
+// Lê a resposta aos pedaços, do jeito que os bytes chegam do TCP. aoCorpo
+// recebe cada trecho do corpo já sem a moldura dos pedaços.
+class LeitorHttp {
+public:
+  RespostaHttp resposta;
+  std::function<void(const std::string& trecho)> aoCorpo;
+
+  void adicionar(const std::string& bytes) {
+    buffer += bytes;
+    if (!cabecalhoLido) {
+      size_t fim = buffer.find("\r\n\r\n");
+      if (fim == std::string::npos) return;
+      sscanf(buffer.c_str(), "HTTP/1.1 %d", &resposta.status);
+      for (size_t i = buffer.find("\r\n") + 2; i < fim;) {
+        size_t f = buffer.find("\r\n", i);
+        std::string linha = buffer.substr(i, f - i);
+        size_t p = linha.find(':');
+        std::string nome = linha.substr(0, p);
+        for (char& ch : nome) ch = tolower(ch);
+        if (p != std::string::npos) resposta.cabecalhos[nome] = linha.substr(linha.find_first_not_of(' ', p + 1));
+        i = f + 2;
+      }
+      emPedacos = resposta.cabecalhos["transfer-encoding"] == "chunked";
+      buffer.erase(0, fim + 4);
+      cabecalhoLido = true;
+    }
+    if (!emPedacos) {
+      entregar(buffer);
+      buffer.clear();
+      return;
+    }
+    // "<hex>\r\n<dados>\r\n" ... "0\r\n\r\n"
+    for (;;) {
+      size_t fimLinha = buffer.find("\r\n");
+      if (fimLinha == std::string::npos) return;
+      size_t tamanho = strtoul(buffer.c_str(), NULL, 16);
+      if (buffer.size() < fimLinha + 2 + tamanho + 2) return;
+      if (tamanho) entregar(buffer.substr(fimLinha + 2, tamanho));
+      buffer.erase(0, fimLinha + 2 + tamanho + 2);
+    }
+  }
+
+private:
+  std::string buffer;
+  bool cabecalhoLido = false, emPedacos = false;
+
+  void entregar(const std::string& trecho) {
+    if (trecho.empty()) return;
+    resposta.corpo += trecho;
+    if (aoCorpo) aoCorpo(trecho);
+  }
+};
+
+// GET alvo; pronto() é chamado quando a conexão fecha (ou o SYN desiste).
+// bytesPorSegundo: velocidade do cliente (0 = a da rede, sim::web).
+inline int httpGet(const std::string& alvo, std::function<void(const RespostaHttp&)> pronto, uint32_t bytesPorSegundo = 0,
+                   const std::string& cabecalhosExtras = "", std::function<void(const std::string&)> aoCorpo = nullptr) {
+  std::shared_ptr<LeitorHttp> leitor(new LeitorHttp());
+  std::shared_ptr<int> conexao(new int(-1));
+  leitor->resposta.inicioUs = sim::agora();
+  leitor->aoCorpo = aoCorpo;
+  sim::ClienteTcp c;
+  c.bytesPorSegundo = bytesPorSegundo;
+  c.aoConectar = [conexao, alvo, cabecalhosExtras]() {
+    sim::web.enviar(*conexao, "GET " + alvo + " HTTP/1.1\r\nHost: 192.168.0.50\r\n" + cabecalhosExtras + "\r\n");
+  };
+  c.aoReceber = [leitor](const std::string& bytes) { leitor->adicionar(bytes); };
+  c.aoFechar = [leitor, pronto](bool recusada) {
+    leitor->resposta.recusada = recusada;
+    leitor->resposta.fimUs = sim::agora();
+    if (pronto) pronto(leitor->resposta);
+  };
+  *conexao = sim::web.abrir(c);
+  return *conexao;
+}
+
+struct EventoSse {
+  uint32_t id = 0;
+  std::string dados;
+  uint64_t chegadaUs = 0;
+};
+
+// EventSource("/eventos"): aoEvento a cada evento completo; aoFechar quando a
+// conexão termina (com o status: 503 = recusado pelo ESP32). Devolve a conexão
+// para o teste fechar a "aba" com sim::web.fechar.
+inline int abrirEventos(std::function<void(const EventoSse&)> aoEvento, std::function<void(const RespostaHttp&)> aoFechar) {
+  std::shared_ptr<std::string> pendente(new std::string());
+  return httpGet("/eventos", aoFechar, 0, "Accept: text/event-stream\r\n", [pendente, aoEvento](const std::string& trecho) {
+    *pendente += trecho;
+    size_t fim;
+    while ((fim = pendente->find("\n\n")) != std::string::npos) {
+      std::string bloco = pendente->substr(0, fim + 1);
+      pendente->erase(0, fim + 2);
+      EventoSse e;
+      e.chegadaUs = sim::agora();
+      bool temDados = false;
+      for (size_t i = 0; i < bloco.size();) {
+        size_t f = bloco.find('\n', i);
+        std::string linha = bloco.substr(i, f - i);
+        if (linha.compare(0, 4, "id: ") == 0) e.id = strtoul(linha.c_str() + 4, NULL, 10);
+        if (linha.compare(0, 6, "data: ") == 0) {
+          e.dados = linha.substr(6);
+          temDados = true;
+        }
+        i = f + 1;
+      }
+      if (temDados && aoEvento) aoEvento(e); // "retry: 3000" sozinho não é evento
+    }
+  });
+}
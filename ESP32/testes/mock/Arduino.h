@@ -0,0 +1,151 @@
+// Arduino.h de mentira: só o que os sketches deste repositório usam do núcleo
+// do ESP32 (Arduino-ESP32 3.x), ligado ao tempo virtual do simulador (sim.h).
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "sim.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define PROGMEM
+#define IRAM_ATTR
+#define RTC_DATA_ATTR // sobrevive ao deep sleep de graça: nada é zerado no PC
+#define PGM_P const char*
+
+using std::max;
+using std::min;
+
+// --- TEMPO ---
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// O relógio do sistema (gettimeofday) também é virtual e não volta a zero no deep sleep
+extern "C" int sim_gettimeofday(struct timeval* tv, void* tz);
+#define gettimeofday sim_gettimeofday
+
+// --- GPIO / ADC / PWM ---
+void pinMode(uint8_t pino, uint8_t modo);
+void digitalWrite(uint8_t pino, uint8_t valor);
+int digitalRead(uint8_t pino);
+uint16_t analogRead(uint8_t pino);
+uint32_t analogReadMilliVolts(uint8_t pino);
+bool ledcAttach(uint8_t pino, uint32_t frequencia, uint8_t resolucao);
+bool ledcWrite(uint8_t pino, uint32_t duty);
+
+enum adc_attenuation_t { ADC_0db, ADC_2_5db, ADC_6db, ADC_11db };
+typedef struct {
+  uint8_t pin;
+  uint8_t channel;
+  int avg_read_raw;
+  int avg_read_mvolts;
+} adc_continuous_data_t;
+bool analogContinuous(const uint8_t pinos[], size_t quantidade, uint32_t conversoesPorPino, uint32_t frequencia, void (*aoTerminar)(void));
+bool analogContinuousRead(adc_continuous_data_t** buffer, uint32_t timeoutMs);
+bool analogContinuousStart();
+bool analogContinuousStop();
+void analogContinuousSetWidth(uint8_t bits);
+void analogContinuousSetAtten(adc_attenuation_t atenuacao);
+
+// --- TIMER DE HARDWARE ---
+struct hw_timer_t;
+hw_timer_t* timerBegin(uint32_t frequencia);
+void timerEnd(hw_timer_t* timer);
+void timerAttachInterrupt(hw_timer_t* timer, void (*fn)(void));
+void timerAlarm(hw_timer_t* timer, uint64_t valor, bool autoReload, uint64_t repeticoes);
+
+// --- NÚMEROS ALEATÓRIOS (semente fixa: a simulação se repete igual) ---
+long random(long maximo);
+long random(long minimo, long maximo);
+void randomSeed(unsigned long semente);
+
+// --- SERIAL ---
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* p, size_t n) {
+    size_t total = 0;
+    while (n--) total += write(*p++);
+    return total;
+  }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const std::string& s) { return write((const uint8_t*)s.data(), s.size()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(int v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(long v, int base = DEC) {
+    if (base == DEC || v >= 0) return numero(v < 0 ? -(unsigned long)v : v, base, v < 0);
+    return numero((unsigned long)v, base, false);
+  }
+  size_t print(unsigned long v, int base = DEC) { return numero(v, base, false); }
+  size_t print(long long v, int base = DEC) { return print((long)v, base); }
+  size_t print(unsigned long long v, int base = DEC) { return print((unsigned long)v, base); }
+  size_t print(double v, int casas = 2) {
+    char texto[48];
+    snprintf(texto, sizeof(texto), "%.*f", casas, v);
+    return write(texto);
+  }
+  template <class T>
+  auto print(const T& v) -> decltype(v.toString(), size_t()) { return print(v.toString()); }
+
+  template <class T>
+  size_t println(const T& v) { return print(v) + println(); }
+  template <class T>
+  size_t println(const T& v, int formato) { return print(v, formato) + println(); }
+  size_t println() { return write((const uint8_t*)"\r\n", 2); }
+
+  int printf(const char* formato, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  size_t numero(unsigned long v, int base, bool negativo) {
+    char texto[72];
+    char* p = texto + sizeof(texto);
+    *--p = 0;
+    do {
+      int d = v % base;
+      *--p = d < 10 ? '0' + d : 'A' + d - 10;
+      v /= base;
+    } while (v);
+    if (negativo) *--p = '-';
+    return write(p);
+  }
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud);
+  void end() {}
+  void flush(); // espera a UART esvaziar (o relógio anda)
+  int available() { return 0; }
+  int read() { return -1; }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* p, size_t n) override;
+  using Print::write;
+  operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
@@ -0,0 +1,5 @@
+// AsyncTCP de mentira: a tarefa async_tcp, os PCBs do lwIP e as conexões com
+// os clientes do teste ficam em servidor_web.cpp (sim::web). Os sketches só
+// usam o AsyncWebServer, então nada de AsyncClient aqui.
+#pragma once
+#include "Arduino.h"
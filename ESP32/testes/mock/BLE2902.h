@@ -0,0 +1,2 @@
+#pragma once
+#include "BLEDevice.h" // o BLE2902 de mentira mora junto com o resto da biblioteca
@@ -0,0 +1,151 @@
+// Biblioteca BLE do Arduino-ESP32 de mentira (BLEDevice, BLEServer,
+// BLEService, BLECharacteristic) sobre o Bluetooth do simulador
+// (bluetooth.cpp). Como na de verdade, o BLEDevice registra o único callback
+// GATT do Bluedroid: cada evento vai para o último servidor criado (se o
+// gatts_if for dele) e depois para o handler de setCustomGattsHandler, que vê
+// os eventos de todas as apps.
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "esp_gatts_api.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatt_common_api.h"
+
+class BLEServer;
+class BLECharacteristic;
+
+class BLEUUID {
+public:
+  BLEUUID() {}
+  BLEUUID(const char* texto); // "8d1a0002-2f4e-..." ou "FFE1"
+  BLEUUID(uint16_t uuid16);
+  bool operator==(const BLEUUID& outro) const { return bytes == outro.bytes; }
+
+  std::string bytes; // little-endian, como no IDF (2 ou 16 bytes)
+};
+
+class BLEDescriptor {
+public:
+  BLEDescriptor(BLEUUID uuid, uint16_t tamanhoMax = 100) : uuid(uuid), tamanhoMax(tamanhoMax) {}
+  virtual ~BLEDescriptor() {}
+  BLEUUID getUUID() const { return uuid; }
+  uint16_t getHandle() const { return handle; }
+  void setValue(const uint8_t* dados, size_t n) { valor.assign((const char*)dados, n); }
+  uint8_t* getValue() { return (uint8_t*)&valor[0]; }
+  size_t getLength() const { return valor.size(); }
+
+  // --- simulador ---
+  BLEUUID uuid;
+  uint16_t tamanhoMax;
+  uint16_t handle = 0;
+  std::string valor;
+};
+
+// CCCD: o cliente escreve 0x0001 para ligar o notify
+class BLE2902 : public BLEDescriptor {
+public:
+  BLE2902() : BLEDescriptor(BLEUUID((uint16_t)ESP_GATT_UUID_CHAR_CLIENT_CONFIG), 2) { valor.assign(2, '\0'); }
+  bool getNotifications() const { return valor.size() >= 1 && (valor[0] & 1); }
+  bool getIndications() const { return valor.size() >= 1 && (valor[0] & 2); }
+  void setNotifications(bool ligar) { valor[0] = ligar ? (valor[0] | 1) : (valor[0] & ~1); }
+};
+
+class BLECharacteristicCallbacks {
+public:
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onWrite(BLECharacteristic* caracteristica) {}
+  virtual void onWrite(BLECharacteristic* caracteristica, esp_ble_gatts_cb_param_t* param) { onWrite(caracteristica); }
+};
+
+class BLECharacteristic {
+public:
+  static const uint32_t PROPERTY_READ = 1 << 0;
+  static const uint32_t PROPERTY_WRITE = 1 << 1;
+  static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+  static const uint32_t PROPERTY_BROADCAST = 1 << 3;
+  static const uint32_t PROPERTY_INDICATE = 1 << 4;
+  static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+  BLECharacteristic(BLEUUID uuid, uint32_t propriedades) : uuid(uuid), propriedades(propriedades) {}
+  virtual ~BLECharacteristic() {}
+  BLEUUID getUUID() const { return uuid; }
+  uint16_t getHandle() const { return handle; }
+  void addDescriptor(BLEDescriptor* d) { descritores.push_back(d); }
+  BLEDescriptor* getDescriptorByUUID(const char* texto);
+  void setCallbacks(BLECharacteristicCallbacks* c) { callbacks = c; }
+  void setValue(const uint8_t* dados, size_t n) { valor.assign((const char*)dados, n); }
+  void setValue(const std::string& v) { valor = v; }
+  std::string getValue() const { return valor; }
+  void notify(bool notificacao = true); // manda o valor atual a quem ligou o notify no BLE2902
+
+  // --- simulador ---
+  BLEUUID uuid;
+  uint32_t propriedades;
+  uint16_t handle = 0;
+  std::string valor;
+  std::vector<BLEDescriptor*> descritores;
+  BLECharacteristicCallbacks* callbacks = NULL;
+  BLEServer* servidor = NULL;
+};
+
+class BLEService {
+public:
+  BLECharacteristic* createCharacteristic(const char* uuid, uint32_t propriedades) {
+    return createCharacteristic(BLEUUID(uuid), propriedades);
+  }
+  BLECharacteristic* createCharacteristic(BLEUUID uuid, uint32_t propriedades);
+  void start(); // publica os atributos no GATT (ESP_GATTS_START_EVT)
+  BLEServer* getServer() const { return servidor; }
+
+  // --- simulador ---
+  BLEUUID uuid;
+  BLEServer* servidor = NULL;
+  std::vector<BLECharacteristic*> caracteristicas;
+  uint16_t handle = 0;
+};
+
+class BLEServerCallbacks {
+public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer* servidor) {}
+  virtual void onConnect(BLEServer* servidor, esp_ble_gatts_cb_param_t* param) {}
+  virtual void onDisconnect(BLEServer* servidor) {}
+  virtual void onDisconnect(BLEServer* servidor, esp_ble_gatts_cb_param_t* param) {}
+  virtual void onMtuChanged(BLEServer* servidor, esp_ble_gatts_cb_param_t* param) {}
+};
+
+class BLEServer {
+public:
+  BLEService* createService(const char* uuid) { return createService(BLEUUID(uuid)); }
+  BLEService* createService(BLEUUID uuid);
+  void setCallbacks(BLEServerCallbacks* c) { callbacks = c; }
+  uint32_t getConnectedCount() const { return conectados; }
+  uint16_t getConnId() const { return connId; }
+  esp_gatt_if_t getGattsIf() const { return gattsIf; }
+  void startAdvertising() {}
+
+  // --- simulador ---
+  // O handleGATTServerEvent da biblioteca: conexão, MTU e escritas nas suas características
+  void tratarEvento(esp_gatts_cb_event_t evento, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t* param);
+  uint16_t appId = 0;
+  esp_gatt_if_t gattsIf = ESP_GATT_IF_NONE;
+  BLEServerCallbacks* callbacks = NULL;
+  std::vector<BLEService*> servicos;
+  uint32_t conectados = 0;
+  uint16_t connId = 0;
+};
+
+typedef void (*gatts_event_handler)(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t* param);
+
+class BLEDevice {
+public:
+  static void init(const std::string& nome); // liga o Bluedroid (só a primeira chamada faz algo)
+  static bool getInitialized();
+  static BLEServer* createServer();
+  static esp_err_t setMTU(uint16_t mtu);
+  static uint16_t getMTU();
+  static void setCustomGattsHandler(gatts_event_handler handler);
+  static void startAdvertising() {}
+};
@@ -0,0 +1,108 @@
+// ESPAsyncWebServer de mentira: rotas, requisições e respostas (texto, da
+// flash ou em pedaços) sobre as conexões simuladas de sim::web. Como na
+// biblioteca de verdade: tudo roda na tarefa async_tcp, a conexão fecha no fim
+// de cada resposta (sem keep-alive) e a função de uma resposta em pedaços é
+// chamada a cada ACK e a cada poll do lwIP (~0,5 s); se ela devolver
+// RESPONSE_TRY_AGAIN nada sai até a próxima chamada.
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Arduino.h"
+#include "AsyncTCP.h"
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+typedef enum { HTTP_GET = 0x01, HTTP_POST = 0x02, HTTP_ANY = 0x7F } WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebServerRequest;
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+typedef std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+typedef std::function<void()> ArDisconnectHandler;
+
+class AsyncWebHeader {
+public:
+  AsyncWebHeader(const std::string& nome, const std::string& valor) : nome(nome), valor(valor) {}
+  const std::string& name() const { return nome; }
+  const std::string& value() const { return valor; }
+
+private:
+  std::string nome, valor;
+};
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const std::string& nome, const std::string& valor) : nome(nome), valor(valor) {}
+  const std::string& name() const { return nome; }
+  const std::string& value() const { return valor; }
+
+private:
+  std::string nome, valor;
+};
+
+class AsyncWebServerResponse {
+public:
+  void addHeader(const char* nome, const char* valor) { cabecalhos.emplace_back(nome, valor); }
+  void addHeader(const std::string& nome, const std::string& valor) { cabecalhos.emplace_back(nome, valor); }
+
+  // --- simulador (servidor_web.cpp) ---
+  int codigo = 200;
+  std::string tipo;
+  std::vector<std::pair<std::string, std::string> > cabecalhos;
+  const uint8_t* corpo = NULL; // texto ou flash (o texto fica em "copia")
+  size_t tamanho = 0;
+  std::string copia;
+  AwsResponseFiller preencher; // resposta em pedaços (chunked)
+  size_t enviado = 0;          // bytes do corpo já entregues ao TCP
+  bool cabecalhoEnviado = false;
+  bool terminou = false;
+};
+
+class AsyncWebServerRequest {
+public:
+  const std::string& url() const { return caminho; }
+  WebRequestMethodComposite method() const { return HTTP_GET; }
+
+  bool hasHeader(const char* nome) const;
+  AsyncWebHeader* getHeader(const char* nome);
+  bool hasParam(const char* nome, bool post = false, bool arquivo = false) const;
+  AsyncWebParameter* getParam(const char* nome, bool post = false, bool arquivo = false);
+
+  void onDisconnect(ArDisconnectHandler fn) { aoDesconectar = fn; }
+
+  AsyncWebServerResponse* beginResponse(int codigo, const char* tipo = "", const char* conteudo = "");
+  AsyncWebServerResponse* beginResponse_P(int codigo, const char* tipo, const uint8_t* dados, size_t tamanho);
+  AsyncWebServerResponse* beginChunkedResponse(const char* tipo, AwsResponseFiller fn);
+  void send(AsyncWebServerResponse* resposta);
+  void send(int codigo, const char* tipo = "", const char* conteudo = "") { send(beginResponse(codigo, tipo, conteudo)); }
+
+  // --- simulador (servidor_web.cpp) ---
+  int conexao = -1;
+  std::string caminho;
+  std::vector<AsyncWebHeader> cabecalhos;
+  std::vector<AsyncWebParameter> parametros;
+  std::unique_ptr<AsyncWebServerResponse> resposta;
+  ArDisconnectHandler aoDesconectar;
+};
+
+class AsyncWebServer {
+public:
+  AsyncWebServer(uint16_t porta) : porta(porta) {}
+  void on(const char* uri, WebRequestMethodComposite metodo, ArRequestHandlerFunction fn);
+  void onNotFound(ArRequestHandlerFunction fn) { naoEncontrado = fn; }
+  void begin(); // cria a tarefa async_tcp e passa a aceitar as conexões de sim::web
+
+  // --- simulador (servidor_web.cpp) ---
+  struct Rota {
+    std::string uri;
+    WebRequestMethodComposite metodo;
+    ArRequestHandlerFunction fn;
+  };
+  uint16_t porta;
+  uint32_t geracao = 0; // boot em que as rotas foram registradas (o setup() registra de novo a cada boot)
+  std::vector<Rota> rotas;
+  ArRequestHandlerFunction naoEncontrado;
+};
@@ -0,0 +1,80 @@
+// PubSubClient de mentira, com a mesma API da biblioteca (knolleary 2.8).
+// Fala com o broker em memória do simulador (sim::broker) ou, com
+// SIM_BROKER=host:porta, com um broker MQTT 3.1.1 de verdade via TCP.
+#pragma once
+#include <functional>
+#include <deque>
+#include "WiFi.h"
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_KEEPALIVE 15
+#define MQTT_SOCKET_TIMEOUT 15
+
+#define MQTT_CONNECTION_TIMEOUT -4
+#define MQTT_CONNECTION_LOST -3
+#define MQTT_CONNECT_FAILED -2
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient {
+public:
+  PubSubClient() {}
+  PubSubClient(WiFiClient& cliente) {}
+  ~PubSubClient();
+
+  PubSubClient& setServer(const char* host, uint16_t porta);
+  PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE);
+  PubSubClient& setKeepAlive(uint16_t segundos);
+  PubSubClient& setSocketTimeout(uint16_t segundos);
+  bool setBufferSize(uint16_t tamanho);
+  uint16_t getBufferSize() { return tamanhoBuffer; }
+
+  bool connect(const char* id);
+  bool connect(const char* id, const char* usuario, const char* senha);
+  void disconnect();
+  bool connected();
+  int state();
+  bool loop();
+
+  bool publish(const char* topico, const char* payload);
+  bool publish(const char* topico, const char* payload, bool retido);
+  bool publish(const char* topico, const uint8_t* payload, unsigned int n);
+  bool publish(const char* topico, const uint8_t* payload, unsigned int n, bool retido);
+  bool beginPublish(const char* topico, unsigned int n, bool retido);
+  size_t write(uint8_t b);
+  size_t write(const uint8_t* p, size_t n);
+  int endPublish();
+  bool subscribe(const char* topico, uint8_t qos = 0);
+  bool unsubscribe(const char* topico);
+
+  // Usado pelo broker em memória
+  void entregar(const std::string& topico, const std::string& payload);
+  bool assina(const std::string& topico) const;
+
+private:
+  void reiniciarSeNovoBoot();
+  void cair(int motivo);
+  bool enviarPacote(uint8_t tipo, const std::string& corpo);
+  bool lerPacote(uint8_t* tipo, std::string* corpo, uint32_t esperaMs);
+  void entregarAoSketch(std::string topico, std::string payload);
+
+  uint32_t geracao = 0;
+  std::function<void(char*, uint8_t*, unsigned int)> callback;
+  std::string host;
+  uint16_t porta = 1883;
+  uint16_t tamanhoBuffer = MQTT_MAX_PACKET_SIZE;
+  uint16_t keepAlive = MQTT_KEEPALIVE;
+  bool conectado = false;
+  int estado = MQTT_DISCONNECTED;
+  uint64_t ultimoEnvioUs = 0;
+  uint16_t proximoId = 1;
+  std::vector<std::string> assinaturas;
+  std::deque<std::pair<std::string, std::string> > chegando; // broker em memória -> sketch
+  std::string publicacaoAberta; // beginPublish ... endPublish
+  std::string topicoAberto;
+  size_t tamanhoAberto = 0;
+  int soquete = -1; // broker real
+  std::string recebido; // bytes lidos do socket e ainda não processados
+};
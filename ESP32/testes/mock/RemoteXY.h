@@ -0,0 +1,23 @@
+// RemoteXY de mentira, só no modo BLE (REMOTEXY_MODE__ESP32CORE_BLE). Como a
+// biblioteca: RemoteXY_Init() liga o BLEDevice e cria um servidor com a
+// característica FFE1, onde o app escreve; RemoteXY_Handler() copia para a
+// struct RemoteXY do sketch o que chegou e atualiza o connect_flag (último
+// byte: 1 enquanto chegam pacotes do app). Depois de uma queda as variáveis
+// ficam com os últimos valores, como na de verdade.
+//
+// O app de mentira é o sim::ble: sim::ble.controles() muda o estado dos
+// controles (os bytes das variáveis de entrada, na ordem da struct).
+#pragma once
+#include "BLEDevice.h"
+
+#ifndef REMOTEXY_MODE__ESP32CORE_BLE
+#error "o simulador só tem o RemoteXY em modo BLE (defina REMOTEXY_MODE__ESP32CORE_BLE)"
+#endif
+
+#define REMOTEXY_TIMEOUT 5000 // ms sem pacote do app: connect_flag volta a 0
+
+void remotexyIniciar(const uint8_t* conf, void* variaveis, size_t tamanho, const char* nome);
+void remotexyHandler();
+
+#define RemoteXY_Init() remotexyIniciar(RemoteXY_CONF, &RemoteXY, sizeof(RemoteXY), REMOTEXY_BLUETOOTH_NAME)
+#define RemoteXY_Handler() remotexyHandler()
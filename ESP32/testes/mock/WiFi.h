@@ -0,0 +1,74 @@
+// WiFi de mentira: o "AP" é sim::wifi (disponível ou não, tempos de varredura,
+// associação e DHCP). O tempo de conexão cai quando o sketch passa canal e BSSID
+// (sem varredura) e quando usa IP estático (sem DHCP), como no ESP32 real.
+#pragma once
+#include "Arduino.h"
+
+typedef enum {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+class IPAddress {
+public:
+  IPAddress() : valor(0) {}
+  IPAddress(uint32_t v) : valor(v) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : valor(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+  operator uint32_t() const { return valor; }
+  uint8_t operator[](int i) const { return (valor >> (8 * i)) & 0xFF; }
+  std::string toString() const {
+    char texto[16];
+    snprintf(texto, sizeof(texto), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return texto;
+  }
+
+private:
+  uint32_t valor;
+};
+
+class WiFiClass {
+public:
+  wl_status_t begin(const char* ssid, const char* senha, int32_t canal = 0, const uint8_t* bssid = NULL, bool conectar = true);
+  wl_status_t status();
+  bool disconnect(bool desligarRadio = false, bool apagarAp = false);
+  bool config(IPAddress ip, IPAddress gateway, IPAddress mascara, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+  bool mode(wifi_mode_t modo) { return true; }
+  bool setAutoReconnect(bool ligar) { return true; }
+  bool persistent(bool ligar) { return true; }
+  bool isConnected() { return status() == WL_CONNECTED; }
+
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress dnsIP(uint8_t i = 0);
+  uint8_t* BSSID();
+  int32_t channel();
+  int8_t RSSI() { return -60; }
+  uint8_t* macAddress(uint8_t* mac);
+
+private:
+  void reiniciarSeNovoBoot();
+  uint32_t geracao = 0;
+  bool iniciado = false;
+  bool conectou = false;
+  bool ipEstatico = false;
+  uint64_t conectaEm = 0; // us
+  uint64_t inicioUs = 0;
+  IPAddress ip;
+};
+extern WiFiClass WiFi;
+
+// Só existe para ser passado ao PubSubClient (o socket de verdade, quando há um, fica lá)
+class WiFiClient {
+public:
+  void setTimeout(uint32_t segundos) {}
+  void setNoDelay(bool ligar) {}
+  void stop() {}
+};
@@ -0,0 +1,601 @@
+// Bluetooth LE do simulador: o Bluedroid (apps GATT, atributos, eventos na
+// tarefa btc), a biblioteca BLE do Arduino, o RemoteXY e o celular (sim::ble).
+//
+// Tudo o que o celular faz vira evento do simulador no próximo evento de
+// conexão; do lado do ESP32 o evento GATT entra na fila da tarefa btc, que
+// chama o BLEServer e o handler de setCustomGattsHandler, nessa ordem, como o
+// BLEDevice::gattServerEventHandler. Como lá, só o último BLEServer criado
+// (m_pServer) recebe eventos: um segundo createServer deixa o primeiro surdo.
+#include <math.h>
+#include <deque>
+#include <memory>
+#include "BLEDevice.h"
+#define REMOTEXY_MODE__ESP32CORE_BLE
+#include "RemoteXY.h"
+
+namespace sim {
+
+extern uint32_t geracao;
+
+Ble ble;
+
+namespace {
+
+struct App {
+  uint16_t id;
+  esp_gatt_if_t gattsIf;
+  BLEServer* servidor; // NULL: app registrada direto com esp_ble_gatts_app_register
+};
+
+struct Atributo {
+  esp_gatt_if_t dono;
+  std::string uuid; // little-endian
+  std::string valor;
+  uint16_t servico;  // handle da declaração do serviço
+  bool publicado;    // serviço iniciado: o celular enxerga
+  BLECharacteristic* caracteristica; // API BLEServer (NULL na tabela do IDF)
+  BLEDescriptor* descritor;
+};
+
+uint32_t geracaoBle = 0;
+bool iniciado = false;
+std::vector<App> apps;
+std::vector<Atributo> atributos; // handle = índice + 1
+std::vector<BLEServer*> servidores;
+gatts_event_handler handlerCustom = NULL;
+uint16_t mtuLocal = 23;
+uint16_t proximoAppServidor = 0; // BLEDevice::createServer registra as apps 0, 1, 2...
+esp_gatt_if_t proximoGattsIf = 3;
+TaskHandle_t tarefaBtc = NULL;
+std::deque<std::function<void()> > filaBtc;
+
+// Celular
+uint16_t connId = 0;
+uint64_t ancora = 0;       // us de um evento de conexão (os outros vêm a cada intervalo)
+bool sinalPerdido = false;
+int eventoApp = -1;
+int eventoSupervisao = -1;
+std::string controlesApp;
+bool controlesEntregues = true;
+
+// RemoteXY
+struct {
+  uint8_t* variaveis = NULL;
+  size_t tamanho = 0;
+  size_t entradas = 0;
+  size_t flag = 0; // posição do connect_flag
+  BLECharacteristic* rx = NULL;
+  std::string recebido;
+  bool novo = false;
+  bool conectado = false;
+  uint64_t ultimoPacote = 0;
+} remotexy;
+
+// Novo boot (ou primeiro uso): o Bluedroid começa do zero
+void garantirBoot() {
+  if (geracaoBle == geracao) return;
+  geracaoBle = geracao;
+  iniciado = false;
+  apps.clear();
+  atributos.clear();
+  servidores.clear();
+  handlerCustom = NULL;
+  mtuLocal = 23;
+  proximoAppServidor = 0;
+  proximoGattsIf = 3;
+  tarefaBtc = NULL;
+  filaBtc.clear();
+  remotexy = {};
+  if (eventoApp >= 0) cancelar(eventoApp);
+  if (eventoSupervisao >= 0) cancelar(eventoSupervisao);
+  eventoApp = eventoSupervisao = -1;
+  sinalPerdido = false;
+  ble.conectado = false;
+  ble.mtu = 23;
+}
+
+App* acharApp(esp_gatt_if_t gattsIf) {
+  for (App& a : apps)
+    if (a.gattsIf == gattsIf) return &a;
+  return NULL;
+}
+
+Atributo* acharAtributo(uint16_t handle) {
+  return handle >= 1 && handle <= atributos.size() ? &atributos[handle - 1] : NULL;
+}
+
+std::string uuid16(uint16_t u) { return std::string(1, (char)(u & 0xFF)) + (char)(u >> 8); }
+
+uint64_t intervaloUs() { return (uint64_t)ble.intervaloAtualMs * 1000; }
+
+// Quem marca os eventos de conexão é o relógio do celular, não o do ESP32
+double periodoUs() { return ble.intervaloAtualMs * 1000.0 * (1 + ble.desvioPpm / 1e6); }
+uint64_t eventoConexao(uint64_t k) { return ancora + llround(k * periodoUs()); }
+
+// Primeiro evento de conexão a partir de agora
+uint64_t proximoEventoConexao() {
+  uint64_t t = agora();
+  if (t <= ancora) return ancora;
+  uint64_t k = (uint64_t)ceil((t - ancora) / periodoUs());
+  while (eventoConexao(k) < t) k++;
+  return eventoConexao(k);
+}
+
+void tarefaBluetooth(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (!filaBtc.empty()) {
+      std::function<void()> fn = std::move(filaBtc.front());
+      filaBtc.pop_front();
+      gastar(ble.custoEventoUs);
+      fn();
+    }
+  }
+}
+
+void postar(std::function<void()> fn) {
+  filaBtc.push_back(std::move(fn));
+  if (tarefaBtc) xTaskNotifyGive(tarefaBtc);
+}
+
+// Evento GATT para uma app. dados: bytes apontados pelo evento (escrita, tabela de handles)
+void entregar(esp_gatts_cb_event_t evento, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t param,
+              std::shared_ptr<std::string> dados = nullptr, std::shared_ptr<std::vector<uint16_t> > handles = nullptr) {
+  uint32_t g = geracao;
+  postar([=]() mutable {
+    if (g != geracao) return;
+    if (evento == ESP_GATTS_WRITE_EVT) param.write.value = (uint8_t*)&(*dados)[0];
+    if (evento == ESP_GATTS_CREAT_ATTR_TAB_EVT) param.add_attr_tab.handles = handles->data();
+    BLEServer* s = servidores.empty() ? NULL : servidores.back(); // m_pServer
+    if (s && s->gattsIf == gattsIf) s->tratarEvento(evento, gattsIf, &param);
+    if (handlerCustom) handlerCustom(evento, gattsIf, &param);
+  });
+}
+
+// CONNECT, MTU e DISCONNECT vão para todas as apps registradas
+void entregarATodas(esp_gatts_cb_event_t evento, const esp_ble_gatts_cb_param_t& param) {
+  for (const App& a : apps) entregar(evento, a.gattsIf, param);
+}
+
+esp_gatt_if_t registrarApp(uint16_t id, BLEServer* servidor) {
+  esp_ble_gatts_cb_param_t p = {};
+  p.reg.app_id = id;
+  for (const App& a : apps)
+    if (a.id == id) {
+      p.reg.status = ESP_GATT_ERROR; // app_id repetido
+      entregar(ESP_GATTS_REG_EVT, ESP_GATT_IF_NONE, p);
+      return ESP_GATT_IF_NONE;
+    }
+  esp_gatt_if_t gattsIf = proximoGattsIf++;
+  apps.push_back({ id, gattsIf, servidor });
+  p.reg.status = ESP_GATT_OK;
+  entregar(ESP_GATTS_REG_EVT, gattsIf, p);
+  return gattsIf;
+}
+
+uint16_t novoAtributo(esp_gatt_if_t dono, const std::string& uuid, const std::string& valor, uint16_t servico) {
+  atributos.push_back({ dono, uuid, valor, servico, false, NULL, NULL });
+  return atributos.size();
+}
+
+void publicar(uint16_t servico) {
+  for (Atributo& a : atributos)
+    if (a.servico == servico) a.publicado = true;
+}
+
+// Escrita do celular em um atributo (com resposta automática: a pilha guarda o valor)
+void escreverDoCelular(uint16_t handle, const std::string& bytes) {
+  Atributo* a = acharAtributo(handle);
+  if (!a || !ble.conectado || sinalPerdido) return;
+  a->valor = bytes;
+  esp_ble_gatts_cb_param_t p = {};
+  p.write.conn_id = connId;
+  p.write.handle = handle;
+  p.write.len = bytes.size();
+  entregar(ESP_GATTS_WRITE_EVT, a->dono, p, std::make_shared<std::string>(bytes));
+}
+
+void fimDaConexao(int motivo) {
+  if (!ble.conectado) return;
+  if (eventoApp >= 0) cancelar(eventoApp);
+  if (eventoSupervisao >= 0) cancelar(eventoSupervisao);
+  eventoApp = eventoSupervisao = -1;
+  ble.conectado = false;
+  sinalPerdido = false;
+  ble.mtu = 23;
+  esp_ble_gatts_cb_param_t p = {};
+  p.disconnect.conn_id = connId;
+  p.disconnect.reason = motivo;
+  entregarATodas(ESP_GATTS_DISCONNECT_EVT, p);
+}
+
+// O app do RemoteXY manda o estado atual dos controles no próximo evento de conexão
+void enviarApp() {
+  if (!ble.conectado || sinalPerdido || !remotexy.rx) return;
+  std::string estado = controlesApp;
+  uint16_t handle = remotexy.rx->handle;
+  em(proximoEventoConexao(), [estado, handle]() {
+    if (!ble.conectado || sinalPerdido) return;
+    escreverDoCelular(handle, estado);
+    ble.pacotesApp++;
+    if (!controlesEntregues && estado == controlesApp) {
+      controlesEntregues = true;
+      ble.chegadaControlesUs = agora();
+    }
+  });
+}
+
+} // namespace
+
+void Ble::conectar() {
+  garantirBoot();
+  if (!iniciado || conectado) return;
+  // O primeiro evento cai em uma fase qualquer do tick do ESP32 (outra a cada conexão)
+  uint64_t fase = (uint64_t)(conexoes + 1) * 12347 % (intervaloMs * 1000);
+  em(agora() + (uint64_t)intervaloMs * 1000 + fase, []() {
+    if (!iniciado || ble.conectado) return;
+    ble.conectado = true;
+    ble.conexoes++;
+    ble.intervaloAtualMs = ble.intervaloMs;
+    ble.supervisaoAtualMs = ble.supervisaoMs;
+    ble.mtu = 23;
+    ancora = agora();
+    connId++;
+    esp_ble_gatts_cb_param_t p = {};
+    p.connect.conn_id = connId;
+    p.connect.conn_params.interval = ble.intervaloMs * 4 / 5;
+    p.connect.conn_params.timeout = ble.supervisaoMs / 10;
+    entregarATodas(ESP_GATTS_CONNECT_EVT, p);
+
+    // Troca de MTU dois eventos depois; o app começa a mandar no seguinte
+    uint16_t id = connId;
+    em(eventoConexao(2), [id]() {
+      if (!ble.conectado || sinalPerdido || connId != id) return;
+      ble.mtu = std::max<uint16_t>(23, std::min(ble.mtuCelular, mtuLocal));
+      esp_ble_gatts_cb_param_t p = {};
+      p.mtu.conn_id = id;
+      p.mtu.mtu = ble.mtu;
+      entregarATodas(ESP_GATTS_MTU_EVT, p);
+    });
+    em(eventoConexao(3), [id]() {
+      if (!ble.conectado || connId != id) return;
+      enviarApp();
+      eventoApp = aCada((uint64_t)ble.periodoAppMs * 1000, []() { enviarApp(); });
+    });
+  });
+}
+
+void Ble::desconectar() {
+  if (!conectado || sinalPerdido) return;
+  em(proximoEventoConexao(), []() { fimDaConexao(0x13); });
+}
+
+void Ble::perderSinal() {
+  if (!conectado || sinalPerdido) return;
+  sinalPerdido = true;
+  quedas++;
+  if (eventoApp >= 0) cancelar(eventoApp);
+  eventoApp = -1;
+  // O ESP32 continua achando que está conectado até a supervisão estourar
+  eventoSupervisao = em(agora() + (uint64_t)supervisaoAtualMs * 1000, []() {
+    eventoSupervisao = -1;
+    fimDaConexao(0x08);
+  });
+}
+
+void Ble::controles(const std::string& entradas) {
+  controlesApp = entradas;
+  controlesEntregues = false;
+  chegadaControlesUs = 0;
+  enviarApp(); // o app manda na hora em que o controle muda
+}
+
+bool Ble::assinar(const char* uuidCaracteristica, bool ligar) {
+  std::string uuid = BLEUUID(uuidCaracteristica).bytes;
+  for (size_t i = 0; i < atributos.size(); i++) {
+    if (!atributos[i].publicado || atributos[i].uuid != uuid) continue;
+    for (size_t j = i + 1; j < atributos.size() && atributos[j].servico == atributos[i].servico; j++) {
+      if (atributos[j].uuid == uuid16(ESP_GATT_UUID_CHAR_DECLARE)) break;
+      if (atributos[j].uuid != uuid16(ESP_GATT_UUID_CHAR_CLIENT_CONFIG)) continue;
+      uint16_t handle = j + 1;
+      std::string valor = uuid16(ligar ? 1 : 0);
+      em(proximoEventoConexao(), [handle, valor]() { escreverDoCelular(handle, valor); });
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace sim
+
+using namespace sim;
+
+// --- BLUEDROID (API do IDF) ---
+
+esp_err_t esp_ble_gatts_app_register(uint16_t appId) {
+  garantirBoot();
+  if (!iniciado) return ESP_ERR_INVALID_STATE; // sem BLEDevice::init o Bluedroid não está ligado
+  registrarApp(appId, NULL);
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_create_attr_tab(const esp_gatts_attr_db_t* tabela, esp_gatt_if_t gattsIf, uint16_t quantos,
+                                        uint8_t instancia) {
+  garantirBoot();
+  if (!iniciado) return ESP_ERR_INVALID_STATE;
+  if (!tabela || quantos == 0) return ESP_ERR_INVALID_ARG;
+  esp_ble_gatts_cb_param_t p = {};
+  p.add_attr_tab.svc_inst_id = instancia;
+  std::shared_ptr<std::vector<uint16_t> > handles(new std::vector<uint16_t>());
+  const esp_attr_desc_t& primeiro = tabela[0].att_desc;
+  bool servico = primeiro.uuid_length == ESP_UUID_LEN_16 && primeiro.uuid_p &&
+                 std::string((char*)primeiro.uuid_p, 2) == uuid16(ESP_GATT_UUID_PRI_SERVICE);
+  if (!acharApp(gattsIf) || !servico) {
+    p.add_attr_tab.status = ESP_GATT_ERROR;
+  } else {
+    uint16_t inicio = atributos.size() + 1;
+    for (uint16_t i = 0; i < quantos; i++) {
+      const esp_attr_desc_t& d = tabela[i].att_desc;
+      std::string valor = d.value ? std::string((char*)d.value, d.length) : std::string(d.length, '\0');
+      handles->push_back(novoAtributo(gattsIf, std::string((char*)d.uuid_p, d.uuid_length), valor, inicio));
+    }
+    p.add_attr_tab.status = ESP_GATT_OK;
+    p.add_attr_tab.num_handle = quantos;
+    p.add_attr_tab.svc_uuid.len = primeiro.length;
+    memcpy(p.add_attr_tab.svc_uuid.uuid.uuid128, primeiro.value, std::min<size_t>(primeiro.length, 16));
+  }
+  entregar(ESP_GATTS_CREAT_ATTR_TAB_EVT, gattsIf, p, nullptr, handles);
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gatts_start_service(uint16_t handle) {
+  garantirBoot();
+  if (!iniciado) return ESP_ERR_INVALID_STATE;
+  Atributo* a = acharAtributo(handle);
+  esp_ble_gatts_cb_param_t p = {};
+  p.start.service_handle = handle;
+  p.start.status = a && a->servico == handle ? ESP_GATT_OK : ESP_GATT_ERROR;
+  if (p.start.status == ESP_GATT_OK) publicar(handle);
+  entregar(ESP_GATTS_START_EVT, a ? a->dono : ESP_GATT_IF_NONE, p);
+  return ESP_OK;
+}
+
+// Notify (ou indicate): sai no próximo evento de conexão; o ESP_GATTS_CONF_EVT volta ao dono
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gattsIf, uint16_t conn, uint16_t handle, uint16_t tamanho, uint8_t* valor,
+                                      bool confirmar) {
+  garantirBoot();
+  if (!iniciado) return ESP_ERR_INVALID_STATE;
+  if (ble.filaCheia) return ESP_ERR_NO_MEM;
+  Atributo* a = acharAtributo(handle);
+  esp_ble_gatts_cb_param_t p = {};
+  p.conf.conn_id = conn;
+  p.conf.handle = handle;
+  p.conf.len = tamanho;
+  if (!ble.conectado || conn != connId || !a || a->dono != gattsIf || tamanho > ble.mtu - 3) {
+    ble.notificacoesRecusadas++;
+    p.conf.status = ESP_GATT_ERROR;
+    entregar(ESP_GATTS_CONF_EVT, gattsIf, p);
+    return ESP_OK; // como no IDF: o erro chega no evento
+  }
+  std::string dados((char*)valor, tamanho);
+  uint16_t id = connId;
+  em(proximoEventoConexao(), [gattsIf, handle, dados, id, p]() mutable {
+    if (!ble.conectado || sinalPerdido || connId != id) return; // perdido no ar
+    Notificacao n = { agora(), handle, dados };
+    ble.notificacoes.push_back(n);
+    if (ble.aoNotificar) ble.aoNotificar(n);
+    p.conf.status = ESP_GATT_OK;
+    entregar(ESP_GATTS_CONF_EVT, gattsIf, p);
+  });
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu) {
+  if (mtu < 23 || mtu > 517) return ESP_ERR_INVALID_ARG;
+  garantirBoot();
+  mtuLocal = mtu;
+  return ESP_OK;
+}
+
+// O celular aceita (e passa a usar dali a dois eventos) ou recusa
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t* params) {
+  garantirBoot();
+  if (!iniciado) return ESP_ERR_INVALID_STATE;
+  ble.pedidosParametros++;
+  if (!ble.conectado || params->timeout * 10 < ble.supervisaoMinimaMs || params->min_int > params->max_int) {
+    ble.parametrosRecusados++;
+    return ESP_OK;
+  }
+  uint32_t intervalo = std::max<uint32_t>(params->max_int * 5 / 4, 8);
+  uint32_t supervisao = params->timeout * 10;
+  uint16_t id = connId;
+  em(proximoEventoConexao() + 2 * intervaloUs(), [intervalo, supervisao, id]() {
+    if (!ble.conectado || connId != id) return;
+    ancora = agora();
+    ble.intervaloAtualMs = intervalo;
+    ble.supervisaoAtualMs = supervisao;
+  });
+  return ESP_OK;
+}
+
+// --- BIBLIOTECA BLE DO ARDUINO ---
+
+BLEUUID::BLEUUID(uint16_t u) : bytes(uuid16(u)) {}
+
+BLEUUID::BLEUUID(const char* texto) {
+  std::string hex;
+  for (const char* c = texto; *c; c++)
+    if (isxdigit((unsigned char)*c)) hex += *c;
+  if (hex.size() != 4 && hex.size() != 32) falhar("UUID inválido: %s", texto);
+  for (size_t i = hex.size(); i >= 2; i -= 2) bytes += (char)strtoul(hex.substr(i - 2, 2).c_str(), NULL, 16);
+}
+
+BLEDescriptor* BLECharacteristic::getDescriptorByUUID(const char* texto) {
+  BLEUUID u(texto);
+  for (BLEDescriptor* d : descritores)
+    if (d->uuid == u) return d;
+  return NULL;
+}
+
+void BLECharacteristic::notify(bool notificacao) {
+  for (BLEDescriptor* d : descritores)
+    if (d->uuid == BLEUUID((uint16_t)ESP_GATT_UUID_CHAR_CLIENT_CONFIG) && !((BLE2902*)d)->getNotifications()) return;
+  if (!servidor || !ble.conectado || !handle) return;
+  esp_ble_gatts_send_indicate(servidor->gattsIf, connId, handle, std::min<size_t>(valor.size(), ble.mtu - 3),
+                              (uint8_t*)&valor[0], !notificacao);
+}
+
+BLECharacteristic* BLEService::createCharacteristic(BLEUUID u, uint32_t propriedades) {
+  BLECharacteristic* c = new BLECharacteristic(u, propriedades);
+  c->servidor = servidor;
+  caracteristicas.push_back(c);
+  return c;
+}
+
+void BLEService::start() {
+  esp_gatt_if_t dono = servidor->gattsIf;
+  handle = novoAtributo(dono, uuid16(ESP_GATT_UUID_PRI_SERVICE), uuid.bytes, 0);
+  atributos[handle - 1].servico = handle;
+  for (BLECharacteristic* c : caracteristicas) {
+    novoAtributo(dono, uuid16(ESP_GATT_UUID_CHAR_DECLARE), "", handle);
+    c->handle = novoAtributo(dono, c->uuid.bytes, c->valor, handle);
+    atributos[c->handle - 1].caracteristica = c;
+    for (BLEDescriptor* d : c->descritores) {
+      d->handle = novoAtributo(dono, d->uuid.bytes, d->valor, handle);
+      atributos[d->handle - 1].descritor = d;
+    }
+  }
+  esp_ble_gatts_start_service(handle);
+}
+
+BLEService* BLEServer::createService(BLEUUID u) {
+  BLEService* s = new BLEService();
+  s->uuid = u;
+  s->servidor = this;
+  servicos.push_back(s);
+  return s;
+}
+
+void BLEServer::tratarEvento(esp_gatts_cb_event_t evento, esp_gatt_if_t, esp_ble_gatts_cb_param_t* param) {
+  switch (evento) {
+    case ESP_GATTS_CONNECT_EVT:
+      connId = param->connect.conn_id;
+      conectados++;
+      if (callbacks) {
+        callbacks->onConnect(this);
+        callbacks->onConnect(this, param);
+      }
+      break;
+    case ESP_GATTS_DISCONNECT_EVT:
+      if (conectados) conectados--;
+      if (callbacks) {
+        callbacks->onDisconnect(this);
+        callbacks->onDisconnect(this, param);
+      }
+      break;
+    case ESP_GATTS_MTU_EVT:
+      if (callbacks) callbacks->onMtuChanged(this, param);
+      break;
+    case ESP_GATTS_WRITE_EVT: {
+      Atributo* a = acharAtributo(param->write.handle);
+      if (!a) break;
+      std::string bytes((char*)param->write.value, param->write.len);
+      if (a->descritor) a->descritor->valor = bytes;
+      if (a->caracteristica) {
+        a->caracteristica->valor = bytes;
+        if (a->caracteristica->callbacks) a->caracteristica->callbacks->onWrite(a->caracteristica, param);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void BLEDevice::init(const std::string& nome) {
+  garantirBoot();
+  if (iniciado) return;
+  iniciado = true;
+  xTaskCreatePinnedToCore(tarefaBluetooth, "btc", 4096, NULL, 19, &tarefaBtc, 0);
+  if (!filaBtc.empty()) xTaskNotifyGive(tarefaBtc);
+}
+
+bool BLEDevice::getInitialized() {
+  garantirBoot();
+  return iniciado;
+}
+
+BLEServer* BLEDevice::createServer() {
+  garantirBoot();
+  if (!iniciado) falhar("BLEDevice::createServer antes do BLEDevice::init");
+  ble.servidores++;
+  BLEServer* s = new BLEServer();
+  s->appId = proximoAppServidor++;
+  s->gattsIf = registrarApp(s->appId, s);
+  servidores.push_back(s);
+  return s;
+}
+
+esp_err_t BLEDevice::setMTU(uint16_t mtu) { return esp_ble_gatt_set_local_mtu(mtu); }
+
+uint16_t BLEDevice::getMTU() {
+  garantirBoot();
+  return mtuLocal;
+}
+
+void BLEDevice::setCustomGattsHandler(gatts_event_handler handler) {
+  garantirBoot();
+  handlerCustom = handler;
+}
+
+// --- REMOTEXY ---
+
+namespace {
+
+class RemoteXYServidor : public BLEServerCallbacks {
+  void onConnect(BLEServer*) override { remotexy.conectado = true; }
+  void onDisconnect(BLEServer*) override { remotexy.conectado = false; }
+};
+
+class RemoteXYRx : public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic* c) override {
+    remotexy.recebido = c->valor;
+    remotexy.novo = true;
+    remotexy.ultimoPacote = agora();
+  }
+};
+
+} // namespace
+
+void remotexyIniciar(const uint8_t* conf, void* variaveis, size_t tamanho, const char* nome) {
+  BLEDevice::init(nome);
+  remotexy.variaveis = (uint8_t*)variaveis;
+  remotexy.tamanho = tamanho;
+  // Configuração nova (começa com 255): tamanho das entradas e das saídas em 16 bits
+  if (conf[0] != 255) falhar("RemoteXY_CONF em formato antigo: gere de novo no site do RemoteXY");
+  remotexy.entradas = conf[1] | (conf[2] << 8);
+  remotexy.flag = remotexy.entradas + (conf[3] | (conf[4] << 8));
+  if (remotexy.flag >= tamanho) falhar("struct RemoteXY menor que o RemoteXY_CONF (%zu bytes)", tamanho);
+  memset(variaveis, 0, tamanho);
+
+  BLEServer* s = BLEDevice::createServer();
+  s->setCallbacks(new RemoteXYServidor());
+  BLEService* servico = s->createService("0000FFE0-0000-1000-8000-00805F9B34FB");
+  remotexy.rx = servico->createCharacteristic("0000FFE1-0000-1000-8000-00805F9B34FB",
+                                             BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE |
+                                               BLECharacteristic::PROPERTY_WRITE_NR | BLECharacteristic::PROPERTY_NOTIFY);
+  remotexy.rx->addDescriptor(new BLE2902());
+  remotexy.rx->setCallbacks(new RemoteXYRx());
+  servico->start();
+}
+
+void remotexyHandler() {
+  if (!remotexy.variaveis) return;
+  gastar(20); // conferir o buffer e o protocolo
+  if (remotexy.novo) {
+    memcpy(remotexy.variaveis, remotexy.recebido.data(), std::min(remotexy.entradas, remotexy.recebido.size()));
+    remotexy.novo = false;
+  }
+  bool vivo = remotexy.conectado && remotexy.ultimoPacote && agora() - remotexy.ultimoPacote < REMOTEXY_TIMEOUT * 1000ull;
+  remotexy.variaveis[remotexy.flag] = vivo ? 1 : 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef int gpio_num_t;
+
+esp_err_t gpio_set_level(gpio_num_t pino, uint32_t nivel); // pode ser chamada de uma interrupção
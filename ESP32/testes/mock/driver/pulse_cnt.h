@@ -0,0 +1,65 @@
+// Contador de pulsos (PCNT) do IDF 5 de mentira: uma unidade conta o encoder de
+// sim::pcnt (o teste, ou o modelo do motor, anda com sim::pcnt.mover). Em
+// quadratura (dois canais, cada um com o outro como nível) a contagem tem
+// sinal; com um canal só, conta as subidas do canal A. Devolve os mesmos erros
+// do IDF para handle nulo e ordem errada (start antes de enable).
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct pcnt_unit_t* pcnt_unit_handle_t;
+typedef struct pcnt_chan_t* pcnt_channel_handle_t;
+
+typedef struct {
+  int low_limit;
+  int high_limit;
+  int intr_priority;
+  struct {
+    uint32_t accum_count : 1; // continua contando além dos limites (precisa dos watch points nos limites)
+  } flags;
+} pcnt_unit_config_t;
+
+typedef struct {
+  uint32_t max_glitch_ns;
+} pcnt_glitch_filter_config_t;
+
+typedef struct {
+  int edge_gpio_num;
+  int level_gpio_num; // -1: sem canal de nível
+  struct {
+    uint32_t invert_edge_input : 1;
+    uint32_t invert_level_input : 1;
+    uint32_t virt_edge_io_level : 1;
+    uint32_t virt_level_io_level : 1;
+    uint32_t io_loop_back : 1;
+  } flags;
+} pcnt_chan_config_t;
+
+typedef enum {
+  PCNT_CHANNEL_EDGE_ACTION_HOLD,
+  PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+  PCNT_CHANNEL_EDGE_ACTION_DECREASE,
+} pcnt_channel_edge_action_t;
+
+typedef enum {
+  PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+  PCNT_CHANNEL_LEVEL_ACTION_INVERSE,
+  PCNT_CHANNEL_LEVEL_ACTION_HOLD,
+} pcnt_channel_level_action_t;
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t* config, pcnt_unit_handle_t* unidade);
+esp_err_t pcnt_del_unit(pcnt_unit_handle_t unidade); // os canais têm que ser apagados antes
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t unidade, const pcnt_glitch_filter_config_t* config);
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unidade, const pcnt_chan_config_t* config, pcnt_channel_handle_t* canal);
+esp_err_t pcnt_del_channel(pcnt_channel_handle_t canal);
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t canal, pcnt_channel_edge_action_t subida,
+                                       pcnt_channel_edge_action_t descida);
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t canal, pcnt_channel_level_action_t alto,
+                                        pcnt_channel_level_action_t baixo);
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unidade, int valor);
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unidade);
+esp_err_t pcnt_unit_disable(pcnt_unit_handle_t unidade);
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unidade);
+esp_err_t pcnt_unit_stop(pcnt_unit_handle_t unidade);
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unidade);
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unidade, int* valor);
@@ -0,0 +1,20 @@
+// Tipos comuns do Bluetooth no IDF (só o que os mocks do BLE usam).
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+#define ESP_BD_ADDR_LEN 6
+typedef uint8_t esp_bd_addr_t[ESP_BD_ADDR_LEN];
+
+#define ESP_UUID_LEN_16 2
+#define ESP_UUID_LEN_32 4
+#define ESP_UUID_LEN_128 16
+
+typedef struct {
+  uint16_t len;
+  union {
+    uint16_t uuid16;
+    uint32_t uuid32;
+    uint8_t uuid128[ESP_UUID_LEN_128]; // little-endian, como no IDF
+  } uuid;
+} esp_bt_uuid_t;
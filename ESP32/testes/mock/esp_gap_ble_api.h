@@ -0,0 +1,15 @@
+// GAP do BLE no IDF: só o pedido de novos parâmetros de conexão, respondido
+// pelo celular de mentira (sim::ble), que pode recusar (o iOS recusa
+// supervisão abaixo de 2 s).
+#pragma once
+#include "esp_bt_defs.h"
+
+typedef struct {
+  esp_bd_addr_t bda;
+  uint16_t min_int; // x 1,25 ms
+  uint16_t max_int; // x 1,25 ms
+  uint16_t latency; // eventos que o periférico pode pular
+  uint16_t timeout; // supervisão, x 10 ms
+} esp_ble_conn_update_params_t;
+
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t* params);
@@ -0,0 +1,4 @@
+#pragma once
+#include "esp_gatt_defs.h"
+
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu); // o MTU final é negociado com o celular (ESP_GATTS_MTU_EVT)
@@ -0,0 +1,45 @@
+// Definições do GATT no IDF: UUIDs padrão, permissões, propriedades e a
+// tabela de atributos de esp_ble_gatts_create_attr_tab.
+#pragma once
+#include <stdint.h>
+#include "esp_bt_defs.h"
+
+typedef uint8_t esp_gatt_if_t;
+#define ESP_GATT_IF_NONE 0xff
+
+typedef enum { ESP_GATT_OK = 0x0, ESP_GATT_ERROR = 0x85 } esp_gatt_status_t;
+
+#define ESP_GATT_UUID_PRI_SERVICE 0x2800
+#define ESP_GATT_UUID_CHAR_DECLARE 0x2803
+#define ESP_GATT_UUID_CHAR_CLIENT_CONFIG 0x2902
+
+#define ESP_GATT_PERM_READ (1 << 0)
+#define ESP_GATT_PERM_WRITE (1 << 4)
+
+#define ESP_GATT_CHAR_PROP_BIT_BROADCAST (1 << 0)
+#define ESP_GATT_CHAR_PROP_BIT_READ (1 << 1)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE_NR (1 << 2)
+#define ESP_GATT_CHAR_PROP_BIT_WRITE (1 << 3)
+#define ESP_GATT_CHAR_PROP_BIT_NOTIFY (1 << 4)
+#define ESP_GATT_CHAR_PROP_BIT_INDICATE (1 << 5)
+
+#define ESP_GATT_RSP_BY_APP 0
+#define ESP_GATT_AUTO_RSP 1
+
+typedef struct {
+  uint8_t auto_rsp; // ESP_GATT_AUTO_RSP: a pilha guarda o valor escrito e responde sozinha
+} esp_attr_control_t;
+
+typedef struct {
+  uint16_t uuid_length; // ESP_UUID_LEN_16 ou ESP_UUID_LEN_128
+  uint8_t* uuid_p;      // little-endian
+  uint16_t perm;
+  uint16_t max_length;
+  uint16_t length;
+  uint8_t* value;
+} esp_attr_desc_t;
+
+typedef struct {
+  esp_attr_control_t attr_control;
+  esp_attr_desc_t att_desc;
+} esp_gatts_attr_db_t;
@@ -0,0 +1,7 @@
+// Deep sleep de mentira: esp_deep_sleep_start() "reinicia" o ESP32 no simulador
+// (tarefas e timers somem, o tempo pula até o despertar e o boot roda de novo).
+#pragma once
+#include <stdint.h>
+
+void esp_sleep_enable_timer_wakeup(uint64_t us);
+[[noreturn]] void esp_deep_sleep_start();
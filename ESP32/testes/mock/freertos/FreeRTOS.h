@@ -0,0 +1,60 @@
+// FreeRTOS de mentira: tarefas cooperativas com tempo virtual (ver sim.cpp).
+// Só a parte da API usada pelos sketches. Um tick = 1 ms, como no ESP32.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef struct TarefaSim* TaskHandle_t;
+typedef struct FilaSim* QueueHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(...) sim_cederDaInterrupcao()
+
+enum eNotifyAction { eNoAction, eSetBits, eIncrement, eSetValueWithOverwrite, eSetValueWithoutOverwrite };
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* nome, uint32_t pilha, void* parametro,
+                                   UBaseType_t prioridade, TaskHandle_t* handle, BaseType_t nucleo);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* nome, uint32_t pilha, void* parametro,
+                       UBaseType_t prioridade, TaskHandle_t* handle);
+void vTaskDelete(TaskHandle_t tarefa);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* anterior, TickType_t periodo);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void taskYIELD();
+
+BaseType_t xTaskNotify(TaskHandle_t tarefa, uint32_t valor, eNotifyAction acao);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t tarefa, uint32_t valor, eNotifyAction acao, BaseType_t* acordou);
+BaseType_t xTaskNotifyWait(uint32_t limparNaEntrada, uint32_t limparNaSaida, uint32_t* valor, TickType_t espera);
+void xTaskNotifyGive(TaskHandle_t tarefa);
+void vTaskNotifyGiveFromISR(TaskHandle_t tarefa, BaseType_t* acordou);
+uint32_t ulTaskNotifyTake(BaseType_t limparNaSaida, TickType_t espera);
+
+QueueHandle_t xQueueCreate(UBaseType_t tamanho, UBaseType_t tamanhoItem);
+BaseType_t xQueueSend(QueueHandle_t fila, const void* item, TickType_t espera);
+BaseType_t xQueueSendFromISR(QueueHandle_t fila, const void* item, BaseType_t* acordou);
+BaseType_t xQueueReceive(QueueHandle_t fila, void* item, TickType_t espera);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t fila);
+
+// Seções críticas: com tarefas cooperativas não há o que travar
+typedef struct {
+  int dummy;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+
+void sim_cederDaInterrupcao();
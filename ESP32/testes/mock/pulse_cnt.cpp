@@ -0,0 +1,152 @@
+// PCNT do simulador: as unidades leem o encoder de sim::pcnt. A contagem é a
+// posição do encoder desde o último clear (ou desde o start), com o sinal e a
+// escala que a configuração dos canais daria no hardware.
+#include <memory>
+#include "Arduino.h"
+#include "driver/pulse_cnt.h"
+
+namespace sim {
+extern uint32_t geracao;
+Pcnt pcnt;
+} // namespace sim
+
+using namespace sim;
+
+struct pcnt_chan_t {
+  int bordaGpio, nivelGpio;
+  pcnt_unit_t* unidade;
+};
+
+struct pcnt_unit_t {
+  uint32_t geracao;
+  bool habilitada = false, contando = false;
+  std::vector<std::unique_ptr<pcnt_chan_t> > canais;
+  int64_t zeroPosicao = 0;
+  uint64_t zeroPercorrido = 0;
+  int64_t parado = 0; // contagem congelada por pcnt_unit_stop
+
+  // Dois canais com nível: quadratura (4 bordas por pulso, com sinal). Senão, subidas do A.
+  int64_t contagem() const {
+    if (!contando) return parado;
+    bool quadratura = canais.size() >= 2 && canais[0]->nivelGpio >= 0 && canais[1]->nivelGpio >= 0;
+    if (quadratura) return pcnt.posicao - zeroPosicao;
+    return (int64_t)(pcnt.percorrido - zeroPercorrido) / 4;
+  }
+  void zerar() {
+    zeroPosicao = pcnt.posicao;
+    zeroPercorrido = pcnt.percorrido;
+    parado = 0;
+  }
+};
+
+// Handle de um boot anterior: o hardware já foi reiniciado
+static bool valida(pcnt_unit_t* u) { return u && u->geracao == geracao; }
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t* config, pcnt_unit_handle_t* unidade) {
+  if (!config || !unidade || config->low_limit >= 0 || config->high_limit <= 0) return ESP_ERR_INVALID_ARG;
+  if (pcnt.semUnidade) return ESP_ERR_NOT_FOUND;
+  *unidade = new pcnt_unit_t();
+  (*unidade)->geracao = geracao;
+  pcnt.unidades++;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_del_unit(pcnt_unit_handle_t unidade) {
+  if (!valida(unidade)) return ESP_ERR_INVALID_ARG;
+  if (unidade->habilitada || !unidade->canais.empty()) return ESP_ERR_INVALID_STATE;
+  delete unidade;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t unidade, const pcnt_glitch_filter_config_t* config) {
+  if (!valida(unidade)) return ESP_ERR_INVALID_ARG;
+  if (unidade->habilitada) return ESP_ERR_INVALID_STATE;
+  if (config && config->max_glitch_ns > 1000) return ESP_ERR_INVALID_ARG; // 1023 ciclos de APB no máximo
+  return ESP_OK;
+}
+
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unidade, const pcnt_chan_config_t* config, pcnt_channel_handle_t* canal) {
+  if (!valida(unidade) || !config || !canal) return ESP_ERR_INVALID_ARG;
+  if (unidade->habilitada) return ESP_ERR_INVALID_STATE;
+  if (unidade->canais.size() >= 2) return ESP_ERR_NOT_FOUND;
+  unidade->canais.emplace_back(new pcnt_chan_t{ config->edge_gpio_num, config->level_gpio_num, unidade });
+  *canal = unidade->canais.back().get();
+  return ESP_OK;
+}
+
+esp_err_t pcnt_del_channel(pcnt_channel_handle_t canal) {
+  if (!canal || !valida(canal->unidade)) return ESP_ERR_INVALID_ARG;
+  if (canal->unidade->habilitada) return ESP_ERR_INVALID_STATE;
+  std::vector<std::unique_ptr<pcnt_chan_t> >& canais = canal->unidade->canais;
+  for (size_t i = 0; i < canais.size(); i++)
+    if (canais[i].get() == canal) {
+      canais.erase(canais.begin() + i);
+      return ESP_OK;
+    }
+  return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t canal, pcnt_channel_edge_action_t,
+                                       pcnt_channel_edge_action_t) {
+  return canal && valida(canal->unidade) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t canal, pcnt_channel_level_action_t,
+                                        pcnt_channel_level_action_t) {
+  return canal && valida(canal->unidade) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unidade, int) {
+  if (!valida(unidade)) return ESP_ERR_INVALID_ARG;
+  return unidade->habilitada ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unidade) {
+  if (!valida(unidade)) return ESP_ERR_INVALID_ARG;
+  if (unidade->habilitada) return ESP_ERR_INVALID_STATE;
+  unidade->habilitada = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_disable(pcnt_unit_handle_t unidade) {
+  if (!valida(unidade)) return ESP_ERR_INVALID_ARG;
+  if (!unidade->habilitada) return ESP_ERR_INVALID_STATE;
+  unidade->habilitada = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unidade) {
+  if (!valida(unidade)) return ESP_ERR_INVALID_ARG;
+  if (!unidade->habilitada) return ESP_ERR_INVALID_STATE;
+  if (!unidade->contando) {
+    // Continua de onde parou
+    unidade->contando = true;
+    int64_t antes = unidade->parado;
+    unidade->zerar();
+    unidade->zeroPosicao -= antes;
+    unidade->zeroPercorrido -= antes * 4;
+  }
+  pcnt.contando = true;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_stop(pcnt_unit_handle_t unidade) {
+  if (!valida(unidade)) return ESP_ERR_INVALID_ARG;
+  if (!unidade->habilitada) return ESP_ERR_INVALID_STATE;
+  unidade->parado = unidade->contagem();
+  unidade->contando = false;
+  pcnt.contando = false;
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unidade) {
+  if (!valida(unidade)) return ESP_ERR_INVALID_ARG;
+  unidade->zerar();
+  return ESP_OK;
+}
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unidade, int* valor) {
+  if (!valida(unidade) || !valor) return ESP_ERR_INVALID_ARG;
+  *valor = (int)unidade->contagem();
+  return ESP_OK;
+}
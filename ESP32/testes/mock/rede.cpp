@@ -0,0 +1,459 @@
+// Wi-Fi, PubSubClient e o broker MQTT do simulador.
+//
+// Broker em memória (padrão): o PubSubClient entrega cada publish em
+// sim::broker.recebidas e recebe, no client.loop(), o que o teste publicar nos
+// tópicos assinados. Cada operação gasta um tempo virtual parecido com o de um
+// ESP32 real, para os tempos medidos pelo sketch fazerem sentido.
+//
+// Broker real (SIM_BROKER=host:porta): o mesmo PubSubClient abre um socket e fala
+// MQTT 3.1.1 (CONNECT, PUBLISH QoS 0, SUBSCRIBE, PINGREQ). O que o sketch
+// publica continua sendo registrado em sim::broker.recebidas.
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <chrono>
+#include "PubSubClient.h"
+
+namespace sim {
+
+extern uint32_t geracao;
+
+Broker broker;
+
+namespace {
+
+std::vector<PubSubClient*> clientes; // conectados ao broker em memória
+std::string hostReal;
+int portaReal = 0;
+
+} // namespace
+
+void usarBrokerReal(const char* host, int porta) {
+  hostReal = host;
+  portaReal = porta;
+}
+
+bool brokerReal() { return portaReal != 0; }
+
+void Broker::publicar(const std::string& topico, const std::string& payload) {
+  for (PubSubClient* c : clientes)
+    if (c->assina(topico)) c->entregar(topico, payload);
+}
+
+size_t Broker::contar(const std::string& topico) const {
+  size_t n = 0;
+  for (const Mensagem& m : recebidas)
+    if (m.topico == topico) n++;
+  return n;
+}
+
+} // namespace sim
+
+using namespace sim;
+
+// --- WI-FI ---
+
+WiFiClass WiFi;
+
+void WiFiClass::reiniciarSeNovoBoot() {
+  if (geracao == sim::geracao) return;
+  geracao = sim::geracao;
+  iniciado = conectou = ipEstatico = false;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* senha, int32_t canal, const uint8_t* bssid, bool conectar) {
+  reiniciarSeNovoBoot();
+  wifi.inicios++;
+  bool rapido = canal > 0 && bssid;
+  if (rapido) wifi.iniciosRapidos++;
+  if (ipEstatico) wifi.iniciosEstaticos++;
+  uint64_t ms = wifi.associacaoMs + (rapido ? 0 : wifi.varreduraMs) + (ipEstatico ? 0 : wifi.dhcpMs);
+  iniciado = true;
+  conectou = false;
+  inicioUs = agora();
+  conectaEm = rapido && canal != wifi.canal ? UINT64_MAX : inicioUs + ms * 1000; // AP mudou de canal
+  if (!ipEstatico) ip = IPAddress(192, 168, 0, 50);
+  return WL_DISCONNECTED;
+}
+
+wl_status_t WiFiClass::status() {
+  reiniciarSeNovoBoot();
+  if (!iniciado) return WL_IDLE_STATUS;
+  if (!wifi.disponivel) {
+    bool estava = conectou;
+    conectou = false;
+    conectaEm = UINT64_MAX; // só volta com outro begin()
+    return estava ? WL_CONNECTION_LOST : WL_DISCONNECTED;
+  }
+  if (agora() < conectaEm) return WL_DISCONNECTED;
+  if (!conectou) {
+    conectou = true;
+    wifi.ultimaConexaoMs = (agora() - inicioUs) / 1000;
+  }
+  return WL_CONNECTED;
+}
+
+bool WiFiClass::disconnect(bool desligarRadio, bool apagarAp) {
+  reiniciarSeNovoBoot();
+  iniciado = conectou = false;
+  return true;
+}
+
+bool WiFiClass::config(IPAddress ipFixo, IPAddress gateway, IPAddress mascara, IPAddress dns1, IPAddress dns2) {
+  reiniciarSeNovoBoot();
+  ipEstatico = (uint32_t)ipFixo != 0;
+  if (ipEstatico) ip = ipFixo;
+  return true;
+}
+
+IPAddress WiFiClass::localIP() { return status() == WL_CONNECTED ? ip : IPAddress(); }
+IPAddress WiFiClass::gatewayIP() { return IPAddress(192, 168, 0, 1); }
+IPAddress WiFiClass::subnetMask() { return IPAddress(255, 255, 255, 0); }
+IPAddress WiFiClass::dnsIP(uint8_t i) { return IPAddress(192, 168, 0, 1); }
+int32_t WiFiClass::channel() { return wifi.canal; }
+
+uint8_t* WiFiClass::BSSID() {
+  static uint8_t bssid[6] = { 0x24, 0x0A, 0xC4, 0x11, 0x22, 0x33 };
+  return bssid;
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+  static const uint8_t meu[6] = { 0x30, 0xAE, 0xA4, 0x07, 0x0D, 0x64 };
+  memcpy(mac, meu, 6);
+  return mac;
+}
+
+// --- PUBSUBCLIENT ---
+
+namespace {
+
+// Tamanho restante do MQTT (1 a 4 bytes, 7 bits por byte)
+std::string codificarTamanho(size_t n) {
+  std::string s;
+  do {
+    uint8_t b = n % 128;
+    n /= 128;
+    if (n) b |= 0x80;
+    s += (char)b;
+  } while (n);
+  return s;
+}
+
+std::string textoMqtt(const std::string& s) {
+  std::string r;
+  r += (char)(s.size() >> 8);
+  r += (char)(s.size() & 0xFF);
+  return r + s;
+}
+
+uint64_t msReais() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+PubSubClient::~PubSubClient() {
+  if (soquete >= 0) close(soquete);
+  clientes.erase(std::remove(clientes.begin(), clientes.end(), this), clientes.end());
+}
+
+// Depois de um deep sleep o objeto global do sketch "nasce" de novo (sem conexão)
+void PubSubClient::reiniciarSeNovoBoot() {
+  if (geracao == sim::geracao) return;
+  geracao = sim::geracao;
+  if (soquete >= 0) close(soquete);
+  soquete = -1;
+  clientes.erase(std::remove(clientes.begin(), clientes.end(), this), clientes.end());
+  conectado = false;
+  estado = MQTT_DISCONNECTED;
+  assinaturas.clear();
+  chegando.clear();
+  recebido.clear();
+  callback = nullptr;
+}
+
+PubSubClient& PubSubClient::setServer(const char* h, uint16_t p) {
+  reiniciarSeNovoBoot();
+  host = h;
+  porta = p;
+  return *this;
+}
+
+PubSubClient& PubSubClient::setCallback(MQTT_CALLBACK_SIGNATURE) {
+  reiniciarSeNovoBoot();
+  this->callback = callback;
+  return *this;
+}
+
+PubSubClient& PubSubClient::setKeepAlive(uint16_t segundos) {
+  keepAlive = segundos;
+  return *this;
+}
+
+PubSubClient& PubSubClient::setSocketTimeout(uint16_t segundos) { return *this; }
+
+bool PubSubClient::setBufferSize(uint16_t tamanho) {
+  tamanhoBuffer = tamanho;
+  return true;
+}
+
+bool PubSubClient::connect(const char* id, const char* usuario, const char* senha) { return connect(id); }
+
+bool PubSubClient::connect(const char* id) {
+  reiniciarSeNovoBoot();
+  if (connected()) return true;
+  if (WiFi.status() != WL_CONNECTED) {
+    estado = MQTT_CONNECT_FAILED;
+    return false;
+  }
+
+  if (!brokerReal()) {
+    if (!broker.disponivel) {
+      gastar((uint64_t)broker.falhaConexaoMs * 1000);
+      estado = MQTT_CONNECTION_TIMEOUT;
+      return false;
+    }
+    gastar((uint64_t)broker.conexaoMs * 1000);
+    conectado = true;
+    estado = MQTT_CONNECTED;
+    assinaturas.clear();
+    chegando.clear();
+    clientes.push_back(this);
+    broker.conexoes++;
+    ultimoEnvioUs = agora();
+    return true;
+  }
+
+  // Broker real: TCP + CONNECT, esperando o CONNACK (no relógio de verdade)
+  uint64_t inicio = msReais();
+  addrinfo dicas = {}, *resultado = NULL;
+  dicas.ai_family = AF_UNSPEC;
+  dicas.ai_socktype = SOCK_STREAM;
+  char textoPorta[8];
+  snprintf(textoPorta, sizeof(textoPorta), "%d", portaReal);
+  if (getaddrinfo(hostReal.c_str(), textoPorta, &dicas, &resultado) != 0) falhar("broker %s não encontrado", hostReal.c_str());
+  soquete = socket(resultado->ai_family, SOCK_STREAM, 0);
+  bool ok = ::connect(soquete, resultado->ai_addr, resultado->ai_addrlen) == 0;
+  freeaddrinfo(resultado);
+  if (!ok) {
+    close(soquete);
+    soquete = -1;
+    gastar((msReais() - inicio) * 1000);
+    estado = MQTT_CONNECT_FAILED;
+    return false;
+  }
+  int um = 1;
+  setsockopt(soquete, IPPROTO_TCP, TCP_NODELAY, &um, sizeof(um));
+
+  std::string corpo = textoMqtt("MQTT");
+  corpo += (char)4;    // versão 3.1.1
+  corpo += (char)0x02; // clean session
+  corpo += (char)(keepAlive >> 8);
+  corpo += (char)(keepAlive & 0xFF);
+  corpo += textoMqtt(id);
+  uint8_t tipo;
+  std::string resposta;
+  conectado = true; // para enviarPacote
+  recebido.clear();
+  if (!enviarPacote(0x10, corpo) || !lerPacote(&tipo, &resposta, 2000) || tipo != 0x20 || resposta.size() < 2 ||
+      resposta[1] != 0) {
+    cair(MQTT_CONNECT_FAILED);
+    gastar((msReais() - inicio) * 1000);
+    return false;
+  }
+  gastar((msReais() - inicio) * 1000);
+  estado = MQTT_CONNECTED;
+  assinaturas.clear();
+  broker.conexoes++;
+  ultimoEnvioUs = agora();
+  return true;
+}
+
+void PubSubClient::cair(int motivo) {
+  if (soquete >= 0) close(soquete);
+  soquete = -1;
+  if (conectado && motivo == MQTT_CONNECTION_LOST) broker.quedas++;
+  conectado = false;
+  estado = motivo;
+  clientes.erase(std::remove(clientes.begin(), clientes.end(), this), clientes.end());
+}
+
+void PubSubClient::disconnect() {
+  reiniciarSeNovoBoot();
+  if (soquete >= 0) enviarPacote(0xE0, "");
+  cair(MQTT_DISCONNECTED);
+}
+
+bool PubSubClient::connected() {
+  reiniciarSeNovoBoot();
+  if (!conectado) return false;
+  if (WiFi.status() != WL_CONNECTED || (!brokerReal() && !broker.disponivel)) cair(MQTT_CONNECTION_LOST);
+  return conectado;
+}
+
+int PubSubClient::state() { return estado; }
+
+bool PubSubClient::enviarPacote(uint8_t tipo, const std::string& corpo) {
+  std::string pacote = (char)tipo + codificarTamanho(corpo.size()) + corpo;
+  if (soquete >= 0) {
+    if (send(soquete, pacote.data(), pacote.size(), MSG_NOSIGNAL) != (ssize_t)pacote.size()) {
+      cair(MQTT_CONNECTION_LOST);
+      return false;
+    }
+  }
+  ultimoEnvioUs = agora();
+  return true;
+}
+
+// Lê um pacote inteiro do socket. esperaMs = 0: só se já estiver todo no buffer.
+bool PubSubClient::lerPacote(uint8_t* tipo, std::string* corpo, uint32_t esperaMs) {
+  uint64_t limite = msReais() + esperaMs;
+  for (;;) {
+    // Já há um pacote completo em "recebido"?
+    if (recebido.size() >= 2) {
+      size_t tamanho = 0, i = 1;
+      int deslocamento = 0;
+      bool completo = false;
+      while (i < recebido.size() && i < 5) {
+        uint8_t b = recebido[i++];
+        tamanho |= (size_t)(b & 0x7F) << deslocamento;
+        deslocamento += 7;
+        if (!(b & 0x80)) {
+          completo = true;
+          break;
+        }
+      }
+      if (completo && recebido.size() >= i + tamanho) {
+        *tipo = recebido[0] & 0xF0;
+        *corpo = recebido.substr(i, tamanho);
+        recebido.erase(0, i + tamanho);
+        return true;
+      }
+    }
+    int agoraReal = (int)(limite > msReais() ? limite - msReais() : 0);
+    pollfd p = { soquete, POLLIN, 0 };
+    if (poll(&p, 1, agoraReal) <= 0) return false;
+    char bytes[4096];
+    ssize_t n = recv(soquete, bytes, sizeof(bytes), 0);
+    if (n <= 0) {
+      cair(MQTT_CONNECTION_LOST);
+      return false;
+    }
+    recebido.append(bytes, n);
+  }
+}
+
+bool PubSubClient::loop() {
+  if (!connected()) return false;
+
+  if (brokerReal()) {
+    uint8_t tipo;
+    std::string corpo;
+    if (lerPacote(&tipo, &corpo, 0) && tipo == 0x30 && corpo.size() >= 2) {
+      size_t n = ((uint8_t)corpo[0] << 8) | (uint8_t)corpo[1];
+      entregarAoSketch(corpo.substr(2, n), corpo.substr(2 + n));
+    }
+    if (!conectado) return false;
+    if (agora() - ultimoEnvioUs > (uint64_t)keepAlive * 1000000) enviarPacote(0xC0, ""); // PINGREQ
+    return conectado;
+  }
+
+  gastar(20);
+  if (!chegando.empty()) { // um pacote por chamada, como a biblioteca
+    std::pair<std::string, std::string> m = chegando.front();
+    chegando.pop_front();
+    entregarAoSketch(m.first, m.second);
+  }
+  return conectado;
+}
+
+// O callback recebe ponteiros para o buffer interno (como na biblioteca): o
+// tópico termina em '\0' e o payload vem logo depois dele, sem terminador
+void PubSubClient::entregarAoSketch(std::string topico, std::string payload) {
+  if (!callback) return;
+  if (5 + topico.size() + payload.size() > tamanhoBuffer) return; // a biblioteca descarta
+  std::vector<char> buffer(topico.size() + 1 + payload.size() + 1);
+  memcpy(buffer.data(), topico.c_str(), topico.size() + 1);
+  memcpy(buffer.data() + topico.size() + 1, payload.data(), payload.size());
+  callback(buffer.data(), (uint8_t*)buffer.data() + topico.size() + 1, payload.size());
+}
+
+void PubSubClient::entregar(const std::string& topico, const std::string& payload) { chegando.emplace_back(topico, payload); }
+
+bool PubSubClient::assina(const std::string& topico) const {
+  for (const std::string& filtro : assinaturas)
+    if (casaTopico(filtro, topico)) return true;
+  return false;
+}
+
+bool PubSubClient::publish(const char* topico, const char* payload) { return publish(topico, (const uint8_t*)payload, strlen(payload), false); }
+bool PubSubClient::publish(const char* topico, const char* payload, bool retido) {
+  return publish(topico, (const uint8_t*)payload, strlen(payload), retido);
+}
+bool PubSubClient::publish(const char* topico, const uint8_t* payload, unsigned int n) { return publish(topico, payload, n, false); }
+
+bool PubSubClient::publish(const char* topico, const uint8_t* payload, unsigned int n, bool retido) {
+  if (!connected()) return false;
+  // Como na biblioteca: o pacote inteiro precisa caber no buffer (cabeçalho de 5 bytes + 2 do tamanho do tópico)
+  if (5 + 2 + strlen(topico) + n > tamanhoBuffer) return false;
+  return beginPublish(topico, n, retido) && write(payload, n) == n && endPublish();
+}
+
+bool PubSubClient::beginPublish(const char* topico, unsigned int n, bool retido) {
+  if (!connected()) return false;
+  topicoAberto = topico;
+  tamanhoAberto = n;
+  publicacaoAberta.clear();
+  return true;
+}
+
+size_t PubSubClient::write(uint8_t b) { return write(&b, 1); }
+
+size_t PubSubClient::write(const uint8_t* p, size_t n) {
+  if (!conectado) return 0;
+  publicacaoAberta.append((const char*)p, n);
+  return n;
+}
+
+int PubSubClient::endPublish() {
+  if (!conectado) return 0;
+  if (publicacaoAberta.size() != tamanhoAberto)
+    falhar("endPublish: beginPublish anunciou %zu bytes e foram escritos %zu", tamanhoAberto, publicacaoAberta.size());
+
+  std::string corpo = textoMqtt(topicoAberto) + publicacaoAberta;
+  uint32_t bytes = 1 + codificarTamanho(corpo.size()).size() + corpo.size();
+  if (brokerReal()) {
+    if (!enviarPacote(0x30, corpo)) return 0;
+  } else {
+    gastar(broker.publicacaoUs + publicacaoAberta.size() / 10 + (uint64_t)broker.travarMs * 1000); // ~10 bytes/us no socket
+    broker.travarMs = 0;
+  }
+  broker.recebidas.push_back({ agora(), topicoAberto, publicacaoAberta, bytes });
+  if (!brokerReal()) broker.publicar(topicoAberto, publicacaoAberta);
+  return 1;
+}
+
+bool PubSubClient::subscribe(const char* topico, uint8_t qos) {
+  if (!connected()) return false;
+  if (brokerReal()) {
+    std::string corpo;
+    corpo += (char)(proximoId >> 8);
+    corpo += (char)(proximoId & 0xFF);
+    proximoId++;
+    corpo += textoMqtt(topico);
+    corpo += (char)0; // QoS 0
+    if (!enviarPacote(0x82, corpo)) return false;
+  } else {
+    gastar(broker.publicacaoUs);
+  }
+  assinaturas.push_back(topico);
+  return true;
+}
+
+bool PubSubClient::unsubscribe(const char* topico) {
+  assinaturas.erase(std::remove(assinaturas.begin(), assinaturas.end(), std::string(topico)), assinaturas.end());
+  return connected();
+}
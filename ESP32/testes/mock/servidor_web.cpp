@@ -0,0 +1,450 @@
+// Conexões TCP (PCBs do lwIP), tarefa async_tcp e o AsyncWebServer do simulador.
+//
+// Os clientes do teste (sim::web.abrir) vivem no contexto do simulador: os
+// pacotes viram eventos com o atraso da rede. Do lado do ESP32, tudo (aceitar,
+// ler a requisição, chamar o handler do sketch, escrever, ACK, poll, fechar)
+// entra numa fila e é feito pela tarefa async_tcp, que gasta o tempo de CPU de
+// cada passo (sim::web.custo*). Assim um handler lento atrasa todo mundo, como
+// no ESP32, e a ocupação da tarefa sai em sim::web.cpuUs.
+#include <deque>
+#include <map>
+#include "ESPAsyncWebServer.h"
+
+namespace sim {
+
+extern uint32_t geracao;
+
+Web web;
+
+namespace {
+
+struct Conexao {
+  enum Estado { SYN, ABERTA, FECHANDO, TIME_WAIT } estado = SYN; // FECHANDO e TIME_WAIT: o PCB ainda existe
+  ClienteTcp cliente;
+  uint32_t tentativas = 0;
+  std::string recebido;
+  std::unique_ptr<AsyncWebServerRequest> requisicao;
+  uint32_t emVoo = 0;          // bytes sem ACK
+  uint64_t chegadaCliente = 0; // us em que o último byte já enviado chega ao cliente
+  bool clienteFechou = false;
+  uint64_t fimTimeWait = 0;
+};
+
+std::map<int, Conexao> conexoesTcp;
+int proximaConexao = 1;
+AsyncWebServer* servidor = NULL;
+TaskHandle_t tarefaTcp = NULL;
+std::deque<std::function<void()> > filaTcp;
+int eventoPoll = -1;
+
+Conexao* achar(int id) {
+  auto it = conexoesTcp.find(id);
+  return it == conexoesTcp.end() ? NULL : &it->second;
+}
+
+uint64_t redeUs() { return (uint64_t)web.redeMs * 1000; }
+
+// Tarefa async_tcp ocupada por us
+void ocupar(uint64_t us) {
+  web.cpuUs += us;
+  gastar(us);
+}
+
+// Do contexto do simulador para a tarefa async_tcp
+void postar(std::function<void()> fn) {
+  filaTcp.push_back(std::move(fn));
+  if (tarefaTcp) xTaskNotifyGive(tarefaTcp);
+}
+
+void tarefaAsyncTcp(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (!filaTcp.empty()) {
+      std::function<void()> fn = std::move(filaTcp.front());
+      filaTcp.pop_front();
+      fn();
+    }
+  }
+}
+
+// PCB para uma conexão nova: se não há livre, o lwIP recicla o TIME_WAIT mais antigo
+bool reservarPcb() {
+  uint32_t emUso = 0;
+  Conexao* maisAntigo = NULL;
+  int idAntigo = -1;
+  for (auto& par : conexoesTcp) {
+    Conexao& c = par.second;
+    if (c.estado == Conexao::SYN) continue;
+    emUso++;
+    if (c.estado == Conexao::TIME_WAIT && (!maisAntigo || c.fimTimeWait < maisAntigo->fimTimeWait)) {
+      maisAntigo = &c;
+      idAntigo = par.first;
+    }
+  }
+  if (emUso < web.pcbs) return true;
+  if (!maisAntigo) return false;
+  conexoesTcp.erase(idAntigo);
+  return true;
+}
+
+void chegouSyn(int id);
+
+void mandarSyn(int id, uint64_t atrasoUs) { em(agora() + atrasoUs, [id]() { chegouSyn(id); }); }
+
+void chegouSyn(int id) {
+  Conexao* c = achar(id);
+  if (!c || c->estado != Conexao::SYN) return;
+  if (!servidor || !reservarPcb()) {
+    web.synDescartados++;
+    if (++c->tentativas >= web.tentativasSyn) {
+      std::function<void(bool)> aoFechar = c->cliente.aoFechar;
+      conexoesTcp.erase(id);
+      if (aoFechar) aoFechar(true);
+      return;
+    }
+    mandarSyn(id, 1000000ull << (c->tentativas - 1)); // retransmissão do SYN: 1, 2, 4... s
+    return;
+  }
+  c->estado = Conexao::ABERTA;
+  web.conexoes++;
+  web.maxPcbsAtivos = std::max(web.maxPcbsAtivos, web.pcbsAtivos());
+  postar([]() { ocupar(web.custoConexaoUs); });
+  em(agora() + redeUs(), [id]() { // SYN-ACK
+    Conexao* c = achar(id);
+    if (c && !c->clienteFechou && c->cliente.aoConectar) c->cliente.aoConectar();
+  });
+}
+
+// --- LADO DO ESP32 (tarefa async_tcp) ---
+
+const char* textoStatus(int codigo) {
+  switch (codigo) {
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+  }
+  return "";
+}
+
+std::string cabecalho(const AsyncWebServerResponse& r) {
+  char linha[64];
+  snprintf(linha, sizeof(linha), "HTTP/1.1 %d %s\r\n", r.codigo, textoStatus(r.codigo));
+  std::string s = linha;
+  s += "Connection: close\r\nAccept-Ranges: none\r\n";
+  if (r.preencher) s += "Transfer-Encoding: chunked\r\n";
+  else s += "Content-Length: " + std::to_string(r.tamanho) + "\r\n";
+  if (!r.tipo.empty()) s += "Content-Type: " + r.tipo + "\r\n";
+  for (const auto& h : r.cabecalhos) s += h.first + ": " + h.second + "\r\n";
+  return s + "\r\n";
+}
+
+void continuar(int id);
+void fecharPeloServidor(int id);
+
+void escrever(int id, const std::string& bytes) {
+  Conexao* c = achar(id);
+  ocupar(web.custoEnvioUs + bytes.size() / 50);
+  if (!(c = achar(id)) || c->estado != Conexao::ABERTA) return;
+  c->emVoo += bytes.size();
+  web.bytesEnviados += bytes.size();
+  uint32_t taxa = c->cliente.bytesPorSegundo ? c->cliente.bytesPorSegundo : web.bytesPorSegundo;
+  uint64_t chegada = std::max(agora() + redeUs(), c->chegadaCliente) + (uint64_t)bytes.size() * 1000000 / taxa;
+  c->chegadaCliente = chegada;
+  em(chegada, [id, bytes]() {
+    Conexao* c = achar(id);
+    if (c && !c->clienteFechou && c->cliente.aoReceber) c->cliente.aoReceber(bytes);
+  });
+  size_t n = bytes.size();
+  em(chegada + redeUs(), [id, n]() { // ACK
+    postar([id, n]() {
+      Conexao* c = achar(id);
+      if (!c || c->estado != Conexao::ABERTA) return;
+      c->emVoo -= n;
+      ocupar(web.custoCallbackUs);
+      continuar(id);
+    });
+  });
+}
+
+// Escreve o que couber da resposta (cabeçalho + corpo ou um pedaço) e fecha no fim
+void continuar(int id) {
+  Conexao* c = achar(id);
+  if (!c || c->estado != Conexao::ABERTA || !c->requisicao || !c->requisicao->resposta) return;
+  AsyncWebServerResponse& r = *c->requisicao->resposta;
+  if (r.terminou) {
+    if (c->emVoo == 0) fecharPeloServidor(id); // tudo confirmado: a biblioteca fecha
+    return;
+  }
+  size_t espaco = web.janela - c->emVoo;
+  std::string saida = r.cabecalhoEnviado ? "" : cabecalho(r);
+  if (espaco < saida.size() + 16) return; // espera ACK
+
+  if (!r.preencher) {
+    size_t n = std::min(espaco - saida.size(), r.tamanho - r.enviado);
+    saida.append((const char*)r.corpo + r.enviado, n);
+    r.enviado += n;
+    r.terminou = r.enviado == r.tamanho;
+  } else {
+    // Pedaço: "<tamanho em hex>\r\n<dados>\r\n" (8 bytes de moldura, como a biblioteca)
+    size_t maximo = espaco - saida.size() - 8;
+    std::vector<uint8_t> buffer(maximo);
+    ocupar(web.custoCallbackUs);
+    size_t n = r.preencher(buffer.data(), maximo, r.enviado);
+    if (!(c = achar(id)) || c->estado != Conexao::ABERTA) return;
+    if (n == RESPONSE_TRY_AGAIN) return; // nem o cabeçalho sai
+    if (n > maximo) falhar("resposta em pedaços devolveu %zu bytes com maxLen %zu", n, maximo);
+    char tamanho[16];
+    snprintf(tamanho, sizeof(tamanho), "%zx\r\n", n);
+    saida += tamanho;
+    saida.append((const char*)buffer.data(), n);
+    saida += "\r\n";
+    if (n == 0) { // "0\r\n\r\n": fim
+      saida += "\r\n";
+      r.terminou = true;
+    }
+    r.enviado += n;
+  }
+  r.cabecalhoEnviado = true;
+  escrever(id, saida);
+}
+
+void apagarRequisicao(Conexao& c) {
+  if (!c.requisicao) return;
+  std::unique_ptr<AsyncWebServerRequest> req = std::move(c.requisicao);
+  if (req->aoDesconectar) req->aoDesconectar();
+}
+
+void fecharPeloServidor(int id) {
+  ocupar(web.custoFecharUs);
+  Conexao* c = achar(id);
+  if (!c || c->estado != Conexao::ABERTA) return;
+  c->estado = Conexao::FECHANDO;
+  apagarRequisicao(*c);
+  uint64_t fin = std::max(agora() + redeUs(), c->chegadaCliente);
+  em(fin, [id]() {
+    Conexao* c = achar(id);
+    if (!c) return;
+    if (!c->clienteFechou && c->cliente.aoFechar) c->cliente.aoFechar(false);
+    c->clienteFechou = true;
+  });
+  em(fin + redeUs(), [id]() { // FIN do cliente: o servidor, que fechou primeiro, fica em TIME_WAIT
+    Conexao* c = achar(id);
+    if (!c || c->estado != Conexao::FECHANDO) return;
+    c->estado = Conexao::TIME_WAIT;
+    c->fimTimeWait = agora() + (uint64_t)web.timeWaitMs * 1000;
+    em(c->fimTimeWait, [id]() {
+      Conexao* c = achar(id);
+      if (c && c->estado == Conexao::TIME_WAIT) conexoesTcp.erase(id);
+    });
+  });
+}
+
+void separarParametros(AsyncWebServerRequest& req, const std::string& alvo) {
+  size_t interrogacao = alvo.find('?');
+  req.caminho = alvo.substr(0, interrogacao);
+  if (interrogacao == std::string::npos) return;
+  std::string consulta = alvo.substr(interrogacao + 1);
+  size_t inicio = 0;
+  while (inicio <= consulta.size()) {
+    size_t fim = consulta.find('&', inicio);
+    if (fim == std::string::npos) fim = consulta.size();
+    std::string par = consulta.substr(inicio, fim - inicio);
+    size_t igual = par.find('=');
+    if (!par.empty()) req.parametros.emplace_back(par.substr(0, igual), igual == std::string::npos ? "" : par.substr(igual + 1));
+    inicio = fim + 1;
+  }
+}
+
+// Rota como o AsyncCallbackWebHandler: igual à uri ou abaixo dela ("/chuva/x")
+bool casaRota(const std::string& uri, const std::string& caminho) {
+  return uri == caminho || caminho.compare(0, uri.size() + 1, uri + "/") == 0;
+}
+
+void receber(int id, const std::string& bytes) {
+  Conexao* c = achar(id);
+  if (!c || c->estado != Conexao::ABERTA || c->requisicao) return; // uma requisição por conexão
+  c->recebido += bytes;
+  size_t fim = c->recebido.find("\r\n\r\n");
+  if (fim == std::string::npos) return;
+
+  ocupar(web.custoRequisicaoUs);
+  if (!(c = achar(id)) || c->estado != Conexao::ABERTA) return;
+  web.requisicoes++;
+  c->requisicao.reset(new AsyncWebServerRequest());
+  AsyncWebServerRequest* req = c->requisicao.get();
+  req->conexao = id;
+  std::string cab = c->recebido.substr(0, fim + 2);
+  size_t fimLinha = cab.find("\r\n");
+  std::string linha = cab.substr(0, fimLinha);
+  size_t espaco1 = linha.find(' '), espaco2 = linha.rfind(' ');
+  std::string metodo = linha.substr(0, espaco1);
+  separarParametros(*req, espaco2 > espaco1 ? linha.substr(espaco1 + 1, espaco2 - espaco1 - 1) : "");
+  for (size_t i = fimLinha + 2; i < cab.size();) {
+    size_t f = cab.find("\r\n", i);
+    std::string h = cab.substr(i, f - i);
+    size_t doisPontos = h.find(':');
+    if (doisPontos != std::string::npos) {
+      size_t v = h.find_first_not_of(' ', doisPontos + 1);
+      req->cabecalhos.emplace_back(h.substr(0, doisPontos), v == std::string::npos ? "" : h.substr(v));
+    }
+    i = f + 2;
+  }
+
+  ArRequestHandlerFunction fn = servidor->naoEncontrado;
+  for (const AsyncWebServer::Rota& r : servidor->rotas)
+    if (metodo == "GET" && (r.metodo & HTTP_GET) && casaRota(r.uri, req->caminho)) {
+      fn = r.fn;
+      break;
+    }
+  if (fn) fn(req);
+  else req->send(404);
+}
+
+} // namespace
+
+int Web::abrir(ClienteTcp cliente) {
+  int id = proximaConexao++;
+  conexoesTcp[id].cliente = std::move(cliente);
+  mandarSyn(id, redeUs());
+  return id;
+}
+
+void Web::enviar(int id, const std::string& bytes) {
+  Conexao* c = achar(id);
+  if (!c || c->estado != Conexao::ABERTA || c->clienteFechou) return;
+  em(agora() + redeUs(), [id, bytes]() { postar([id, bytes]() { receber(id, bytes); }); });
+}
+
+void Web::fechar(int id) {
+  Conexao* c = achar(id);
+  if (!c || c->clienteFechou) return;
+  c->clienteFechou = true;
+  if (c->estado == Conexao::SYN) {
+    conexoesTcp.erase(id); // ainda não conectou: só desiste
+    return;
+  }
+  em(agora() + redeUs(), [id]() { // FIN chega ao ESP32
+    postar([id]() {
+      Conexao* c = achar(id);
+      if (!c || c->estado != Conexao::ABERTA) return; // o servidor já tinha fechado
+      ocupar(web.custoFecharUs);
+      if (!(c = achar(id)) || c->estado != Conexao::ABERTA) return;
+      c->estado = Conexao::FECHANDO;
+      apagarRequisicao(*c);
+      em(agora() + redeUs(), [id]() { conexoesTcp.erase(id); }); // LAST_ACK: o PCB sai sem TIME_WAIT
+    });
+  });
+}
+
+uint32_t Web::pcbsAtivos() const {
+  uint32_t n = 0;
+  for (const auto& par : conexoesTcp) n += par.second.estado == Conexao::ABERTA || par.second.estado == Conexao::FECHANDO;
+  return n;
+}
+
+} // namespace sim
+
+using namespace sim;
+
+static void pollLwip();
+
+// --- ESPAsyncWebServer ---
+
+void AsyncWebServer::on(const char* uri, WebRequestMethodComposite metodo, ArRequestHandlerFunction fn) {
+  if (geracao != sim::geracao) { // boot novo: o objeto "nasceu de novo"
+    rotas.clear();
+    naoEncontrado = nullptr;
+    geracao = sim::geracao;
+  }
+  rotas.push_back({ uri, metodo, fn });
+}
+
+void AsyncWebServer::begin() {
+  // Boot novo: as conexões do boot anterior morreram junto com o lwIP
+  servidor = this;
+  conexoesTcp.clear();
+  filaTcp.clear();
+  xTaskCreatePinnedToCore(tarefaAsyncTcp, "async_tcp", 16384, NULL, 3, &tarefaTcp, 1);
+  // Poll do lwIP: a cada pollMs (desde o boot, + fasePollMs) a biblioteca pede
+  // mais dados às respostas abertas
+  if (eventoPoll >= 0) cancelar(eventoPoll);
+  uint64_t periodo = (uint64_t)web.pollMs * 1000;
+  uint64_t fase = inicioBoot() + (uint64_t)web.fasePollMs * 1000;
+  uint64_t primeiro = fase + ((agora() - inicioBoot()) / periodo + 1) * periodo;
+  eventoPoll = em(primeiro, []() {
+    eventoPoll = aCada((uint64_t)web.pollMs * 1000, []() { pollLwip(); });
+    pollLwip();
+  });
+}
+
+static void pollLwip() {
+  for (auto& par : conexoesTcp) {
+    Conexao& c = par.second;
+    if (c.estado != Conexao::ABERTA || !c.requisicao || !c.requisicao->resposta) continue;
+    int id = par.first;
+    postar([id]() {
+      ocupar(web.custoCallbackUs);
+      continuar(id);
+    });
+  }
+}
+
+bool AsyncWebServerRequest::hasHeader(const char* nome) const {
+  for (const AsyncWebHeader& h : cabecalhos)
+    if (strcasecmp(h.name().c_str(), nome) == 0) return true;
+  return false;
+}
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(const char* nome) {
+  for (AsyncWebHeader& h : cabecalhos)
+    if (strcasecmp(h.name().c_str(), nome) == 0) return &h;
+  return NULL;
+}
+
+bool AsyncWebServerRequest::hasParam(const char* nome, bool post, bool arquivo) const {
+  for (const AsyncWebParameter& p : parametros)
+    if (p.name() == nome) return true;
+  return false;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(const char* nome, bool post, bool arquivo) {
+  for (AsyncWebParameter& p : parametros)
+    if (p.name() == nome) return &p;
+  return NULL;
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int codigo, const char* tipo, const char* conteudo) {
+  AsyncWebServerResponse* r = new AsyncWebServerResponse();
+  r->codigo = codigo;
+  r->tipo = tipo;
+  r->copia = conteudo;
+  r->corpo = (const uint8_t*)r->copia.data();
+  r->tamanho = r->copia.size();
+  return r;
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse_P(int codigo, const char* tipo, const uint8_t* dados, size_t tamanho) {
+  AsyncWebServerResponse* r = new AsyncWebServerResponse();
+  r->codigo = codigo;
+  r->tipo = tipo;
+  r->corpo = dados;
+  r->tamanho = tamanho;
+  return r;
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginChunkedResponse(const char* tipo, AwsResponseFiller fn) {
+  AsyncWebServerResponse* r = new AsyncWebServerResponse();
+  r->tipo = tipo;
+  r->preencher = fn;
+  return r;
+}
+
+// Como na biblioteca: a resposta começa a sair na hora, dentro do handler
+void AsyncWebServerRequest::send(AsyncWebServerResponse* r) {
+  if (resposta) falhar("segunda resposta para a mesma requisição (%s)", caminho.c_str());
+  resposta.reset(r);
+  continuar(conexao);
+}
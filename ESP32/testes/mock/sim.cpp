@@ -0,0 +1,721 @@
+// Núcleo do simulador: relógio virtual, escalonador das tarefas, eventos
+// (timers, ADC), GPIO/PWM, Serial e deep sleep.
+//
+// Cada tarefa do FreeRTOS ganha uma pilha própria e roda como uma corrotina:
+// ela segue até bloquear (vTaskDelay, espera de notificação, gastar...) e aí
+// devolve o controle ao escalonador, que escolhe a próxima pronta de maior
+// prioridade. Se ninguém está pronto, o relógio pula direto para o próximo
+// evento. Interrupções (timer, bloco do ADC) rodam no contexto do escalonador.
+//
+// A troca de contexto usa _setjmp/_longjmp (makecontext só para a primeira
+// entrada): sem a chamada de sistema do swapcontext, um dia simulado leva
+// poucos segundos.
+#include <ucontext.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <deque>
+#include <memory>
+#include "Arduino.h"
+#include "esp_sleep.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+#define PILHA_TAREFA (256 * 1024) // bytes (no PC printf e cia. pedem mais que no ESP32)
+#define LIMITE_SEM_CEDER 50000000 // leituras do relógio sem ceder: a tarefa travou
+
+struct TarefaSim {
+  enum Estado { PRONTA, DORMINDO, ESPERANDO, TERMINADA };
+  std::string nome;
+  TaskFunction_t fn;
+  void* parametro;
+  UBaseType_t prioridade;
+  Estado estado = PRONTA;
+  uint64_t acordarEm = 0;  // DORMINDO / ESPERANDO com prazo
+  bool expirou = false;    // saiu da espera pelo prazo, não por aviso
+  uint32_t aviso = 0;      // valor da notificação
+  bool avisoPendente = false;
+  uint64_t ordem = 0;      // para o rodízio entre tarefas de mesma prioridade
+  bool iniciada = false;
+  std::unique_ptr<char[]> pilha;
+  ucontext_t contexto;
+  jmp_buf salto;
+};
+
+struct FilaSim {
+  UBaseType_t capacidade;
+  UBaseType_t tamanhoItem;
+  std::deque<std::string> itens;
+};
+
+struct hw_timer_t {
+  uint32_t frequencia;
+  void (*fn)(void) = NULL;
+  int evento = -1;
+};
+
+namespace sim {
+
+std::string serial;
+bool ecoSerial = false;
+Pino pinos[64];
+std::function<void(uint8_t)> aoEscreverPino;
+std::function<int(uint8_t, uint64_t)> sensor = [](uint8_t, uint64_t) { return 4095; };
+uint32_t adcAmostrasPorBloco = 1;
+uint32_t adcBlocosLidos = 0;
+Wifi wifi;
+uint32_t boots = 0;
+uint64_t tempoDormindoUs = 0;
+
+uint32_t geracao = 0; // muda a cada boot: objetos globais do sketch se "reconstroem" (WiFi, PubSubClient)
+
+namespace {
+
+struct Evento {
+  int id;
+  uint64_t us;
+  uint64_t periodo; // 0 = uma vez só
+  bool dispositivo; // some no deep sleep (timer, ADC)
+  std::function<void()> fn;
+};
+
+uint64_t relogio = 0;
+uint64_t boot = 0;
+uint64_t contadorOrdem = 0;
+int proximoEvento = 1;
+std::vector<Evento> eventos;
+std::vector<std::unique_ptr<TarefaSim> > tarefas;
+TarefaSim* atual = NULL;
+jmp_buf principal;
+uint64_t leiturasSemCeder = 0;
+
+void (*funcaoSetup)() = NULL;
+void (*funcaoLoop)() = NULL;
+bool dormir = false;
+uint64_t despertarUs = 0;
+uint64_t despertarEm = 0;
+
+// UART: fila de 128 bytes esvaziando no ritmo do baud rate
+double usPorCaractere = 0;
+uint64_t uartLivreEm = 0;
+
+// ADC contínuo
+struct {
+  void (*aoTerminar)(void) = NULL;
+  std::vector<uint8_t> pinos;
+  uint64_t periodo = 0;
+  int evento = -1;
+  std::deque<int> prontos; // médias dos blocos ainda não lidos (o DMA guarda poucos)
+  adc_continuous_data_t resultado[8];
+} adc;
+
+uint64_t semente = 0x2545F4914F6CDD1Dull;
+
+void iniciarTarefa();
+
+TarefaSim* criarTarefa(TaskFunction_t fn, const char* nome, void* parametro, UBaseType_t prioridade) {
+  TarefaSim* t = new TarefaSim();
+  t->nome = nome;
+  t->fn = fn;
+  t->parametro = parametro;
+  t->prioridade = prioridade;
+  t->ordem = ++contadorOrdem;
+  t->pilha.reset(new char[PILHA_TAREFA]);
+  getcontext(&t->contexto);
+  t->contexto.uc_stack.ss_sp = t->pilha.get();
+  t->contexto.uc_stack.ss_size = PILHA_TAREFA;
+  t->contexto.uc_link = NULL;
+  makecontext(&t->contexto, iniciarTarefa, 0);
+  tarefas.emplace_back(t);
+  return t;
+}
+
+// Primeira instrução de toda tarefa
+void iniciarTarefa() {
+  atual->fn(atual->parametro);
+  // No FreeRTOS uma tarefa não pode retornar; aqui ela só termina
+  atual->estado = TarefaSim::TERMINADA;
+  _longjmp(principal, 1);
+}
+
+// Devolve o controle ao escalonador; volta quando a tarefa for escolhida de novo
+void ceder() {
+  if (!atual) falhar("função de tarefa chamada fora de uma tarefa (interrupção ou teste)");
+  if (!_setjmp(atual->salto)) _longjmp(principal, 1);
+}
+
+void loopTask(void*) {
+  funcaoSetup();
+  for (;;) {
+    funcaoLoop();
+    gastar(1); // o loop() que nunca bloqueia ainda deixa o relógio andar
+  }
+}
+
+void ligarDispositivo() {
+  boots++;
+  boot = relogio;
+  geracao++;
+  uartLivreEm = 0;
+  usPorCaractere = 0;
+  for (Pino& p : pinos) p = Pino();
+  criarTarefa(loopTask, "loopTask", NULL, 1);
+}
+
+int agendar(uint64_t us, uint64_t periodo, bool dispositivo, std::function<void()> fn);
+
+// Deep sleep: tudo o que é do chip some (o teste e a RTC ficam) e o boot volta no despertar
+void executarDeepSleep() {
+  dormir = false;
+  tarefas.clear();
+  atual = NULL;
+  eventos.erase(std::remove_if(eventos.begin(), eventos.end(), [](const Evento& e) { return e.dispositivo; }),
+                eventos.end());
+  adc.evento = -1;
+  adc.prontos.clear();
+  uint64_t inicioSono = relogio;
+  agendar(despertarEm, 0, true, [inicioSono]() {
+    tempoDormindoUs += relogio - inicioSono;
+    ligarDispositivo();
+  });
+}
+
+int agendar(uint64_t us, uint64_t periodo, bool dispositivo, std::function<void()> fn) {
+  eventos.push_back({ proximoEvento, us, periodo, dispositivo, std::move(fn) });
+  return proximoEvento++;
+}
+
+// Dispara os eventos vencidos (em ordem de tempo) e acorda as tarefas cujo prazo passou
+void processarVencidos() {
+  for (;;) {
+    size_t escolhido = SIZE_MAX;
+    for (size_t i = 0; i < eventos.size(); i++)
+      if (eventos[i].us <= relogio && (escolhido == SIZE_MAX || eventos[i].us < eventos[escolhido].us)) escolhido = i;
+    if (escolhido == SIZE_MAX) break;
+
+    std::function<void()> fn = eventos[escolhido].fn;
+    if (eventos[escolhido].periodo) eventos[escolhido].us += eventos[escolhido].periodo;
+    else eventos.erase(eventos.begin() + escolhido);
+    fn();
+    if (dormir) return;
+  }
+
+  for (auto& t : tarefas) {
+    if ((t->estado == TarefaSim::DORMINDO || t->estado == TarefaSim::ESPERANDO) && t->acordarEm <= relogio) {
+      t->expirou = t->estado == TarefaSim::ESPERANDO;
+      t->estado = TarefaSim::PRONTA;
+    }
+  }
+}
+
+TarefaSim* escolherPronta() {
+  TarefaSim* melhor = NULL;
+  for (auto& t : tarefas) {
+    if (t->estado != TarefaSim::PRONTA) continue;
+    if (!melhor || t->prioridade > melhor->prioridade || (t->prioridade == melhor->prioridade && t->ordem < melhor->ordem))
+      melhor = t.get();
+  }
+  return melhor;
+}
+
+void executarTarefa(TarefaSim* t) {
+  t->ordem = ++contadorOrdem;
+  atual = t;
+  leiturasSemCeder = 0;
+  if (!_setjmp(principal)) {
+    if (!t->iniciada) {
+      t->iniciada = true;
+      setcontext(&t->contexto);
+    }
+    _longjmp(t->salto, 1);
+  }
+  atual = NULL;
+  if (dormir) return;
+  tarefas.erase(std::remove_if(tarefas.begin(), tarefas.end(),
+                               [](const std::unique_ptr<TarefaSim>& x) { return x->estado == TarefaSim::TERMINADA; }),
+                tarefas.end());
+}
+
+uint64_t proximoInstante() {
+  uint64_t proximo = UINT64_MAX;
+  for (const Evento& e : eventos) proximo = std::min(proximo, e.us);
+  for (auto& t : tarefas)
+    if (t->estado == TarefaSim::DORMINDO || t->estado == TarefaSim::ESPERANDO) proximo = std::min(proximo, t->acordarEm);
+  return proximo;
+}
+
+bool executar(uint64_t fim, const std::function<bool()>* condicao) {
+  if (atual) falhar("sim::rodar chamado de dentro de uma tarefa");
+  for (;;) {
+    processarVencidos();
+    if (dormir) executarDeepSleep();
+    if (condicao && (*condicao)()) return true;
+
+    TarefaSim* t = escolherPronta();
+    if (t) {
+      executarTarefa(t);
+      if (dormir) executarDeepSleep();
+      continue;
+    }
+    uint64_t proximo = proximoInstante();
+    if (proximo > fim) {
+      relogio = std::max(relogio, fim);
+      return condicao && (*condicao)();
+    }
+    relogio = std::max(relogio, proximo);
+  }
+}
+
+// Tick (ms desde o boot) em que uma espera de "ticks" termina
+uint64_t fimDaEspera(TickType_t ticks) {
+  if (ticks == portMAX_DELAY) return UINT64_MAX;
+  uint64_t tickAtual = (relogio - boot) / 1000;
+  return boot + (tickAtual + ticks) * 1000;
+}
+
+void contarLeitura() {
+  if (atual && ++leiturasSemCeder > LIMITE_SEM_CEDER)
+    falhar("tarefa \"%s\" leu o relógio %d vezes sem ceder (laço sem delay?)", atual->nome.c_str(), LIMITE_SEM_CEDER);
+}
+
+void escreverPino(uint8_t pino, int nivel, uint32_t duty, bool pwm) {
+  if (pino >= 64) falhar("pino %u não existe", pino);
+  Pino& p = pinos[pino];
+  bool mudou = pwm ? p.duty != duty : p.nivel != nivel;
+  if (pwm) p.duty = duty;
+  else p.nivel = nivel;
+  p.escritas++;
+  if (mudou) p.ultimaMudancaUs = relogio;
+  if (aoEscreverPino) aoEscreverPino(pino);
+}
+
+} // namespace
+
+uint64_t agora() { return relogio; }
+uint64_t inicioBoot() { return boot; }
+
+void gastar(uint64_t us) {
+  if (!atual) return; // interrupção ou teste: instantâneo
+  atual->estado = TarefaSim::DORMINDO;
+  atual->acordarEm = relogio + us;
+  ceder();
+}
+
+void rodar(uint64_t ms) { executar(relogio + ms * 1000, NULL); }
+
+bool rodarAte(const std::function<bool()>& condicao, uint64_t limiteMs) {
+  return executar(relogio + limiteMs * 1000, &condicao);
+}
+
+void ligar(void (*setup)(), void (*loop)()) {
+  const char* eco = getenv("SIM_SERIAL");
+  if (eco && eco[0] == '1') ecoSerial = true;
+  const char* broker = getenv("SIM_BROKER");
+  if (broker && broker[0]) {
+    std::string endereco = broker;
+    size_t doisPontos = endereco.rfind(':');
+    int porta = doisPontos == std::string::npos ? 1883 : atoi(endereco.c_str() + doisPontos + 1);
+    usarBrokerReal(endereco.substr(0, doisPontos).c_str(), porta);
+  }
+  funcaoSetup = setup;
+  funcaoLoop = loop;
+  ligarDispositivo();
+}
+
+void desligar() {
+  if (atual) falhar("sim::desligar chamado de dentro de uma tarefa");
+  tarefas.clear();
+  eventos.clear();
+  adc = {};
+  adc.evento = -1;
+  dormir = false;
+  boots = 0;
+  tempoDormindoUs = 0;
+  geracao++;
+}
+
+int em(uint64_t us, std::function<void()> fn) { return agendar(us, 0, false, std::move(fn)); }
+int aCada(uint64_t periodoUs, std::function<void()> fn) { return agendar(relogio + periodoUs, periodoUs, false, std::move(fn)); }
+void cancelar(int id) {
+  eventos.erase(std::remove_if(eventos.begin(), eventos.end(), [id](const Evento& e) { return e.id == id; }), eventos.end());
+}
+
+size_t contar(const char* trecho, size_t desde) {
+  size_t n = 0;
+  for (size_t i = serial.find(trecho, desde); i != std::string::npos; i = serial.find(trecho, i + 1)) n++;
+  return n;
+}
+
+void falhar(const char* formato, ...) {
+  va_list args;
+  va_start(args, formato);
+  fprintf(stderr, "[sim %.3f s] ", relogio / 1e6);
+  vfprintf(stderr, formato, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  exit(2);
+}
+
+static std::vector<std::string> niveis(const std::string& topico) {
+  std::vector<std::string> partes(1);
+  for (char c : topico) {
+    if (c == '/') partes.emplace_back();
+    else partes.back() += c;
+  }
+  return partes;
+}
+
+bool casaTopico(const std::string& filtro, const std::string& topico) {
+  std::vector<std::string> f = niveis(filtro), t = niveis(topico);
+  for (size_t i = 0; i < f.size(); i++) {
+    if (f[i] == "#") return true; // "a/#" também casa com "a"
+    if (i >= t.size()) return false;
+    if (f[i] != "+" && f[i] != t[i]) return false;
+  }
+  return f.size() == t.size();
+}
+
+} // namespace sim
+
+using namespace sim;
+
+// --- TEMPO ---
+
+unsigned long millis() {
+  contarLeitura();
+  return (relogio - boot) / 1000;
+}
+
+unsigned long micros() {
+  contarLeitura();
+  return (unsigned long)(relogio - boot);
+}
+
+int64_t esp_timer_get_time() {
+  contarLeitura();
+  return relogio - boot;
+}
+
+extern "C" int sim_gettimeofday(struct timeval* tv, void*) {
+  contarLeitura();
+  tv->tv_sec = relogio / 1000000;
+  tv->tv_usec = relogio % 1000000;
+  return 0;
+}
+
+void delay(uint32_t ms) { vTaskDelay(ms); }
+void delayMicroseconds(uint32_t us) { gastar(us); }
+void yield() { vTaskDelay(0); }
+
+// --- GPIO / PWM / ADC ---
+
+void pinMode(uint8_t pino, uint8_t modo) {}
+void digitalWrite(uint8_t pino, uint8_t valor) { escreverPino(pino, valor ? HIGH : LOW, 0, false); }
+int digitalRead(uint8_t pino) { return pinos[pino].nivel; }
+esp_err_t gpio_set_level(gpio_num_t pino, uint32_t nivel) {
+  escreverPino(pino, nivel ? HIGH : LOW, 0, false);
+  return ESP_OK;
+}
+
+bool ledcAttach(uint8_t pino, uint32_t frequencia, uint8_t resolucao) {
+  pinos[pino].pwm = true;
+  return true;
+}
+
+bool ledcWrite(uint8_t pino, uint32_t duty) {
+  if (!pinos[pino].pwm) falhar("ledcWrite no pino %u sem ledcAttach", pino);
+  escreverPino(pino, 0, duty, true);
+  return true;
+}
+
+uint16_t analogRead(uint8_t pino) {
+  gastar(10); // uma conversão avulsa leva uns 10 us
+  return std::min(4095, std::max(0, sensor(pino, relogio)));
+}
+
+uint32_t analogReadMilliVolts(uint8_t pino) { return analogRead(pino) * 3300 / 4095; }
+
+bool analogContinuous(const uint8_t pinosAdc[], size_t quantidade, uint32_t conversoesPorPino, uint32_t frequencia,
+                      void (*aoTerminar)(void)) {
+  if (quantidade == 0 || quantidade > 8 || frequencia == 0) return false;
+  adc.pinos.assign(pinosAdc, pinosAdc + quantidade);
+  adc.aoTerminar = aoTerminar;
+  adc.periodo = (uint64_t)conversoesPorPino * quantidade * 1000000 / frequencia;
+  return true;
+}
+
+bool analogContinuousStart() {
+  if (!adc.periodo) return false;
+  if (adc.evento >= 0) cancelar(adc.evento);
+  adc.evento = agendar(relogio + adc.periodo, adc.periodo, true, []() {
+    // Média do bloco: o sensor é lido em adcAmostrasPorBloco pontos do bloco que acabou
+    uint32_t n = std::max<uint32_t>(1, adcAmostrasPorBloco);
+    int64_t soma = 0;
+    for (uint32_t i = 0; i < n; i++) {
+      uint64_t t = relogio - adc.periodo + adc.periodo * (2 * i + 1) / (2 * n);
+      soma += std::min(4095, std::max(0, sensor(adc.pinos[0], t)));
+    }
+    adc.prontos.push_back((int)(soma / n));
+    if (adc.prontos.size() > 4) adc.prontos.pop_front(); // DMA sem espaço: perde o mais antigo
+    if (adc.aoTerminar) adc.aoTerminar();
+  });
+  return true;
+}
+
+bool analogContinuousStop() {
+  if (adc.evento >= 0) cancelar(adc.evento);
+  adc.evento = -1;
+  return true;
+}
+
+bool analogContinuousRead(adc_continuous_data_t** buffer, uint32_t timeoutMs) {
+  if (adc.prontos.empty()) return false;
+  int media = adc.prontos.front();
+  adc.prontos.pop_front();
+  adcBlocosLidos++;
+  for (size_t i = 0; i < adc.pinos.size(); i++) {
+    adc.resultado[i].pin = adc.pinos[i];
+    adc.resultado[i].channel = 0;
+    adc.resultado[i].avg_read_raw = media;
+    adc.resultado[i].avg_read_mvolts = media * 3300 / 4095;
+  }
+  *buffer = adc.resultado;
+  return true;
+}
+
+void analogContinuousSetWidth(uint8_t bits) {}
+void analogContinuousSetAtten(adc_attenuation_t atenuacao) {}
+
+// --- TIMER DE HARDWARE ---
+
+hw_timer_t* timerBegin(uint32_t frequencia) {
+  hw_timer_t* t = new hw_timer_t();
+  t->frequencia = frequencia;
+  return t;
+}
+
+void timerEnd(hw_timer_t* t) {
+  if (t->evento >= 0) cancelar(t->evento);
+  delete t;
+}
+
+void timerAttachInterrupt(hw_timer_t* t, void (*fn)(void)) { t->fn = fn; }
+
+void timerAlarm(hw_timer_t* t, uint64_t valor, bool autoReload, uint64_t repeticoes) {
+  if (t->evento >= 0) cancelar(t->evento);
+  uint64_t periodo = valor * 1000000 / t->frequencia;
+  t->evento = agendar(relogio + periodo, autoReload ? periodo : 0, true, [t]() {
+    if (t->fn) t->fn();
+  });
+}
+
+// --- ALEATÓRIOS ---
+
+long random(long maximo) { return random(0, maximo); }
+
+long random(long minimo, long maximo) {
+  if (maximo <= minimo) return minimo;
+  semente ^= semente << 13;
+  semente ^= semente >> 7;
+  semente ^= semente << 17;
+  return minimo + (long)(semente % (uint64_t)(maximo - minimo));
+}
+
+void randomSeed(unsigned long s) { semente = s ? s : 1; }
+
+// --- SERIAL ---
+
+HardwareSerial Serial;
+
+void HardwareSerial::begin(unsigned long baud) { usPorCaractere = 10e6 / baud; }
+
+size_t HardwareSerial::write(const uint8_t* p, size_t n) {
+  serial.append((const char*)p, n);
+  if (ecoSerial) fwrite(p, 1, n, stdout);
+  if (usPorCaractere > 0) {
+    // Cabe na fila de 128 bytes da UART: volta na hora. Senão, espera esvaziar.
+    uint64_t inicio = std::max(uartLivreEm, relogio);
+    uartLivreEm = inicio + (uint64_t)(n * usPorCaractere);
+    uint64_t limite = relogio + (uint64_t)(128 * usPorCaractere);
+    if (uartLivreEm > limite) gastar(uartLivreEm - limite);
+  }
+  return n;
+}
+
+void HardwareSerial::flush() {
+  if (uartLivreEm > relogio) gastar(uartLivreEm - relogio);
+}
+
+int Print::printf(const char* formato, ...) {
+  char texto[512];
+  va_list args;
+  va_start(args, formato);
+  int n = vsnprintf(texto, sizeof(texto), formato, args);
+  va_end(args);
+  write((const uint8_t*)texto, std::min<size_t>(n, sizeof(texto) - 1));
+  return n;
+}
+
+// --- HEAP ---
+
+size_t heap_caps_get_free_size(uint32_t caps) { return 180000; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return 110592; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return 172000; }
+
+const char* esp_err_to_name(esp_err_t erro) {
+  switch (erro) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+  }
+  return "ESP_ERR_?";
+}
+
+// --- DEEP SLEEP ---
+
+void esp_sleep_enable_timer_wakeup(uint64_t us) { despertarUs = us; }
+
+void esp_deep_sleep_start() {
+  if (!atual) falhar("esp_deep_sleep_start fora de uma tarefa");
+  dormir = true;
+  despertarEm = relogio + despertarUs;
+  _longjmp(principal, 1); // a tarefa nunca mais volta: o chip reinicia ao acordar
+}
+
+// --- FREERTOS ---
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* nome, uint32_t pilha, void* parametro,
+                                   UBaseType_t prioridade, TaskHandle_t* handle, BaseType_t nucleo) {
+  TarefaSim* t = criarTarefa(fn, nome, parametro, prioridade);
+  if (handle) *handle = t;
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* nome, uint32_t pilha, void* parametro, UBaseType_t prioridade,
+                       TaskHandle_t* handle) {
+  return xTaskCreatePinnedToCore(fn, nome, pilha, parametro, prioridade, handle, 0);
+}
+
+void vTaskDelete(TaskHandle_t tarefa) {
+  TarefaSim* t = tarefa ? tarefa : atual;
+  if (!t) falhar("vTaskDelete(NULL) fora de uma tarefa");
+  t->estado = TarefaSim::TERMINADA;
+  if (t == atual) _longjmp(principal, 1);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  if (!atual) falhar("vTaskDelay fora de uma tarefa");
+  atual->estado = TarefaSim::DORMINDO;
+  atual->acordarEm = ticks ? fimDaEspera(ticks) : relogio;
+  ceder();
+}
+
+void vTaskDelayUntil(TickType_t* anterior, TickType_t periodo) {
+  *anterior += periodo;
+  atual->estado = TarefaSim::DORMINDO;
+  atual->acordarEm = std::max(relogio, boot + (uint64_t)*anterior * 1000);
+  ceder();
+}
+
+TickType_t xTaskGetTickCount() { return (relogio - boot) / 1000; }
+TaskHandle_t xTaskGetCurrentTaskHandle() { return atual; }
+void taskYIELD() { vTaskDelay(0); }
+void sim_cederDaInterrupcao() {}
+
+static bool avisar(TaskHandle_t t, uint32_t valor, eNotifyAction acao) {
+  if (!t) falhar("notificação para uma tarefa que não existe");
+  switch (acao) {
+    case eNoAction: break;
+    case eSetBits: t->aviso |= valor; break;
+    case eIncrement: t->aviso++; break;
+    case eSetValueWithOverwrite: t->aviso = valor; break;
+    case eSetValueWithoutOverwrite:
+      if (t->avisoPendente) return false;
+      t->aviso = valor;
+      break;
+  }
+  t->avisoPendente = true;
+  if (t->estado == TarefaSim::ESPERANDO) t->estado = TarefaSim::PRONTA;
+  return true;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t t, uint32_t valor, eNotifyAction acao) { return avisar(t, valor, acao); }
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t t, uint32_t valor, eNotifyAction acao, BaseType_t* acordou) {
+  bool ok = avisar(t, valor, acao);
+  if (acordou) *acordou = pdTRUE;
+  return ok;
+}
+
+void xTaskNotifyGive(TaskHandle_t t) { avisar(t, 0, eIncrement); }
+void vTaskNotifyGiveFromISR(TaskHandle_t t, BaseType_t* acordou) {
+  avisar(t, 0, eIncrement);
+  if (acordou) *acordou = pdTRUE;
+}
+
+// Espera uma notificação por até "espera" ticks. Retorna false se o prazo venceu.
+static bool esperarAviso(TickType_t espera) {
+  if (!atual) falhar("espera de notificação fora de uma tarefa");
+  if (atual->avisoPendente) return true;
+  if (espera == 0) return false;
+  atual->estado = TarefaSim::ESPERANDO;
+  atual->acordarEm = fimDaEspera(espera);
+  atual->expirou = false;
+  ceder();
+  return atual->avisoPendente;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t limparNaEntrada, uint32_t limparNaSaida, uint32_t* valor, TickType_t espera) {
+  if (!atual->avisoPendente) atual->aviso &= ~limparNaEntrada;
+  bool chegou = esperarAviso(espera);
+  if (valor) *valor = atual->aviso;
+  if (!chegou) return pdFALSE;
+  atual->aviso &= ~limparNaSaida;
+  atual->avisoPendente = false;
+  return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t limparNaSaida, TickType_t espera) {
+  if (atual->aviso == 0) {
+    atual->avisoPendente = false;
+    esperarAviso(espera);
+  }
+  uint32_t valor = atual->aviso;
+  if (valor) atual->aviso = limparNaSaida ? 0 : valor - 1;
+  atual->avisoPendente = false;
+  return valor;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t tamanho, UBaseType_t tamanhoItem) {
+  FilaSim* f = new FilaSim();
+  f->capacidade = tamanho;
+  f->tamanhoItem = tamanhoItem;
+  return f;
+}
+
+BaseType_t xQueueSend(QueueHandle_t f, const void* item, TickType_t espera) {
+  if (f->itens.size() >= f->capacidade) {
+    if (espera) falhar("xQueueSend com espera não é simulado");
+    return pdFALSE;
+  }
+  f->itens.emplace_back((const char*)item, f->tamanhoItem);
+  return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t f, const void* item, BaseType_t* acordou) { return xQueueSend(f, item, 0); }
+
+BaseType_t xQueueReceive(QueueHandle_t f, void* item, TickType_t espera) {
+  if (f->itens.empty()) {
+    if (espera) falhar("xQueueReceive com espera não é simulado");
+    return pdFALSE;
+  }
+  memcpy(item, f->itens.front().data(), f->tamanhoItem);
+  f->itens.pop_front();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t f) { return f->itens.size(); }
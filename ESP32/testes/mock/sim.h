@@ -0,0 +1,235 @@
+// Simulador do ESP32 no PC: tempo virtual, tarefas do FreeRTOS e periféricos
+// de mentira (GPIO, PWM, ADC, timers, PCNT, Wi-Fi, broker MQTT, servidor web, BLE).
+//
+// O sketch é compilado sem nenhuma mudança contra os cabeçalhos desta pasta
+// (Arduino.h, WiFi.h, PubSubClient.h...), que chamam as funções daqui. O
+// relógio só anda quando todas as tarefas estão esperando (delay, notificação,
+// timer) ou quando uma operação "gasta" tempo (publish, Serial): dias de
+// funcionamento rodam em segundos e o resultado é sempre o mesmo.
+//
+// Uso em um teste:
+//   #include "../1. Detector de Chuva .../sensorDeChuvaMQTT.ino"
+//   int main() {
+//     sim::ligar(setup, loop);
+//     sim::rodar(60 * 1000);                 // 1 min simulado
+//     sim::broker.disponivel = false;        // derruba o broker
+//     ...
+//   }
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+// --- TEMPO VIRTUAL ---
+uint64_t agora();        // us desde o início da simulação
+uint64_t inicioBoot();   // us do último boot (millis() conta a partir daqui)
+void gastar(uint64_t us); // a tarefa atual fica ocupada por us (as outras continuam rodando)
+
+// Roda a simulação por ms milissegundos de tempo virtual
+void rodar(uint64_t ms);
+// Roda até condicao() ser verdadeira ou passar limiteMs. Retorna condicao().
+bool rodarAte(const std::function<bool()>& condicao, uint64_t limiteMs);
+
+// Liga o "ESP32": a loopTask chama setup() e depois loop() para sempre,
+// como o núcleo do Arduino. Depois de um deep sleep o boot se repete.
+void ligar(void (*setup)(), void (*loop)());
+// Desliga o "ESP32" (tarefas, timers e eventos somem) para o teste ligar outro cenário.
+// As variáveis globais do sketch continuam como estavam.
+void desligar();
+
+// Eventos do teste (rodam no contexto do simulador, como uma interrupção).
+// Sobrevivem ao deep sleep; os timers e o ADC do sketch não.
+int em(uint64_t us, std::function<void()> fn); // instante absoluto (agora() + atraso)
+int aCada(uint64_t periodoUs, std::function<void()> fn);
+void cancelar(int id);
+
+// --- SERIAL ---
+extern std::string serial; // tudo o que o sketch imprimiu (teste procura aqui)
+extern bool ecoSerial;     // também mostra no terminal (variável de ambiente SIM_SERIAL=1)
+size_t contar(const char* trecho, size_t desde = 0); // ocorrências de trecho em serial
+
+// --- GPIO E PWM ---
+struct Pino {
+  int nivel;                 // digitalWrite / gpio_set_level
+  uint32_t duty;             // ledcWrite
+  bool pwm;                  // ledcAttach feito
+  uint32_t escritas;         // quantas chamadas de escrita (mesmo sem mudar o valor)
+  uint64_t ultimaMudancaUs;  // quando o valor mudou de verdade pela última vez
+};
+extern Pino pinos[64];
+// Chamada a cada escrita em qualquer pino (ex.: modelo do motor)
+extern std::function<void(uint8_t pino)> aoEscreverPino;
+
+// --- ADC ---
+// Leitura "verdadeira" do pino no instante us (0-4095). O ADC contínuo chama
+// uma vez por bloco (no meio dele), ou adcAmostrasPorBloco vezes espalhadas.
+extern std::function<int(uint8_t pino, uint64_t us)> sensor;
+extern uint32_t adcAmostrasPorBloco;
+extern uint32_t adcBlocosLidos;
+
+// --- WI-FI ---
+struct Wifi {
+  bool disponivel = true;     // o AP está no ar
+  int32_t canal = 6;          // canal do AP (begin() com outro canal nunca conecta)
+  uint32_t varreduraMs = 1200; // procura de canal (pulada com canal + BSSID)
+  uint32_t associacaoMs = 150;
+  uint32_t dhcpMs = 600;      // pulado com IP estático (WiFi.config)
+  uint32_t inicios = 0;       // WiFi.begin() chamados
+  uint32_t iniciosRapidos = 0; // ... com canal + BSSID
+  uint32_t iniciosEstaticos = 0; // ... com IP estático
+  uint64_t ultimaConexaoMs = 0; // tempo do último begin() até conectar
+};
+extern Wifi wifi;
+
+// --- DEEP SLEEP ---
+extern uint32_t boots;         // 1 no primeiro boot
+extern uint64_t tempoDormindoUs; // total em deep sleep (desde ligar())
+
+// --- BROKER MQTT ---
+// Por padrão o PubSubClient fala com este broker em memória. Com a variável de
+// ambiente SIM_BROKER=host:porta (ou usarBrokerReal) ele abre um socket TCP e
+// fala MQTT 3.1.1 de verdade com um broker local (mosquitto, por exemplo).
+struct Mensagem {
+  uint64_t us; // instante (tempo virtual) em que chegou ao broker
+  std::string topico;
+  std::string payload;
+  uint32_t bytes = 0; // o PUBLISH inteiro como sai no socket: cabeçalho fixo, tópico e payload
+};
+
+struct Broker {
+  bool disponivel = true;            // false: conexões caem e novas falham
+  uint32_t conexaoMs = 30;           // TCP + CONNECT/CONNACK
+  uint32_t falhaConexaoMs = 2000;    // tentativa com o broker fora (timeout do socket)
+  uint32_t publicacaoUs = 300;       // um publish (até o write do socket)
+  uint32_t travarMs = 0;             // o próximo publish fica preso no write (buffer TCP cheio) e volta a 0
+  uint32_t conexoes = 0;
+  uint32_t quedas = 0;               // conexões derrubadas por disponivel = false
+  std::vector<Mensagem> recebidas;   // tudo o que o sketch publicou
+
+  // Manda uma mensagem para o sketch (chega no próximo client.loop(), se ele assinou o tópico)
+  void publicar(const std::string& topico, const std::string& payload);
+  size_t contar(const std::string& topico) const;
+};
+extern Broker broker;
+void usarBrokerReal(const char* host, int porta);
+bool brokerReal();
+
+// --- TCP E SERVIDOR WEB (AsyncTCP / ESPAsyncWebServer) ---
+// Clientes de mentira (navegadores) abrem conexões com o AsyncWebServer do
+// sketch. Cada sentido leva redeMs; os bytes do servidor chegam no ritmo do
+// cliente (bytesPorSegundo) e só saem enquanto houver janela (bytes sem ACK).
+// Cada conexão ocupa um dos pcbs PCBs do lwIP até o fim do TIME_WAIT (que o
+// lwIP recicla quando falta PCB). Sem PCB livre o SYN é descartado e o cliente
+// manda outro depois de 1, 2, 4... s, como o Linux/Android.
+//
+// Tudo o que o servidor faz roda na tarefa "async_tcp", que gasta o custo de
+// CPU de cada passo (estimativas para o ESP32 a 240 MHz); cpuUs soma esse tempo.
+struct ClienteTcp {
+  std::function<void()> aoConectar;
+  std::function<void(const std::string& bytes)> aoReceber;
+  std::function<void(bool recusada)> aoFechar; // recusada: desistiu do SYN, nunca conectou
+  uint32_t bytesPorSegundo = 0;               // 0 = Web::bytesPorSegundo (celular com sinal fraco: poucos KB/s)
+};
+
+struct Web {
+  uint32_t pcbs = 16;                // MEMP_NUM_TCP_PCB (CONFIG_LWIP_MAX_ACTIVE_TCP)
+  uint32_t redeMs = 5;               // um sentido
+  uint32_t bytesPorSegundo = 1000000;
+  uint32_t janela = 5744;            // TCP_SND_BUF: bytes sem ACK por conexão
+  uint32_t pollMs = 500;             // tcp_poll do AsyncTCP (timer do lwIP, contado desde o boot)
+  uint32_t fasePollMs = 0;           // deslocamento do timer: fase entre o poll e as tarefas do sketch
+  uint32_t timeWaitMs = 120000;      // 2 x TCP_MSL
+  uint32_t tentativasSyn = 6;
+  uint32_t custoConexaoUs = 150;     // aceitar: PCB, AsyncClient, AsyncWebServerRequest
+  uint32_t custoRequisicaoUs = 300;  // ler e rotear a requisição (cabeçalhos em String)
+  uint32_t custoEnvioUs = 40;        // cada tcp_write + tcp_output (+ 1 us a cada 50 bytes copiados)
+  uint32_t custoCallbackUs = 15;     // ACK, poll, função de uma resposta em pedaços
+  uint32_t custoFecharUs = 60;
+
+  uint32_t conexoes = 0;        // aceitas pelo servidor
+  uint32_t synDescartados = 0;  // SYN sem PCB livre
+  uint32_t maxPcbsAtivos = 0;   // pico de PCBs fora do TIME_WAIT
+  uint32_t requisicoes = 0;
+  uint64_t cpuUs = 0;           // ocupação da tarefa async_tcp
+  uint64_t bytesEnviados = 0;
+
+  int abrir(ClienteTcp cliente);                       // manda o SYN; devolve o número da conexão
+  void enviar(int conexao, const std::string& bytes);  // do cliente para o servidor
+  void fechar(int conexao);                            // o cliente fecha (aba fechada)
+  uint32_t pcbsAtivos() const;
+};
+extern Web web;
+
+// --- BLUETOOTH LE (BLEDevice, RemoteXY e a API GATT do IDF) ---
+// Um celular de mentira conecta no ESP32, troca o MTU e escreve nas
+// características: o app do RemoteXY manda o estado dos controles na hora em
+// que o usuário mexe e de novo a cada periodoAppMs. O rádio só fala nos
+// eventos de conexão (a cada intervalo): uma escrita ou um notify espera o
+// próximo. No ESP32 os eventos GATT (conexão, MTU, escrita, queda) chegam pela
+// tarefa do Bluetooth (btc, prioridade 19), como no IDF.
+struct Notificacao {
+  uint64_t us; // chegou ao celular
+  uint16_t handle;
+  std::string dados;
+};
+
+struct Ble {
+  // Celular (valem para a próxima conexão)
+  uint32_t intervaloMs = 30;        // intervalo de conexão
+  uint32_t supervisaoMs = 5000;     // sem ouvir o outro lado por isso a conexão cai (Android: 5 s; iOS: 720 ms)
+  uint32_t supervisaoMinimaMs = 0;  // pedidos de parâmetros com supervisão menor são recusados (iOS: 2000)
+  uint16_t mtuCelular = 517;        // o MTU final é o menor entre este e o do ESP32 (iOS: 185)
+  uint32_t periodoAppMs = 100;      // o app do RemoteXY reenvia os controles
+  int32_t desvioPpm = 40;           // relógio do celular (marca os eventos de conexão) contra o do ESP32
+  uint32_t custoEventoUs = 30;      // CPU da tarefa btc por evento GATT
+  bool filaCheia = false;           // send_indicate devolve ESP_ERR_NO_MEM (fila da pilha BLE cheia)
+
+  // Conexão atual
+  bool conectado = false;           // do ponto de vista do ESP32 (até o ESP_GATTS_DISCONNECT_EVT)
+  uint16_t mtu = 23;
+  uint32_t intervaloAtualMs = 0;
+  uint32_t supervisaoAtualMs = 0;
+
+  uint32_t conexoes = 0;
+  uint32_t quedas = 0;              // perderSinal
+  uint32_t servidores = 0;          // BLEDevice::createServer
+  uint32_t pacotesApp = 0;          // escritas do app do RemoteXY entregues ao ESP32
+  uint64_t chegadaControlesUs = 0;  // quando o último estado de controles() chegou ao ESP32 (0 = ainda não)
+  uint32_t pedidosParametros = 0;   // esp_ble_gap_update_conn_params
+  uint32_t parametrosRecusados = 0;
+  uint32_t notificacoesRecusadas = 0; // sem conexão, handle errado ou maior que MTU - 3
+  std::vector<Notificacao> notificacoes;
+  std::function<void(const Notificacao&)> aoNotificar;
+
+  void conectar();                  // conecta em um intervalo, troca o MTU e o app começa a mandar
+  void desconectar();               // o celular desconecta (o ESP32 vê no próximo evento de conexão)
+  void perderSinal();               // sai do alcance: nada mais passa; o ESP32 só vê a queda depois da supervisão
+  void controles(const std::string& entradas); // bytes das variáveis de entrada do RemoteXY
+  bool assinar(const char* uuidCaracteristica, bool ligar = true); // escreve no CCCD (0x2902) da característica
+};
+extern Ble ble;
+
+// --- ENCODER (PCNT) ---
+struct Pcnt {
+  int64_t posicao = 0;      // bordas em quadratura desde o início, com sinal (4 por pulso do canal A)
+  uint64_t percorrido = 0;  // |bordas| somadas: com um canal só o PCNT conta percorrido / 4 subidas
+  bool semUnidade = false;  // pcnt_new_unit falha com ESP_ERR_NOT_FOUND (sem unidade livre)
+  uint32_t unidades = 0;    // criadas com sucesso
+  bool contando = false;    // pcnt_unit_start feito
+
+  void mover(int64_t bordas) {
+    posicao += bordas;
+    percorrido += bordas < 0 ? -bordas : bordas;
+  }
+};
+extern Pcnt pcnt;
+
+// --- UTILITÁRIOS ---
+void falhar(const char* formato, ...); // erro do simulador: imprime e sai com código 2
+bool casaTopico(const std::string& filtro, const std::string& topico); // + e #
+
+} // namespace sim
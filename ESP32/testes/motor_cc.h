@@ -0,0 +1,79 @@
+// Motor CC com redução atrás de uma ponte H L298N, para ligar nos pinos do
+// simulador (a mesma planta serve para os testes da rampa, do PID e do BLE).
+//
+// A cada passo (100 us, integração de Euler) lê EN (PWM), IN1 e IN2:
+//   - EN > 0 e IN1 != IN2: tensão média Vs * duty / 255 no sentido de IN1;
+//   - EN > 0 e IN1 == IN2 (os dois HIGH ou os dois LOW): freio, motor em curto;
+//   - EN = 0: solto (a corrente some pelos diodos, só o atrito segura).
+//   L di/dt = V - R i - Ke w      J dw/dt = Kt i - b w - carga
+// O encoder anda sim::pcnt (1320 bordas por volta do eixo de saída) e, se
+// pedido, o ADC mostra a corrente no resistor de sense e a tensão da fonte.
+#pragma once
+#include <math.h>
+#include "sim.h"
+
+class MotorCC {
+public:
+  // Eixo de saída (já com a redução): sem carga, 12 V dão ~230 RPM
+  double vs = 12;          // V da fonte (o L298N perde ~2 V, já descontado aqui)
+  double r = 2.5;          // ohm
+  double l = 2.5e-3;       // H
+  double ke = 0.482;       // V por rad/s (= Kt em N.m/A)
+  double b = 0.003;        // N.m por rad/s (atrito viscoso)
+  double j = 0.002;        // kg.m² (rotor refletido + volante)
+  double carga = 0;        // N.m contra o giro
+  double bordasPorVolta = 1320;
+  bool comEncoder = true;  // false: o encoder está desligado (o PCNT não conta nada)
+
+  uint8_t in1, in2, en;    // pinos da ponte H
+  double corrente = 0;     // A
+  double w = 0;            // rad/s (positivo = IN1 HIGH / IN2 LOW)
+
+  MotorCC(uint8_t in1, uint8_t in2, uint8_t en) : in1(in1), in2(in2), en(en) {}
+
+  // Começa a integrar (chamar depois de sim::ligar: desligar() cancela o evento)
+  void ligar() { evento = sim::aCada(PASSO_US, [this]() { passo(PASSO_US * 1e-6); }); }
+  void parar() { sim::cancelar(evento); }
+
+  // Sensor de corrente (V = i x sense) e divisor da fonte no ADC
+  void ligarSensores(uint8_t pinoTensao, uint8_t pinoCorrente, double senseOhm = 0.5, double divisor = 11) {
+    sim::sensor = [=](uint8_t pino, uint64_t) {
+      double mv = 0;
+      if (pino == pinoCorrente) mv = fabs(corrente) * senseOhm * 1000;
+      if (pino == pinoTensao) mv = (vs + 2) * 1000 / divisor;
+      return (int)lround(mv * 4095 / 3300);
+    };
+  }
+
+  double rpm() const { return w * 60 / (2 * M_PI); }
+
+private:
+  static const uint64_t PASSO_US = 100;
+  int evento = -1;
+  double bordas = 0; // fração de borda ainda não contada
+
+  void passo(double dt) {
+    uint32_t duty = sim::pinos[en].duty;
+    bool a = sim::pinos[in1].nivel, bb = sim::pinos[in2].nivel;
+    if (duty == 0) {
+      corrente = 0;
+    } else {
+      double v = a == bb ? 0 : (a ? 1 : -1) * vs * duty / 255;
+      corrente += (v - r * corrente - ke * w) / l * dt;
+    }
+    double torque = ke * corrente;
+    if (w == 0 && fabs(torque) <= carga) {
+      // Parado e sem força para vencer a carga: continua parado
+    } else {
+      double sentido = w != 0 ? (w > 0 ? 1 : -1) : (torque > 0 ? 1 : -1);
+      double novo = w + (torque - b * w - carga * sentido) / j * dt;
+      // A carga (atrito seco) freia até parar, mas não faz o eixo girar ao contrário
+      w = novo * sentido < 0 && fabs(torque) <= carga ? 0 : novo;
+    }
+    if (!comEncoder) return;
+    bordas += w * dt / (2 * M_PI) * bordasPorVolta;
+    int64_t inteiras = (int64_t)bordas;
+    bordas -= inteiras;
+    if (inteiras) sim::pcnt.mover(inteiras);
+  }
+};
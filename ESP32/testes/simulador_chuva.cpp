@@ -0,0 +1,99 @@
+// Roda o sensorDeChuvaMQTT (sem mudanças) por vários dias simulados e mede
+// taxa de publicação, volta da tarefa de rede e reconexões. Base para comparar
+// versões do firmware (regressão de desempenho) sem placa e sem rede.
+//
+//   build/simulador_chuva [dias] [quedas do broker por dia]
+//   SIM_BROKER=localhost:1883 build/simulador_chuva 1     (broker de verdade)
+//
+// As quedas (só no broker em memória) têm horário e duração sorteados (1 a 30
+// min) com semente fixa: duas rodadas do mesmo firmware dão o mesmo resultado.
+#include "../1. Detector de Chuva com ESP32 e MQTT/sensorDeChuvaMQTT/sensorDeChuvaMQTT.ino"
+#include <chrono>
+#include <unistd.h>
+#include "chuva_sintetica.h"
+
+// Percentil a partir dos baldes acumulados do texto do Prometheus (limite do balde)
+static std::string percentil(const std::string& texto, const std::string& nome, double p) {
+  std::vector<std::pair<std::string, double> > baldes;
+  std::string prefixo = nome + "_bucket{le=\"";
+  for (size_t i = texto.find(prefixo); i != std::string::npos; i = texto.find(prefixo, i + 1)) {
+    size_t fim = texto.find('"', i + prefixo.size());
+    baldes.emplace_back(texto.substr(i + prefixo.size(), fim - i - prefixo.size()), atof(texto.c_str() + fim + 2));
+  }
+  if (baldes.empty() || baldes.back().second == 0) return "--";
+  for (auto& b : baldes)
+    if (b.second >= p * baldes.back().second) return (b.first == "+Inf" ? ">" + baldes[baldes.size() - 2].first : "<=" + b.first) + " us";
+  return "--";
+}
+
+int main(int argc, char** argv) {
+  double dias = argc > 1 ? atof(argv[1]) : 7;
+  double quedasPorDia = argc > 2 ? atof(argv[2]) : 0;
+  if (dias <= 0) sim::falhar("uso: simulador_chuva [dias] [quedas do broker por dia]");
+
+  ChuvaSintetica chuva(7);
+  sim::sensor = [&chuva](uint8_t, uint64_t us) { return chuva(us); };
+
+  // Quedas do broker: instante e duração sorteados
+  uint64_t totalForaUs = 0;
+  int quedas = 0;
+  if (quedasPorDia > 0 && !sim::brokerReal()) {
+    double t = 0;
+    while (true) {
+      t += -log(1 - random(1, 1000000) / 1e6) * 86400e6 / quedasPorDia;
+      if (t >= dias * 86400e6) break;
+      uint64_t duracao = random(60, 1801) * 1000000ull;
+      sim::em((uint64_t)t, []() { sim::broker.disponivel = false; });
+      sim::em((uint64_t)t + duracao, []() { sim::broker.disponivel = true; });
+      totalForaUs += duracao;
+      quedas++;
+      t += duracao;
+    }
+  }
+
+  auto inicio = std::chrono::steady_clock::now();
+  sim::ligar(setup, loop);
+  uint64_t horas = (uint64_t)(dias * 24);
+  for (uint64_t h = 0; h < horas; h++) {
+    sim::rodar(3600 * 1000);
+    if (!sim::ecoSerial && isatty(2)) fprintf(stderr, "\r%llu/%llu h simuladas", (unsigned long long)h + 1, (unsigned long long)horas);
+  }
+  double segundosReais = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+  if (!sim::ecoSerial && isatty(2)) fprintf(stderr, "\n");
+
+  // O que chegou ao broker
+  size_t leituras = 0, bytes = 0, mensagens = 0;
+  uint32_t maiorIdade = 0;
+  std::string ultimasMetricas;
+  for (const sim::Mensagem& m : sim::broker.recebidas) {
+    if (m.topico == topic_stats) ultimasMetricas = m.payload;
+    if (m.topico != topic_publish) continue;
+    mensagens++;
+    bytes += m.payload.size();
+    if (!m.payload.empty() && (uint8_t)m.payload[0] == QUADRO_MARCADOR) {
+      leituras += (uint8_t)m.payload[1];
+    } else if (m.payload.find(';') != std::string::npos) {
+      leituras++;
+      maiorIdade = std::max<uint32_t>(maiorIdade, strtoul(m.payload.c_str() + m.payload.find(';') + 1, NULL, 10));
+    }
+  }
+  double segundosSimulados = horas * 3600.0;
+  uint64_t geradas = (uint64_t)(segundosSimulados * 1000 / MSG_INTERVAL); // 1ª leitura em MSG_INTERVAL
+
+  printf("Simulados %.1f dias em %.1f s (%.0fx o tempo real)\n", segundosSimulados / 86400, segundosReais,
+         segundosSimulados / segundosReais);
+  printf("Broker: %s | %d quedas (%.1f min fora) | %u conexoes, %lu falhas de conexao\n",
+         sim::brokerReal() ? "real (SIM_BROKER)" : "em memoria", quedas, totalForaUs / 60e6, sim::broker.conexoes,
+         (unsigned long)metricaFalhasMqtt.ler());
+  long sumidas = (long)geradas - (long)leituras - totalNaFila() - (long)(spscEscrita.load() - spscLeitura.load());
+  printf("Leituras: %llu geradas, %zu entregues, %u ainda na fila | sumidas %ld (perdidas na fila %lu, descartes SPSC %lu)\n",
+         (unsigned long long)geradas, leituras, totalNaFila(), sumidas, (unsigned long)amostrasPerdidas,
+         (unsigned long)spscDescartes.load());
+  printf("Sinal: %zu chuvas sorteadas\n", chuva.quantidadeChuvas());
+  printf("Publicacao: %.0f mensagens/h, %.0f bytes/h | maior idade ao publicar %.1f s\n", mensagens / (segundosSimulados / 3600),
+         bytes / (segundosSimulados / 3600), maiorIdade / 1000.0);
+  printf("Volta da tarefa de rede: p50 %s, p99 %s | publicacao: p99 %s\n",
+         percentil(ultimasMetricas, "chuva_rede_volta_us", 0.5).c_str(), percentil(ultimasMetricas, "chuva_rede_volta_us", 0.99).c_str(),
+         percentil(ultimasMetricas, "chuva_mqtt_publicacao_us", 0.99).c_str());
+  return 0;
+}
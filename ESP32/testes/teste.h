@@ -0,0 +1,31 @@
+// Verificações dos testes do PC: cada VERIFICA imprime "ok" ou "FALHOU" com a
+// linha, e o teste termina com fimDosTestes() (código 1 se algo falhou).
+// percentil() resume as listas de tempos.
+#pragma once
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+inline int falhasTeste = 0;
+
+#define VERIFICA(condicao, ...)                                  \
+  do {                                                           \
+    bool passou_ = (condicao);                                   \
+    printf("  %s ", passou_ ? "ok    " : "FALHOU");              \
+    printf(__VA_ARGS__);                                         \
+    if (!passou_) printf("  (%s:%d: %s)", __FILE__, __LINE__, #condicao); \
+    printf("\n");                                                \
+    if (!passou_) falhasTeste++;                                 \
+  } while (0)
+
+inline int fimDosTestes() {
+  if (falhasTeste) printf("%d verificação(ões) falharam\n", falhasTeste);
+  return falhasTeste ? 1 : 0;
+}
+
+// Percentil (0-1) de uma lista de tempos
+inline double percentil(std::vector<double> v, double p) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+}
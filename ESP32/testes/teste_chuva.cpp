@@ -0,0 +1,81 @@
+// Teste de fumaça do sensorDeChuvaMQTT (sem mudanças) no simulador: um dia de
+// publicação sem perder leitura, comando com confirmação, histórico, métricas e
+// o limite de taxa do envio por exceção.
+#include "../1. Detector de Chuva com ESP32 e MQTT/sensorDeChuvaMQTT/sensorDeChuvaMQTT.ino"
+#include "chuva_sintetica.h"
+#include "teste.h"
+
+// Leituras que chegaram ao broker em topic_publish (texto ou quadro do modo lote)
+static size_t leiturasEntregues() {
+  size_t n = 0;
+  for (const sim::Mensagem& m : sim::broker.recebidas) {
+    if (m.topico != topic_publish || m.payload.empty()) continue;
+    if ((uint8_t)m.payload[0] == QUADRO_MARCADOR) n += (uint8_t)m.payload[1];
+    else if (m.payload.find(';') != std::string::npos) n++;
+  }
+  return n;
+}
+
+static std::string ultima(const char* topico) {
+  for (size_t i = sim::broker.recebidas.size(); i-- > 0;)
+    if (sim::broker.recebidas[i].topico == topico) return sim::broker.recebidas[i].payload;
+  return "";
+}
+
+int main() {
+  ChuvaSintetica chuva(3);
+  sim::sensor = [&chuva](uint8_t, uint64_t us) { return chuva(us); };
+
+  puts("boot e conexao:");
+  sim::ligar(setup, loop);
+  VERIFICA(sim::rodarAte([]() { return sim::broker.conexoes == 1; }, 30 * 1000), "conecta ao broker");
+  sim::rodar(100);
+  VERIFICA(sim::broker.contar(topic_publish) >= 1 && sim::broker.recebidas[0].payload == "Conectado!",
+           "publica \"Conectado!\" ao conectar");
+
+  puts("um dia publicando:");
+  sim::rodar(24ull * 3600 * 1000);
+  size_t esperadas = 24ull * 3600 * 1000 / MSG_INTERVAL;
+  size_t entregues = leiturasEntregues();
+  VERIFICA(entregues + totalNaFila() + 1 >= esperadas && entregues <= esperadas + 1,
+           "uma leitura a cada %d ms (%zu entregues, %u na fila, %zu esperadas)", MSG_INTERVAL, entregues, totalNaFila(),
+           esperadas);
+  VERIFICA(amostrasPerdidas == 0 && spscDescartes.load() == 0, "nenhuma leitura descartada");
+  VERIFICA(sim::broker.conexoes == 1, "uma conexão só, sem quedas (%u)", sim::broker.conexoes);
+  size_t metricas = sim::broker.contar(topic_stats);
+  VERIFICA(metricas >= 24 * 60 - 1, "métricas a cada %d s (%zu)", INTERVALO_METRICAS / 1000, metricas);
+  VERIFICA(ultima(topic_stats).find("chuva_rede_volta_us_bucket") != std::string::npos,
+           "métricas em texto do Prometheus");
+
+  puts("comando e confirmacao:");
+  sim::broker.publicar(topic_subscribe, "I=5000;L=1");
+  VERIFICA(sim::rodarAte([]() { return sim::broker.contar(topic_resposta) == 1; }, 1000), "responde o comando em menos de 1 s");
+  VERIFICA(ultima(topic_resposta).rfind("ok I=5000 ", 0) == 0, "confirma a configuração nova (%s)", ultima(topic_resposta).c_str());
+  VERIFICA(sim::pinos[pinoLED].nivel == HIGH, "L=1 acende o LED");
+  size_t antes = leiturasEntregues();
+  sim::rodar(10 * 60 * 1000);
+  size_t novas = leiturasEntregues() - antes;
+  VERIFICA(novas >= 119 && novas <= 121, "I=5000: 12 leituras por minuto (%zu em 10 min)", novas);
+  sim::broker.publicar(topic_subscribe, "I=10");
+  sim::rodar(1000);
+  VERIFICA(ultima(topic_resposta) == "erro I", "intervalo fora da faixa é recusado (%s)", ultima(topic_resposta).c_str());
+
+  puts("historico:");
+  sim::broker.publicar(topic_pedido, "100");
+  VERIFICA(sim::rodarAte([]() { return sim::broker.contar(topic_historico) == 1; }, 1000), "responde o pedido de histórico");
+  std::string h = ultima(topic_historico);
+  VERIFICA(!h.empty() && (uint8_t)h[0] == HISTORICO_MARCADOR, "resposta no formato binário do histórico");
+
+  puts("envio por excecao:");
+  modoExcecao = true;
+  temReferencia = false;
+  limiteTaxa = 0;
+  deveEnviar({ 0, 2000 });
+  unsigned long porTaxa = enviadasTaxa;
+  VERIFICA(!deveEnviar({ 1000, 2030 }) && enviadasTaxa == porTaxa, "T=0 desliga o envio por taxa (30 LSB/s dentro da faixa)");
+  limiteTaxa = 20;
+  VERIFICA(deveEnviar({ 2000, 2060 }) && enviadasTaxa == porTaxa + 1, "com T=20 a mesma variação sai na hora");
+  modoExcecao = false;
+
+  return fimDosTestes();
+}
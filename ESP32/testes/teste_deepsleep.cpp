@@ -0,0 +1,117 @@
+// Modo deep sleep do sensorDeChuvaMQTT (cicloDeepSleep) com Wi-Fi, timer da
+// RTC e broker simulados: uma leitura por despertar, conexão a cada
+// DEEP_SLEEP_K despertares com BSSID/canal/IP da RTC, nada perdido, e os
+// tempos impressos pelo ciclo.
+//
+// O sketch vem com MODO_DEEP_SLEEP 0; aqui ele é compilado com 1. Obs.: no
+// simulador as variáveis fora da RTC também sobrevivem ao deep sleep, então o
+// teste só confia nas da RTC.
+#define MODO_DEEP_SLEEP 1
+#include "../1. Detector de Chuva com ESP32 e MQTT/sensorDeChuvaMQTT/sensorDeChuvaMQTT.ino"
+#include "teste.h"
+
+void loopNunca() { sim::falhar("loop() rodou no modo deep sleep"); }
+
+struct Ciclo {
+  uint32_t numero, acordadoMs, enviadas;
+  long despertarParaPublishMs;
+};
+
+// Linhas "Ciclo N: acordado X ms ... | E amostras enviadas, despertar->publish Y ms" do Monitor Serial
+static std::vector<Ciclo> ciclos() {
+  std::vector<Ciclo> v;
+  for (size_t i = sim::serial.find("Ciclo "); i != std::string::npos; i = sim::serial.find("Ciclo ", i + 1)) {
+    std::string linha = sim::serial.substr(i, sim::serial.find('\n', i) - i);
+    Ciclo c = { 0, 0, 0, -1 };
+    sscanf(linha.c_str(), "Ciclo %u: acordado %u ms", &c.numero, &c.acordadoMs);
+    size_t e = linha.find(" amostras enviadas, despertar->publish ");
+    if (e != std::string::npos) {
+      c.enviadas = atoi(linha.c_str() + linha.rfind(' ', e - 1) + 1);
+      c.despertarParaPublishMs = atol(linha.c_str() + e + strlen(" amostras enviadas, despertar->publish "));
+    }
+    v.push_back(c);
+  }
+  return v;
+}
+
+// Instantes (ms) das leituras publicadas, como em teste_fila
+static std::vector<int64_t> instantes() {
+  std::vector<int64_t> v;
+  for (const sim::Mensagem& m : sim::broker.recebidas) {
+    if (m.topico != topic_publish || m.payload.find(';') == std::string::npos) continue;
+    v.push_back(m.us / 1000 - strtol(m.payload.c_str() + m.payload.find(';') + 1, NULL, 10));
+  }
+  return v;
+}
+
+int main() {
+  sim::sensor = [](uint8_t, uint64_t us) { return 3000 - (int)(us / 60000000 % 100); };
+  sim::ligar(setup, loopNunca);
+
+  puts("ciclos de deep sleep:");
+  sim::rodar((uint64_t)DEEP_SLEEP_K * 3 * DEEP_SLEEP_INTERVALO + DEEP_SLEEP_INTERVALO / 2);
+  std::vector<Ciclo> c = ciclos();
+  VERIFICA(sim::boots == DEEP_SLEEP_K * 3 + 1 && despertares == sim::boots, "um despertar por minuto (%u boots)", sim::boots);
+  VERIFICA(c.size() == sim::boots && c.back().numero == despertares, "cada ciclo imprime o seu relatório (%zu)", c.size());
+  VERIFICA(sim::wifi.inicios == 3, "Wi-Fi só a cada %d despertares (%u inícios)", DEEP_SLEEP_K, sim::wifi.inicios);
+  VERIFICA(sim::broker.conexoes == 3, "broker só a cada %d despertares (%u conexões)", DEEP_SLEEP_K, sim::broker.conexoes);
+  uint32_t maiorSemRede = 0;
+  for (const Ciclo& x : c)
+    if (x.numero % DEEP_SLEEP_K) maiorSemRede = std::max(maiorSemRede, x.acordadoMs);
+  VERIFICA(maiorSemRede <= 20, "sem rede fica acordado só para ler o sensor (máximo %u ms)", maiorSemRede);
+
+  puts("conexao rapida pela RTC:");
+  VERIFICA(redeCache.valido && redeCache.canal == 6, "BSSID, canal e IP guardados na RTC");
+  VERIFICA(sim::wifi.iniciosRapidos == 2 && sim::wifi.iniciosEstaticos == 2, "2ª e 3ª conexões sem varredura e sem DHCP");
+  // + 5 ms: o sketch confere o status com delay(5)
+  VERIFICA(sim::wifi.ultimaConexaoMs <= sim::wifi.associacaoMs + 5, "Wi-Fi em %llu ms (só a associação)",
+           (unsigned long long)sim::wifi.ultimaConexaoMs);
+  const Ciclo& primeiro = c[DEEP_SLEEP_K - 1];
+  const Ciclo& terceiro = c[3 * DEEP_SLEEP_K - 1];
+  printf("         despertar->publish: %ld ms na 1a conexao, %ld ms com o cache | acordado %u e %u ms\n",
+         primeiro.despertarParaPublishMs, terceiro.despertarParaPublishMs, primeiro.acordadoMs, terceiro.acordadoMs);
+  uint32_t rapida = sim::wifi.associacaoMs + sim::broker.conexaoMs;
+  VERIFICA(terceiro.despertarParaPublishMs >= (long)rapida && terceiro.despertarParaPublishMs <= (long)rapida + 20,
+           "despertar->publish com o cache: Wi-Fi + broker (%ld ms)", terceiro.despertarParaPublishMs);
+  VERIFICA(primeiro.despertarParaPublishMs - terceiro.despertarParaPublishMs >= (long)(sim::wifi.varreduraMs + sim::wifi.dhcpMs),
+           "o cache economiza a varredura e o DHCP");
+  VERIFICA(terceiro.acordadoMs < DEEP_SLEEP_INTERVALO / 100, "ciclo com envio acordado %u ms", terceiro.acordadoMs);
+
+  puts("leituras:");
+  std::vector<int64_t> v = instantes();
+  bool passo = v.size() == 3 * DEEP_SLEEP_K;
+  for (size_t i = 1; i < v.size(); i++) passo = passo && llabs(v[i] - v[i - 1] - DEEP_SLEEP_INTERVALO) <= 20;
+  VERIFICA(passo, "%d leituras, uma a cada %d ms (%zu publicadas)", 3 * DEEP_SLEEP_K, DEEP_SLEEP_INTERVALO, v.size());
+  VERIFICA(totalNaFila() == 1 && amostrasPerdidas == 0, "nada perdido (fila %u, perdidas %lu)", totalNaFila(),
+           (unsigned long)amostrasPerdidas);
+
+  puts("AP mudou de canal (cache invalido):");
+  sim::wifi.canal = 11;
+  uint32_t inicios = sim::wifi.inicios;
+  sim::rodar((uint64_t)DEEP_SLEEP_K * DEEP_SLEEP_INTERVALO);
+  VERIFICA(sim::contar("descartando cache") == 1 && !redeCache.valido, "desiste em %d ms e descarta o cache",
+           DEEP_SLEEP_WIFI_TIMEOUT);
+  c = ciclos();
+  VERIFICA(c[4 * DEEP_SLEEP_K - 1].acordadoMs >= DEEP_SLEEP_WIFI_TIMEOUT, "esse ciclo ficou %u ms acordado",
+           c[4 * DEEP_SLEEP_K - 1].acordadoMs);
+  sim::rodar((uint64_t)DEEP_SLEEP_K * DEEP_SLEEP_INTERVALO);
+  uint32_t normal = sim::wifi.varreduraMs + sim::wifi.associacaoMs + sim::wifi.dhcpMs;
+  VERIFICA(sim::wifi.inicios == inicios + 2 && sim::wifi.ultimaConexaoMs >= normal && sim::wifi.ultimaConexaoMs <= normal + 5,
+           "no ciclo seguinte conecta do jeito normal (%llu ms)", (unsigned long long)sim::wifi.ultimaConexaoMs);
+  VERIFICA(redeCache.valido && redeCache.canal == 11, "e guarda o canal novo");
+  v = instantes();
+  VERIFICA(v.size() == 5 * DEEP_SLEEP_K && amostrasPerdidas == 0, "as leituras do ciclo sem Wi-Fi saem no seguinte (%zu)",
+           v.size());
+
+  puts("comandos:");
+  Configuracao cfg = configuracaoAtual();
+  const char* cmd = "I=5000";
+  VERIFICA(interpretarComando((const byte*)cmd, strlen(cmd), cfg) == 'I' && intervaloAmostragem.load() == DEEP_SLEEP_INTERVALO,
+           "I= recusado: o período é o do timer da RTC (%lu ms)", (unsigned long)intervaloAmostragem.load());
+  cfg = configuracaoAtual();
+  cmd = "B=8;E=1";
+  VERIFICA(interpretarComando((const byte*)cmd, strlen(cmd), cfg) == 0 && cfg.lote == 8 && cfg.excecao,
+           "os outros ajustes continuam aceitos");
+
+  return fimDosTestes();
+}
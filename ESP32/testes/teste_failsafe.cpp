@@ -0,0 +1,149 @@
+// Motor Bluetooth: failsafe quando o link cai, com o motor CC (motor_cc.h) a
+// 100%. Celular fora do alcance (os pacotes do RemoteXY param: batimento),
+// celular que desconecta (ESP_GATTS_DISCONNECT_EVT), parada medida no encoder
+// em malha fechada e estimada sem encoder, e os parâmetros de conexão pedidos
+// ao Android e ao iPhone.
+//
+//   build/teste_failsafe
+#define MODO_MALHA_FECHADA 1
+#include "../2. Motor Bluetooth.i/MotorBluetooth2.i.ino"
+#include "motor_cc.h"
+#include "teste.h"
+
+static std::string controles(uint8_t ligado, uint8_t sentido, int8_t velocidade) {
+  return std::string{ (char)ligado, (char)sentido, (char)velocidade };
+}
+
+// Novo boot com o app conectado e o motor a 100%
+static void ligarA100(MotorCC& motor) {
+  motor.w = motor.corrente = 0;
+  sim::ligar(setup, loop);
+  motor.ligar();
+  sim::rodar(500);
+  sim::ble.controles(controles(0, 0, 0));
+  sim::ble.conectar();
+  sim::rodarAte([]() { return RemoteXY.connect_flag == 1; }, 5000);
+  sim::ble.controles(controles(1, 0, 100));
+  sim::rodar(2000);
+}
+
+// Desliga o motor antes de reiniciar (as variáveis do sketch continuam na memória do PC)
+static void desligarMotor() {
+  sim::ble.controles(controles(0, 0, 0));
+  sim::rodar(500);
+  sim::ble.desconectar();
+  sim::rodar(500);
+  sim::desligar();
+}
+
+struct Parada {
+  bool impressa = false;
+  std::string linha;
+  float detectadoMs = -1, paradoMs = -1; // como o sketch imprimiu (a partir da queda ou do último pacote)
+  double rpmNaParada = -1;               // rotação de verdade quando o sketch marcou a parada
+  double realMs = -1;                    // do mesmo ponto até o motor de verdade ficar abaixo de RPM_PARADO
+};
+
+// Provoca a queda e espera a linha FAILSAFE do Monitor Serial
+static Parada medirParada(MotorCC& motor, void (*queda)()) {
+  Parada p;
+  size_t desde = sim::serial.size();
+  int64_t realUs = -1;
+  bool marcada = false;
+  int amostrador = sim::aCada(100, [&]() {
+    if (realUs < 0 && failsafe.load() && fabs(motor.rpm()) < RPM_PARADO) realUs = esp_timer_get_time();
+    if (!marcada && paradoFailsafe.load()) {
+      marcada = true;
+      p.rpmNaParada = fabs(motor.rpm());
+    }
+  });
+  queda();
+  p.impressa = sim::rodarAte([desde]() { return sim::contar("FAILSAFE", desde) > 0; }, 8000);
+  sim::rodar(300);
+  sim::cancelar(amostrador);
+  if (!p.impressa) return p;
+  size_t inicio = sim::serial.find("FAILSAFE", desde);
+  p.linha = sim::serial.substr(inicio, sim::serial.find('\n', inicio) - inicio);
+  sscanf(p.linha.c_str() + p.linha.find("detectado em"), "detectado em %f ms, motor parado em %f", &p.detectadoMs, &p.paradoMs);
+  if (realUs >= 0) p.realMs = (realUs - (int64_t)instanteReferencia.load()) / 1000.0;
+  printf("         %s\n", p.linha.c_str());
+  return p;
+}
+
+int main() {
+  MotorCC motor(pinoIN1, pinoIN2, pinoENA);
+
+  puts("Android: parâmetros de conexão:");
+  ligarA100(motor);
+  VERIFICA(malhaFechada.load() && motor.rpm() > 190, "motor a %.0f RPM em malha fechada", motor.rpm());
+  VERIFICA(sim::ble.pedidosParametros == 1 && sim::ble.parametrosRecusados == 0, "pede os parâmetros uma vez e o celular aceita");
+  VERIFICA(sim::ble.supervisaoAtualMs == SUPERVISAO_CONEXAO_MS && sim::ble.intervaloAtualMs == 30,
+           "supervisão de 5 s para %u ms, intervalo %u ms", sim::ble.supervisaoAtualMs, sim::ble.intervaloAtualMs);
+
+  puts("celular sai do alcance (malha fechada):");
+  uint64_t quedaUs = sim::agora();
+  Parada p = medirParada(motor, []() { sim::ble.perderSinal(); });
+  VERIFICA(p.impressa && p.linha.find("sem heartbeat") != std::string::npos, "detectado pela falta de pacotes do app");
+  VERIFICA(p.detectadoMs >= PRAZO_HEARTBEAT_MS && p.detectadoMs <= PRAZO_HEARTBEAT_MS + PERIODO_SUPERVISOR_US / 1000.0 + 1,
+           "%.1f ms depois do último pacote (prazo %d ms)", p.detectadoMs, PRAZO_HEARTBEAT_MS);
+  VERIFICA(p.linha.find("medido no encoder") != std::string::npos && p.paradoMs <= PRAZO_PARADA_MS,
+           "parada medida no encoder em %.1f ms", p.paradoMs);
+  VERIFICA(p.rpmNaParada < RPM_PARADO + 5 && p.realMs >= 0 && fabs(p.paradoMs - p.realMs) <= JANELA_VELOCIDADE + 2,
+           "o motor de verdade estava a %.1f RPM (abaixo de %d em %.1f ms)", p.rpmNaParada, RPM_PARADO, p.realMs);
+  VERIFICA(sim::ble.conectado, "o DISCONNECT ainda não chegou (supervisão de %u ms)", sim::ble.supervisaoAtualMs);
+  sim::rodarAte([]() { return linkCaiu.load(); }, 3000);
+  double desconexaoMs = (sim::agora() - quedaUs) / 1000.0;
+  VERIFICA(linkCaiu.load() && desconexaoMs >= SUPERVISAO_CONEXAO_MS && desconexaoMs < SUPERVISAO_CONEXAO_MS + 100,
+           "DISCONNECT pela supervisão em %.0f ms (linkCaiu)", desconexaoMs);
+  VERIFICA(sim::contar("FAILSAFE") == 1, "uma linha por parada");
+
+  puts("reconecta com o Power ligado e depois desligado:");
+  size_t desde = sim::serial.size();
+  sim::ble.controles(controles(1, 0, 100));
+  sim::ble.conectar();
+  sim::rodarAte([]() { return RemoteXY.connect_flag == 1; }, 5000);
+  sim::rodar(1000);
+  VERIFICA(failsafe.load() && fabs(motor.rpm()) < RPM_PARADO, "com o Power ligado no app o motor não volta sozinho");
+  sim::ble.controles(controles(0, 0, 0));
+  sim::rodar(500);
+  VERIFICA(!failsafe.load() && sim::contar("Failsafe desarmado", desde) == 1, "desarma com o Power em desligado");
+
+  puts("celular desconecta (malha fechada):");
+  sim::ble.controles(controles(1, 0, 100));
+  sim::rodar(2000);
+  p = medirParada(motor, []() { sim::ble.desconectar(); });
+  VERIFICA(p.impressa && p.linha.find("conexao caiu") != std::string::npos, "detectado pelo DISCONNECT do handler GATT");
+  VERIFICA(p.detectadoMs <= PERIODO_SUPERVISOR_US / 1000.0 + 1, "%.1f ms depois do DISCONNECT", p.detectadoMs);
+  VERIFICA(p.linha.find("medido no encoder") != std::string::npos && p.paradoMs <= PRAZO_PARADA_MS &&
+             fabs(p.paradoMs - p.realMs) <= JANELA_VELOCIDADE + 2,
+           "parada medida em %.1f ms (motor de verdade: %.1f ms)", p.paradoMs, p.realMs);
+  desligarMotor();
+
+  puts("sem encoder (malha aberta):");
+  sim::ble = sim::Ble();
+  sim::pcnt.semUnidade = true;
+  ligarA100(motor);
+  VERIFICA(!malhaFechada.load() && motor.rpm() > 190, "motor a %.0f RPM em malha aberta", motor.rpm());
+  p = medirParada(motor, []() { sim::ble.perderSinal(); });
+  VERIFICA(p.impressa && p.linha.find("sem heartbeat") != std::string::npos &&
+             p.linha.find("estimado, sem encoder") != std::string::npos,
+           "a parada entra como estimada");
+  VERIFICA(p.paradoMs <= PRAZO_PARADA_MS && p.realMs >= 0, "motor de verdade parado em %.1f ms (estimado: %.1f ms)", p.realMs,
+           p.paradoMs);
+  sim::pcnt.semUnidade = false;
+  sim::rodar(6000); // supervisão de 2 s
+  desligarMotor();
+
+  puts("iPhone (supervisão de 720 ms, recusa menos de 2 s):");
+  sim::ble = sim::Ble();
+  sim::ble.supervisaoMs = 720;
+  sim::ble.supervisaoMinimaMs = 2000;
+  sim::ble.mtuCelular = 185;
+  ligarA100(motor);
+  VERIFICA(sim::ble.pedidosParametros == 0 && sim::ble.supervisaoAtualMs == 720, "não pede: a supervisão já é menor que 2 s");
+  p = medirParada(motor, []() { sim::ble.perderSinal(); });
+  VERIFICA(p.impressa && p.linha.find("sem heartbeat") != std::string::npos && p.paradoMs <= PRAZO_PARADA_MS,
+           "o batimento pega a queda antes da supervisão");
+  desligarMotor();
+  return fimDosTestes();
+}
@@ -0,0 +1,201 @@
+// Store-and-forward do sensorDeChuvaMQTT: derruba o broker por N minutos e
+// confere, pelo instante de cada leitura (chegada no broker - idade), que
+// nenhuma se perdeu, nenhuma chegou duas vezes, a ordem foi mantida e o
+// período entre leituras não mudou durante a queda e a reconexão. Por último
+// trava a tarefa de rede num publish e confere a fila SPSC e a amostragem.
+#include "../1. Detector de Chuva com ESP32 e MQTT/sensorDeChuvaMQTT/sensorDeChuvaMQTT.ino"
+#include "chuva_sintetica.h"
+#include "teste.h"
+
+// Instante (ms, relógio do sistema) de cada leitura publicada a partir da mensagem "desde"
+static std::vector<int64_t> instantes(size_t desde) {
+  std::vector<int64_t> v;
+  for (size_t i = desde; i < sim::broker.recebidas.size(); i++) {
+    const sim::Mensagem& m = sim::broker.recebidas[i];
+    if (m.topico != topic_publish || m.payload.empty()) continue;
+    const uint8_t* p = (const uint8_t*)m.payload.data();
+    int64_t chegada = m.us / 1000;
+    if (p[0] == QUADRO_MARCADOR) {
+      uint16_t periodo = p[2] | (p[3] << 8);
+      uint32_t idade = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+      for (int n = 0; n < p[1]; n++) v.push_back(chegada - idade + (int64_t)n * periodo);
+    } else if (m.payload.find(';') != std::string::npos) {
+      v.push_back(chegada - strtol(m.payload.c_str() + m.payload.find(';') + 1, NULL, 10));
+    }
+  }
+  return v;
+}
+
+// Buracos na sequência: retorna quantas leituras faltam entre a primeira e a última
+// (e conta repetidas/fora de ordem em "erradas")
+static long buracos(const std::vector<int64_t>& v, int64_t periodo, long* erradas) {
+  long faltando = 0;
+  *erradas = 0;
+  for (size_t i = 1; i < v.size(); i++) {
+    int64_t passo = v[i] - v[i - 1];
+    if (passo < periodo / 2) (*erradas)++;
+    else faltando += (passo + periodo / 2) / periodo - 1;
+  }
+  return faltando;
+}
+
+// Maior desvio (ms) do passo entre leituras feitas de "deMs" a "ateMs" para o
+// período; em "n" quantos passos entraram na conta
+static int64_t maiorDesvio(const std::vector<int64_t>& v, int64_t deMs, int64_t ateMs, int64_t periodo, size_t* n) {
+  int64_t pior = 0;
+  *n = 0;
+  for (size_t i = 1; i < v.size(); i++) {
+    if (v[i - 1] < deMs || v[i] > ateMs) continue;
+    pior = std::max(pior, (int64_t)llabs(v[i] - v[i - 1] - periodo));
+    (*n)++;
+  }
+  return pior;
+}
+
+// Maior número de publicações em topic_publish dentro de qualquer janela de 1 s
+static size_t picoPorSegundo(size_t desde) {
+  std::vector<uint64_t> t;
+  for (size_t i = desde; i < sim::broker.recebidas.size(); i++)
+    if (sim::broker.recebidas[i].topico == topic_publish) t.push_back(sim::broker.recebidas[i].us);
+  size_t pico = 0;
+  for (size_t i = 0, j = 0; i < t.size(); i++) {
+    while (t[i] - t[j] >= 1000000) j++;
+    pico = std::max(pico, i - j + 1);
+  }
+  return pico;
+}
+
+// Maiores valores das linhas do relatorioTempos() a partir de "desde": a etapa de
+// amostragem (desvio do timer e bloco do ADC, us) e a espera na fila SPSC (ms)
+struct Tempos {
+  uint32_t relatorios, desvioTimer, blocoAdc, esperaSpsc;
+};
+
+static Tempos maximosRelatorio(size_t desde) {
+  Tempos t = { 0, 0, 0, 0 };
+  for (size_t i = sim::serial.find("desvio timer max", desde); i != std::string::npos;
+       i = sim::serial.find("desvio timer max", i + 1)) {
+    unsigned long d = 0, b = 0, e = 0;
+    if (sscanf(sim::serial.c_str() + i, "desvio timer max %lu us | bloco ADC max %lu us | espera SPSC max %lu", &d, &b, &e) != 3)
+      continue;
+    t.relatorios++;
+    t.desvioTimer = std::max<uint32_t>(t.desvioTimer, d);
+    t.blocoAdc = std::max<uint32_t>(t.blocoAdc, b);
+    t.esperaSpsc = std::max<uint32_t>(t.esperaSpsc, e);
+  }
+  return t;
+}
+
+// Um publish preso no socket por "segundos": a tarefa de rede para, a de amostragem não
+static void travarRede(uint32_t segundos) {
+  sim::broker.travarMs = segundos * 1000;
+  sim::rodarAte([]() { return sim::broker.travarMs == 0; }, segundos * 1000 + 10000); // o mock zera ao soltar
+  // Espera a tarefa de rede esvaziar as filas e imprimir o relatório com a espera na SPSC
+  sim::rodarAte([]() { return totalNaFila() == 0; }, 5 * 60 * 1000);
+  sim::rodar(RELATORIO_TEMPOS + 1000);
+}
+
+static void queda(uint64_t minutos) {
+  uint64_t fim = sim::agora() + minutos * 60000000ull;
+  sim::broker.disponivel = false;
+  sim::em(fim, []() { sim::broker.disponivel = true; });
+  sim::rodar(minutos * 60000);
+}
+
+int main(int argc, char** argv) {
+  uint64_t minutosQueda = argc > 1 ? strtoull(argv[1], NULL, 10) : 60; // ex.: build/teste_fila 80
+  ChuvaSintetica chuva(11);
+  sim::sensor = [&chuva](uint8_t, uint64_t us) { return chuva(us); };
+  sim::ligar(setup, loop);
+  sim::rodar(10 * 60 * 1000);
+
+  printf("queda de %llu min (formato texto):\n", (unsigned long long)minutosQueda);
+  size_t inicio = sim::broker.recebidas.size();
+  int64_t inicioQuedaMs = sim::agora() / 1000;
+  queda(minutosQueda);
+  size_t durante = 0;
+  for (size_t i = inicio; i < sim::broker.recebidas.size(); i++) durante += sim::broker.recebidas[i].topico == topic_publish;
+  VERIFICA(durante == 0, "nada publicado com o broker fora");
+  VERIFICA((uint64_t)totalNaFila() + 2 >= minutosQueda * 30, "a fila guardou a queda toda (%u leituras)", totalNaFila());
+  VERIFICA(sim::rodarAte([]() { return totalNaFila() == 0; }, 5 * 60 * 1000), "a fila esvazia depois que o broker volta");
+  int64_t fimDrenoMs = sim::agora() / 1000;
+  sim::rodar(60 * 1000);
+
+  std::vector<int64_t> v = instantes(0);
+  // A amostragem não pode sentir as tentativas de reconexão nem a drenagem da fila
+  size_t passos;
+  int64_t desvio = maiorDesvio(v, inicioQuedaMs, fimDrenoMs, MSG_INTERVAL, &passos);
+  VERIFICA(passos + 2 >= (size_t)((fimDrenoMs - inicioQuedaMs) / MSG_INTERVAL) && desvio <= 5,
+           "leituras a cada %d ms ± 5 com o broker fora e reconectando (%zu passos, pior %lld ms)", MSG_INTERVAL, passos,
+           (long long)desvio);
+  long erradas;
+  long faltando = buracos(v, MSG_INTERVAL, &erradas);
+  VERIFICA(faltando == 0 && amostrasPerdidas == 0, "nenhuma leitura perdida (%ld faltando, %lu descartadas)", faltando,
+           (unsigned long)amostrasPerdidas);
+  VERIFICA(erradas == 0, "sem repetidas e em ordem (%ld)", erradas);
+  // + 1: o "Conectado!" sai junto com a primeira rodada
+  size_t pico = picoPorSegundo(inicio), limite = DRENO_POR_RODADA * 1000 / DRENO_INTERVALO;
+  VERIFICA(pico <= limite + 1, "drenagem limitada a %zu mensagens/s (pico %zu)", limite, pico);
+  VERIFICA(sim::broker.conexoes == 2, "uma reconexão (%u conexões)", sim::broker.conexoes);
+
+  puts("queda de 30 min no modo lote (B=16):");
+  sim::broker.publicar(topic_subscribe, "B=16");
+  sim::rodar(2 * 60 * 1000);
+  inicio = sim::broker.recebidas.size();
+  queda(30);
+  VERIFICA(sim::rodarAte([]() { return totalNaFila() < 16; }, 5 * 60 * 1000), "os quadros saem depois que o broker volta");
+  sim::rodar(60 * 1000);
+  v = instantes(inicio);
+  faltando = buracos(v, MSG_INTERVAL, &erradas);
+  VERIFICA(v.size() >= 30 * 30 && faltando == 0 && erradas == 0, "quadros contínuos (%zu leituras, %ld faltando, %ld erradas)",
+           v.size(), faltando, erradas);
+
+  puts("queda maior que as duas camadas da fila (100 min):");
+  sim::broker.publicar(topic_subscribe, "B=1");
+  sim::rodar(2 * 60 * 1000);
+  inicio = sim::broker.recebidas.size();
+  queda(100);
+  unsigned long descartadas = amostrasPerdidas;
+  VERIFICA(totalNaFila() == TAM_FILA_RAM + TAM_FILA_RTC, "RAM e RTC cheias (%u)", totalNaFila());
+  VERIFICA(descartadas + 2 >= 100 * 30 - (TAM_FILA_RAM + TAM_FILA_RTC) && descartadas <= 100 * 30 - (TAM_FILA_RAM + TAM_FILA_RTC) + 2, "descarta só o excesso (%lu)", descartadas);
+  sim::rodarAte([]() { return totalNaFila() == 0; }, 5 * 60 * 1000);
+  v = instantes(inicio);
+  faltando = buracos(v, MSG_INTERVAL, &erradas);
+  VERIFICA(faltando == 0 && erradas == 0 && v.size() >= TAM_FILA_RAM + TAM_FILA_RTC,
+           "chegam as %d mais novas, sem buraco (%zu leituras, %ld faltando)", TAM_FILA_RAM + TAM_FILA_RTC, v.size(),
+           faltando);
+
+  puts("tarefa de rede presa num publish:");
+  const uint32_t curta = TAM_SPSC * MSG_INTERVAL / 1000 / 2, longa = TAM_SPSC * MSG_INTERVAL / 1000 + 72;
+  spscPico = 0;
+  spscDescartes = 0;
+  // + 1: a idade do publish preso foi escrita antes de travar, então o instante dele sai errado
+  inicio = sim::broker.recebidas.size() + 1;
+  size_t desde = sim::serial.size();
+  travarRede(curta);
+  Tempos t = maximosRelatorio(desde);
+  v = instantes(inicio);
+  faltando = buracos(v, MSG_INTERVAL, &erradas);
+  printf("         %u s: SPSC pico %u/%d, descartes %u | espera SPSC max %u ms, desvio timer max %u us, bloco ADC max %u us\n",
+         curta, spscPico.load(), TAM_SPSC, spscDescartes.load(), t.esperaSpsc, t.desvioTimer, t.blocoAdc);
+  VERIFICA(t.relatorios > 0 && t.esperaSpsc >= (curta - 2) * 1000, "a rede ficou parada (espera na SPSC de %u ms)", t.esperaSpsc);
+  VERIFICA(spscPico.load() >= curta * 1000 / MSG_INTERVAL - 1 && spscPico.load() < TAM_SPSC && spscDescartes.load() == 0,
+           "%u s cabem na fila SPSC (pico %u de %d)", curta, spscPico.load(), TAM_SPSC);
+  VERIFICA(faltando == 0 && erradas == 0, "nenhuma leitura perdida (%ld faltando, %ld erradas)", faltando, erradas);
+  VERIFICA(t.desvioTimer <= 1000 && t.blocoAdc <= 1000, "a amostragem não sente a rede parada (desvio %u us, bloco %u us)",
+           t.desvioTimer, t.blocoAdc);
+
+  spscPico = 0;
+  desde = sim::serial.size();
+  travarRede(longa);
+  t = maximosRelatorio(desde);
+  uint32_t excesso = longa * 1000 / MSG_INTERVAL - TAM_SPSC;
+  printf("         %u s: SPSC pico %u/%d, descartes %u | espera SPSC max %u ms, desvio timer max %u us, bloco ADC max %u us\n",
+         longa, spscPico.load(), TAM_SPSC, spscDescartes.load(), t.esperaSpsc, t.desvioTimer, t.blocoAdc);
+  VERIFICA(spscPico.load() == TAM_SPSC && spscDescartes.load() + 2 >= excesso && spscDescartes.load() <= excesso + 2,
+           "%u s: a fila SPSC enche e descarta só o excesso (%u, esperado ~%u)", longa, spscDescartes.load(), excesso);
+  VERIFICA(t.relatorios > 0 && t.desvioTimer <= 1000 && t.blocoAdc <= 1000,
+           "e a amostragem continua no horário (desvio %u us, bloco %u us)", t.desvioTimer, t.blocoAdc);
+
+  return fimDosTestes();
+}
@@ -0,0 +1,125 @@
+// Filtro do ADC do sensorDeChuvaMQTT (mediana móvel + média do período) com
+// formas de onda conhecidas, e a cadeia inteira (DMA -> filtro -> publicação)
+// no simulador.
+//
+//   build/teste_filtro                 testes
+//   build/teste_filtro gravacao.txt    passa uma gravação pelo filtro (uma
+//                                      leitura crua 0-4095 por linha, a 20 kHz)
+#include "../1. Detector de Chuva com ESP32 e MQTT/sensorDeChuvaMQTT/sensorDeChuvaMQTT.ino"
+#include <random>
+#include "chuva_sintetica.h"
+#include "teste.h"
+
+const int BLOCOS_POR_PERIODO = ADC_FREQUENCIA / ADC_CONVERSOES_POR_BLOCO * MSG_INTERVAL / 1000; // 200
+
+// Passa um período de blocos pelo filtro e devolve o valor do período
+static int periodo(const std::function<int(int)>& bloco) {
+  for (int i = 0; i < BLOCOS_POR_PERIODO; i++) filtroEntrada(bloco(i));
+  int valor = -1;
+  filtroFecharPeriodo(&valor);
+  return valor;
+}
+
+static double desvio(const std::vector<int>& v) {
+  double media = 0, m2 = 0;
+  for (int x : v) media += x;
+  media /= v.size();
+  for (int x : v) m2 += (x - media) * (x - media);
+  return sqrt(m2 / (v.size() - 1));
+}
+
+// Gravação crua: média de cada ADC_CONVERSOES_POR_BLOCO leituras vira um bloco
+static int passarGravacao(const char* arquivo) {
+  FILE* f = fopen(arquivo, "r");
+  if (!f) sim::falhar("não abriu %s", arquivo);
+  long soma = 0, conversoes = 0, blocos = 0;
+  int leitura;
+  while (fscanf(f, "%d", &leitura) == 1) {
+    soma += leitura;
+    if (++conversoes % ADC_CONVERSOES_POR_BLOCO) continue;
+    filtroEntrada(soma / ADC_CONVERSOES_POR_BLOCO);
+    soma = 0;
+    if (++blocos % BLOCOS_POR_PERIODO) continue;
+    int valor;
+    filtroFecharPeriodo(&valor);
+    printf("%.1f s: nivel %d | ruido %.2f LSB, pico-a-pico %u, %.1f bits efetivos\n", blocos / 100.0, 4095 - valor,
+           ruidoBloco.load(), picoAPico.load(), bitsEfetivos.load());
+  }
+  fclose(f);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) return passarGravacao(argv[1]);
+  std::mt19937 gerador(5);
+  filtroReiniciar();
+
+  puts("sinal constante:");
+  VERIFICA(periodo([](int) { return 2000; }) == 2000, "sai o próprio valor");
+  VERIFICA(ruidoBloco.load() == 0 && bitsEfetivos.load() == 12, "sem ruído: 12 bits efetivos");
+  VERIFICA(blocosPorPeriodo.load() == (uint32_t)BLOCOS_POR_PERIODO, "%d blocos por período", BLOCOS_POR_PERIODO);
+
+  puts("picos isolados:");
+  // Um bloco em cada 7 leva um pico de 400 LSB (interferência): a mediana de 5 remove todos
+  int comPicos = periodo([](int i) { return i % 7 == 3 ? 2400 : 2000; });
+  VERIFICA(comPicos == 2000, "a mediana remove picos isolados (%d)", comPicos);
+  VERIFICA(picoAPico.load() == 0, "nenhum pico chega na média (pico-a-pico %u)", picoAPico.load());
+  // Dois blocos seguidos ainda são minoria na janela de 5; três já são o sinal
+  periodo([](int) { return 2000; }); // o último bloco do período anterior foi um pico
+  VERIFICA(periodo([](int i) { return i % 10 < 2 ? 2400 : 2000; }) == 2000, "dois blocos seguidos também somem");
+
+  puts("degrau no meio do periodo:");
+  int degrau = periodo([](int i) { return i < BLOCOS_POR_PERIODO / 2 ? 1000 : 3000; });
+  VERIFICA(abs(degrau - 2000) <= 10, "média dos dois patamares (%d)", degrau);
+  VERIFICA(periodo([](int) { return 3000; }) == 3000, "o período seguinte já está no patamar novo");
+
+  puts("ruido gaussiano:");
+  std::normal_distribution<double> ruido(0, 6);
+  std::vector<int> saidas;
+  double ruidoMedio = 0, bitsMedios = 0;
+  periodo([&](int) { return (int)lround(2000 + ruido(gerador)); }); // tira o patamar de 3000 da janela da mediana
+  for (int p = 0; p < 400; p++) {
+    saidas.push_back(periodo([&](int) { return (int)lround(2000 + ruido(gerador)); }));
+    ruidoMedio += ruidoBloco.load() / 400;
+    bitsMedios += bitsEfetivos.load() / 400;
+  }
+  double sigmaSaida = desvio(saidas);
+  double bitsMedidos = log2(4096 / (std::max(sigmaSaida, 0.29) * sqrt(12.0)));
+  printf("         sigma dos blocos 6 LSB -> ruido medido %.2f LSB, saida %.2f LSB (%.1f bits), estimado %.1f bits\n", ruidoMedio,
+         sigmaSaida, bitsMedidos, bitsMedios);
+  VERIFICA(ruidoMedio > 3 && ruidoMedio < 6, "ruído entre blocos medido depois da mediana (%.2f LSB)", ruidoMedio);
+  VERIFICA(sigmaSaida < 1, "o valor do período varia menos de 1 LSB (%.2f)", sigmaSaida);
+  VERIFICA(fabs(bitsMedios - bitsMedidos) < 0.5, "bits efetivos estimados batem com o medido (%.1f x %.1f)", bitsMedios,
+           bitsMedidos);
+
+  puts("cadeia inteira no simulador:");
+  ChuvaSintetica chuva(21);
+  chuva.chuvasPorDia = 24;
+  sim::sensor = [&chuva](uint8_t, uint64_t us) { return chuva(us); };
+  sim::adcAmostrasPorBloco = 20; // cada bloco é a média de 20 leituras espalhadas nele (200 no ESP32: fica lento)
+  memset(&filtro, 0, sizeof(filtro)); // a janela da mediana começa vazia, como no boot
+  sim::ligar(setup, loop);
+  sim::rodar(6ull * 3600 * 1000);
+  // Cada leitura publicada comparada com o nível verdadeiro (sem ruído) no meio do período
+  double erroMaximo = 0, erroQuadratico = 0;
+  size_t n = 0;
+  for (const sim::Mensagem& m : sim::broker.recebidas) {
+    if (m.topico != topic_publish || m.payload.find(';') == std::string::npos) continue;
+    double instante = (m.us / 1000 - atol(m.payload.c_str() + m.payload.find(';') + 1)) / 1000.0;
+    double verdadeiro = 0;
+    for (int k = 0; k < 20; k++) verdadeiro += chuva.molhado(instante - MSG_INTERVAL / 1000.0 * (k + 0.5) / 20) / 20;
+    double erro = atoi(m.payload.c_str()) - verdadeiro;
+    erroMaximo = std::max(erroMaximo, fabs(erro));
+    erroQuadratico += erro * erro;
+    n++;
+  }
+  erroQuadratico = sqrt(erroQuadratico / std::max<size_t>(n, 1));
+  printf("         %zu leituras, %zu chuvas: erro RMS %.2f LSB, maximo %.1f LSB\n", n, chuva.quantidadeChuvas(), erroQuadratico,
+         erroMaximo);
+  VERIFICA(n >= 10700, "publicou as leituras (%zu)", n);
+  VERIFICA(erroQuadratico < 2, "erro RMS contra o nível verdadeiro abaixo de 2 LSB (%.2f)", erroQuadratico);
+  VERIFICA(erroMaximo < 5, "nenhuma leitura longe do nível verdadeiro (máximo %.1f LSB)", erroMaximo);
+  VERIFICA(periodosSemAdc.load() == 0, "nenhum período sem blocos do DMA");
+
+  return fimDosTestes();
+}
@@ -0,0 +1,71 @@
+// Modo lote do sensorDeChuvaMQTT: quantos bytes cada leitura custa na rede no
+// formato texto ("valor;idade") e no quadro binário 0xB1 com B=16. Conta os
+// PUBLISH que chegam ao broker do simulador (cabeçalho fixo, tópico e payload,
+// como saem no socket) durante N minutos de cada formato. É daqui que sai a
+// tabela do modo lote no README do sensor.
+//
+//   build/teste_lote [minutos]   (padrão 60)
+#include "../1. Detector de Chuva com ESP32 e MQTT/sensorDeChuvaMQTT/sensorDeChuvaMQTT.ino"
+#include "chuva_sintetica.h"
+#include "teste.h"
+
+#define BYTES_TCP_IP 40 // cabeçalhos IPv4 + TCP sem opções, um segmento por PUBLISH
+
+struct Contagem {
+  size_t mensagens = 0;
+  size_t leituras = 0;
+  uint64_t bytes = 0;
+};
+
+// Publicações de leituras em topic_publish a partir da mensagem "desde" (o "Conectado!" fica de fora)
+static Contagem contar(size_t desde) {
+  Contagem c;
+  for (size_t i = desde; i < sim::broker.recebidas.size(); i++) {
+    const sim::Mensagem& m = sim::broker.recebidas[i];
+    if (m.topico != topic_publish || m.payload.empty()) continue;
+    if ((uint8_t)m.payload[0] == QUADRO_MARCADOR) c.leituras += (uint8_t)m.payload[1];
+    else if (m.payload.find(';') != std::string::npos) c.leituras++;
+    else continue;
+    c.mensagens++;
+    c.bytes += m.bytes;
+  }
+  return c;
+}
+
+static Contagem medir(const char* nome, const char* comando, uint64_t minutos) {
+  sim::broker.publicar(topic_subscribe, comando);
+  sim::rodar(2 * 60 * 1000); // a troca de formato fica fora da medida
+  size_t desde = sim::broker.recebidas.size();
+  sim::rodar(minutos * 60 * 1000);
+  Contagem c = contar(desde);
+  printf("         %-8s %5zu mensagens, %5zu leituras, %7llu bytes MQTT | por leitura: %.3f mensagens, %.1f bytes MQTT, "
+         "%.1f com TCP/IP\n",
+         nome, c.mensagens, c.leituras, (unsigned long long)c.bytes, (double)c.mensagens / c.leituras,
+         (double)c.bytes / c.leituras, (double)(c.bytes + c.mensagens * BYTES_TCP_IP) / c.leituras);
+  return c;
+}
+
+int main(int argc, char** argv) {
+  uint64_t minutos = argc > 1 ? strtoull(argv[1], NULL, 10) : 60;
+  ChuvaSintetica chuva(3);
+  sim::sensor = [&chuva](uint8_t, uint64_t us) { return chuva(us); };
+  sim::ligar(setup, loop);
+  sim::rodarAte([]() { return sim::broker.conexoes == 1; }, 30 * 1000);
+
+  printf("%llu min em cada formato:\n", (unsigned long long)minutos);
+  Contagem texto = medir("texto", "B=1", minutos);
+  Contagem lote = medir("B=16", "B=16", minutos);
+
+  size_t esperadas = minutos * 60 * 1000 / MSG_INTERVAL;
+  VERIFICA(texto.leituras + 1 >= esperadas && lote.leituras + 16 >= esperadas && lote.leituras <= esperadas + 16,
+           "as mesmas ~%zu leituras nos dois (%zu e %zu)", esperadas, texto.leituras, lote.leituras);
+  VERIFICA(texto.mensagens == texto.leituras, "texto: uma mensagem por leitura");
+  VERIFICA(lote.leituras == lote.mensagens * 16, "lote: quadros cheios de 16 leituras");
+
+  double bytesTexto = (double)(texto.bytes + texto.mensagens * BYTES_TCP_IP) / texto.leituras;
+  double bytesLote = (double)(lote.bytes + lote.mensagens * BYTES_TCP_IP) / lote.leituras;
+  printf("         com TCP/IP: %.1fx menos bytes por leitura\n", bytesTexto / bytesLote);
+  VERIFICA(bytesTexto / bytesLote >= 8, "o lote gasta bem menos rede por leitura (%.1f contra %.1f bytes)", bytesLote,
+           bytesTexto);
+  return fimDosTestes();
+}
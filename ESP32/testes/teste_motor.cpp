@@ -0,0 +1,151 @@
+// Motor Bluetooth (MotorBluetooth2.i): latência do comando do app até a saída.
+// Um celular conecta pelo RemoteXY e liga/desliga o motor 100 vezes, com
+// sentido e velocidade sorteados (reconectando a cada 20); a latência vai da chegada do pacote com o
+// estado novo ao ESP32 até a primeira mudança em IN1/IN2. Compara o loop
+// antigo (tudo no loop() com delay(10), copiado abaixo) com o sketch atual
+// (loop acordado pelo handler GATT + tarefa da rampa), com o motor CC (motor_cc.h) nos pinos,
+// e conta as escritas repetidas em IN1/IN2 e ENA.
+//
+//   build/teste_motor
+#include "../2. Motor Bluetooth.i/MotorBluetooth2.i.ino"
+#include "motor_cc.h"
+#include "teste.h"
+
+#define COMANDOS 100
+
+// --- O SKETCH ANTES DA MUDANÇA (loop com delay(10), escreve os pinos sempre) ---
+void setupAntes() {
+  RemoteXY_Init();
+  Serial.begin(115200);
+  pinMode(pinoIN1, OUTPUT);
+  pinMode(pinoIN2, OUTPUT);
+  ledcAttach(pinoENA, 30000, 8);
+  pararMotor();
+  Serial.println("Sistema iniciado! Aguardando conexao Bluetooth...");
+}
+
+void loopAntes() {
+  RemoteXY_Handler();
+  if (RemoteXY.switch_power == 0) {
+    pararMotor();
+  } else {
+    int velocidade = RemoteXY.slider_vel * 2.55;
+    if (velocidade > 255) velocidade = 255;
+    if (velocidade < 0) velocidade = 0;
+    ledcWrite(pinoENA, velocidade);
+    if (RemoteXY.switch_sentido == 0) {
+      digitalWrite(pinoIN1, HIGH);
+      digitalWrite(pinoIN2, LOW);
+    } else {
+      digitalWrite(pinoIN1, LOW);
+      digitalWrite(pinoIN2, HIGH);
+    }
+  }
+  delay(10);
+}
+
+struct Medida {
+  std::vector<double> latencia; // ms
+  size_t semResposta = 0;
+  double escritasSentidoPorS = 0; // IN1 + IN2 com o comando parado
+  double escritasEnaPorS = 0;
+  uint32_t enaRepetidas = 0;      // ledcWrite em ENA com o mesmo duty que já estava
+};
+
+static uint32_t semente = 12345;
+static uint32_t sortear(uint32_t n) {
+  semente = semente * 1103515245 + 12345;
+  return (semente >> 16) % n;
+}
+
+static std::string controles(uint8_t ligado, uint8_t sentido, int8_t velocidade) {
+  return std::string{ (char)ligado, (char)sentido, (char)velocidade };
+}
+
+static Medida medir(void (*setupSketch)(), void (*loopSketch)(), MotorCC& motor) {
+  Medida m;
+  semente = 12345; // os mesmos comandos nos dois
+  sim::ligar(setupSketch, loopSketch);
+  motor.ligar();
+  sim::rodar(500);
+  sim::ble.controles(controles(0, 0, 0)); // o app abre com tudo desligado
+  sim::ble.conectar();
+  VERIFICA(sim::rodarAte([]() { return RemoteXY.connect_flag == 1; }, 5000), "o app conecta (connect_flag)");
+
+  // Latência: da chegada do pacote até IN1 ou IN2 mudar de verdade
+  bool esperando = false;
+  sim::aoEscreverPino = [&](uint8_t pino) {
+    if (pino == pinoENA && sim::pinos[pino].ultimaMudancaUs != sim::agora()) m.enaRepetidas++;
+    if (!esperando || (pino != pinoIN1 && pino != pinoIN2) || sim::pinos[pino].ultimaMudancaUs != sim::agora()) return;
+    if (!sim::ble.chegadaControlesUs) return; // ainda no rádio
+    m.latencia.push_back((sim::agora() - sim::ble.chegadaControlesUs) / 1000.0);
+    esperando = false;
+  };
+  for (int i = 0; i < COMANDOS; i++) {
+    bool ligar = i % 2 == 0;
+    std::string estado = ligar ? controles(1, sortear(2), 10 + sortear(91)) : controles(0, 0, 0);
+    esperando = true;
+    sim::ble.controles(estado);
+    if (!sim::rodarAte([&]() { return !esperando; }, 200)) m.semResposta++;
+    esperando = false;
+    sim::rodar(300 + sortear(1000));
+    // Os eventos de conexão ficam numa fase fixa do tick do ESP32 (só o desvio
+    // do relógio do celular mexe): reconecta para medir outras fases
+    if (i % 20 == 19 && i + 1 < COMANDOS) {
+      sim::ble.desconectar();
+      sim::rodarAte([]() { return RemoteXY.connect_flag == 0; }, 1000);
+      sim::ble.conectar();
+      sim::rodarAte([]() { return RemoteXY.connect_flag == 1; }, 5000);
+    }
+  }
+
+  // Comando parado (ligado, 60%): quantas vezes por segundo os pinos são reescritos
+  sim::ble.controles(controles(1, 0, 60));
+  sim::rodar(3000);
+  uint32_t sentido = sim::pinos[pinoIN1].escritas + sim::pinos[pinoIN2].escritas, ena = sim::pinos[pinoENA].escritas;
+  sim::rodar(10000);
+  m.escritasSentidoPorS = (sim::pinos[pinoIN1].escritas + sim::pinos[pinoIN2].escritas - sentido) / 10.0;
+  m.escritasEnaPorS = (sim::pinos[pinoENA].escritas - ena) / 10.0;
+  sim::aoEscreverPino = nullptr;
+  return m;
+}
+
+static void imprimir(const char* nome, const Medida& m) {
+  printf("%-6s  %3zu comandos  latencia p50 %.2f ms, p99 %.2f ms, max %.2f ms | escritas/s parado: IN1+IN2 %.0f, ENA %.0f"
+         " | ENA repetido %u vezes\n",
+         nome, m.latencia.size(), percentil(m.latencia, 0.5), percentil(m.latencia, 0.99), percentil(m.latencia, 1),
+         m.escritasSentidoPorS, m.escritasEnaPorS, m.enaRepetidas);
+}
+
+int main() {
+  MotorCC motor(pinoIN1, pinoIN2, pinoENA);
+  motor.ligarSensores(pinoTensao, pinoCorrente);
+
+  puts("antes: loop() com delay(10)");
+  Medida antes = medir(setupAntes, loopAntes, motor);
+  imprimir("antes", antes);
+  VERIFICA(antes.semResposta == 0 && antes.latencia.size() == COMANDOS, "todos os comandos chegam aos pinos");
+  // O comando espera o fim do delay(10) e o próximo RemoteXY_Handler()
+  VERIFICA(percentil(antes.latencia, 1) <= 10.5, "no pior caso um delay(10) + o handler");
+  sim::desligar();
+
+  puts("depois: loop() acordado pelo handler GATT e tarefa da rampa");
+  sim::ble = sim::Ble();
+  Medida depois = medir(setup, loop, motor);
+  imprimir("depois", depois);
+  VERIFICA(depois.semResposta == 0 && depois.latencia.size() == COMANDOS, "todos os comandos chegam aos pinos");
+  // O loop() acorda com o pacote; só falta o próximo tick da tarefa da rampa
+  VERIFICA(percentil(depois.latencia, 1) <= 1.2, "no pior caso 1 tick da rampa");
+  VERIFICA(percentil(depois.latencia, 0.99) < percentil(antes.latencia, 0.99), "p99 menor que antes");
+  VERIFICA(depois.escritasSentidoPorS == 0 && antes.escritasSentidoPorS >= 190,
+           "com o comando parado IN1/IN2 não são mais reescritos (antes: %.0f/s)", antes.escritasSentidoPorS);
+  // A tarefa da rampa calcula o duty a cada 1 ms, mas só escreve quando ele muda
+  VERIFICA(depois.enaRepetidas == 0, "ENA só é escrito quando o duty muda (antes: %u escritas repetidas)", antes.enaRepetidas);
+
+  // Malha aberta (padrão): 60% do slider vira 60% de duty, e sem carga o motor gira a 60% de RPM_SEM_CARGA
+  double esperado = 0.6 * RPM_SEM_CARGA;
+  printf("        motor em 60%%: duty %u, %.0f RPM (sem carga: %.0f)\n", sim::pinos[pinoENA].duty, motor.rpm(), esperado);
+  VERIFICA(sim::pinos[pinoENA].duty == dutyDaVelocidade(60) && fabs(motor.rpm() - esperado) < 0.1 * esperado,
+           "o motor segue o slider");
+  return fimDosTestes();
+}
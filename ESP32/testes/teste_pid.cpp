@@ -0,0 +1,113 @@
+// Motor Bluetooth em malha fechada (MODO_MALHA_FECHADA 1): o PID do sketch
+// (pid.h, 1 kHz na tarefa da rampa) contra o motor CC de motor_cc.h, com o
+// encoder contado pelo PCNT. Degraus do slider, carga entrando com o motor
+// girando e as duas saídas para malha aberta: encoder desligado (sem pulsos
+// com duty alto) e PCNT que não inicia.
+//
+//   build/teste_pid
+#define MODO_MALHA_FECHADA 1
+#include "../2. Motor Bluetooth.i/MotorBluetooth2.i.ino"
+#include "motor_cc.h"
+#include "teste.h"
+
+static std::string controles(uint8_t ligado, uint8_t sentido, int8_t velocidade) {
+  return std::string{ (char)ligado, (char)sentido, (char)velocidade };
+}
+
+// Novo boot com o app conectado e o motor desligado
+static void ligarComApp(MotorCC& motor) {
+  sim::ble = sim::Ble();
+  motor.w = motor.corrente = 0;
+  sim::ligar(setup, loop);
+  motor.ligar();
+  sim::rodar(500);
+  sim::ble.controles(controles(0, 0, 0));
+  sim::ble.conectar();
+  sim::rodarAte([]() { return RemoteXY.connect_flag == 1; }, 5000);
+}
+
+// Desliga o motor antes de reiniciar (as variáveis do sketch continuam na memória do PC)
+static void desligarMotor() {
+  sim::ble.controles(controles(0, 0, 0));
+  sim::rodar(500);
+  sim::desligar();
+}
+
+static double rpmAlvo(int slider) { return slider * RPM_MAX / 100.0; }
+
+static void imprimirDegrau(const Degrau& d) {
+  printf("         %.0f -> %.0f RPM: subida %u ms, sobressinal %.1f%%, acomodacao %u ms, erro final %.1f RPM\n", d.de, d.para,
+         d.t90 - d.t10, d.pico > 1 ? (d.pico - 1) * 100 : 0, d.ultimoFora,
+         d.amostrasFinal ? d.somaErroFinal / d.amostrasFinal : 0);
+}
+
+int main() {
+  MotorCC motor(pinoIN1, pinoIN2, pinoENA);
+  motor.ligarSensores(pinoTensao, pinoCorrente);
+
+  puts("degraus do slider:");
+  ligarComApp(motor);
+  VERIFICA(malhaFechada.load() && sim::contar("Encoder:") == 0, "PCNT iniciado, malha fechada");
+  sim::ble.controles(controles(1, 0, 50));
+  sim::rodar(JANELA_DEGRAU_MS + 500);
+  Degrau d = resultadoDegrau;
+  imprimirDegrau(d);
+  VERIFICA(fabs(motor.rpm() - rpmAlvo(50)) < 0.05 * rpmAlvo(50), "0 -> 50%%: %.1f RPM (alvo %.0f)", motor.rpm(), rpmAlvo(50));
+  VERIFICA(d.para == rpmAlvo(50) && d.pico < 1.1f && d.ultimoFora < 1500, "sobressinal < 10%% e acomoda em 1,5 s");
+
+  sim::ble.controles(controles(1, 0, 80));
+  sim::rodar(JANELA_DEGRAU_MS + 500);
+  d = resultadoDegrau;
+  imprimirDegrau(d);
+  VERIFICA(d.para == rpmAlvo(80) && d.t90 > 0 && d.pico < 1.1f, "50 -> 80%%: chega sem passar 10%% do alvo");
+  VERIFICA(fabs(d.amostrasFinal ? d.somaErroFinal / d.amostrasFinal : 99) < 2, "erro médio no fim < 2 RPM");
+
+  puts("carga de 0,4 N.m com o motor a 80%:");
+  double dip = motor.rpm();
+  motor.carga = 0.4;
+  int amostrador = sim::aCada(1000, [&]() { dip = std::min(dip, motor.rpm()); });
+  sim::rodar(2000);
+  sim::cancelar(amostrador);
+  double fechada = motor.rpm();
+  printf("         cai até %.1f RPM e volta para %.1f RPM (alvo %.0f), duty %u\n", dip, fechada, rpmAlvo(80),
+         sim::pinos[pinoENA].duty);
+  VERIFICA(fabs(fechada - rpmAlvo(80)) < 0.03 * rpmAlvo(80), "o PID compensa a carga");
+  motor.carga = 0;
+  desligarMotor();
+
+  puts("encoder desligado:");
+  motor.comEncoder = false;
+  ligarComApp(motor);
+  VERIFICA(malhaFechada.load(), "o PCNT inicia (não tem como saber que o encoder não está ligado)");
+  size_t desde = sim::serial.size();
+  sim::ble.controles(controles(1, 0, 50));
+  uint64_t inicio = sim::agora();
+  sim::rodarAte([]() { return !malhaFechada.load(); }, 3000);
+  double ms = (sim::agora() - inicio) / 1000.0;
+  sim::rodar(1500);
+  printf("         malha aberta depois de %.0f ms, duty %u, %.0f RPM\n", ms, sim::pinos[pinoENA].duty, motor.rpm());
+  VERIFICA(!malhaFechada.load() && sim::contar("Encoder sem pulsos", desde) == 1, "volta para malha aberta e avisa uma vez");
+  VERIFICA(ms < PRAZO_ENCODER_MS + 500, "em menos de %d ms + a rampa", PRAZO_ENCODER_MS);
+  VERIFICA(sim::pinos[pinoENA].duty == dutyDaVelocidade(50), "duty volta ao do slider (não fica no máximo do PID)");
+  motor.comEncoder = true;
+  desligarMotor();
+
+  puts("PCNT sem unidade livre:");
+  sim::pcnt.semUnidade = true;
+  ligarComApp(motor);
+  VERIFICA(sim::contar("pcnt_new_unit falhou (ESP_ERR_NOT_FOUND)") == 1 && sim::contar("Sem encoder: seguindo em malha aberta") == 1,
+           "o erro do PCNT é impresso e o sketch segue em malha aberta");
+  VERIFICA(!malhaFechada.load() && unidadeEncoder == NULL, "unidadeEncoder fica NULL (lerVelocidade não chama o PCNT)");
+  sim::ble.controles(controles(1, 0, 80));
+  sim::rodar(3000);
+  double semCarga = motor.rpm();
+  motor.carga = 0.4;
+  sim::rodar(2000);
+  double aberta = motor.rpm();
+  printf("         malha aberta a 80%%: %.1f RPM sem carga, %.1f com 0,4 N.m (fechada: %.1f)\n", semCarga, aberta, fechada);
+  VERIFICA(sim::pinos[pinoENA].duty == dutyDaVelocidade(80) && aberta < fechada - 10, "sem o PID a carga derruba a rotação");
+  motor.carga = 0;
+  sim::pcnt.semUnidade = false;
+  desligarMotor();
+  return fimDosTestes();
+}
@@ -0,0 +1,94 @@
+// Perfil de velocidade do motor (rampa.h), sem simulador: degraus de subida,
+// descida, pequenos e com o alvo mudando no meio, a 1 kHz como na tarefa da
+// rampa. Confere os limites de aceleração e jerk, que a velocidade não passa
+// do alvo e que o perfil encaixa no alvo (rampaChegou) no tempo esperado.
+#include "../2. Motor Bluetooth.i/rampa.h"
+#include "teste.h"
+
+// Os mesmos limites do sketch (ACELERACAO_MAX, JERK_MAX, FREQ_RAMPA)
+const LimitesRampa limites = { 200.0f, 2000.0f };
+const float dt = 0.001f;
+
+struct Percurso {
+  float maxAceleracao = 0; // %/s
+  float maxJerk = 0;       // %/s²
+  float maxVelocidade = 0, minVelocidade = 100;
+  bool monotono = true;    // sem voltar para trás no caminho até o alvo
+  float segundos = -1;     // até rampaChegou (-1 = não chegou)
+};
+
+// Roda até chegar (ou até "limite" segundos) guardando os extremos
+static Percurso percorrer(Rampa& r, float alvo, float limite = 5, const LimitesRampa& lim = limites, float passo = dt) {
+  Percurso p;
+  float sentido = alvo >= r.velocidade ? 1 : -1;
+  for (int i = 1; i <= limite / passo; i++) {
+    Rampa antes = r;
+    rampaPasso(r, alvo, lim, passo);
+    p.maxAceleracao = fmaxf(p.maxAceleracao, fabsf(r.aceleracao));
+    if (!rampaChegou(r, alvo)) p.maxJerk = fmaxf(p.maxJerk, fabsf(r.aceleracao - antes.aceleracao) / passo);
+    p.maxVelocidade = fmaxf(p.maxVelocidade, r.velocidade);
+    p.minVelocidade = fminf(p.minVelocidade, r.velocidade);
+    if ((r.velocidade - antes.velocidade) * sentido < -1e-4f) p.monotono = false;
+    if (rampaChegou(r, alvo)) {
+      p.segundos = i * passo;
+      break;
+    }
+  }
+  return p;
+}
+
+int main() {
+  puts("0 -> 100%:");
+  Rampa r = { 0, 0 };
+  Percurso p = percorrer(r, 100);
+  printf("         chegou em %.3f s, aceleracao max %.1f %%/s, jerk max %.0f %%/s2\n", p.segundos, p.maxAceleracao, p.maxJerk);
+  VERIFICA(p.segundos > 0 && r.velocidade == 100 && r.aceleracao == 0, "encaixa no alvo");
+  // 100% a 200 %/s = 0,5 s, mais 0,1 s subindo e descendo a aceleração no jerk máximo
+  VERIFICA(p.segundos >= 0.55f && p.segundos <= 0.7f, "leva ~0,6 s");
+  VERIFICA(p.maxAceleracao <= limites.aceleracao + 0.01f, "aceleração nunca passa de %.0f %%/s", limites.aceleracao);
+  VERIFICA(p.maxJerk <= limites.jerk * 1.001f, "aceleração muda no máximo %.0f %%/s2", limites.jerk);
+  VERIFICA(p.monotono && p.maxVelocidade <= 100, "sobe sem voltar e sem passar de 100");
+
+  puts("100 -> 0%:");
+  p = percorrer(r, 0);
+  VERIFICA(p.segundos >= 0.55f && p.segundos <= 0.7f && r.velocidade == 0, "desce até zero em ~0,6 s (%.3f s)", p.segundos);
+  VERIFICA(p.monotono && p.minVelocidade >= 0, "sem ficar negativa");
+  VERIFICA(p.maxJerk <= limites.jerk * 1.001f, "jerk limitado também na descida");
+
+  puts("degrau pequeno (50 -> 52%):");
+  r = { 50, 0 };
+  p = percorrer(r, 52);
+  VERIFICA(p.segundos > 0 && p.segundos < 0.1f && p.maxVelocidade <= 52.05f, "chega em %.3f s sem passar do alvo", p.segundos);
+  VERIFICA(p.maxAceleracao < limites.aceleracao, "nem chega na aceleração máxima (%.1f %%/s)", p.maxAceleracao);
+
+  puts("alvo muda no meio da subida (0 -> 100, em 0,2 s vira 60):");
+  r = { 0, 0 };
+  percorrer(r, 100, 0.2f);
+  float emMovimento = r.velocidade, aceleracao = r.aceleracao;
+  p = percorrer(r, 60);
+  printf("         estava em %.1f%% a %.0f %%/s, pico %.1f%%\n", emMovimento, aceleracao, p.maxVelocidade);
+  VERIFICA(emMovimento < 60 && p.segundos > 0 && r.velocidade == 60, "encaixa no alvo novo");
+  VERIFICA(p.maxVelocidade <= 60.05f, "sem passar do alvo novo");
+  VERIFICA(p.maxJerk <= limites.jerk * 1.001f, "a troca de alvo não dá tranco");
+
+  puts("alvo cai para trás da velocidade atual (0 -> 100, em 0,4 s vira 20):");
+  r = { 0, 0 };
+  percorrer(r, 100, 0.4f);
+  emMovimento = r.velocidade;
+  p = percorrer(r, 20);
+  printf("         estava em %.1f%%, pico %.1f%%, chegou em %.3f s\n", emMovimento, p.maxVelocidade, p.segundos);
+  // Não dá para parar na hora: passa do ponto em que estava, volta e encaixa em 20
+  VERIFICA(p.segundos > 0 && r.velocidade == 20 && p.maxJerk <= limites.jerk * 1.001f, "volta e encaixa sem tranco");
+
+  puts("passo maior (10 ms):");
+  r = { 0, 0 };
+  p = percorrer(r, 100, 5, limites, 0.01f);
+  VERIFICA(p.segundos > 0 && p.maxVelocidade <= 100 && p.segundos <= 0.8f, "ainda converge sem oscilar (%.2f s)", p.segundos);
+
+  puts("failsafe (500 %/s, 10000 %/s2) de 100%:");
+  const LimitesRampa failsafe = { 500.0f, 10000.0f };
+  r = { 100, 0 };
+  p = percorrer(r, 0, 5, failsafe);
+  VERIFICA(p.segundos > 0 && p.segundos <= 0.3f && r.velocidade == 0, "para em %.3f s (prazo do failsafe: 0,5 s)", p.segundos);
+  return fimDosTestes();
+}
@@ -0,0 +1,173 @@
+// Testa o próprio simulador: relógio virtual, tarefas, notificações, timer,
+// ADC contínuo, deep sleep, Wi-Fi, o broker em memória e o PCNT.
+#include <Arduino.h>
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include "esp_sleep.h"
+#include "driver/pulse_cnt.h"
+#include "teste.h"
+
+// --- tarefas e notificações ---
+TaskHandle_t consumidor = NULL;
+hw_timer_t* timer = NULL;
+uint32_t avisosRecebidos = 0, bitsVistos = 0, voltasLentas = 0;
+uint64_t instanteAviso[8];
+
+void IRAM_ATTR aoTimer() {
+  BaseType_t acordar = pdFALSE;
+  xTaskNotifyFromISR(consumidor, 1 << 1, eSetBits, &acordar);
+  portYIELD_FROM_ISR();
+}
+
+void tarefaConsumidor(void*) {
+  for (;;) {
+    uint32_t bits = 0;
+    if (xTaskNotifyWait(0, 0xFFFFFFFF, &bits, portMAX_DELAY) != pdTRUE) continue;
+    if (avisosRecebidos < 8) instanteAviso[avisosRecebidos] = micros();
+    avisosRecebidos++;
+    bitsVistos |= bits;
+  }
+}
+
+void tarefaLenta(void*) {
+  for (;;) {
+    voltasLentas++;
+    vTaskDelay(pdMS_TO_TICKS(100));
+  }
+}
+
+void setupTarefas() {
+  Serial.begin(115200);
+  xTaskCreatePinnedToCore(tarefaConsumidor, "consumidor", 4096, NULL, 5, &consumidor, 1);
+  xTaskCreatePinnedToCore(tarefaLenta, "lenta", 4096, NULL, 1, NULL, 0);
+  timer = timerBegin(1000000);
+  timerAttachInterrupt(timer, &aoTimer);
+  timerAlarm(timer, 250000, true, 0); // 250 ms
+}
+
+void loopTarefas() { vTaskDelete(NULL); }
+
+// --- deep sleep ---
+RTC_DATA_ATTR uint32_t acordou = 0;
+uint32_t millisNoBoot[4];
+
+void setupDeepSleep() {
+  if (acordou < 4) millisNoBoot[acordou] = millis();
+  acordou++;
+  delay(50); // "trabalha" 50 ms
+  esp_sleep_enable_timer_wakeup(950000);
+  esp_deep_sleep_start();
+}
+
+void loopNunca() { sim::falhar("loop() depois de deep sleep"); }
+
+// --- Wi-Fi e broker em memória ---
+WiFiClient espClient;
+PubSubClient client(espClient);
+std::string ultimoComando;
+
+void aoReceber(char* topico, byte* payload, unsigned int n) {
+  ultimoComando = std::string(topico) + "=" + std::string((char*)payload, n);
+}
+
+void setupRede() {
+  WiFi.begin("rede", "senha");
+  while (WiFi.status() != WL_CONNECTED) delay(10);
+  client.setServer("broker", 1883);
+  client.setCallback(aoReceber);
+}
+
+void loopRede() {
+  if (!client.connected()) {
+    if (client.connect("teste")) client.subscribe("george/sensor/led");
+    else delay(1000);
+    return;
+  }
+  client.loop();
+  static unsigned long ultimo = 0;
+  if (millis() - ultimo >= 1000) {
+    ultimo = millis();
+    char texto[24];
+    snprintf(texto, sizeof(texto), "%lu", millis() / 1000);
+    client.publish("george/sensor/chuva", texto);
+  }
+  delay(5);
+}
+
+int main() {
+  puts("relogio e tarefas:");
+  sim::ligar(setupTarefas, loopTarefas);
+  sim::rodar(1000);
+  VERIFICA(sim::agora() == 1000000, "1 s simulado (agora = %llu us)", (unsigned long long)sim::agora());
+  VERIFICA(avisosRecebidos == 4, "timer de 250 ms acordou a tarefa 4 vezes (%u)", avisosRecebidos);
+  VERIFICA(instanteAviso[0] == 250000 && instanteAviso[3] == 1000000, "sem atraso: 1º aviso em %llu us, 4º em %llu us",
+           (unsigned long long)instanteAviso[0], (unsigned long long)instanteAviso[3]);
+  VERIFICA(bitsVistos == 2, "bits da notificação chegam (0x%x)", bitsVistos);
+  VERIFICA(voltasLentas == 10 || voltasLentas == 11, "vTaskDelay(100) roda 10 vezes por segundo (%u)", voltasLentas);
+
+  sim::rodar(24ull * 3600 * 1000);
+  VERIFICA(avisosRecebidos == 4 + 4 * 86400, "um dia simulado: %u avisos", avisosRecebidos);
+
+  puts("deep sleep:");
+  sim::desligar();
+  sim::ligar(setupDeepSleep, loopNunca);
+  sim::rodar(3500);
+  VERIFICA(acordou == 4 && sim::boots == 4, "acorda a cada 1 s: %u boots em 3,5 s", sim::boots);
+  VERIFICA(millisNoBoot[1] == 0 && millisNoBoot[3] == 0, "millis() volta a zero a cada boot");
+  VERIFICA(sim::tempoDormindoUs == 3 * 950000, "dormiu 3 x 950 ms (%llu us)", (unsigned long long)sim::tempoDormindoUs);
+
+  puts("wi-fi e broker em memoria:");
+  sim::desligar();
+  uint64_t inicio = sim::agora();
+  sim::ligar(setupRede, loopRede);
+  sim::rodar(10 * 1000);
+  VERIFICA(sim::wifi.ultimaConexaoMs == 1950, "Wi-Fi conecta em varredura + associação + DHCP (%llu ms)",
+           (unsigned long long)sim::wifi.ultimaConexaoMs);
+  size_t publicadas = sim::broker.contar("george/sensor/chuva");
+  VERIFICA(publicadas == 8 || publicadas == 9, "uma publicação por segundo (%zu em 10 s)", publicadas);
+  sim::broker.publicar("george/sensor/led", "1");
+  sim::broker.publicar("george/sensor/outro", "x");
+  sim::rodar(100);
+  VERIFICA(ultimoComando == "george/sensor/led=1", "mensagem do broker chega no callback (%s)", ultimoComando.c_str());
+
+  sim::broker.disponivel = false;
+  sim::rodar(60 * 1000);
+  VERIFICA(sim::broker.contar("george/sensor/chuva") == publicadas + 1 || sim::broker.contar("george/sensor/chuva") == publicadas,
+           "broker fora: nada publicado");
+  VERIFICA(sim::broker.quedas == 1, "a queda derruba a conexão (%u)", sim::broker.quedas);
+  sim::broker.disponivel = true;
+  sim::rodar(5 * 1000);
+  VERIFICA(sim::broker.conexoes == 2, "reconecta quando o broker volta (%u conexões)", sim::broker.conexoes);
+  VERIFICA(sim::agora() - inicio == 75100000ull, "tempo simulado exato");
+
+  puts("topicos:");
+  VERIFICA(sim::casaTopico("george/sensor/#", "george/sensor/chuva/stats"), "# casa com vários níveis");
+  VERIFICA(sim::casaTopico("george/sensor/#", "george/sensor"), "a/# casa com a");
+  VERIFICA(sim::casaTopico("george/+/chuva", "george/sensor/chuva"), "+ casa com um nível");
+  VERIFICA(!sim::casaTopico("george/+", "george/sensor/chuva"), "+ não casa com dois níveis");
+  VERIFICA(!sim::casaTopico("george/sensor/led", "george/sensor/led/ack"), "tópico exato não casa com subtópico");
+
+  puts("pcnt:");
+  pcnt_unit_config_t config = {};
+  config.low_limit = -100;
+  config.high_limit = 100;
+  pcnt_unit_handle_t unidade = NULL;
+  VERIFICA(pcnt_new_unit(&config, &unidade) == ESP_OK, "cria a unidade");
+  pcnt_chan_config_t a = { 34, 35 }, b = { 35, 34 };
+  pcnt_channel_handle_t canalA = NULL, canalB = NULL;
+  pcnt_new_channel(unidade, &a, &canalA);
+  pcnt_new_channel(unidade, &b, &canalB);
+  VERIFICA(pcnt_unit_start(unidade) == ESP_ERR_INVALID_STATE, "start antes do enable falha");
+  VERIFICA(pcnt_unit_enable(unidade) == ESP_OK && pcnt_unit_start(unidade) == ESP_OK, "enable e start");
+  sim::pcnt.mover(40);
+  sim::pcnt.mover(-10);
+  int contagem = 0;
+  pcnt_unit_get_count(unidade, &contagem);
+  VERIFICA(contagem == 30, "quadratura conta com sinal (%d)", contagem);
+  VERIFICA(pcnt_unit_get_count(NULL, &contagem) == ESP_ERR_INVALID_ARG, "handle nulo dá ESP_ERR_INVALID_ARG");
+  sim::pcnt.semUnidade = true;
+  VERIFICA(pcnt_new_unit(&config, &unidade) == ESP_ERR_NOT_FOUND, "sem unidade livre dá ESP_ERR_NOT_FOUND");
+  sim::pcnt.semUnidade = false;
+
+  return fimDosTestes();
+}
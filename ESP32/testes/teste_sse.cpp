@@ -0,0 +1,182 @@
+// sensorDeChuva3.0 (servidor assíncrono + Server-Sent Events) com 50
+// navegadores abertos ao mesmo tempo: quantos são atendidos, quanto cada
+// leitura leva da tarefa de amostragem até cada navegador e quanto de CPU a
+// tarefa async_tcp gasta. Depois, os mesmos 50 navegadores fazendo polling de
+// /chuva a cada 2 s, como a página antiga, para comparar.
+//
+//   build/teste_sse [clientes]   (padrão 50)
+#include "../Ñ usei/sensorDeChuva3.0/sensorDeChuva3.0.ino"
+#include "cliente_http.h"
+#include "teste.h"
+
+#define MINUTOS 10
+
+struct Navegador {
+  int conexao = -1;
+  RespostaHttp fim;
+  bool fechou = false;
+  std::vector<EventoSse> eventos;
+};
+
+// Atraso (ms) de cada evento: da leitura (millis() do ESP32 no evento) até chegar
+// ao navegador. O primeiro de cada navegador fica de fora: é a última leitura,
+// mandada junto com o cabeçalho, e pode ter até INTERVALO_AMOSTRA de idade.
+static std::vector<double> atrasos(const std::vector<Navegador>& nav) {
+  std::vector<double> v;
+  for (const Navegador& n : nav)
+    for (size_t k = 1; k < n.eventos.size(); k++) {
+      const EventoSse& e = n.eventos[k];
+      uint64_t leituraUs = sim::inicioBoot() + (uint64_t)strtoul(e.dados.c_str() + e.dados.find(';') + 1, NULL, 10) * 1000;
+      v.push_back((e.chegadaUs - leituraUs) / 1000.0);
+    }
+  return v;
+}
+
+static void abrir(std::vector<Navegador>& nav, size_t i) {
+  nav[i].conexao = abrirEventos([&nav, i](const EventoSse& e) { nav[i].eventos.push_back(e); },
+                                [&nav, i](const RespostaHttp& r) {
+                                  nav[i].fim = r;
+                                  nav[i].fechou = true;
+                                });
+}
+
+int main(int argc, char** argv) {
+  size_t clientes = argc > 1 ? atoi(argv[1]) : 50;
+  sim::sensor = [](uint8_t, uint64_t us) { return 1000 + (int)(us / 1000000 % 2000); }; // muda a cada leitura
+  sim::ligar(setup, loop);
+  sim::rodarAte([]() { return sim::contar("WiFi conectado") > 0; }, 30000);
+  sim::rodar(3000);
+
+  printf("%zu navegadores no /eventos por %d min:\n", clientes, MINUTOS);
+  std::vector<Navegador> nav(clientes);
+  for (size_t i = 0; i < clientes; i++) sim::em(sim::agora() + i * 20000, [&nav, i]() { abrir(nav, i); }); // todos em 1 s
+  uint64_t cpuAntes = sim::web.cpuUs, inicio = sim::agora();
+  uint32_t seqAntes = amostraSeq.load();
+  sim::rodar(MINUTOS * 60000);
+  double segundos = (sim::agora() - inicio) / 1e6;
+  uint32_t leituras = amostraSeq.load() - seqAntes;
+
+  size_t atendidos = 0, recusados503 = 0, semResposta = 0, faltando = 0;
+  std::vector<double> tempoRecusa;
+  for (const Navegador& n : nav) {
+    if (!n.fechou) {
+      atendidos++;
+      // Todas as leituras desde a primeira, sem buraco e sem repetir
+      for (size_t k = 1; k < n.eventos.size(); k++) faltando += n.eventos[k].id - n.eventos[k - 1].id - 1;
+      if (n.eventos.size() + 2 < leituras) faltando += leituras - n.eventos.size();
+    } else if (n.fim.status == 503) {
+      recusados503++;
+      tempoRecusa.push_back((n.fim.fimUs - n.fim.inicioUs) / 1000.0);
+    } else {
+      semResposta++;
+    }
+  }
+  VERIFICA(atendidos == std::min<size_t>(clientes, MAX_CLIENTES_SSE), "%zu atendidos (MAX_CLIENTES_SSE = %d)", atendidos,
+           MAX_CLIENTES_SSE);
+  VERIFICA(recusados503 + atendidos == clientes && semResposta == 0, "os outros %zu recebem 503 (nenhum fica pendurado)",
+           recusados503);
+  printf("         503 em p50 %.0f ms, p99 %.0f ms | %u SYN descartados por falta de PCB (o navegador repete em 1, 2, 4 s)\n",
+         percentil(tempoRecusa, 0.5), percentil(tempoRecusa, 0.99), sim::web.synDescartados);
+  VERIFICA(sim::web.maxPcbsAtivos <= PCBS_TCP, "no máximo %u PCBs em uso (%d no lwIP)", sim::web.maxPcbsAtivos, PCBS_TCP);
+  VERIFICA(faltando == 0, "cada atendido recebe todas as %u leituras, sem buraco", leituras);
+
+  std::vector<double> atraso = atrasos(nav);
+  printf("         atraso leitura->navegador: p50 %.0f ms, p99 %.0f ms, max %.0f ms (%zu eventos)\n", percentil(atraso, 0.5),
+         percentil(atraso, 0.99), percentil(atraso, 1), atraso.size());
+  // Sem leitura nova a função do /eventos devolve RESPONSE_TRY_AGAIN e só é chamada
+  // de novo no poll do lwIP: a espera depende da fase entre a amostragem e o poll
+  // (fixa em cada boot), e nunca passa de um período do poll
+  VERIFICA(percentil(atraso, 1) <= sim::web.pollMs + 4 * sim::web.redeMs + 10,
+           "no pior caso espera o próximo poll do lwIP (%u ms) + a rede", sim::web.pollMs);
+  // Atraso por navegador: ninguém fica para trás
+  double piorP99 = 0;
+  for (const Navegador& n : nav)
+    if (!n.fechou) piorP99 = std::max(piorP99, percentil(atrasos({ n }), 0.99));
+  VERIFICA(piorP99 <= sim::web.pollMs + 4 * sim::web.redeMs + 10, "p99 do pior navegador %.0f ms", piorP99);
+
+  double cpuSse = (sim::web.cpuUs - cpuAntes) / 1e3 / segundos; // ms de CPU por segundo
+  printf("         CPU da async_tcp: %.2f ms/s (%.3f%%) = %.0f us por evento entregue\n", cpuSse, cpuSse / 10,
+         (sim::web.cpuUs - cpuAntes) / (double)std::max<size_t>(1, atraso.size()));
+  VERIFICA(cpuSse < 10, "menos de 1%% de um núcleo");
+  VERIFICA(sim::contar("Clientes SSE: 6/6") > 0, "o relatório do Monitor Serial mostra os 6 clientes");
+
+  puts("vagas voltam quando um navegador fecha:");
+  size_t fechados = 0;
+  for (Navegador& n : nav)
+    if (!n.fechou && fechados < 3) {
+      sim::web.fechar(n.conexao);
+      n.fechou = true;
+      fechados++;
+    }
+  sim::rodar(100);
+  VERIFICA(clientesSse.load() == MAX_CLIENTES_SSE - 3, "onDisconnect libera a vaga (%d clientes)", clientesSse.load());
+  std::vector<Navegador> novos(3);
+  for (size_t i = 0; i < novos.size(); i++) abrir(novos, i);
+  sim::rodar(5000);
+  bool entraram = true;
+  for (const Navegador& n : novos) entraram = entraram && !n.fechou && !n.eventos.empty();
+  VERIFICA(entraram && clientesSse.load() == MAX_CLIENTES_SSE, "3 navegadores novos entram e recebem leituras");
+
+  // Fecha tudo e compara com a página antiga: GET /chuva a cada 2 s
+  for (Navegador& n : nav)
+    if (!n.fechou) sim::web.fechar(n.conexao);
+  for (Navegador& n : novos) sim::web.fechar(n.conexao);
+  sim::rodar(1000);
+  VERIFICA(clientesSse.load() == 0 && conexoesAbertas.load() == 0, "sem navegador, nenhuma vaga presa");
+
+  printf("polling: %zu navegadores com GET /chuva a cada 2 s por %d min:\n", clientes, MINUTOS);
+  size_t ok = 0, ocupado = 0, falhas = 0;
+  std::vector<double> latencia;
+  bool parar = false;
+  std::function<void(size_t)> pedir = [&](size_t i) {
+    if (parar) return;
+    uint64_t proximo = sim::agora() + 2000000;
+    httpGet("/chuva", [&, i, proximo](const RespostaHttp& r) {
+      if (r.status == 200) {
+        ok++;
+        latencia.push_back((r.fimUs - r.inicioUs) / 1000.0);
+      } else if (r.status == 503) {
+        ocupado++;
+      } else {
+        falhas++;
+      }
+      sim::em(std::max(proximo, sim::agora()), [&, i]() { pedir(i); }); // setInterval de 2 s
+    });
+  };
+  for (size_t i = 0; i < clientes; i++) sim::em(sim::agora() + i * 2000000 / clientes, [&, i]() { pedir(i); });
+  cpuAntes = sim::web.cpuUs;
+  inicio = sim::agora();
+  sim::rodar(MINUTOS * 60000);
+  parar = true;
+  segundos = (sim::agora() - inicio) / 1e6;
+  sim::rodar(5000);
+  double cpuPolling = (sim::web.cpuUs - cpuAntes) / 1e3 / segundos;
+  printf("         %zu respostas 200 (%.1f/s), %zu com 503, %zu sem resposta | latencia p50 %.0f ms, p99 %.0f ms\n", ok,
+         ok / segundos, ocupado, falhas, percentil(latencia, 0.5), percentil(latencia, 0.99));
+  printf("         CPU da async_tcp: %.2f ms/s (%.3f%%), %.1fx o SSE\n", cpuPolling, cpuPolling / 10, cpuPolling / cpuSse);
+  VERIFICA(cpuPolling > cpuSse, "o SSE gasta menos CPU que o polling");
+  VERIFICA(conexoesAbertas.load() == 0, "nenhuma requisição presa no fim");
+  puts("fase ruim entre a amostragem e o poll:");
+  // Novo boot (sem nenhum cliente: as vagas do sketch continuam zeradas) com o poll do lwIP logo antes de cada leitura: cada evento espera quase um poll inteiro
+  {
+    sim::desligar();
+    sim::web.fasePollMs = sim::web.pollMs - 20;
+    size_t desde = sim::serial.size();
+    sim::ligar(setup, loop);
+    sim::rodarAte([desde]() { return sim::contar("WiFi conectado", desde) > 0; }, 30000);
+    sim::rodar(3000);
+    std::vector<Navegador> ruim(MAX_CLIENTES_SSE);
+    for (size_t i = 0; i < ruim.size(); i++) abrir(ruim, i);
+    sim::rodar(2 * 60000);
+    std::vector<double> a = atrasos(ruim);
+    printf("         atraso leitura->navegador: p50 %.0f ms, p99 %.0f ms, max %.0f ms (%zu eventos)\n", percentil(a, 0.5),
+           percentil(a, 0.99), percentil(a, 1), a.size());
+    VERIFICA(a.size() >= 55 * ruim.size() && percentil(a, 1) <= sim::web.pollMs + 4 * sim::web.redeMs + 10,
+             "continua abaixo de um poll + a rede");
+    for (Navegador& n : ruim) sim::web.fechar(n.conexao);
+    sim::rodar(1000);
+    sim::web.fasePollMs = 0;
+  }
+
+  return fimDosTestes();
+}
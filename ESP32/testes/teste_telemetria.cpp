@@ -0,0 +1,143 @@
+// Motor Bluetooth: telemetria por notify numa app GATT própria (APP_TELEMETRIA),
+// ao lado do BLEServer do RemoteXY. Confere que só existe um BLEServer, que o
+// app do RemoteXY continua mandando no motor, que o notify só sai com o CCCD
+// ligado, o formato dos pacotes (marcador, seq, amostras por MTU) e que a
+// assinatura some na desconexão.
+//
+//   build/teste_telemetria
+#include "../2. Motor Bluetooth.i/MotorBluetooth2.i.ino"
+#include "teste.h"
+
+static std::string controles(uint8_t ligado, uint8_t sentido, int8_t velocidade) {
+  return std::string{ (char)ligado, (char)sentido, (char)velocidade };
+}
+
+struct Recebido {
+  size_t notificacoes = 0;
+  size_t amostras = 0;
+  size_t maxAmostras = 0;   // maior n em um notify
+  bool formato = true;      // marcador, tamanho = cabeçalho + n amostras, handle do valor
+  bool seqContinuo = true;
+};
+
+// Notificações que chegaram ao celular a partir de "desde"
+static Recebido contarNotificacoes(size_t desde) {
+  Recebido r;
+  int seqAnterior = -1;
+  for (size_t i = desde; i < sim::ble.notificacoes.size(); i++) {
+    const sim::Notificacao& n = sim::ble.notificacoes[i];
+    const uint8_t* d = (const uint8_t*)n.dados.data();
+    r.notificacoes++;
+    if (n.dados.size() < TELEMETRIA_CABECALHO || d[0] != TELEMETRIA_MARCADOR ||
+        n.dados.size() != (size_t)(TELEMETRIA_CABECALHO + d[1] * TELEMETRIA_AMOSTRA) || n.handle != handlesTelemetria[IDX_VALOR]) {
+      r.formato = false;
+      continue;
+    }
+    int seq = d[2] | (d[3] << 8);
+    if (seqAnterior >= 0 && seq != ((seqAnterior + 1) & 0xFFFF)) r.seqContinuo = false;
+    seqAnterior = seq;
+    r.amostras += d[1];
+    r.maxAmostras = std::max<size_t>(r.maxAmostras, d[1]);
+  }
+  return r;
+}
+
+static void ligarComApp() {
+  sim::ligar(setup, loop);
+  sim::rodar(500);
+  sim::ble.controles(controles(0, 0, 0));
+  sim::ble.conectar();
+  sim::rodarAte([]() { return RemoteXY.connect_flag == 1; }, 5000);
+}
+
+// Desliga o motor e desconecta antes de reiniciar (as variáveis do sketch continuam na memória do PC)
+static void desligarMotor() {
+  sim::ble.controles(controles(0, 0, 0));
+  sim::rodar(500);
+  sim::ble.desconectar();
+  sim::rodar(500);
+  sim::desligar();
+}
+
+int main() {
+  puts("boot e RemoteXY:");
+  ligarComApp();
+  VERIFICA(sim::ble.servidores == 1, "um BLEServer só (o do RemoteXY)");
+  VERIFICA(servicoTelemetria.load() && telemetriaIf.load() != ESP_GATT_IF_NONE && sim::contar("Telemetria desligada") == 0,
+           "app %#x registrada e serviço iniciado", APP_TELEMETRIA);
+  sim::ble.controles(controles(1, 0, 50));
+  sim::rodar(1000);
+  VERIFICA(dutyAplicado.load() == dutyDaVelocidade(50), "o app do RemoteXY continua mandando no motor (duty %u)",
+           dutyAplicado.load());
+  VERIFICA(mtuTelemetria.load() == MTU_PEDIDO, "MTU %u negociado", mtuTelemetria.load());
+
+  puts("sem assinar:");
+  size_t desde = sim::ble.notificacoes.size();
+  sim::rodar(1000);
+  VERIFICA(sim::ble.notificacoes.size() == desde && !notifyTelemetria.load(), "nenhum notify sem o CCCD ligado");
+
+  puts("assinando (MTU 247):");
+  VERIFICA(sim::ble.assinar(CARACTERISTICA_TELEMETRIA), "o celular acha o CCCD da característica");
+  sim::rodarAte([]() { return notifyTelemetria.load(); }, 1000);
+  sim::rodar(100);
+  desde = sim::ble.notificacoes.size();
+  sim::rodar(5000);
+  Recebido r = contarNotificacoes(desde);
+  printf("         %zu notify, %zu amostras em 5 s (max %zu por notify)\n", r.notificacoes, r.amostras, r.maxAmostras);
+  VERIFICA(r.formato && r.seqContinuo, "pacotes bem formados e seq sem buracos");
+  VERIFICA(r.amostras >= 5 * TELEMETRIA_HZ - 15 && r.amostras <= 5 * TELEMETRIA_HZ + 15, "~%d amostras/s", TELEMETRIA_HZ);
+  VERIFICA(r.notificacoes <= 5 * 1000 / TELEMETRIA_LATENCIA_MS + 2 && r.maxAmostras <= capacidadeTelemetria(),
+           "juntadas em notify de até %u amostras", capacidadeTelemetria());
+  VERIFICA(sim::ble.notificacoesRecusadas == 0 && notifyRecusados.load() == 0, "nenhum notify recusado");
+
+  puts("fila da pilha BLE cheia:");
+  uint32_t enviadas = notificacoesEnviadas, bytes = bytesTelemetria, amostras = amostrasTelemetria;
+  sim::ble.filaCheia = true;
+  sim::rodar(500);
+  sim::ble.filaCheia = false;
+  VERIFICA(notifyRecusados.load() > 0, "send_indicate com erro: %u recusados", notifyRecusados.load());
+  VERIFICA(notificacoesEnviadas == enviadas && bytesTelemetria == bytes && amostrasTelemetria == amostras,
+           "e nada entra nos contadores de enviados");
+  notifyRecusados = 0;
+
+  puts("desligando o notify:");
+  sim::ble.assinar(CARACTERISTICA_TELEMETRIA, false);
+  sim::rodar(500);
+  desde = sim::ble.notificacoes.size();
+  sim::rodar(1000);
+  VERIFICA(sim::ble.notificacoes.size() == desde, "para de mandar");
+
+  puts("reconexão:");
+  sim::ble.assinar(CARACTERISTICA_TELEMETRIA);
+  sim::rodar(500);
+  sim::ble.controles(controles(0, 0, 0)); // o failsafe da desconexão só desarma com o motor desligado
+  sim::rodar(500);
+  sim::ble.desconectar();
+  sim::rodarAte([]() { return !conectadoTelemetria.load(); }, 1000);
+  VERIFICA(!notifyTelemetria.load() && mtuTelemetria.load() == 23, "a desconexão zera a assinatura e o MTU");
+  sim::ble.conectar();
+  sim::rodarAte([]() { return RemoteXY.connect_flag == 1; }, 5000);
+  desde = sim::ble.notificacoes.size();
+  sim::rodar(1000);
+  VERIFICA(sim::ble.notificacoes.size() == desde, "sem assinar de novo, nada");
+  sim::ble.assinar(CARACTERISTICA_TELEMETRIA);
+  sim::rodar(1000);
+  VERIFICA(sim::ble.notificacoes.size() > desde && sim::ble.notificacoesRecusadas == 0, "assinando de novo, volta");
+  desligarMotor();
+
+  puts("iPhone (MTU 185):");
+  sim::ble = sim::Ble();
+  sim::ble.mtuCelular = 185;
+  ligarComApp();
+  sim::ble.assinar(CARACTERISTICA_TELEMETRIA);
+  sim::rodar(500);
+  desde = sim::ble.notificacoes.size();
+  sim::rodar(3000);
+  r = contarNotificacoes(desde);
+  VERIFICA(mtuTelemetria.load() == 185 && capacidadeTelemetria() == (185 - 3 - TELEMETRIA_CABECALHO) / TELEMETRIA_AMOSTRA,
+           "MTU 185: %u amostras por notify", capacidadeTelemetria());
+  VERIFICA(r.formato && r.maxAmostras <= capacidadeTelemetria() && sim::ble.notificacoesRecusadas == 0,
+           "nenhum notify maior que MTU - 3");
+  desligarMotor();
+  return fimDosTestes();
+}
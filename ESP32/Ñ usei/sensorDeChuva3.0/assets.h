@@ -0,0 +1,168 @@
+// Gerado por gerar_assets.py a partir da pasta data/. Não edite à mão:
+// mude os arquivos em data/ e rode o script de novo.
+#pragma once
+
+struct Asset {
+  const char* caminho;  // rota no servidor
+  const char* tipo;     // Content-Type
+  const char* cache;    // Cache-Control
+  const char* etag;     // hash do conteúdo, entre aspas
+  const uint8_t* dados; // conteúdo já em gzip
+  size_t tamanho;
+};
+
+// grafico.js: 2541 bytes -> 1155 bytes em gzip
+const uint8_t grafico_js_gz[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8d, 0x56, 0x4d, 0x6f, 0xdb, 0x46,
+  0x10, 0xbd, 0xeb, 0x57, 0x0c, 0x94, 0x0b, 0x19, 0x53, 0xb4, 0xe4, 0x8f, 0x20, 0xb5, 0x9d, 0x14,
+  0x41, 0x12, 0xa4, 0x87, 0xa4, 0x30, 0x6a, 0xa3, 0x1f, 0x30, 0x8c, 0x62, 0x4d, 0x8e, 0xc8, 0x8d,
+  0xa9, 0x5d, 0x66, 0x77, 0x25, 0x53, 0x6d, 0xfc, 0x47, 0x7a, 0x33, 0x7a, 0xea, 0x21, 0xa7, 0xdc,
+  0x7a, 0xe5, 0x1f, 0xeb, 0x0c, 0x97, 0xa4, 0x28, 0xc7, 0x30, 0x0a, 0x1b, 0x20, 0x77, 0x76, 0xe6,
+  0xcd, 0xec, 0x9b, 0xb7, 0x43, 0xed, 0xee, 0xc2, 0x3b, 0x53, 0xdf, 0xcd, 0x65, 0xa2, 0x21, 0x45,
+  0x28, 0xa4, 0xca, 0x05, 0x2c, 0xea, 0x2f, 0x4a, 0x2e, 0x34, 0xe0, 0x02, 0x4e, 0x12, 0xa1, 0x56,
+  0xc2, 0xbe, 0x8c, 0x40, 0x69, 0x28, 0x96, 0x99, 0x30, 0x90, 0x6a, 0xf8, 0x41, 0x66, 0x79, 0x92,
+  0x0b, 0xe3, 0x2c, 0x04, 0x9f, 0x96, 0x08, 0xab, 0x26, 0x2c, 0xc5, 0xd1, 0xee, 0x2e, 0x2c, 0x17,
+  0xf0, 0xfa, 0xcd, 0x8f, 0x80, 0xa0, 0xea, 0xbf, 0x35, 0x24, 0xc2, 0x18, 0xcc, 0x04, 0x43, 0x19,
+  0x4c, 0xd1, 0x82, 0xa5, 0x37, 0xa9, 0x1c, 0x1a, 0x85, 0x2e, 0x8c, 0xe1, 0x67, 0x21, 0x21, 0x33,
+  0x62, 0x25, 0x08, 0x95, 0x32, 0xbc, 0x3d, 0x3b, 0xdd, 0xdf, 0x83, 0x8f, 0x4b, 0xe5, 0xa8, 0x1c,
+  0xc1, 0x70, 0x65, 0x7d, 0x97, 0x49, 0x25, 0x20, 0x58, 0xa1, 0x81, 0x0c, 0x8d, 0x30, 0xbf, 0x0b,
+  0x6b, 0xd1, 0xd9, 0xb8, 0x5c, 0x53, 0xfc, 0x59, 0xfd, 0x15, 0x28, 0x12, 0x13, 0xb4, 0xb6, 0xbe,
+  0x33, 0x52, 0x1f, 0x01, 0xca, 0xaa, 0x39, 0x8b, 0xc3, 0x45, 0xa9, 0x23, 0x40, 0x9b, 0x88, 0x42,
+  0xc0, 0x74, 0x72, 0x30, 0x9b, 0x4e, 0x23, 0x5f, 0xa1, 0x00, 0x5b, 0xff, 0x63, 0x24, 0x52, 0x95,
+  0x1f, 0x85, 0x42, 0xda, 0x4e, 0xf4, 0x82, 0xf3, 0x2f, 0xea, 0xbb, 0x8a, 0x4f, 0x3e, 0x5e, 0x88,
+  0xea, 0x54, 0x53, 0x15, 0x76, 0x0c, 0x65, 0xf3, 0x8c, 0x47, 0xf3, 0xa5, 0x4a, 0x9c, 0xd4, 0x8a,
+  0x08, 0x13, 0xcc, 0x57, 0xe0, 0xa9, 0x89, 0x40, 0x97, 0x89, 0x46, 0x1b, 0xc2, 0x9f, 0x23, 0x00,
+  0x97, 0x4b, 0x1b, 0xfb, 0x0d, 0x78, 0x01, 0xfe, 0xe5, 0xb8, 0xb7, 0xbb, 0xaa, 0x37, 0xc6, 0x19,
+  0xba, 0xd7, 0x84, 0x8c, 0x95, 0x0b, 0xc6, 0x7b, 0xe9, 0x38, 0xec, 0xbd, 0xfa, 0xd4, 0xe4, 0xeb,
+  0xa1, 0x07, 0xa6, 0xcf, 0x9f, 0xe1, 0x60, 0xda, 0xbb, 0xae, 0x3f, 0x88, 0x6a, 0xe3, 0xd5, 0xac,
+  0xd8, 0x81, 0x0e, 0xba, 0xc9, 0xa9, 0xcd, 0xc6, 0x83, 0x17, 0xe4, 0x30, 0x7e, 0x32, 0x3d, 0xfc,
+  0x0e, 0x9f, 0x8b, 0x71, 0xef, 0xe5, 0xa4, 0x5b, 0x16, 0x7a, 0xe3, 0xd8, 0xae, 0xd9, 0x77, 0xe3,
+  0xc4, 0xa9, 0x2e, 0x2e, 0x37, 0xc9, 0xdb, 0xe5, 0xed, 0x88, 0x49, 0x3d, 0x5b, 0x5e, 0x59, 0x8e,
+  0x92, 0xe0, 0x74, 0x4a, 0x85, 0xd2, 0xbf, 0x27, 0x0e, 0x02, 0xac, 0xe2, 0x23, 0xa0, 0x08, 0x57,
+  0x7f, 0x35, 0xc4, 0x5b, 0x48, 0xac, 0x93, 0x12, 0x90, 0x25, 0xc3, 0xad, 0x58, 0xe1, 0x1f, 0xa3,
+  0x96, 0xd2, 0xb8, 0x34, 0xda, 0x69, 0xb7, 0x2e, 0x31, 0x4e, 0x71, 0x2e, 0x95, 0x34, 0x6f, 0x44,
+  0xda, 0x10, 0xd1, 0x93, 0x1f, 0x54, 0x11, 0xac, 0x07, 0x5c, 0x73, 0x51, 0xaf, 0x8c, 0x11, 0xeb,
+  0x41, 0xac, 0x2d, 0x64, 0x82, 0xd4, 0x85, 0xa2, 0x60, 0xef, 0xc9, 0x36, 0xab, 0xe1, 0xd6, 0x01,
+  0x1e, 0x09, 0x5d, 0x3f, 0x12, 0xda, 0xd6, 0x6f, 0x02, 0x32, 0xdd, 0x1e, 0x8f, 0x1e, 0xa8, 0x5f,
+  0xa4, 0x32, 0xa1, 0x7a, 0x85, 0x79, 0xb4, 0xf8, 0xb8, 0x5c, 0xda, 0x3c, 0xa8, 0x06, 0x35, 0x79,
+  0xcb, 0xba, 0xb1, 0xc8, 0x39, 0x04, 0xad, 0x5f, 0x81, 0x2a, 0x73, 0x39, 0xbc, 0xbc, 0x27, 0x11,
+  0x8f, 0xd5, 0xa3, 0xd9, 0x5c, 0xce, 0x5d, 0xd0, 0xc4, 0xf6, 0x78, 0x03, 0xdb, 0xed, 0xff, 0x2f,
+  0xbf, 0xf3, 0xd8, 0xaa, 0xde, 0x67, 0x5b, 0x91, 0x35, 0x21, 0x7b, 0x27, 0xe9, 0x08, 0x6e, 0xfa,
+  0x95, 0x97, 0xf6, 0x8d, 0x4c, 0x5d, 0x1e, 0x41, 0x7e, 0xcf, 0x9c, 0x23, 0x8d, 0x0d, 0x77, 0xdc,
+  0x42, 0xa0, 0xfd, 0x44, 0xfb, 0x07, 0x87, 0x11, 0xa4, 0x92, 0xd3, 0xcc, 0xa6, 0x11, 0x49, 0xa7,
+  0x64, 0x11, 0xee, 0xd3, 0xeb, 0x95, 0xb0, 0x48, 0xaf, 0x7b, 0x87, 0xc7, 0x40, 0xea, 0x5a, 0x08,
+  0x93, 0xa1, 0x22, 0x49, 0x09, 0x23, 0xc0, 0xd5, 0x5f, 0x1a, 0x75, 0x62, 0x73, 0xd5, 0x6d, 0x8b,
+  0x57, 0x90, 0x0b, 0x05, 0xdc, 0xc0, 0xa4, 0x81, 0x9e, 0x30, 0x6c, 0x04, 0xa2, 0x70, 0x64, 0xcc,
+  0x69, 0xd9, 0x60, 0x4f, 0x1a, 0x5c, 0x2e, 0x21, 0x89, 0x93, 0x02, 0x85, 0xf9, 0x09, 0x13, 0x17,
+  0x50, 0x3a, 0xfa, 0xbf, 0xa1, 0x8a, 0x43, 0xbf, 0x35, 0x27, 0x72, 0x29, 0x6c, 0x3c, 0xdb, 0x2b,
+  0x2b, 0x92, 0x88, 0x14, 0xc5, 0xb8, 0xdd, 0x90, 0x45, 0x71, 0xe6, 0xd6, 0x05, 0x97, 0x36, 0x7e,
+  0xb2, 0xbf, 0xbf, 0xdf, 0xda, 0xf9, 0x1a, 0xbf, 0x2a, 0x64, 0xa6, 0xd8, 0x9e, 0x20, 0xcf, 0xb7,
+  0x41, 0xc4, 0x39, 0x5f, 0xf2, 0xc1, 0x3d, 0x63, 0xc6, 0x76, 0x61, 0x2f, 0x82, 0xd9, 0x73, 0x4a,
+  0x48, 0x6e, 0x74, 0xc2, 0xb7, 0x3c, 0xb5, 0x7e, 0x3b, 0x82, 0x43, 0x3f, 0x83, 0x2d, 0x4f, 0x30,
+  0x1a, 0x8c, 0x34, 0x53, 0x19, 0xc5, 0x3a, 0xa3, 0xaf, 0x71, 0x93, 0x19, 0x9f, 0xf1, 0xdf, 0x43,
+  0xc9, 0x0d, 0x73, 0xdc, 0x6c, 0xcc, 0xe9, 0xb2, 0x07, 0xcc, 0x8c, 0x24, 0xfb, 0xf4, 0x98, 0x1e,
+  0x27, 0xc4, 0x37, 0x3d, 0x77, 0x76, 0x3a, 0xd9, 0xf0, 0x6e, 0xc6, 0xd7, 0xa0, 0x21, 0x67, 0xa7,
+  0x61, 0x6b, 0x02, 0x01, 0x3f, 0x9e, 0x82, 0x0c, 0xa9, 0xc8, 0x03, 0xaf, 0xa5, 0x24, 0xbe, 0x42,
+  0x1a, 0xc3, 0xa7, 0xc2, 0xe5, 0xa4, 0x19, 0x5a, 0x2e, 0xf4, 0x0a, 0xcf, 0x75, 0x40, 0x4c, 0x47,
+  0x84, 0xd0, 0x98, 0xa8, 0xee, 0xd6, 0x44, 0x48, 0xdc, 0x8d, 0x7e, 0xc7, 0x57, 0xdf, 0xe9, 0x72,
+  0xc0, 0xc9, 0x07, 0xc2, 0x8b, 0x8d, 0x5e, 0xaa, 0x34, 0x08, 0x36, 0x03, 0xad, 0x4b, 0x1d, 0x46,
+  0x6d, 0x27, 0x0f, 0x19, 0x89, 0x40, 0x0f, 0x7a, 0x15, 0x73, 0xe1, 0xaa, 0x93, 0x57, 0x77, 0x3b,
+  0xba, 0x2b, 0x43, 0x1b, 0x2f, 0xe8, 0xc4, 0x21, 0x7d, 0x71, 0xdc, 0xd2, 0xa8, 0x2d, 0x86, 0x7f,
+  0xa5, 0x49, 0xa4, 0x4d, 0xf3, 0xa5, 0xe0, 0x0f, 0x59, 0x69, 0xe4, 0x02, 0xa5, 0x61, 0x2d, 0xd1,
+  0xaa, 0xfe, 0xb7, 0x70, 0x3c, 0xfd, 0x9b, 0xc1, 0xd5, 0x66, 0xa9, 0xa6, 0x7d, 0x9a, 0x8b, 0xe9,
+  0x65, 0x04, 0xd5, 0x6c, 0xb3, 0x56, 0x54, 0xdb, 0x8c, 0x6c, 0x29, 0x0f, 0xa1, 0xe6, 0x2c, 0x74,
+  0x31, 0x83, 0x59, 0xe3, 0x34, 0xa1, 0xc8, 0xf0, 0x81, 0xfe, 0x14, 0x38, 0x77, 0xf7, 0xa5, 0xa1,
+  0xf0, 0x06, 0xde, 0x08, 0x87, 0x01, 0x85, 0xc4, 0x4e, 0xbf, 0xd7, 0x34, 0x7f, 0xf0, 0x9c, 0x2a,
+  0x3b, 0x73, 0x46, 0xaa, 0x2c, 0xf0, 0x44, 0x44, 0x8d, 0x8c, 0x9f, 0x85, 0x8f, 0x36, 0xfd, 0x41,
+  0xd4, 0xd9, 0x23, 0xa8, 0x7d, 0xaf, 0x3a, 0xf0, 0x07, 0xf4, 0xd6, 0x7d, 0x48, 0x7c, 0x02, 0xee,
+  0xf3, 0x2f, 0x7c, 0xc3, 0xf9, 0x7a, 0x7a, 0xd3, 0x50, 0x1c, 0x43, 0xe5, 0x5d, 0x7b, 0xe5, 0x5d,
+  0xc3, 0x09, 0x28, 0x7a, 0x6c, 0x0b, 0xaf, 0x64, 0xd6, 0x7c, 0x05, 0x6d, 0xcb, 0x66, 0xf0, 0xbd,
+  0xbf, 0xc6, 0x47, 0xd0, 0xea, 0xa1, 0xba, 0xb8, 0xbe, 0xf4, 0x54, 0x92, 0x20, 0xd2, 0x2a, 0x24,
+  0x6d, 0xb0, 0x43, 0xab, 0xa4, 0x06, 0xe5, 0x5b, 0xf9, 0xfa, 0x4e, 0x48, 0xd5, 0x4a, 0x8a, 0x20,
+  0xa2, 0xcd, 0xe7, 0x92, 0x81, 0x06, 0x8b, 0xa7, 0x1c, 0xe4, 0xd1, 0x58, 0x3a, 0xd7, 0x9d, 0x74,
+  0x7a, 0x85, 0x97, 0x34, 0xdf, 0x4a, 0x96, 0x31, 0x16, 0x34, 0x90, 0x7a, 0x95, 0x77, 0xe6, 0x56,
+  0x8f, 0xdb, 0x1a, 0xdf, 0xe6, 0x68, 0xd6, 0x09, 0xb0, 0xfe, 0xcb, 0xcb, 0x6b, 0x25, 0x0a, 0x4d,
+  0xa3, 0x89, 0x7e, 0x72, 0x68, 0xe0, 0x9f, 0x39, 0x4e, 0xbc, 0x17, 0x57, 0x58, 0xb0, 0x02, 0xb3,
+  0xee, 0xb7, 0x98, 0x50, 0x4e, 0x66, 0xfa, 0x9b, 0x99, 0xb3, 0xdd, 0x89, 0xed, 0xd9, 0xb2, 0xee,
+  0xf5, 0x38, 0x6c, 0x2b, 0xf1, 0xe3, 0xfb, 0x4a, 0x73, 0xfe, 0x3f, 0x61, 0x22, 0xb5, 0x83, 0xed,
+  0x09, 0x00, 0x00,
+};
+
+// index.html: 2311 bytes -> 1105 bytes em gzip
+const uint8_t index_html_gz[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x85, 0x56, 0xcb, 0x6e, 0xe3, 0x36,
+  0x14, 0xdd, 0xe7, 0x2b, 0x6e, 0x54, 0x14, 0x90, 0x10, 0x4b, 0x7e, 0xc4, 0x18, 0x04, 0xb6, 0xec,
+  0x62, 0x3a, 0x49, 0xdb, 0x14, 0x4d, 0x1b, 0x8c, 0x3d, 0x8b, 0x22, 0xcd, 0x82, 0x23, 0x5d, 0x5b,
+  0x2c, 0x24, 0xd2, 0x25, 0x29, 0xc5, 0x9e, 0x41, 0x3e, 0x66, 0xd0, 0x45, 0x3f, 0x20, 0xbb, 0x6e,
+  0xfd, 0x63, 0xbd, 0x94, 0x28, 0x3f, 0x26, 0x09, 0x9a, 0x8d, 0x6d, 0xf2, 0x3e, 0xcf, 0x39, 0xf7,
+  0x32, 0xf1, 0xe9, 0xe5, 0x6f, 0xef, 0xe6, 0xbf, 0xdf, 0x5e, 0xc1, 0x4f, 0xf3, 0x9b, 0x5f, 0xa6,
+  0x71, 0x66, 0x8a, 0x7c, 0x7a, 0x12, 0x67, 0xc8, 0xd2, 0xe9, 0x09, 0x40, 0x5c, 0xa0, 0x61, 0x20,
+  0x58, 0x81, 0x13, 0xaf, 0xe2, 0xf8, 0xb0, 0x92, 0xca, 0x78, 0x90, 0x48, 0x61, 0x50, 0x98, 0x89,
+  0xf7, 0xc0, 0x53, 0x93, 0x4d, 0x52, 0xac, 0x78, 0x82, 0x61, 0xfd, 0xa3, 0x03, 0x5c, 0x70, 0xc3,
+  0x59, 0x1e, 0xea, 0x84, 0xe5, 0x38, 0xe9, 0x7b, 0xfb, 0x30, 0x49, 0xc6, 0x94, 0x46, 0x72, 0xfb,
+  0x30, 0xff, 0x21, 0xbc, 0x68, 0x2e, 0x0c, 0x37, 0x39, 0x4e, 0x6f, 0x24, 0x39, 0x49, 0x05, 0x29,
+  0xc2, 0xbb, 0xac, 0xac, 0x18, 0x5c, 0xcd, 0x6e, 0xcf, 0x07, 0x71, 0xb7, 0xb9, 0xb5, 0x76, 0xa7,
+  0x61, 0x08, 0x3f, 0xaa, 0xed, 0x97, 0x05, 0x4f, 0x24, 0x2c, 0x15, 0xab, 0x58, 0x2a, 0x41, 0x48,
+  0x58, 0xa9, 0xed, 0xd3, 0x4a, 0x71, 0xd9, 0x78, 0x80, 0xbf, 0x28, 0x45, 0xc2, 0xa5, 0x60, 0xa0,
+  0xb1, 0xa0, 0x52, 0x0c, 0x2a, 0x81, 0x26, 0x80, 0x30, 0xac, 0xa3, 0xe8, 0x44, 0xf1, 0x95, 0x01,
+  0xad, 0x92, 0x89, 0xd7, 0xa5, 0x28, 0x36, 0x5a, 0xf4, 0xa7, 0xfe, 0xae, 0x9a, 0xe0, 0xc5, 0x02,
+  0xdf, 0x5c, 0x9c, 0x0f, 0x87, 0xc3, 0xf3, 0x8f, 0xde, 0x34, 0xee, 0x36, 0x96, 0x8d, 0x93, 0xd9,
+  0x34, 0x45, 0x00, 0x7c, 0x94, 0xe9, 0x06, 0x3e, 0x43, 0xc1, 0x45, 0xd3, 0xed, 0x08, 0xce, 0xfb,
+  0xbd, 0xd5, 0x7a, 0x0c, 0x05, 0x5b, 0xb7, 0x27, 0x17, 0x3d, 0x77, 0xa2, 0x96, 0x5c, 0x8c, 0xa0,
+  0x07, 0xac, 0x34, 0x72, 0x0c, 0x0b, 0xc2, 0x2c, 0x5c, 0xb0, 0x82, 0xe7, 0x9b, 0x11, 0xbc, 0x55,
+  0x84, 0xd0, 0x18, 0x0c, 0xae, 0x4d, 0xc8, 0x72, 0xbe, 0x24, 0xbb, 0x04, 0x6d, 0xb1, 0x63, 0x78,
+  0xac, 0x13, 0x65, 0x03, 0x4a, 0x93, 0xc8, 0x5c, 0xaa, 0x11, 0x7c, 0xd3, 0x1b, 0x0e, 0xf0, 0xcd,
+  0xa2, 0xbd, 0x4a, 0x98, 0xa8, 0x98, 0xa6, 0x6b, 0x97, 0xaf, 0xdf, 0xeb, 0x7d, 0xdb, 0xdc, 0x51,
+  0xd5, 0x4d, 0xa9, 0x71, 0xb7, 0xe1, 0x2f, 0xb6, 0xf5, 0xd6, 0x3d, 0x64, 0x83, 0x16, 0x63, 0xa2,
+  0x52, 0x18, 0xb9, 0x47, 0x9a, 0x60, 0x9a, 0x63, 0xb1, 0x92, 0xf0, 0x1e, 0x59, 0x4e, 0x8e, 0x83,
+  0xda, 0xde, 0x25, 0xe1, 0xe9, 0xc4, 0xb3, 0xac, 0x99, 0x30, 0xb1, 0xc6, 0x5e, 0x93, 0x73, 0xe2,
+  0x51, 0x8f, 0x1e, 0x64, 0xc8, 0x97, 0x19, 0xb1, 0x39, 0xa4, 0x1f, 0x84, 0x58, 0xe3, 0x72, 0x00,
+  0x73, 0x03, 0x59, 0xb7, 0x0b, 0x1f, 0x0a, 0x06, 0x19, 0x65, 0xb6, 0x49, 0x73, 0xe4, 0xa6, 0x54,
+  0x14, 0x9a, 0xe4, 0xc0, 0x52, 0x06, 0x03, 0xd0, 0xb5, 0x59, 0xc5, 0x54, 0xad, 0x0f, 0x33, 0x87,
+  0x09, 0x08, 0x7c, 0x20, 0xb2, 0x6b, 0x76, 0xfc, 0x54, 0x26, 0xa5, 0x2d, 0x39, 0x5a, 0xa2, 0xb9,
+  0xca, 0xd1, 0x7e, 0xfd, 0x7e, 0x73, 0x9d, 0xfa, 0x47, 0x75, 0x05, 0x9d, 0x3a, 0xc8, 0xab, 0x7f,
+  0x9f, 0x81, 0x94, 0x54, 0xe6, 0x72, 0x04, 0xde, 0xaf, 0xbc, 0xc2, 0x7c, 0xd7, 0xbe, 0xd7, 0xb1,
+  0xd4, 0xdd, 0x12, 0x37, 0x52, 0x13, 0x94, 0xd4, 0x57, 0x07, 0x36, 0x37, 0x6c, 0x3d, 0x82, 0x21,
+  0xe1, 0x0a, 0x8f, 0xc1, 0xb8, 0xc1, 0xbc, 0xae, 0x2c, 0x4a, 0x51, 0xa3, 0xa0, 0xaf, 0xbe, 0x3b,
+  0xb6, 0x45, 0x97, 0xb9, 0xe1, 0x85, 0xbc, 0x16, 0xda, 0x30, 0x22, 0x90, 0x8a, 0xef, 0x8d, 0x6d,
+  0xcf, 0xc4, 0x73, 0xce, 0xb5, 0x1f, 0x40, 0xda, 0x4a, 0x93, 0x9a, 0xdd, 0xfe, 0x6b, 0x8d, 0x59,
+  0x0b, 0x82, 0xd5, 0xef, 0xd2, 0x69, 0x7a, 0x17, 0x2f, 0xe5, 0x0b, 0x54, 0x28, 0x12, 0xf6, 0x1e,
+  0x73, 0xb9, 0x24, 0x61, 0xb7, 0x11, 0x2f, 0x99, 0xc1, 0x48, 0xc8, 0x07, 0x8a, 0x19, 0x3e, 0x0f,
+  0x7f, 0xd2, 0x82, 0xdd, 0x0f, 0xe0, 0xed, 0x2e, 0x51, 0x8d, 0x3a, 0x31, 0x5c, 0xd2, 0x77, 0x85,
+  0x7f, 0x95, 0x5c, 0xf3, 0xed, 0x3f, 0xdb, 0xbf, 0x25, 0xe8, 0xed, 0x53, 0x07, 0x5c, 0x3b, 0x69,
+  0x4d, 0x8c, 0x35, 0xa9, 0xf0, 0x53, 0x1d, 0x66, 0x81, 0x26, 0xc9, 0x7c, 0xaf, 0x9b, 0x71, 0x4d,
+  0x8a, 0xd9, 0x78, 0x41, 0x64, 0x32, 0x14, 0xf5, 0x6c, 0x19, 0x1a, 0x2e, 0xf0, 0x55, 0x40, 0x90,
+  0x2a, 0xa4, 0x26, 0x04, 0xa8, 0xc8, 0xca, 0x98, 0x20, 0x21, 0xb4, 0xbe, 0xb6, 0x4b, 0x74, 0x45,
+  0x96, 0x8e, 0x1b, 0xdb, 0x5d, 0xce, 0x29, 0xa1, 0xa6, 0x9e, 0xe8, 0x26, 0x32, 0x8a, 0x17, 0x7e,
+  0x10, 0xe9, 0x55, 0xce, 0x8d, 0xef, 0xfd, 0x21, 0x3c, 0x07, 0x2b, 0xbc, 0x04, 0xc2, 0x51, 0xfb,
+  0x2b, 0xbb, 0x48, 0xae, 0x85, 0xf1, 0x9b, 0x78, 0x77, 0xbd, 0xfb, 0x36, 0x4a, 0xc7, 0x0b, 0xee,
+  0xfa, 0xf7, 0x41, 0x8d, 0x98, 0xc7, 0x96, 0xd4, 0x7f, 0x27, 0x6e, 0xc0, 0x9a, 0x7a, 0x07, 0x75,
+  0xac, 0x6d, 0x0d, 0x77, 0xf7, 0x44, 0x76, 0xf3, 0xa5, 0x4d, 0xbc, 0xa0, 0x25, 0xe4, 0x5b, 0x03,
+  0x4e, 0xc7, 0xfd, 0x31, 0x7d, 0xc4, 0xae, 0xe6, 0x28, 0x47, 0xb1, 0x34, 0x19, 0x1d, 0x9d, 0x9d,
+  0xed, 0x7b, 0x72, 0xc2, 0x65, 0x34, 0x40, 0x36, 0x90, 0x2b, 0x87, 0x1f, 0x96, 0x33, 0xde, 0x99,
+  0xae, 0x75, 0xb4, 0x2a, 0x75, 0xe6, 0xef, 0xaa, 0x6f, 0xfc, 0xa8, 0xfa, 0x00, 0xce, 0x9e, 0xf5,
+  0x7c, 0xe0, 0xb8, 0x79, 0xc5, 0x91, 0x1a, 0x3d, 0xb0, 0x7a, 0xa6, 0xc4, 0x17, 0xf2, 0xb4, 0xd6,
+  0x8f, 0xee, 0x73, 0x27, 0xec, 0x05, 0xad, 0x6d, 0x75, 0x49, 0x4b, 0x55, 0xfb, 0x6b, 0x6d, 0x61,
+  0x71, 0xa6, 0xc4, 0x69, 0xc2, 0xac, 0x1a, 0xf6, 0xa4, 0x52, 0xf7, 0x2d, 0xd3, 0xe4, 0x94, 0x70,
+  0xa6, 0xae, 0x2a, 0xbb, 0x53, 0xac, 0x4b, 0xab, 0xc2, 0x41, 0x00, 0x97, 0xb8, 0x92, 0x9c, 0x42,
+  0x59, 0x61, 0xd1, 0x83, 0x81, 0x6b, 0xa7, 0xbb, 0x11, 0xb4, 0x13, 0x41, 0x6b, 0xa7, 0x54, 0xca,
+  0x2d, 0x82, 0xfd, 0x4c, 0xd0, 0x52, 0xf2, 0x67, 0xa8, 0x2a, 0x54, 0xe1, 0x8c, 0xe2, 0xb6, 0x21,
+  0xeb, 0x24, 0x3a, 0x88, 0x60, 0x86, 0x70, 0x10, 0x31, 0x61, 0x5c, 0x75, 0x28, 0xa4, 0x60, 0x15,
+  0x2e, 0xa9, 0x7e, 0x45, 0xba, 0xb4, 0x97, 0x09, 0x3d, 0x38, 0x5a, 0x7e, 0x22, 0x42, 0x64, 0xd4,
+  0x88, 0xba, 0x6d, 0xe0, 0xb8, 0x68, 0xff, 0x58, 0xa0, 0xd8, 0x9c, 0xba, 0x25, 0x54, 0xdb, 0xcc,
+  0x64, 0xa9, 0x12, 0xa4, 0x71, 0x70, 0x77, 0x7b, 0x4a, 0xdd, 0x41, 0x24, 0x45, 0x81, 0x5a, 0xb3,
+  0xa5, 0x05, 0x7d, 0x8f, 0x13, 0xbe, 0x2a, 0x13, 0x8c, 0x52, 0x66, 0x58, 0xab, 0x91, 0xb1, 0xe7,
+  0xe4, 0x5a, 0x31, 0xda, 0xf7, 0x63, 0xee, 0x08, 0xf4, 0x8e, 0x7c, 0xf9, 0xeb, 0xb4, 0xf6, 0xef,
+  0x0f, 0x44, 0xc0, 0x17, 0xe0, 0xef, 0x6c, 0xe3, 0xc9, 0x57, 0xa2, 0x08, 0xdc, 0xd0, 0xd6, 0xf9,
+  0x7e, 0xde, 0x7e, 0xa1, 0x89, 0xe7, 0xf5, 0x33, 0x6a, 0x27, 0x7d, 0xfb, 0xa4, 0xda, 0x45, 0xf4,
+  0xa2, 0x9c, 0xda, 0xb0, 0xc7, 0xc9, 0x4e, 0x9f, 0xe9, 0xf6, 0x7f, 0xa7, 0x77, 0x17, 0xc8, 0x56,
+  0x31, 0xa3, 0xf5, 0xf4, 0x42, 0x76, 0x27, 0x4c, 0x96, 0xf2, 0xfa, 0x39, 0x57, 0xfb, 0xa6, 0x9e,
+  0x4f, 0x4a, 0xe7, 0x25, 0xa5, 0xef, 0xa5, 0xee, 0x84, 0xdc, 0x3c, 0x90, 0xee, 0x65, 0x8a, 0xbb,
+  0xcd, 0xd3, 0x48, 0x0f, 0x5e, 0xfd, 0x0f, 0xcf, 0x7f, 0xcf, 0x55, 0x73, 0x84, 0x07, 0x09, 0x00,
+  0x00,
+};
+
+const Asset assets[] = {
+  { "/grafico.js", "application/javascript", "public, max-age=31536000, immutable", "\"e8fe6834443b\"", grafico_js_gz, sizeof(grafico_js_gz) },
+  { "/", "text/html; charset=utf-8", "no-cache", "\"0dd95b56e873\"", index_html_gz, sizeof(index_html_gz) },
+};
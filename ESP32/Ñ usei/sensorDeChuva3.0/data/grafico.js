@@ -0,0 +1,75 @@
+// Gráfico de linha mínimo em <canvas>, no lugar do Highcharts (que vinha de
+// um CDN e não carrega em redes sem internet). Vai gravado no ESP32 junto da
+// página (ver gerar_assets.py). Só o necessário: eixo de tempo, escala 0-4100,
+// uma série e janela com no máximo "maxPontos" pontos.
+function Grafico(canvas, opcoes) {
+  this.canvas = canvas;
+  this.ctx = canvas.getContext("2d");
+  this.maxPontos = opcoes.maxPontos || 40;
+  this.yMax = opcoes.yMax || 4100;
+  this.cor = opcoes.cor || "#059e8a";
+  this.titulo = opcoes.titulo || "";
+  this.x = [];
+  this.y = [];
+}
+
+// Substitui todos os pontos (ex.: histórico) e desenha uma vez
+Grafico.prototype.definirDados = function (x, y) {
+  this.x = Array.prototype.slice.call(x, -this.maxPontos);
+  this.y = Array.prototype.slice.call(y, -this.maxPontos);
+  this.desenhar();
+};
+
+Grafico.prototype.adicionar = function (x, y) {
+  this.x.push(x);
+  this.y.push(y);
+  if (this.x.length > this.maxPontos) {
+    this.x.shift();
+    this.y.shift();
+  }
+  this.desenhar();
+};
+
+Grafico.prototype.desenhar = function () {
+  var c = this.ctx, w = this.canvas.width, h = this.canvas.height;
+  var esq = 45, dir = 10, topo = 30, base = 25; // margens para título e eixos
+  var larg = w - esq - dir, alt = h - topo - base;
+  c.clearRect(0, 0, w, h);
+  c.font = "12px Arial";
+  c.fillStyle = "#333";
+  c.textAlign = "center";
+  c.fillText(this.titulo, w / 2, 18);
+
+  // Eixo Y: 5 linhas de grade
+  c.strokeStyle = "#e6e6e6";
+  c.textAlign = "right";
+  for (var i = 0; i <= 4; i++) {
+    var gy = topo + alt - (alt * i) / 4;
+    c.beginPath(); c.moveTo(esq, gy); c.lineTo(esq + larg, gy); c.stroke();
+    c.fillText(Math.round((this.yMax * i) / 4), esq - 5, gy + 4);
+  }
+  var n = this.x.length;
+  if (n === 0) return;
+
+  // Eixo X: horário do primeiro e do último ponto
+  var x0 = this.x[0], x1 = this.x[n - 1], dx = Math.max(1, x1 - x0);
+  c.textAlign = "left";
+  c.fillText(new Date(x0).toLocaleTimeString(), esq, h - 6);
+  c.textAlign = "right";
+  c.fillText(new Date(x1).toLocaleTimeString(), esq + larg, h - 6);
+
+  c.strokeStyle = this.cor;
+  c.lineWidth = 2;
+  c.beginPath();
+  for (var k = 0; k < n; k++) {
+    var px = esq + (n === 1 ? larg : ((this.x[k] - x0) / dx) * larg);
+    var py = topo + alt - (Math.min(this.y[k], this.yMax) / this.yMax) * alt;
+    if (k === 0) c.moveTo(px, py); else c.lineTo(px, py);
+  }
+  c.stroke();
+  c.lineWidth = 1;
+
+  // Último valor, como o dataLabel do gráfico antigo
+  c.fillStyle = this.cor;
+  c.fillText(this.y[n - 1], esq + larg, py - 6);
+};
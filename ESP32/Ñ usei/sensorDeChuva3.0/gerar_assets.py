@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+# Gera assets.h a partir dos arquivos da pasta data/.
+#
+# Cada arquivo é comprimido com gzip (nível 9) e vira um vetor de bytes na
+# flash do ESP32, junto com o ETag (hash do conteúdo). O servidor envia os bytes
+# do jeito que estão, com "Content-Encoding: gzip": o ESP32 não comprime nada.
+#
+# Dentro dos arquivos, {{nome}} é trocado pelo hash do arquivo "nome" (ex.:
+# "/grafico.js?v={{grafico.js}}"). Assim o grafico.js pode ficar em cache por
+# um ano: quando ele muda, o endereço na página muda junto.
+#
+# Uso (na pasta do sketch, sempre que mudar algo em data/):
+#   python3 gerar_assets.py
+
+import gzip
+import hashlib
+import os
+import re
+
+PASTA = os.path.join(os.path.dirname(os.path.abspath(__file__)), "data")
+SAIDA = os.path.join(os.path.dirname(os.path.abspath(__file__)), "assets.h")
+
+TIPOS = {".html": "text/html; charset=utf-8", ".js": "application/javascript", ".css": "text/css"}
+
+# index.html é revalidado a cada visita (304 se não mudou); o resto é versionado pela URL
+CACHE_PAGINA = "no-cache"
+CACHE_VERSIONADO = "public, max-age=31536000, immutable"
+
+
+def identificador(nome):
+    return re.sub(r"[^0-9a-zA-Z]", "_", nome)
+
+
+def main():
+    # Páginas por último: elas citam o hash dos outros arquivos
+    nomes = sorted(os.listdir(PASTA), key=lambda n: (n.endswith(".html"), n))
+    hashes = {}
+    linhas = [
+        "// Gerado por gerar_assets.py a partir da pasta data/. Não edite à mão:",
+        "// mude os arquivos em data/ e rode o script de novo.",
+        "#pragma once",
+        "",
+        "struct Asset {",
+        "  const char* caminho;  // rota no servidor",
+        "  const char* tipo;     // Content-Type",
+        "  const char* cache;    // Cache-Control",
+        "  const char* etag;     // hash do conteúdo, entre aspas",
+        "  const uint8_t* dados; // conteúdo já em gzip",
+        "  size_t tamanho;",
+        "};",
+        "",
+    ]
+    tabela = []
+
+    for nome in nomes:
+        with open(os.path.join(PASTA, nome), "rb") as f:
+            conteudo = f.read()
+        conteudo = re.sub(rb"\{\{([^}]+)\}\}", lambda m: hashes[m.group(1).decode()].encode(), conteudo)
+        hashes[nome] = hashlib.sha1(conteudo).hexdigest()[:12]
+        comprimido = gzip.compress(conteudo, 9, mtime=0)  # mtime=0: mesmo arquivo, mesmos bytes
+
+        ident = identificador(nome)
+        linhas.append("// %s: %d bytes -> %d bytes em gzip" % (nome, len(conteudo), len(comprimido)))
+        linhas.append("const uint8_t %s_gz[] PROGMEM = {" % ident)
+        for i in range(0, len(comprimido), 16):
+            linhas.append("  " + ", ".join("0x%02x" % b for b in comprimido[i:i + 16]) + ",")
+        linhas.append("};")
+        linhas.append("")
+
+        pagina = nome.endswith(".html")
+        caminho = "/" if nome == "index.html" else "/" + nome
+        tabela.append('  { "%s", "%s", "%s", "\\"%s\\"", %s_gz, sizeof(%s_gz) },' % (
+            caminho, TIPOS[os.path.splitext(nome)[1]], CACHE_PAGINA if pagina else CACHE_VERSIONADO,
+            hashes[nome], ident, ident))
+        print("%-12s %6d -> %6d bytes" % (nome, len(conteudo), len(comprimido)))
+
+    linhas.append("const Asset assets[] = {")
+    linhas.extend(tabela)
+    linhas.append("};")
+    linhas.append("")
+
+    with open(SAIDA, "w", encoding="utf-8") as f:
+        f.write("\n".join(linhas))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,5 +1,9 @@
 #include <WiFi.h>
-#include <WebServer.h>
+#include <AsyncTCP.h>          // https://github.com/me-no-dev/AsyncTCP
+#include <ESPAsyncWebServer.h> // https://github.com/me-no-dev/ESPAsyncWebServer
+#include <atomic>
+#include "esp_heap_caps.h"
+#include <metricas.h> // ESP32/libraries/Metricas
 
 // --- CONFIGURAÇÕES DE REDE ---
 const char* ssid = "Jorgemar";     // Coloque o nome EXATO do Wi-Fi
@@ -10,66 +14,109 @@ const int pinoSensor = 36; // VP
 const int pinoLED = 26;
 
 // --- OBJETOS ---
-WebServer server(80); // Cria o servidor na porta padrão 80
+// Servidor assíncrono: as requisições são atendidas por eventos da pilha TCP
+// (tarefa async_tcp), sem loop() chamando handleClient(). Um celular lento no
+// Wi-Fi fraco não trava mais os outros: cada conexão anda no seu ritmo.
+AsyncWebServer server(80); // Cria o servidor na porta padrão 80
+
+// --- ORÇAMENTO DE CONEXÕES TCP ---
+// O AsyncTCP usa a API raw do lwIP (sem sockets), então o limite não é o
+// CONFIG_LWIP_MAX_SOCKETS: cada conexão, HTTP ou SSE, ocupa um PCB TCP, e só
+// existem MEMP_NUM_TCP_PCB (CONFIG_LWIP_MAX_ACTIVE_TCP, 16 no Arduino-ESP32).
+// Sem PCB livre o lwIP só recicla conexões em TIME_WAIT (ou de prioridade
+// menor); se não houver, o SYN é descartado e o navegador só tenta de novo
+// depois de 1, 2, 4 s. Por isso os dois limites abaixo somados deixam
+// FOLGA_PCBS livres: quem passou do limite ainda precisa de um PCB para
+// receber o 503.
+#define PCBS_TCP 16
+#define FOLGA_PCBS 4
+#define MAX_CONEXOES 6     // requisições HTTP abertas ao mesmo tempo
+#define MAX_CLIENTES_SSE 6 // conexões abertas no /eventos
+static_assert(MAX_CONEXOES + MAX_CLIENTES_SSE + FOLGA_PCBS <= PCBS_TCP, "Conexoes demais para os PCBs do lwIP");
+
+// Acima do limite a resposta é um 503 imediato, em vez de a memória acabar.
+std::atomic<int> conexoesAbertas(0);
+std::atomic<int> clientesSse(0);
+
+// --- AMOSTRAGEM (UMA LEITURA PARA TODOS OS CLIENTES) ---
+// Uma única tarefa lê o sensor a cada INTERVALO_AMOSTRA e controla o LED.
+// Antes, cada GET /chuva fazia um analogRead(): N navegadores = N leituras.
+#define INTERVALO_AMOSTRA 2000 // ms
+std::atomic<int> ultimoValor(0);
+std::atomic<uint32_t> ultimoInstante(0); // millis() da última leitura
+std::atomic<uint32_t> amostraSeq(0);     // sobe a cada leitura nova
+std::atomic<uint32_t> maxLeituraAdc(0);  // us, desde o último relatório
+
+// --- HISTÓRICO (/history) ---
+// Anel com a última hora de leituras, preenchido pela tarefa de amostragem.
+// Quem abre a página recebe tudo em uma requisição e o gráfico já nasce cheio.
+// A tarefa escreve a posição e só depois incrementa historicoTotal; quem lê
+// confere, depois de copiar, se a posição não foi sobrescrita no meio do caminho.
+#define TAM_HISTORICO 1800 // 1 hora a cada 2 s (14 KB de RAM)
+struct Amostra {
+  uint32_t instante; // millis() da leitura
+  int16_t valor;
+};
+Amostra historico[TAM_HISTORICO];
+std::atomic<uint32_t> historicoTotal(0); // leituras já guardadas desde o boot
+
+// --- SERVER-SENT EVENTS (/eventos) ---
+// O navegador abre UMA conexão (EventSource) e recebe cada leitura nova: sem
+// polling e sem um handshake HTTP a cada 2 s. Cada evento tem só ~30 bytes:
+// "id: <seq>\ndata: <valor>;<instante>\n\n" (instante = millis() da leitura, o
+// mesmo relógio do /history).
+//
+// Cada cliente é uma resposta em pedaços (chunked) que não termina nunca. A
+// biblioteca chama a função que preenche o pedaço na tarefa async_tcp, sempre
+// que a conexão aceita mais bytes: a cada ACK e, com a conexão parada, no poll
+// do lwIP (~0,5 s). Se há leitura nova, ela escreve o evento; senão devolve
+// RESPONSE_TRY_AGAIN. Assim todo envio acontece na mesma tarefa que abre e
+// fecha as conexões, e o loop() não mexe em cliente nenhum. Um cliente lento
+// não acumula fila: quando a conexão libera, recebe só a leitura mais nova.
+#define SSE_RECONEXAO 3000 // ms até o navegador reconectar se a conexão cair
+
+// Tempos para o Monitor Serial (a cada RELATORIO_TEMPOS). Escritos na tarefa
+// async_tcp, lidos e zerados pelo loop().
+#define RELATORIO_TEMPOS 10000 // ms
+std::atomic<uint32_t> maxEnvio(0);        // us: escrever um evento para um cliente
+std::atomic<uint32_t> somaEnvio(0);       // us somados na janela (para a média por cliente)
+std::atomic<uint32_t> eventosEnviados(0); // envios (evento x cliente) na janela
+unsigned long ultimoRelatorio = 0;
+
+// --- MÉTRICAS (/metrics) ---
+// Distribuição dos tempos (histogramas) e contadores desde o boot, no formato
+// texto do Prometheus: GET /metrics (ou um Prometheus configurado para raspar o
+// ESP32). Registrar uma medida é só um incremento atômico (ver metricas.h).
+const uint32_t LIMITES_US[] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000 };
+Histograma metricaLeituraAdc("chuva_adc_leitura_us", "analogRead + LED na tarefa de amostragem (us)", LIMITES_US);
+Histograma metricaEnvioSse("chuva_sse_envio_us", "Escrever um evento para um cliente SSE (us)", LIMITES_US);
+Contador metricaEventos("chuva_sse_eventos_total", "Eventos enviados (evento x cliente)");
+Contador metricaRecusadas("chuva_http_recusadas_total", "Requisicoes e clientes SSE recusados por falta de vaga");
+Medidor metricaConexoes("chuva_http_conexoes_abertas", "Requisicoes HTTP abertas",
+                        []() -> int32_t { return conexoesAbertas.load(); });
+Medidor metricaClientesSse("chuva_sse_clientes", "Clientes conectados no /eventos",
+                           []() -> int32_t { return clientesSse.load(); });
+Medidor metricaHeapLivre("chuva_heap_livre_bytes", "Heap livre",
+                         []() -> int32_t { return heap_caps_get_free_size(MALLOC_CAP_8BIT); });
+Medidor metricaMaiorBloco("chuva_heap_maior_bloco_bytes", "Maior bloco livre do heap",
+                          []() -> int32_t { return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); });
 
 // --- PÁGINA HTML (O Site que o ESP32 vai enviar) ---
-// Usamos a biblioteca Highcharts (gratuita para uso pessoal) para desenhar o gráfico
-const char index_html[] PROGMEM = R"rawliteral(
-<!DOCTYPE HTML><html>
-<head>
-  <meta name="viewport" content="width=device-width, initial-scale=1">
-  <title>Monitor de Chuva ESP32</title>
-  <script src="https://code.highcharts.com/highcharts.js"></script>
-  <style>
-    body { min-width: 310px; max-width: 800px; height: 400px; margin: 0 auto; font-family: Arial; text-align: center; }
-    h2 { color: #042e6f; }
-  </style>
-</head>
-<body>
-  <h2>Monitoramento de Chuva em Tempo Real</h2>
-  <div id="chart-chuva" class="container"></div>
-  <script>
-    var chartT = new Highcharts.Chart({
-      chart:{ renderTo : 'chart-chuva' },
-      title: { text: 'Nivel de Chuva' },
-      series: [{
-        name: 'Umidade',
-        data: []
-      }],
-      plotOptions: {
-        line: { animation: false, dataLabels: { enabled: true } },
-        series: { color: '#059e8a' }
-      },
-      xAxis: { type: 'datetime', dateTimeLabelFormats: { second: '%H:%M:%S' } },
-      yAxis: {
-        title: { text: 'Intensidade (0-4095)' },
-        min: 0, max: 4100
-      },
-      credits: { enabled: false }
-    });
+// A página (data/index.html) e o gráfico (data/grafico.js, no lugar do Highcharts
+// do CDN) ficam na flash já comprimidos em gzip, dentro de assets.h. Depois de
+// mudar algo em data/, rode "python3 gerar_assets.py" para gerar o assets.h de novo.
+// Cada arquivo vai com ETag: se o navegador já tem a mesma versão, recebe só um 304.
+#include "assets.h"
 
-    // Função que pede dados ao ESP32 a cada 2 segundos
-    setInterval(function ( ) {
-      var xhttp = new XMLHttpRequest();
-      xhttp.onreadystatechange = function() {
-        if (this.readyState == 4 && this.status == 200) {
-          var x = (new Date()).getTime(), // Hora atual
-              y = parseInt(this.responseText); // Valor do sensor
-          
-          // Adiciona o ponto no gráfico
-          if(chartT.series[0].data.length > 40) {
-            chartT.series[0].addPoint([x, y], true, true, true);
-          } else {
-            chartT.series[0].addPoint([x, y], true, false, true);
-          }
-        }
-      };
-      xhttp.open("GET", "/chuva", true);
-      xhttp.send();
-    }, 2000 ) ; // 2000ms = 2 segundos
-  </script>
-</body>
-</html>)rawliteral";
+// --- PROTÓTIPOS ---
+void tarefaAmostragem(void* parametro);
+bool reservarConexao(AsyncWebServerRequest* request, std::atomic<int>& abertas, int limite);
+void enviarAsset(AsyncWebServerRequest* request, const Asset& a);
+void enviarHistorico(AsyncWebServerRequest* request);
+void enviarMetricas(AsyncWebServerRequest* request);
+void abrirEventos(AsyncWebServerRequest* request);
+size_t escreverEvento(char* buffer, size_t maxLen, uint32_t seq, bool primeiro);
+void relatorioTempos();
 
 void setup() {
   Serial.begin(115200);
@@ -94,27 +141,239 @@ void setup() {
   Serial.println(WiFi.localIP());
 
   // Define as rotas do servidor
-  // 1. Quando alguém acessar a raiz (/), envia o HTML
-  server.on("/", HTTP_GET, []() {
-    server.send(200, "text/html", index_html);
+  // 1. A página (/) e o gráfico (/grafico.js), direto da flash
+  for (const Asset& a : assets) {
+    server.on(a.caminho, HTTP_GET, [&a](AsyncWebServerRequest* request) {
+      if (reservarConexao(request, conexoesAbertas, MAX_CONEXOES)) enviarAsset(request, a);
+    });
+  }
+
+  // 2. /chuva continua existindo (ex.: scripts), mas só devolve a última leitura
+  server.on("/chuva", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (!reservarConexao(request, conexoesAbertas, MAX_CONEXOES)) return;
+    char texto[8];
+    snprintf(texto, sizeof(texto), "%d", ultimoValor.load());
+    request->send(200, "text/plain", texto);
+  });
+
+  // 3. Fluxo de eventos: a conexão fica aberta e recebe cada leitura nova
+  server.on("/eventos", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (reservarConexao(request, clientesSse, MAX_CLIENTES_SSE)) abrirEventos(request);
+  });
+
+  // 4. Histórico: /history?since=<instante>&max=<n> em CSV, enviado em pedaços
+  server.on("/history", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (reservarConexao(request, conexoesAbertas, MAX_CONEXOES)) enviarHistorico(request);
   });
 
-  // 2. Quando o JavaScript pedir (/chuva), envia só o valor numérico
-  server.on("/chuva", HTTP_GET, []() {
+  // 5. Métricas no formato do Prometheus
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest* request) {
+    if (reservarConexao(request, conexoesAbertas, MAX_CONEXOES)) enviarMetricas(request);
+  });
+
+  server.begin();
+
+  // Leitura do sensor no núcleo 1; o Wi-Fi e o servidor ficam no núcleo 0/loop
+  xTaskCreatePinnedToCore(tarefaAmostragem, "amostragem", 2048, NULL, 2, NULL, 1);
+}
+
+void loop() {
+  // O servidor e os eventos andam sozinhos (tarefa async_tcp); aqui só o relatório
+  relatorioTempos();
+  delay(100);
+}
+
+// --- TAREFAS ---
+
+void tarefaAmostragem(void* parametro) {
+  TickType_t proxima = xTaskGetTickCount();
+  for (;;) {
+    uint32_t inicio = micros();
     int valor = analogRead(pinoSensor);
     int grafico = 4095 - valor; // Inverte valor
-    
+
     // Controle do LED
     if (grafico > 1000) digitalWrite(pinoLED, HIGH);
     else digitalWrite(pinoLED, LOW);
 
-    // Envia o valor para o navegador
-    server.send(200, "text/plain", String(grafico));
-  });
+    uint32_t duracao = micros() - inicio;
+    if (duracao > maxLeituraAdc.load()) maxLeituraAdc.store(duracao);
+    metricaLeituraAdc.observar(duracao);
 
-  server.begin();
+    uint32_t agora = millis();
+    uint32_t total = historicoTotal.load();
+    historico[total % TAM_HISTORICO] = { agora, (int16_t)grafico };
+    historicoTotal.store(total + 1); // Só agora a posição passa a valer para quem lê
+
+    ultimoValor.store(grafico);
+    ultimoInstante.store(agora);
+    amostraSeq.fetch_add(1); // Publica a leitura (cada cliente SSE compara com a última que recebeu)
+
+    vTaskDelayUntil(&proxima, pdMS_TO_TICKS(INTERVALO_AMOSTRA)); // Período fixo, sem deriva
+  }
 }
 
-void loop() {
-  server.handleClient(); // Mantém o servidor ouvindo os clientes
-}
\ No newline at end of file
+// --- POOL DE CONEXÕES ---
+
+// Conta a requisição como aberta (em "abertas") até o cliente desconectar; se
+// já houver "limite" abertas, responde 503 e a requisição não é atendida.
+bool reservarConexao(AsyncWebServerRequest* request, std::atomic<int>& abertas, int limite) {
+  if (abertas.fetch_add(1) >= limite) {
+    abertas.fetch_sub(1);
+    metricaRecusadas.somar();
+    request->send(503, "text/plain", "Servidor ocupado");
+    return false;
+  }
+  request->onDisconnect([&abertas]() { abertas.fetch_sub(1); });
+  return true;
+}
+
+// --- ARQUIVOS DA PÁGINA ---
+
+// Envia o arquivo como está na flash (gzip). Se o navegador mandar o mesmo ETag
+// que já tem em cache, responde 304 sem corpo.
+void enviarAsset(AsyncWebServerRequest* request, const Asset& a) {
+  AsyncWebServerResponse* resposta;
+  const AsyncWebHeader* etag = request->getHeader("If-None-Match");
+  if (etag && etag->value() == a.etag) {
+    resposta = request->beginResponse(304);
+  } else {
+    resposta = request->beginResponse_P(200, a.tipo, a.dados, a.tamanho);
+    resposta->addHeader("Content-Encoding", "gzip");
+  }
+  resposta->addHeader("ETag", a.etag);
+  resposta->addHeader("Cache-Control", a.cache);
+  request->send(resposta);
+}
+
+// --- HISTÓRICO ---
+
+// GET /history?since=<instante>&max=<n>
+// Leituras com instante > since (padrão: todas), no máximo as n mais novas
+// (padrão: TAM_HISTORICO), da mais antiga para a mais nova. Formato CSV:
+//   agora,<millis() no envio>      <- para o navegador converter para o relógio dele
+//   <instante>,<valor>
+//   ...
+// Vai em pedaços (chunked): a biblioteca chama a função abaixo sempre que a
+// conexão aceita mais bytes, e ela escreve direto no buffer do pedaço. Nada do
+// tamanho do histórico é alocado, e um cliente lento não segura os outros.
+void enviarHistorico(AsyncWebServerRequest* request) {
+  uint32_t desde = request->hasParam("since") ? strtoul(request->getParam("since")->value().c_str(), NULL, 10) : 0;
+  uint32_t maximo = request->hasParam("max") ? strtoul(request->getParam("max")->value().c_str(), NULL, 10) : TAM_HISTORICO;
+
+  // Primeira posição ainda no anel com instante > desde (o anel está em ordem de tempo)
+  uint32_t total = historicoTotal.load();
+  uint32_t fim = total;
+  uint32_t inicio = total > TAM_HISTORICO ? total - TAM_HISTORICO : 0;
+  if (fim - inicio > maximo) inicio = fim - maximo;
+  while (inicio < fim && historico[inicio % TAM_HISTORICO].instante <= desde) inicio++;
+
+  bool cabecalho = true;
+  uint32_t proximo = inicio;
+  AsyncWebServerResponse* resposta = request->beginChunkedResponse("text/csv",
+    [cabecalho, proximo, fim](uint8_t* buffer, size_t maxLen, size_t index) mutable -> size_t {
+      if (maxLen < 32) return RESPONSE_TRY_AGAIN; // Não cabe nem uma linha: espera mais espaço
+      char* p = (char*)buffer;
+      size_t n = 0;
+      if (cabecalho) {
+        n += snprintf(p, maxLen, "agora,%lu\n", (unsigned long)millis());
+        cabecalho = false;
+      }
+      while (proximo < fim && n + 24 < maxLen) {
+        Amostra a = historico[proximo % TAM_HISTORICO];
+        // A tarefa de amostragem pode ter sobrescrito esta posição enquanto
+        // copiávamos: com total - proximo == TAM_HISTORICO ela já está escrevendo
+        // a leitura total (mesma posição do anel) e ainda não incrementou o total.
+        // A barreira impede que a leitura do total abaixo seja feita antes da cópia
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (historicoTotal.load() - proximo++ >= TAM_HISTORICO) continue;
+        n += snprintf(p + n, maxLen - n, "%lu,%d\n", (unsigned long)a.instante, a.valor);
+      }
+      return n; // 0 = fim da resposta
+    });
+  request->send(resposta);
+}
+
+// --- MÉTRICAS ---
+
+// GET /metrics: todas as métricas, em pedaços (chunked) como o /history. O
+// cursor guarda onde a exportação parou entre um pedaço e outro.
+void enviarMetricas(AsyncWebServerRequest* request) {
+  CursorMetricas cursor;
+  metricasIniciar(cursor);
+  AsyncWebServerResponse* resposta = request->beginChunkedResponse("text/plain; version=0.0.4",
+    [cursor](uint8_t* buffer, size_t maxLen, size_t index) mutable -> size_t {
+      size_t n = metricasExportar(cursor, (char*)buffer, maxLen);
+      if (n == 0 && cursor.atual) return RESPONSE_TRY_AGAIN; // A próxima linha não coube
+      return n; // 0 = fim da resposta
+    });
+  request->send(resposta);
+}
+
+// --- SERVER-SENT EVENTS ---
+
+// Abre o fluxo de eventos de um cliente (ver SERVER-SENT EVENTS lá em cima).
+// "enviada" é a última leitura que este cliente recebeu; cada cliente tem a sua.
+void abrirEventos(AsyncWebServerRequest* request) {
+  uint32_t enviada = 0;
+  bool primeiro = true;
+  AsyncWebServerResponse* resposta = request->beginChunkedResponse("text/event-stream",
+    [enviada, primeiro](uint8_t* buffer, size_t maxLen, size_t index) mutable -> size_t {
+      uint32_t seq = amostraSeq.load();
+      if ((seq == enviada && !primeiro) || maxLen < 64) return RESPONSE_TRY_AGAIN; // Nada novo (ou sem espaço)
+
+      uint32_t inicio = micros();
+      size_t n = escreverEvento((char*)buffer, maxLen, seq, primeiro);
+      primeiro = false;
+      if (seq == enviada) return n; // Só o cabeçalho: ainda não houve leitura
+      enviada = seq;
+
+      uint32_t duracao = micros() - inicio;
+      if (duracao > maxEnvio.load()) maxEnvio.store(duracao);
+      somaEnvio.fetch_add(duracao);
+      eventosEnviados.fetch_add(1);
+      metricaEventos.somar();
+      metricaEnvioSse.observar(duracao);
+      return n;
+    });
+  resposta->addHeader("Cache-Control", "no-cache");
+  request->send(resposta);
+}
+
+// Escreve o evento da leitura "seq" no buffer. O primeiro pedaço de cada
+// cliente leva antes o tempo de reconexão (e a última leitura, se já houver uma)
+size_t escreverEvento(char* buffer, size_t maxLen, uint32_t seq, bool primeiro) {
+  size_t n = 0;
+  if (primeiro) n = snprintf(buffer, maxLen, "retry: %d\n\n", SSE_RECONEXAO);
+  if (seq == 0) return n; // Ainda não houve nenhuma leitura
+  n += snprintf(buffer + n, maxLen - n, "id: %lu\ndata: %d;%lu\n\n", (unsigned long)seq,
+                ultimoValor.load(), (unsigned long)ultimoInstante.load());
+  return n;
+}
+
+// A cada RELATORIO_TEMPOS imprime o custo do envio e zera para a próxima janela
+void relatorioTempos() {
+  unsigned long now = millis();
+  if (now - ultimoRelatorio < RELATORIO_TEMPOS) return;
+  ultimoRelatorio = now;
+
+  uint32_t enviados = eventosEnviados.exchange(0);
+  uint32_t soma = somaEnvio.exchange(0);
+  Serial.print("Clientes SSE: ");
+  Serial.print(clientesSse.load());
+  Serial.print("/");
+  Serial.print(MAX_CLIENTES_SSE);
+  Serial.print(" | requisicoes abertas: ");
+  Serial.print(conexoesAbertas.load());
+  Serial.print("/");
+  Serial.print(MAX_CONEXOES);
+  Serial.print(" | recusadas: ");
+  Serial.print(metricaRecusadas.ler());
+  Serial.print(" | envio max ");
+  Serial.print(maxEnvio.exchange(0));
+  Serial.print(" us | media por evento ");
+  Serial.print(enviados ? soma / enviados : 0);
+  Serial.print(" us | leitura ADC max ");
+  Serial.print(maxLeituraAdc.exchange(0));
+  Serial.println(" us");
+}